@@ -0,0 +1,166 @@
+#include "AsyncLogger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+#include "ThreadUtil.h"
+
+namespace yffplayer {
+
+// 写线程在队列为空时的等待间隔，生产者从不唤醒写线程，避免系统调用
+constexpr auto WRITER_IDLE_INTERVAL = std::chrono::milliseconds(10);
+
+AsyncLogger::AsyncLogger(std::shared_ptr<Logger> sink, size_t capacity)
+    : mSink(sink) {
+    // 容量取 2 的幂，下标用掩码计算
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    mSlots.reset(new Slot[size]);
+    mMask = size - 1;
+    for (size_t i = 0; i < size; i++) {
+        mSlots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mWriterThread = std::thread(&AsyncLogger::writerLoop, this);
+}
+
+AsyncLogger::~AsyncLogger() {
+    mRunning = false;
+    if (mWriterThread.joinable()) {
+        mWriterThread.join();
+    }
+    // 写线程退出后送出剩余的日志
+    while (drain()) {
+    }
+}
+
+std::shared_ptr<Logger> AsyncLogger::wrap(std::shared_ptr<Logger> logger) {
+    if (!logger || std::dynamic_pointer_cast<AsyncLogger>(logger)) {
+        return logger;
+    }
+
+    // 同一输出的所有播放器共用一个实例，只有一个写线程
+    static std::mutex mutex;
+    static std::map<Logger*, std::weak_ptr<AsyncLogger>> instances;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = instances.begin(); it != instances.end();) {
+        if (it->second.expired()) {
+            it = instances.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    std::shared_ptr<AsyncLogger> instance = instances[logger.get()].lock();
+    if (!instance) {
+        instance = std::make_shared<AsyncLogger>(logger);
+        instances[logger.get()] = instance;
+    }
+    return instance;
+}
+
+bool AsyncLogger::isEnabled(LogLevel level) const {
+    return Logger::isEnabled(level) && (!mSink || mSink->isEnabled(level));
+}
+
+void AsyncLogger::log(LogLevel level, const std::string& tag,
+                      const std::string& message) {
+    push(level, tag.c_str(), message.data(), message.size());
+}
+
+void AsyncLogger::write(LogLevel level, const char* tag, const char* message,
+                        size_t length) {
+    push(level, tag, message, length);
+}
+
+bool AsyncLogger::push(LogLevel level, const char* tag, const char* message,
+                       size_t length) {
+    if (!isEnabled(level)) {
+        return false;
+    }
+
+    // 有界 MPSC 队列：每个槽的序号表示它可写（== 位置）还是可读（== 位置+1）
+    uint64_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    while (true) {
+        slot = &mSlots[pos & mMask];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence - pos);
+        if (diff == 0) {
+            if (mEnqueuePos.compare_exchange_weak(pos, pos + 1,
+                                                  std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // 队列已满，丢弃而不是等待
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = mEnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    size_t tagLength = std::min(strlen(tag), kTagMax - 1);
+    memcpy(slot->tag, tag, tagLength);
+    slot->tag[tagLength] = '\0';
+    length = std::min(length, kLogMessageMax);
+    memcpy(slot->message, message, length);
+    slot->length = static_cast<uint16_t>(length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLogger::drain() {
+    bool delivered = false;
+    uint64_t pos = mDequeuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Slot& slot = mSlots[pos & mMask];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+            break;
+        }
+        if (mSink) {
+            mSink->log(slot.level, slot.tag,
+                       std::string(slot.message, slot.length));
+        }
+        slot.sequence.store(pos + mMask + 1, std::memory_order_release);
+        pos++;
+        mDequeuePos.store(pos, std::memory_order_release);
+        delivered = true;
+    }
+
+    int64_t dropped = mDropped.load(std::memory_order_relaxed);
+    if (dropped != mDroppedReported && mSink) {
+        mSink->log(LogLevel::Warning, "AsyncLogger",
+                   "日志队列已满，丢弃 " +
+                       std::to_string(dropped - mDroppedReported) + " 条日志");
+        mDroppedReported = dropped;
+    }
+    return delivered;
+}
+
+void AsyncLogger::writerLoop() {
+    setCurrentThreadName("yff-logger");
+    while (mRunning) {
+        if (!drain()) {
+            std::this_thread::sleep_for(WRITER_IDLE_INTERVAL);
+        }
+    }
+}
+
+void AsyncLogger::flush() {
+    uint64_t target = mEnqueuePos.load(std::memory_order_acquire);
+    while (mRunning &&
+           mDequeuePos.load(std::memory_order_acquire) < target) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+int64_t AsyncLogger::getDroppedCount() const {
+    return mDropped.load(std::memory_order_relaxed);
+}
+
+}  // namespace yffplayer
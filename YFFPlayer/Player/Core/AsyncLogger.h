@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "Logger.h"
+
+namespace yffplayer {
+
+// Logger front end that never blocks the caller. Messages are copied into
+// a fixed ring of slots (bounded lock-free MPSC queue) and handed to the
+// wrapped logger by a background writer thread. When the ring is full the
+// message is dropped and counted; the writer reports drops to the sink.
+//
+// Each instance owns a writer thread and capacity * ~560 bytes, so many
+// players should share one instance; wrap() does that per sink.
+class AsyncLogger : public Logger {
+   public:
+    explicit AsyncLogger(std::shared_ptr<Logger> sink, size_t capacity = 256);
+    ~AsyncLogger() override;
+
+    // Returns logger itself if it already is an AsyncLogger, otherwise
+    // the process-wide AsyncLogger of that sink, created on first use and
+    // released with its last user
+    static std::shared_ptr<Logger> wrap(std::shared_ptr<Logger> logger);
+
+    // Also filtered by the sink's level, so setMinLevel() on the sink
+    // still skips formatting
+    bool isEnabled(LogLevel level) const override;
+
+    void log(LogLevel level, const std::string& tag,
+             const std::string& message) override;
+    void write(LogLevel level, const char* tag, const char* message,
+               size_t length) override;
+
+    // Block until everything queued so far reached the sink
+    void flush();
+
+    int64_t getDroppedCount() const;
+
+   private:
+    static constexpr size_t kTagMax = 24;
+
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        LogLevel level{LogLevel::Info};
+        uint16_t length{0};
+        char tag[kTagMax];
+        char message[kLogMessageMax];
+    };
+
+    std::shared_ptr<Logger> mSink;
+    std::unique_ptr<Slot[]> mSlots;
+    size_t mMask;
+
+    alignas(64) std::atomic<uint64_t> mEnqueuePos{0};
+    alignas(64) std::atomic<uint64_t> mDequeuePos{0};
+    std::atomic<int64_t> mDropped{0};
+    int64_t mDroppedReported{0};
+
+    std::atomic<bool> mRunning{true};
+    std::thread mWriterThread;
+
+    bool push(LogLevel level, const char* tag, const char* message,
+              size_t length);
+    // Deliver queued messages to the sink, returns false if none
+    bool drain();
+    void writerLoop();
+};
+
+}  // namespace yffplayer
@@ -1,7 +1,8 @@
 #include "AudioDecoder.h"
 
-#include <chrono>
-#include <thread>
+#include <algorithm>
+
+#include "Tracer.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -27,28 +28,33 @@ bool AudioDecoder::open(AVCodecParameters* codecParam) {
     // 查找解码器
     const AVCodec* decoder = avcodec_find_decoder(codecParam->codec_id);
     if (!decoder) {
-        mLogger->log(LogLevel::Error, "AudioDecoder",
-                     "找不到解码器: " + std::to_string(codecParam->codec_id));
+        YFF_LOG(mLogger, LogLevel::Error, "AudioDecoder", "找不到解码器: %d",
+                static_cast<int>(codecParam->codec_id));
         return false;
     }
 
     // 创建解码上下文
     mCodecContext = avcodec_alloc_context3(decoder);
     if (!mCodecContext) {
-        mLogger->log(LogLevel::Error, "AudioDecoder", "无法创建解码上下文");
+        YFF_LOG(mLogger, LogLevel::Error, "AudioDecoder", "无法创建解码上下文");
         return false;
     }
 
     if (avcodec_parameters_to_context((AVCodecContext*)mCodecContext,
                                       codecParam) < 0) {
-        mLogger->log(LogLevel::Error, "AudioDecoder", "无法设置解码器参数");
+        YFF_LOG(mLogger, LogLevel::Error, "AudioDecoder", "无法设置解码器参数");
         avcodec_free_context((AVCodecContext**)&mCodecContext);
         return false;
     }
 
+    // 解复用器输出的数据包时间戳统一为微秒
+    ((AVCodecContext*)mCodecContext)->pkt_timebase = AV_TIME_BASE_Q;
+    if (mLowDelay) {
+        ((AVCodecContext*)mCodecContext)->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    }
     // 打开解码器
     if (avcodec_open2((AVCodecContext*)mCodecContext, decoder, nullptr) < 0) {
-        mLogger->log(LogLevel::Error, "AudioDecoder", "无法打开解码器");
+        YFF_LOG(mLogger, LogLevel::Error, "AudioDecoder", "无法打开解码器");
         avcodec_free_context((AVCodecContext**)&mCodecContext);
         return false;
     }
@@ -56,13 +62,13 @@ bool AudioDecoder::open(AVCodecParameters* codecParam) {
     // 创建重采样上下文
     mSwrContext = swr_alloc();
     if (!mSwrContext) {
-        mLogger->log(LogLevel::Error, "AudioDecoder", "无法创建重采样上下文");
-        avcodec_close((AVCodecContext*)mCodecContext);
+        YFF_LOG(mLogger, LogLevel::Error, "AudioDecoder",
+                "无法创建重采样上下文");
         avcodec_free_context((AVCodecContext**)&mCodecContext);
         return false;
     }
 
-    mLogger->log(LogLevel::Info, "AudioDecoder", "音频解码器初始化成功");
+    YFF_LOG(mLogger, LogLevel::Info, "AudioDecoder", "音频解码器初始化成功");
     return true;
 }
 
@@ -72,8 +78,21 @@ void AudioDecoder::start() {
     }
 
     mIsRunning = true;
-    mDecodeThread = std::thread(&AudioDecoder::decodeLoop, this);
-    mLogger->log(LogLevel::Info, "AudioDecoder", "音频解码线程已启动");
+    mFrame = av_frame_alloc();
+    mDecodeLoop = decodeLoop();
+    // 跳转后放弃等待，旧代号的帧不再送出
+    mDecodeLoop.setInterrupt(
+        [this]() { return currentGeneration() != mDecodeGeneration; });
+    if (mRunner.hasTaskGroup()) {
+        // 在执行器上运行时由队列唤醒：有新数据包，或帧队列腾出空间
+        mPacketBuffer->setPushListener([this]() { mRunner.wake(); });
+        mFrameBuffer->setPopListener([this]() { mRunner.wake(); });
+    }
+    // 重采样在同一阶段内完成，一并计入音频解码
+    mRunner.start(
+        "yff-adec", [this]() { return mDecodeLoop.step(); }, mStats,
+        PipelineStats::Stage::AUDIO_DECODE);
+    YFF_LOG(mLogger, LogLevel::Info, "AudioDecoder", "音频解码线程已启动");
 }
 
 void AudioDecoder::stop() {
@@ -82,10 +101,12 @@ void AudioDecoder::stop() {
     }
 
     mIsRunning = false;
-    if (mDecodeThread.joinable()) {
-        mDecodeThread.join();
-    }
-    mLogger->log(LogLevel::Info, "AudioDecoder", "音频解码线程已停止");
+    mRunner.stop();
+    mDecodeLoop = CoStage();
+    mPacketBuffer->setPushListener(nullptr);
+    mFrameBuffer->setPopListener(nullptr);
+    av_frame_free(&mFrame);
+    YFF_LOG(mLogger, LogLevel::Info, "AudioDecoder", "音频解码线程已停止");
 }
 
 void AudioDecoder::close() {
@@ -97,14 +118,15 @@ void AudioDecoder::close() {
     }
 
     if (mCodecContext) {
-        avcodec_close((AVCodecContext*)mCodecContext);
         avcodec_free_context((AVCodecContext**)&mCodecContext);
         mCodecContext = nullptr;
     }
 
-    mLogger->log(LogLevel::Info, "AudioDecoder", "音频解码器已关闭");
+    YFF_LOG(mLogger, LogLevel::Info, "AudioDecoder", "音频解码器已关闭");
 }
 
+void AudioDecoder::setSpeed(float speed) { mSpeed = speed; }
+
 int64_t AudioDecoder::timestampToMicroseconds(int64_t timestamp,
                                               int timebase_num,
                                               int timebase_den) {
@@ -123,7 +145,7 @@ std::shared_ptr<AudioFrame> AudioDecoder::convertAudioFrame(AVFrame* frame) {
     
     // 转换时间戳为微秒
     audioFrame->pts = timestampToMicroseconds(
-        frame->pts, ctx->time_base.num, ctx->time_base.den);
+        frame->pts, ctx->pkt_timebase.num, ctx->pkt_timebase.den);
     
     // 计算持续时间（微秒）
     audioFrame->duration = 1000000 * frame->nb_samples / frame->sample_rate;
@@ -143,13 +165,26 @@ std::shared_ptr<AudioFrame> AudioDecoder::convertAudioFrame(AVFrame* frame) {
     
     // 初始化重采样上下文
     if (swr_init(swr) < 0) {
-        mLogger->log(LogLevel::Error, "AudioDecoder", "重采样上下文初始化失败");
+        YFF_LOG(mLogger, LogLevel::Error, "AudioDecoder",
+                "重采样上下文初始化失败");
         return nullptr;
     }
     
     // 分配重采样后的数据缓冲区
     int64_t dstSamples = av_rescale_rnd(frame->nb_samples, kAudioTargetSampleRate,
                             frame->sample_rate, AV_ROUND_UP);
+
+    // 变速：通过重采样补偿增减输出样本数，播放时长随之缩放。补偿在
+    // 变速后的输出样本数内完成，0.5倍等大幅变速时步长才准确
+    float speed = mSpeed;
+    if (speed != 1.0f && dstSamples > 0) {
+        int compensation = (int)(dstSamples / speed) - (int)dstSamples;
+        if (compensation != 0 &&
+            swr_set_compensation(swr, compensation,
+                                 (int)dstSamples + compensation) >= 0) {
+            dstSamples += std::max(compensation, 0);
+        }
+    }
     int dstBufferSize = av_samples_get_buffer_size(
         nullptr, kAudioTargetChannels, (int)dstSamples,
         AV_SAMPLE_FMT_S16, 0);
@@ -159,7 +194,7 @@ std::shared_ptr<AudioFrame> AudioDecoder::convertAudioFrame(AVFrame* frame) {
     int ret = swr_convert(swr, &dstData, (int)dstSamples,
                       (const uint8_t**)frame->data, frame->nb_samples);
     if (ret < 0) {
-        mLogger->log(LogLevel::Error, "AudioDecoder", "音频重采样失败");
+        YFF_LOG(mLogger, LogLevel::Error, "AudioDecoder", "音频重采样失败");
         av_free(dstData);
         return nullptr;
     }
@@ -174,66 +209,137 @@ std::shared_ptr<AudioFrame> AudioDecoder::convertAudioFrame(AVFrame* frame) {
     return audioFrame;
 }
 
-void AudioDecoder::decodeLoop() {
-    AVCodecContext* ctx = (AVCodecContext*)mCodecContext;
-    AVPacket* avPacket = nullptr;
-    AVFrame* avFrame = av_frame_alloc();
+void AudioDecoder::flushCodec() {
+    if (mCodecContext) {
+        avcodec_flush_buffers(mCodecContext);
+    }
+}
 
-    while (mIsRunning) {
+CoStage AudioDecoder::decodeLoop() {
+    AVCodecContext* ctx = mCodecContext;
+
+    while (true) {
+        bool failed = false;
         try {
-            // 首先检查输出帧缓冲区是否已满
-            if (mFrameBuffer->full()) {
-                // 如果缓冲区已满，睡眠一段时间后继续
-                //                mLogger->log(LogLevel::Warning,
-                //                "AudioDecoder",
-                //                                "缓冲区已满，等待数据处理");
-                av_usleep(10000);  // 10毫秒 = 10000微秒
+            // 跳转后即使没有新数据包也先清空解码器
+            syncGeneration(currentGeneration());
+
+            // 从缓冲区获取数据包，缓冲区为空时挂起等待新的数据包
+            std::optional<AVPacket*> popped = co_await queuePop(
+                *mPacketBuffer, mStats, PipelineStats::Queue::AUDIO_PACKETS);
+            AVPacket* packet = popped.value_or(nullptr);
+            if (!packet) {
                 continue;
             }
 
-            // 尝试从缓冲区获取数据包
-            if (!mPacketBuffer->tryPop(avPacket) || !avPacket) {
-                // 如果缓冲区为空，睡眠一段时间后继续
-                av_usleep(10000);  // 10毫秒 = 10000微秒
+            // 丢弃跳转前读出的数据包；新代号的第一个数据包前清空解码器
+            uint32_t generation = packetGeneration(packet);
+            if (generation != currentGeneration()) {
+                if (mStats) {
+                    mStats->addStale(PipelineStats::Queue::AUDIO_PACKETS);
+                }
+                av_packet_free(&packet);
                 continue;
             }
+            syncGeneration(generation);
 
-            // 发送数据包到解码器
-            int ret = avcodec_send_packet(ctx, avPacket);
+            traceInstant(TraceEvent::DEQUEUE, packet->pts);
+
+            // 发送数据包到解码器，发送后即释放数据包
+            // 解码耗时包括发送数据包和接收该包产生的所有帧
+            int ret = 0;
+            int64_t decodeStartTime = av_gettime_relative();
+            {
+                TraceSpan span(TraceEvent::SEND_PACKET, packet->pts);
+                ret = avcodec_send_packet(ctx, packet);
+            }
+            int64_t decodeUs = av_gettime_relative() - decodeStartTime;
+            av_packet_free(&packet);
             if (ret < 0) {
-                mLogger->log(LogLevel::Error, "AudioDecoder",
-                             "发送数据包到解码器失败");
+                YFF_LOG(mLogger, LogLevel::Error, "AudioDecoder",
+                        "发送数据包到解码器失败");
+                co_await stageYield();
                 continue;
             }
 
             // 接收解码后的帧
-            while (ret >= 0 && !mFrameBuffer->full()) {
-                ret = avcodec_receive_frame(ctx, avFrame);
+            while (ret >= 0) {
+                int64_t receiveStartTime = av_gettime_relative();
+                {
+                    TraceSpan span(TraceEvent::RECEIVE_FRAME);
+                    ret = avcodec_receive_frame(ctx, mFrame);
+                    if (ret >= 0) {
+                        span.setId(mFrame->pts);
+                    }
+                }
+                decodeUs += av_gettime_relative() - receiveStartTime;
                 if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
                     break;
                 } else if (ret < 0) {
-                    mLogger->log(LogLevel::Error, "AudioDecoder",
-                                 "从解码器接收帧失败");
+                    YFF_LOG(mLogger, LogLevel::Error, "AudioDecoder",
+                            "从解码器接收帧失败");
                     break;
                 }
 
-                std::shared_ptr<AudioFrame> audioFrame = convertAudioFrame(avFrame);
-                av_frame_unref(avFrame);
-                if (audioFrame) {
-                    if (!mFrameBuffer->tryPush(audioFrame)) {
-                        av_free(audioFrame->data);
+                // 精确跳转：目标位置之前的帧不转换
+                if (mFrame->pts != AV_NOPTS_VALUE && mFrame->sample_rate > 0 &&
+                    isBeforeStart(mFrame->pts, 1000000LL * mFrame->nb_samples /
+                                                   mFrame->sample_rate)) {
+                    av_frame_unref(mFrame);
+                    continue;
+                }
+
+                std::shared_ptr<AudioFrame> audioFrame;
+                int64_t convertStartTime = av_gettime_relative();
+                {
+                    TraceSpan span(TraceEvent::CONVERT, mFrame->pts);
+                    audioFrame = convertAudioFrame(mFrame);
+                }
+                if (mStats) {
+                    mStats->recordStage(
+                        PipelineStats::Stage::AUDIO_CONVERT,
+                        av_gettime_relative() - convertStartTime);
+                }
+                av_frame_unref(mFrame);
+                if (!audioFrame) {
+                    continue;
+                }
+                audioFrame->generation = mDecodeGeneration;
+
+                // 将帧放入缓冲区，缓冲区已满时挂起等待帧被取走；
+                // 等待中停止解码时协程被销毁，由释放函数回收样本数据
+                int64_t pts = audioFrame->pts;
+                if (co_await queuePush(
+                        *mFrameBuffer, audioFrame, mStats,
+                        PipelineStats::Queue::AUDIO_FRAMES,
+                        [](std::shared_ptr<AudioFrame>& frame) {
+                            av_free(frame->data);
+                        })) {
+                    traceInstant(TraceEvent::ENQUEUE, pts);
+                } else {
+                    // 等待被跳转中断，帧已过期
+                    if (mStats) {
+                        mStats->addStale(PipelineStats::Queue::AUDIO_FRAMES);
                     }
+                    av_free(audioFrame->data);
                 }
             }
+            if (mStats) {
+                mStats->recordStage(PipelineStats::Stage::AUDIO_DECODE,
+                                    decodeUs);
+            }
         } catch (const std::exception& e) {
-            mLogger->log(LogLevel::Error, "AudioDecoder",
-                         std::string("解码循环异常: ") + e.what());
-            av_usleep(10000);  // 10毫秒 = 10000微秒
+            YFF_LOG(mLogger, LogLevel::Error, "AudioDecoder",
+                    "解码循环异常: %s", e.what());
+            failed = true;
         }
-    }
 
-    av_frame_free(&avFrame);
-    av_packet_free(&avPacket);
+        if (failed) {
+            co_await stageSleep(10000);  // 10毫秒 = 10000微秒
+        } else {
+            co_await stageYield();
+        }
+    }
 }
 
 }  // namespace yffplayer
@@ -26,7 +26,13 @@ class AudioDecoder : public Decoder {
     void stop() override;
     void close() override;
 
+    // Playback speed applied by resampling, pitch shifts with it
+    void setSpeed(float speed);
+
    private:
+    // Microbenchmarks call the conversion functions directly
+    friend struct DecoderBenchAccess;
+
     std::shared_ptr<BufferQueue<AVPacket*>> mPacketBuffer;
     std::shared_ptr<BufferQueue<std::shared_ptr<AudioFrame>>> mFrameBuffer;
 
@@ -36,6 +42,8 @@ class AudioDecoder : public Decoder {
     // Decoding context
     AVCodecContext* mCodecContext{nullptr};
 
+    std::atomic<float> mSpeed{1.0f};
+
     // Convert timestamp to microseconds
     int64_t timestampToMicroseconds(int64_t timestamp, int timebase_num,
                                     int timebase_den);
@@ -47,7 +55,11 @@ class AudioDecoder : public Decoder {
     // Covert audio
     std::shared_ptr<AudioFrame> convertAudioFrame(AVFrame* frame);
 
-    void decodeLoop() override;
+    // Receives every decoded frame
+    AVFrame* mFrame{nullptr};
+
+    CoStage decodeLoop() override;
+    void flushCodec() override;
 };
 
 }  // namespace yffplayer
@@ -11,5 +11,6 @@ struct AudioFrame {
     int channels;      // Number of channels
     int sampleRate;    // Sample rate
     int bitDepth;      // Bit depth
+    uint32_t generation;  // Seek generation, see SeekGeneration.h
 };
 }  // namespace yffplayer
@@ -9,6 +9,19 @@ extern "C" {
 
 namespace yffplayer {
 
+// 队列元素的时长（微秒），数据包时间戳已由解复用器转换为微秒
+static int64_t itemDuration(AVPacket* const& packet) {
+    return packet && packet->duration > 0 ? packet->duration : 0;
+}
+
+static int64_t itemDuration(const std::shared_ptr<AudioFrame>& frame) {
+    return frame ? frame->duration : 0;
+}
+
+static int64_t itemDuration(const std::shared_ptr<VideoFrame>& frame) {
+    return frame ? frame->duration : 0;
+}
+
 template <typename T>
 BufferQueue<T>::BufferQueue(size_t maxSize) : mMaxSize(maxSize) {
     if (maxSize == 0) {
@@ -22,6 +35,8 @@ void BufferQueue<T>::push(const T& item) {
     mNotFull.wait(lock, [this]() { return mQueue.size() < mMaxSize; });
 
     mQueue.push(item);
+    mDuration += itemDuration(item);
+    notifyPushed();
     lock.unlock();
     mNotEmpty.notify_one();
 }
@@ -33,6 +48,8 @@ T BufferQueue<T>::pop() {
 
     T item = mQueue.front();
     mQueue.pop();
+    mDuration -= itemDuration(item);
+    notifyPopped();
     lock.unlock();
     mNotFull.notify_one();
     return item;
@@ -40,12 +57,15 @@ T BufferQueue<T>::pop() {
 
 template <typename T>
 bool BufferQueue<T>::tryPush(const T& item) {
-    std::unique_lock<std::mutex> lock(mMutex, std::try_to_lock);
-    if (!lock.owns_lock() || mQueue.size() >= mMaxSize) {
+    // 只在队列满时失败，锁只在入队出队期间短暂持有，直接等待
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mQueue.size() >= mMaxSize) {
         return false;
     }
 
     mQueue.push(item);
+    mDuration += itemDuration(item);
+    notifyPushed();
     lock.unlock();
     mNotEmpty.notify_one();
     return true;
@@ -53,13 +73,16 @@ bool BufferQueue<T>::tryPush(const T& item) {
 
 template <typename T>
 bool BufferQueue<T>::tryPop(T& item) {
-    std::unique_lock<std::mutex> lock(mMutex, std::try_to_lock);
-    if (!lock.owns_lock() || mQueue.empty()) {
+    // 只在队列空时失败，锁竞争不会被误报为空
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mQueue.empty()) {
         return false;
     }
 
     item = mQueue.front();
     mQueue.pop();
+    mDuration -= itemDuration(item);
+    notifyPopped();
     lock.unlock();
     mNotFull.notify_one();
     return true;
@@ -83,16 +106,68 @@ bool BufferQueue<T>::full() const {
     return mQueue.size() >= mMaxSize;
 }
 
+template <typename T>
+size_t BufferQueue<T>::maxSize() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMaxSize;
+}
+
+template <typename T>
+void BufferQueue<T>::setMaxSize(size_t maxSize) {
+    if (maxSize == 0) {
+        throw std::invalid_argument("Queue size must be greater than 0");
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMaxSize = maxSize;
+    notifyPopped();
+    mNotFull.notify_all();
+}
+
 template <typename T>
 void BufferQueue<T>::clear() {
     std::lock_guard<std::mutex> lock(mMutex);
     while (!mQueue.empty()) {
         mQueue.pop();
     }
+    mDuration = 0;
+    notifyPopped();
     mNotEmpty.notify_all();
     mNotFull.notify_all();
 }
 
+template <typename T>
+int64_t BufferQueue<T>::duration() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mDuration;
+}
+
+template <typename T>
+void BufferQueue<T>::setPushListener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPushListener = std::move(listener);
+}
+
+template <typename T>
+void BufferQueue<T>::setPopListener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPopListener = std::move(listener);
+}
+
+template <typename T>
+void BufferQueue<T>::notifyPushed() {
+    if (mPushListener) {
+        mPushListener();
+    }
+}
+
+template <typename T>
+void BufferQueue<T>::notifyPopped() {
+    // 降到一半以下才唤醒生产者，避免每取出一个元素就调度一次
+    if (mPopListener && mQueue.size() <= mMaxSize / 2) {
+        mPopListener();
+    }
+}
+
 template class BufferQueue<std::shared_ptr<AudioFrame>>;
 // 视频帧
 template class BufferQueue<std::shared_ptr<VideoFrame>>;
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <mutex>
 #include <queue>
 #include <stdexcept>
@@ -14,17 +16,40 @@ class BufferQueue {
     std::condition_variable mNotEmpty;
     std::condition_variable mNotFull;
     size_t mMaxSize;
+    int64_t mDuration{0};
+    std::function<void()> mPushListener;
+    std::function<void()> mPopListener;
+
+    void notifyPushed();
+    void notifyPopped();
 
    public:
     explicit BufferQueue(size_t maxSize = 100);
 
     void push(const T& item);
     T pop();
+    // Never wait for space or items: fail only when the queue is full or
+    // empty, not when another thread holds the lock
     bool tryPush(const T& item);
     bool tryPop(T& item);
     size_t size() const;
     bool empty() const;
     bool full() const;
+    size_t maxSize() const;
     void clear();
+
+    // Change the capacity, items above it stay queued until popped
+    void setMaxSize(size_t maxSize);
+
+    // Total duration of the queued items in microseconds
+    int64_t duration() const;
+
+    // Readiness callbacks for stages running on an executor: the push
+    // listener (the consumer) runs after every push, the pop listener (the
+    // producer) after a pop leaves the queue at most half full. They run
+    // under the queue lock, so after clearing one it is no longer called;
+    // they must not use the queue.
+    void setPushListener(std::function<void()> listener);
+    void setPopListener(std::function<void()> listener);
 };
 }  // namespace yffplayer
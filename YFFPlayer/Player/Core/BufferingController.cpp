@@ -0,0 +1,175 @@
+#include "BufferingController.h"
+
+#include <algorithm>
+
+namespace yffplayer {
+
+// 吞吐量平滑系数
+constexpr double THROUGHPUT_SMOOTHING = 0.3;
+
+BufferingController::BufferingController(const BufferingConfig& config)
+    : mConfig(config),
+      mLowWatermarkUs(config.lowWatermarkUs),
+      mHighWatermarkUs(config.highWatermarkUs) {}
+
+void BufferingController::setConfig(const BufferingConfig& config) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mConfig = config;
+    updateWatermarks();
+}
+
+BufferingConfig BufferingController::getConfig() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mConfig;
+}
+
+void BufferingController::reset() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mInputSpeed = 0.0;
+    mFilled = false;
+    mPlaying = false;
+    mBuffering = false;
+    mIsRebuffer = false;
+    mRebufferCount = 0;
+    mRebufferDurationUs = 0;
+    mPlaybackDurationUs = 0;
+    updateWatermarks();
+}
+
+void BufferingController::updateThroughput(int64_t mediaTimeUs,
+                                           int64_t readTimeUs) {
+    if (mediaTimeUs <= 0 || readTimeUs <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    double speed = static_cast<double>(mediaTimeUs) / readTimeUs;
+    if (mInputSpeed <= 0.0) {
+        mInputSpeed = speed;
+    } else {
+        mInputSpeed = mInputSpeed * (1.0 - THROUGHPUT_SMOOTHING) +
+                      speed * THROUGHPUT_SMOOTHING;
+    }
+    updateWatermarks();
+}
+
+void BufferingController::updateWatermarks() {
+    mLowWatermarkUs = mConfig.lowWatermarkUs;
+    mHighWatermarkUs = mConfig.highWatermarkUs;
+
+    // 输入慢于实时播放时，按比例放大水位，减少卡顿次数
+    if (mConfig.adaptive && mInputSpeed > 0.0 && mInputSpeed < 1.0) {
+        double scale = 1.0 / mInputSpeed;
+        mHighWatermarkUs =
+            std::min(static_cast<int64_t>(mConfig.highWatermarkUs * scale),
+                     mConfig.maxHighWatermarkUs);
+        mLowWatermarkUs =
+            std::min(static_cast<int64_t>(mConfig.lowWatermarkUs * scale),
+                     mHighWatermarkUs / 2);
+    }
+}
+
+bool BufferingController::shouldStartBuffering(int64_t bufferedUs,
+                                               bool inputEnded) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (bufferedUs >= mHighWatermarkUs) {
+        mFilled = true;
+    }
+    if (inputEnded) {
+        return false;
+    }
+    // 预缓冲远低于低水位，缓冲区首次达到高水位之前只在耗尽时进入缓冲，
+    // 否则起播后立即卡顿
+    if (!mFilled) {
+        return bufferedUs <= 0;
+    }
+    return bufferedUs < mLowWatermarkUs;
+}
+
+bool BufferingController::shouldStopBuffering(int64_t bufferedUs,
+                                              bool inputEnded) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (bufferedUs >= mHighWatermarkUs) {
+        mFilled = true;
+    }
+    return inputEnded || bufferedUs >= mHighWatermarkUs;
+}
+
+void BufferingController::onPlaybackStarted(int64_t nowUs) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mPlaying) {
+        mPlaying = true;
+        mPlayingSinceUs = nowUs;
+    }
+}
+
+void BufferingController::onPlaybackStopped(int64_t nowUs) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mBuffering) {
+        if (mIsRebuffer) {
+            mRebufferDurationUs += nowUs - mBufferingSinceUs;
+        }
+        mBuffering = false;
+    } else if (mPlaying) {
+        mPlaybackDurationUs += nowUs - mPlayingSinceUs;
+    }
+    mPlaying = false;
+}
+
+void BufferingController::onBufferingStarted(int64_t nowUs, bool isRebuffer) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mBuffering) {
+        return;
+    }
+    if (mPlaying) {
+        mPlaybackDurationUs += nowUs - mPlayingSinceUs;
+    }
+    mBuffering = true;
+    mIsRebuffer = isRebuffer;
+    mBufferingSinceUs = nowUs;
+    if (isRebuffer) {
+        mRebufferCount++;
+    }
+}
+
+void BufferingController::onBufferingEnded(int64_t nowUs) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mBuffering) {
+        return;
+    }
+    if (mIsRebuffer) {
+        mRebufferDurationUs += nowUs - mBufferingSinceUs;
+    }
+    mBuffering = false;
+    mPlaying = true;
+    mPlayingSinceUs = nowUs;
+}
+
+RebufferStats BufferingController::getStats(int64_t nowUs) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    RebufferStats stats;
+    stats.rebufferCount = mRebufferCount;
+    stats.rebufferDurationUs = mRebufferDurationUs;
+    stats.playbackDurationUs = mPlaybackDurationUs;
+
+    // 计入尚未结束的区间
+    if (mBuffering) {
+        if (mIsRebuffer) {
+            stats.rebufferDurationUs += nowUs - mBufferingSinceUs;
+        }
+    } else if (mPlaying) {
+        stats.playbackDurationUs += nowUs - mPlayingSinceUs;
+    }
+
+    int64_t total = stats.rebufferDurationUs + stats.playbackDurationUs;
+    if (total > 0) {
+        stats.rebufferRatio =
+            static_cast<double>(stats.rebufferDurationUs) / total;
+    }
+    stats.inputSpeed = mInputSpeed;
+    stats.lowWatermarkUs = mLowWatermarkUs;
+    stats.highWatermarkUs = mHighWatermarkUs;
+    return stats;
+}
+
+}  // namespace yffplayer
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include "PlayerTypes.h"
+
+namespace yffplayer {
+
+// Decides when playback stalls to rebuffer and keeps rebuffer statistics.
+// Watermarks apply to the buffered media duration; with adaptive
+// watermarks they grow when the input delivers media slower than realtime.
+// The low watermark only applies once the buffer has reached the high
+// watermark after reset(): playback starts after a preroll much shorter
+// than the low watermark, and until then only an empty buffer stalls.
+class BufferingController {
+   public:
+    explicit BufferingController(
+        const BufferingConfig& config = BufferingConfig());
+
+    void setConfig(const BufferingConfig& config);
+    BufferingConfig getConfig() const;
+
+    // Clear statistics and throughput history
+    void reset();
+
+    // Feed a throughput sample: media time read during readTimeUs
+    void updateThroughput(int64_t mediaTimeUs, int64_t readTimeUs);
+
+    // Watermark checks, both note when bufferedUs reaches the high
+    // watermark
+    bool shouldStartBuffering(int64_t bufferedUs, bool inputEnded);
+    bool shouldStopBuffering(int64_t bufferedUs, bool inputEnded);
+
+    // Playback and buffering transitions, timestamps in microseconds
+    void onPlaybackStarted(int64_t nowUs);
+    void onPlaybackStopped(int64_t nowUs);
+    void onBufferingStarted(int64_t nowUs, bool isRebuffer);
+    void onBufferingEnded(int64_t nowUs);
+
+    RebufferStats getStats(int64_t nowUs) const;
+
+   private:
+    mutable std::mutex mMutex;
+    BufferingConfig mConfig;
+
+    // Current watermarks, adapted from mConfig
+    int64_t mLowWatermarkUs;
+    int64_t mHighWatermarkUs;
+
+    // Smoothed media time read per time spent reading
+    double mInputSpeed{0.0};
+
+    // The buffer has reached the high watermark since reset()
+    bool mFilled{false};
+
+    bool mPlaying{false};
+    bool mBuffering{false};
+    bool mIsRebuffer{false};
+    int64_t mPlayingSinceUs{0};
+    int64_t mBufferingSinceUs{0};
+
+    int mRebufferCount{0};
+    int64_t mRebufferDurationUs{0};
+    int64_t mPlaybackDurationUs{0};
+
+    void updateWatermarks();
+};
+
+}  // namespace yffplayer
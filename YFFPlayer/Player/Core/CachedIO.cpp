@@ -0,0 +1,475 @@
+#include "CachedIO.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/error.h>
+}
+
+namespace yffplayer {
+
+// 单次网络读取的上限，避免一次请求阻塞过久
+constexpr int FETCH_CHUNK_SIZE = 256 * 1024;
+
+// HEAD 响应头的长度上限，超出的部分不再解析
+constexpr int MAX_HEADER_BYTES = 16 * 1024;
+
+CachedIO::CachedIO(const std::string& directory, int64_t sizeLimit,
+                   std::shared_ptr<Logger> logger)
+    : mLogger(logger), mDirectory(directory), mSizeLimit(sizeLimit) {}
+
+CachedIO::~CachedIO() { close(); }
+
+bool CachedIO::isNetworkUrl(const std::string& url) {
+    return url.compare(0, 7, "http://") == 0 ||
+           url.compare(0, 8, "https://") == 0;
+}
+
+bool CachedIO::open(const std::string& url, const AVIOInterruptCB& interrupt) {
+    mInterrupt = interrupt;
+    mUrl = url;
+
+    // 网络读取都在解复用线程上进行，直接使用调用方的中断回调
+    int ret = avio_open2(&mSource, url.c_str(), AVIO_FLAG_READ, &mInterrupt,
+                         nullptr);
+    if (ret < 0) {
+        YFF_LOG(mLogger, LogLevel::Error, "CachedIO",
+                "无法打开输入: %s, 错误: %d", url.c_str(), ret);
+        return false;
+    }
+
+    mSeekable = (mSource->seekable & AVIO_SEEKABLE_NORMAL) != 0;
+    mSize = avio_size(mSource);
+
+    // 长度未知或不可跳转的输入（如直播）直接透传，不做缓存
+    mCaching = mSeekable && mSize > 0 && openCacheEntry();
+    if (!mCaching) {
+        YFF_LOG(mLogger, LogLevel::Info, "CachedIO", "输入不可缓存，直接读取");
+    }
+    return true;
+}
+
+bool CachedIO::openCacheEntry() {
+    std::error_code error;
+    std::filesystem::create_directories(mDirectory, error);
+    if (error) {
+        YFF_LOG(mLogger, LogLevel::Warning, "CachedIO", "无法创建缓存目录: %s",
+                mDirectory.c_str());
+        return false;
+    }
+
+    // 缓存项以URL哈希命名，内容长度作为校验值
+    char name[32];
+    snprintf(name, sizeof(name), "%016zx", std::hash<std::string>{}(mUrl));
+    std::filesystem::path base = std::filesystem::path(mDirectory) / name;
+    mDataPath = base.string() + ".data";
+    mIndexPath = base.string() + ".index";
+
+    mDataFd = ::open(mDataPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (mDataFd < 0) {
+        YFF_LOG(mLogger, LogLevel::Warning, "CachedIO", "无法打开缓存文件: %s",
+                mDataPath.c_str());
+        return false;
+    }
+
+    // 同一资源同时只由一个实例读写缓存，包括其他进程中的实例
+    if (flock(mDataFd, LOCK_EX | LOCK_NB) != 0) {
+        YFF_LOG(mLogger, LogLevel::Info, "CachedIO",
+                "缓存项正被其他实例使用: %s", mUrl.c_str());
+        ::close(mDataFd);
+        mDataFd = -1;
+        return false;
+    }
+
+    mValidator = fetchValidator();
+    loadIndex();
+
+    // 稀疏文件，未缓存的区域不占用磁盘
+    if (ftruncate(mDataFd, mSize) != 0) {
+        ::close(mDataFd);
+        mDataFd = -1;
+        return false;
+    }
+
+    // 更新访问时间，供LRU淘汰使用
+    std::filesystem::last_write_time(
+        mIndexPath, std::filesystem::file_time_type::clock::now(), error);
+
+    int64_t cached = 0;
+    for (const auto& range : mRanges) {
+        cached += range.second - range.first;
+    }
+    YFF_LOG(mLogger, LogLevel::Info, "CachedIO",
+            "缓存已打开: %s, 已缓存 %lld/%lld 字节", mUrl.c_str(),
+            static_cast<long long>(cached), static_cast<long long>(mSize));
+    return true;
+}
+
+std::string CachedIO::fetchValidator() {
+    char protocol[16];
+    char host[256];
+    char path[2048];
+    int port = -1;
+    av_url_split(protocol, sizeof(protocol), nullptr, 0, host, sizeof(host),
+                 &port, path, sizeof(path), mUrl.c_str());
+    bool secure = strcmp(protocol, "https") == 0;
+    if (port < 0) {
+        port = secure ? 443 : 80;
+    }
+
+    // 单独发送 HEAD 请求取校验信息，FFmpeg 的 HTTP 协议不导出这些响应头
+    std::string address = std::string(secure ? "tls://" : "tcp://") + host +
+                          ":" + std::to_string(port);
+    AVIOContext* connection = nullptr;
+    if (avio_open2(&connection, address.c_str(), AVIO_FLAG_READ_WRITE,
+                   &mInterrupt, nullptr) < 0) {
+        return "";
+    }
+    std::string request = std::string("HEAD ") + (path[0] ? path : "/") +
+                          " HTTP/1.1\r\nHost: " + host + ":" +
+                          std::to_string(port) +
+                          "\r\nConnection: close\r\n\r\n";
+    avio_write(connection,
+               reinterpret_cast<const unsigned char*>(request.data()),
+               static_cast<int>(request.size()));
+    avio_flush(connection);
+
+    // 逐行读取响应头，直到空行；非 2xx 响应（如重定向）不提供校验信息
+    std::string etag;
+    std::string lastModified;
+    std::string line;
+    bool statusLine = true;
+    bool success = false;
+    for (int i = 0; i < MAX_HEADER_BYTES && !avio_feof(connection); i++) {
+        char c = static_cast<char>(avio_r8(connection));
+        if (c != '\n') {
+            if (c != '\r') {
+                line += c;
+            }
+            continue;
+        }
+        if (line.empty()) {
+            break;
+        }
+        if (statusLine) {
+            size_t space = line.find(' ');
+            success = space != std::string::npos &&
+                      line.compare(space + 1, 1, "2") == 0;
+            statusLine = false;
+        } else {
+            size_t colon = line.find(':');
+            std::string name = line.substr(0, colon);
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            std::string value =
+                colon == std::string::npos ? "" : line.substr(colon + 1);
+            value.erase(0, value.find_first_not_of(' '));
+            if (name == "etag") {
+                etag = value;
+            } else if (name == "last-modified") {
+                lastModified = value;
+            }
+        }
+        line.clear();
+    }
+    avio_closep(&connection);
+
+    if (!success || (etag.empty() && lastModified.empty())) {
+        return "";
+    }
+    return etag + " " + lastModified;
+}
+
+void CachedIO::loadIndex() {
+    mRanges.clear();
+
+    // 索引格式：URL、内容长度、校验信息，之后每行一个已缓存区间
+    std::ifstream input(mIndexPath);
+    std::string url;
+    std::string sizeLine;
+    std::string validator;
+    if (input && std::getline(input, url) && std::getline(input, sizeLine) &&
+        std::getline(input, validator) && url == mUrl &&
+        sizeLine == std::to_string(mSize) && validator == mValidator) {
+        int64_t start;
+        int64_t end;
+        while (input >> start >> end) {
+            if (start >= 0 && end > start && end <= mSize) {
+                addRange(start, end);
+            }
+        }
+        mIndexDirty = false;
+        return;
+    }
+
+    // 资源已变化或索引损坏，丢弃旧数据
+    if (input.is_open()) {
+        YFF_LOG(mLogger, LogLevel::Info, "CachedIO", "缓存已失效: %s",
+                mUrl.c_str());
+    }
+    mRanges.clear();
+    if (ftruncate(mDataFd, 0) != 0) {
+        YFF_LOG(mLogger, LogLevel::Warning, "CachedIO", "清空缓存文件失败");
+    }
+    mIndexDirty = true;
+}
+
+void CachedIO::saveIndex() {
+    if (!mIndexDirty || mIndexPath.empty()) {
+        return;
+    }
+
+    // 先写临时文件再替换，避免中途退出留下损坏的索引
+    std::string tempPath = mIndexPath + ".tmp";
+    {
+        std::ofstream output(tempPath, std::ios::trunc);
+        output << mUrl << "\n" << mSize << "\n" << mValidator << "\n";
+        for (const auto& range : mRanges) {
+            output << range.first << " " << range.second << "\n";
+        }
+        if (!output) {
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, mIndexPath, error);
+    mIndexDirty = error.value() != 0;
+}
+
+void CachedIO::addRange(int64_t start, int64_t end) {
+    // 与前后相邻或重叠的区间合并
+    auto it = mRanges.upper_bound(start);
+    if (it != mRanges.begin()) {
+        auto previous = std::prev(it);
+        if (previous->second >= start) {
+            start = previous->first;
+            end = std::max(end, previous->second);
+            it = mRanges.erase(previous);
+        }
+    }
+    while (it != mRanges.end() && it->first <= end) {
+        end = std::max(end, it->second);
+        it = mRanges.erase(it);
+    }
+    mRanges[start] = end;
+    mIndexDirty = true;
+}
+
+int64_t CachedIO::cachedRangeEnd(int64_t position) const {
+    auto it = mRanges.upper_bound(position);
+    if (it == mRanges.begin()) {
+        return -1;
+    }
+    --it;
+    return position < it->second ? it->second : -1;
+}
+
+int64_t CachedIO::nextCachedStart(int64_t position) const {
+    auto it = mRanges.upper_bound(position);
+    return it == mRanges.end() ? -1 : it->first;
+}
+
+void CachedIO::close() {
+    if (mDataFd >= 0) {
+        saveIndex();
+        ::close(mDataFd);
+        mDataFd = -1;
+        YFF_LOG(mLogger, LogLevel::Info, "CachedIO",
+                "缓存已关闭, 网络读取 %lld 字节, 缓存命中 %lld 字节",
+                static_cast<long long>(mNetworkBytes),
+                static_cast<long long>(mCachedBytes));
+        trim();
+    }
+    if (mSource) {
+        avio_closep(&mSource);
+    }
+    mRanges.clear();
+    releaseAVIOContext();
+}
+
+bool CachedIO::isSeekable() const { return mSeekable; }
+
+int64_t CachedIO::getNetworkBytes() const { return mNetworkBytes; }
+
+int64_t CachedIO::getCachedBytes() const { return mCachedBytes; }
+
+int CachedIO::read(uint8_t* buffer, int size) {
+    if (!mCaching) {
+        return fetch(buffer, size);
+    }
+
+    if (mPosition >= mSize) {
+        return AVERROR_EOF;
+    }
+
+    // 命中缓存区间时从本地文件读取
+    int64_t rangeEnd = cachedRangeEnd(mPosition);
+    if (rangeEnd > 0) {
+        int bytes =
+            static_cast<int>(std::min<int64_t>(size, rangeEnd - mPosition));
+        ssize_t ret = pread(mDataFd, buffer, bytes, mPosition);
+        if (ret > 0) {
+            mPosition += ret;
+            mCachedBytes += ret;
+            return static_cast<int>(ret);
+        }
+        // 本地读取失败时回退到网络
+    }
+
+    // 只请求到下一个缓存区间为止的空洞
+    int64_t holeEnd = nextCachedStart(mPosition);
+    if (holeEnd < 0 || holeEnd > mSize) {
+        holeEnd = mSize;
+    }
+    int bytes = static_cast<int>(
+        std::min<int64_t>({size, holeEnd - mPosition, FETCH_CHUNK_SIZE}));
+    int64_t start = mPosition;
+    int ret = fetch(buffer, bytes);
+    if (ret > 0) {
+        if (pwrite(mDataFd, buffer, ret, start) == ret) {
+            addRange(start, start + ret);
+        }
+    }
+    return ret;
+}
+
+int CachedIO::fetch(uint8_t* buffer, int size) {
+    if (mSourcePosition != mPosition) {
+        int64_t ret = avio_seek(mSource, mPosition, SEEK_SET);
+        if (ret < 0) {
+            return static_cast<int>(ret);
+        }
+        mSourcePosition = mPosition;
+    }
+
+    int ret = avio_read_partial(mSource, buffer, size);
+    if (ret > 0) {
+        mSourcePosition += ret;
+        mPosition += ret;
+        mNetworkBytes += ret;
+    }
+    return ret;
+}
+
+int64_t CachedIO::seek(int64_t offset, int whence) {
+    if (whence & AVSEEK_SIZE) {
+        return mSize >= 0 ? mSize : AVERROR(ENOSYS);
+    }
+
+    int64_t position;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET:
+            position = offset;
+            break;
+        case SEEK_CUR:
+            position = mPosition + offset;
+            break;
+        case SEEK_END:
+            if (mSize < 0) {
+                return AVERROR(ENOSYS);
+            }
+            position = mSize + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    if (position < 0) {
+        return AVERROR(EINVAL);
+    }
+
+    // 网络连接在真正需要读取空洞时才跳转
+    mPosition = position;
+    return position;
+}
+
+void CachedIO::trim() {
+    if (mSizeLimit <= 0) {
+        return;
+    }
+
+    struct Entry {
+        std::filesystem::path base;
+        std::filesystem::file_time_type lastUsed;
+        int64_t bytes;
+    };
+    std::vector<Entry> entries;
+    int64_t total = 0;
+
+    std::error_code error;
+    for (const auto& file :
+         std::filesystem::directory_iterator(mDirectory, error)) {
+        if (file.path().extension() != ".index") {
+            continue;
+        }
+        Entry entry;
+        entry.base = file.path();
+        entry.base.replace_extension();
+        entry.lastUsed = file.last_write_time(error);
+
+        // 按索引中的已缓存区间统计实际占用
+        entry.bytes = 0;
+        std::ifstream input(file.path());
+        std::string url;
+        std::string size;
+        std::string validator;
+        int64_t start;
+        int64_t end;
+        if (std::getline(input, url) && std::getline(input, size) &&
+            std::getline(input, validator)) {
+            while (input >> start >> end) {
+                entry.bytes += end - start;
+            }
+        }
+        total += entry.bytes;
+        entries.push_back(entry);
+    }
+
+    if (total <= mSizeLimit) {
+        return;
+    }
+
+    // 按最近使用时间从旧到新淘汰，当前使用的缓存项保留
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) {
+                  return a.lastUsed < b.lastUsed;
+              });
+    std::string current =
+        std::filesystem::path(mIndexPath).replace_extension().string();
+    for (const Entry& entry : entries) {
+        if (total <= mSizeLimit) {
+            break;
+        }
+        if (entry.base.string() == current) {
+            continue;
+        }
+
+        // 其他实例正在使用的缓存项保留
+        std::string dataPath = entry.base.string() + ".data";
+        int fd = ::open(dataPath.c_str(), O_RDWR);
+        if (fd >= 0 && flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            ::close(fd);
+            continue;
+        }
+        std::filesystem::remove(entry.base.string() + ".index", error);
+        std::filesystem::remove(dataPath, error);
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        total -= entry.bytes;
+        YFF_LOG(mLogger, LogLevel::Info, "CachedIO", "淘汰缓存项: %s",
+                entry.base.string().c_str());
+    }
+}
+
+}  // namespace yffplayer
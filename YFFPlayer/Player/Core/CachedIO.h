@@ -0,0 +1,78 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "IOBackend.h"
+#include "Logger.h"
+
+namespace yffplayer {
+
+// Persistent byte-range cache for network inputs. Each resource is a
+// sparse data file plus a range index on disk; cached ranges are served
+// locally and only the holes are fetched from the network. An entry is
+// used by one instance at a time, across processes too, through a flock
+// on its data file; other instances of the same URL read uncached. The
+// index is validated by content length plus the ETag and Last-Modified
+// of a HEAD request.
+class CachedIO : public IOBackend {
+   public:
+    CachedIO(const std::string& directory, int64_t sizeLimit,
+             std::shared_ptr<Logger> logger);
+    ~CachedIO() override;
+
+    // Whether url is a network input worth caching
+    static bool isNetworkUrl(const std::string& url);
+
+    bool open(const std::string& url,
+              const AVIOInterruptCB& interrupt) override;
+    int read(uint8_t* buffer, int size) override;
+    int64_t seek(int64_t offset, int whence) override;
+    bool isSeekable() const override;
+    void close() override;
+
+    // Bytes fetched from the network and served from disk
+    int64_t getNetworkBytes() const;
+    int64_t getCachedBytes() const;
+
+   private:
+    bool openCacheEntry();
+    // ETag and Last-Modified of mUrl from a HEAD request, empty if the
+    // server sends neither or the request fails
+    std::string fetchValidator();
+    void loadIndex();
+    void saveIndex();
+    void addRange(int64_t start, int64_t end);
+    // End of the cached range containing position, -1 if not cached
+    int64_t cachedRangeEnd(int64_t position) const;
+    // Start of the first cached range after position, -1 if none
+    int64_t nextCachedStart(int64_t position) const;
+    int fetch(uint8_t* buffer, int size);
+    // Drop least recently used entries until the cache fits the limit
+    void trim();
+
+    std::shared_ptr<Logger> mLogger;
+    std::string mDirectory;
+    int64_t mSizeLimit;
+
+    std::string mUrl;
+    std::string mDataPath;
+    std::string mIndexPath;
+    AVIOContext* mSource{nullptr};
+    int64_t mSourcePosition{0};
+    int64_t mSize{-1};
+    std::string mValidator;
+    bool mSeekable{false};
+    bool mCaching{false};
+    int mDataFd{-1};
+
+    // Cached ranges [start, end), merged and non-overlapping
+    std::map<int64_t, int64_t> mRanges;
+    bool mIndexDirty{false};
+    int64_t mPosition{0};
+    int64_t mNetworkBytes{0};
+    int64_t mCachedBytes{0};
+};
+
+}  // namespace yffplayer
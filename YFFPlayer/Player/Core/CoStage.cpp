@@ -0,0 +1,111 @@
+#include "CoStage.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace yffplayer {
+
+static int64_t monotonicTimeUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+CoStage::CoStage(CoStage&& other) noexcept
+    : mHandle(std::exchange(other.mHandle, nullptr)),
+      mInterrupt(std::move(other.mInterrupt)) {}
+
+CoStage& CoStage::operator=(CoStage&& other) noexcept {
+    if (this != &other) {
+        if (mHandle) {
+            mHandle.destroy();
+        }
+        mHandle = std::exchange(other.mHandle, nullptr);
+        mInterrupt = std::move(other.mInterrupt);
+    }
+    return *this;
+}
+
+CoStage::~CoStage() {
+    // 挂起中的协程帧随之销毁，析构局部对象；未推入队列的数据由
+    // queuePush的释放函数回收，其余裸资源需由调用方自行记录释放
+    if (mHandle) {
+        mHandle.destroy();
+    }
+}
+
+void CoStage::setInterrupt(std::function<bool()> interrupt) {
+    mInterrupt = std::move(interrupt);
+}
+
+TaskStep CoStage::step() {
+    if (!mHandle || mHandle.done()) {
+        return TaskStep::done();
+    }
+
+    promise_type& promise = mHandle.promise();
+    if (StageWait* wait = promise.wait) {
+        if (mInterrupt && mInterrupt()) {
+            wait->mInterrupted = true;
+        } else if (!wait->poll()) {
+            return wait->blocked();
+        }
+        promise.wait = nullptr;
+    }
+
+    mHandle.resume();
+    if (mHandle.done()) {
+        if (promise.exception) {
+            std::rethrow_exception(std::exchange(promise.exception, nullptr));
+        }
+        return TaskStep::done();
+    }
+    if (!promise.wait) {
+        return TaskStep::again();
+    }
+    // 挂起前中断已置位时不等待唤醒，下一步直接结束等待
+    if (mInterrupt && mInterrupt()) {
+        return TaskStep::again();
+    }
+    return promise.wait->blocked();
+}
+
+void StageWait::await_suspend(
+    std::coroutine_handle<CoStage::promise_type> handle) {
+    mSuspendTimeUs = monotonicTimeUs();
+    handle.promise().wait = this;
+}
+
+int64_t StageWait::waitedUs() const {
+    if (mSuspendTimeUs < 0) {
+        return 0;
+    }
+    return monotonicTimeUs() - mSuspendTimeUs;
+}
+
+void QueueWait::chargeWait(bool push) const {
+    if (!mStats || mStatsQueue == PipelineStats::Queue::COUNT) {
+        return;
+    }
+    int64_t waitUs = waitedUs();
+    if (waitUs <= 0) {
+        return;
+    }
+    if (push) {
+        mStats->addPushWait(mStatsQueue, waitUs);
+    } else {
+        mStats->addPopWait(mStatsQueue, waitUs);
+    }
+}
+
+StageSleep::StageSleep(int64_t delayUs)
+    : mDeadlineUs(monotonicTimeUs() + delayUs) {}
+
+bool StageSleep::poll() { return monotonicTimeUs() >= mDeadlineUs; }
+
+TaskStep StageSleep::blocked() const {
+    return TaskStep::sleep(std::max<int64_t>(
+        mDeadlineUs - monotonicTimeUs(), 0));
+}
+
+}  // namespace yffplayer
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "BufferQueue.h"
+#include "Executor.h"
+#include "PipelineStats.h"
+
+namespace yffplayer {
+
+class StageWait;
+
+// A pipeline stage written as a C++20 coroutine. The body suspends at
+// co_await points instead of sleeping or polling, and a StageRunner
+// resumes it through step(), either on a dedicated thread or as an
+// executor task. A waiting stage holds neither a thread nor a stack, only
+// its coroutine frame. Destroying the CoStage destroys a suspended body
+// with its locals, which is how a stage is cancelled; raw resources held
+// across a co_await need an owner that frees them, see queuePush().
+//
+//   CoStage Decoder::decodeLoop() {
+//       while (true) {
+//           std::optional<AVPacket*> packet = co_await queuePop(packets);
+//           ...
+//           co_await queuePush(frames, frame);
+//           co_await stageYield();
+//       }
+//   }
+class CoStage {
+   public:
+    struct promise_type {
+        StageWait* wait{nullptr};
+        std::exception_ptr exception;
+
+        CoStage get_return_object() {
+            return CoStage(
+                std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    CoStage() = default;
+    CoStage(CoStage&& other) noexcept;
+    CoStage& operator=(CoStage&& other) noexcept;
+    CoStage(const CoStage&) = delete;
+    CoStage& operator=(const CoStage&) = delete;
+    ~CoStage();
+
+    // While interrupt returns true, waits end early: queuePop() yields
+    // nullopt and queuePush() false, so the body can handle a seek or a
+    // track switch instead of staying blocked on a queue. Set before the
+    // first step().
+    void setInterrupt(std::function<bool()> interrupt);
+
+    // Resume the body until it waits, yields or returns; done() once it
+    // returned. Rethrows an exception that escaped the body.
+    TaskStep step();
+
+   private:
+    explicit CoStage(std::coroutine_handle<promise_type> handle)
+        : mHandle(handle) {}
+
+    std::coroutine_handle<promise_type> mHandle;
+    std::function<bool()> mInterrupt;
+};
+
+// A point where a stage body waits. The awaiting step completes the wait
+// with poll() when it can; otherwise the stage is parked as blocked()
+// says and poll() is retried on the next step.
+class StageWait {
+   public:
+    virtual ~StageWait() = default;
+
+    bool await_ready() { return poll(); }
+    void await_suspend(std::coroutine_handle<CoStage::promise_type> handle);
+
+   protected:
+    friend class CoStage;
+
+    bool mInterrupted{false};
+
+    // Complete the wait without blocking
+    virtual bool poll() = 0;
+    // How to wait for the next poll, idle() relies on a wake()
+    virtual TaskStep blocked() const { return TaskStep::idle(); }
+
+    // Time between the suspension and now, 0 if it never suspended
+    int64_t waitedUs() const;
+
+   private:
+    int64_t mSuspendTimeUs{-1};
+};
+
+// Queue wait charged to the queue's push or pop wait counter
+class QueueWait : public StageWait {
+   protected:
+    QueueWait(const std::shared_ptr<PipelineStats>& stats,
+              PipelineStats::Queue statsQueue)
+        : mStats(stats.get()), mStatsQueue(statsQueue) {}
+
+    void chargeWait(bool push) const;
+
+   private:
+    PipelineStats* mStats;
+    PipelineStats::Queue mStatsQueue;
+};
+
+template <typename T>
+class QueuePop : public QueueWait {
+   public:
+    QueuePop(BufferQueue<T>& queue,
+             const std::shared_ptr<PipelineStats>& stats,
+             PipelineStats::Queue statsQueue)
+        : QueueWait(stats, statsQueue), mQueue(queue) {}
+
+    // The popped item, nullopt if the wait was interrupted
+    std::optional<T> await_resume() {
+        chargeWait(false);
+        if (mInterrupted) {
+            return std::nullopt;
+        }
+        return std::move(mItem);
+    }
+
+   protected:
+    bool poll() override { return mQueue.tryPop(mItem); }
+
+   private:
+    BufferQueue<T>& mQueue;
+    T mItem{};
+};
+
+template <typename T>
+class QueuePush : public QueueWait {
+   public:
+    // Releases an item that never reached the queue because the stage
+    // was destroyed while waiting
+    using Disposer = std::function<void(T&)>;
+
+    QueuePush(BufferQueue<T>& queue, T item,
+              const std::shared_ptr<PipelineStats>& stats,
+              PipelineStats::Queue statsQueue, Disposer dispose)
+        : QueueWait(stats, statsQueue),
+          mQueue(queue),
+          mItem(std::move(item)),
+          mDispose(std::move(dispose)) {}
+    QueuePush(const QueuePush&) = delete;
+    QueuePush& operator=(const QueuePush&) = delete;
+
+    ~QueuePush() override {
+        if (!mResumed && mDispose) {
+            mDispose(mItem);
+        }
+    }
+
+    // False if the wait was interrupted; the caller still owns the item
+    bool await_resume() {
+        mResumed = true;
+        chargeWait(true);
+        return !mInterrupted;
+    }
+
+   protected:
+    bool poll() override { return mQueue.tryPush(mItem); }
+
+   private:
+    BufferQueue<T>& mQueue;
+    T mItem;
+    Disposer mDispose;
+    bool mResumed{false};
+};
+
+class StageSleep : public StageWait {
+   public:
+    explicit StageSleep(int64_t delayUs);
+    void await_resume() {}
+
+   protected:
+    bool poll() override;
+    TaskStep blocked() const override;
+
+   private:
+    int64_t mDeadlineUs;
+};
+
+class StageCondition : public StageWait {
+   public:
+    explicit StageCondition(std::function<bool()> condition)
+        : mCondition(std::move(condition)) {}
+    void await_resume() {}
+
+   protected:
+    bool poll() override { return mCondition(); }
+
+   private:
+    std::function<bool()> mCondition;
+};
+
+// Give other stages a turn, the body continues on the next step
+struct StageYield {
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<CoStage::promise_type>) const {}
+    void await_resume() const {}
+};
+
+// co_await queuePop(queue) waits for an item; the time spent waiting is
+// added to the pop wait of statsQueue when stats is set
+template <typename T>
+QueuePop<T> queuePop(
+    BufferQueue<T>& queue,
+    const std::shared_ptr<PipelineStats>& stats = nullptr,
+    PipelineStats::Queue statsQueue = PipelineStats::Queue::COUNT) {
+    return QueuePop<T>(queue, stats, statsQueue);
+}
+
+// co_await queuePush(queue, item) waits for space and pushes the item. If
+// the stage is destroyed before the push, dispose releases the item;
+// items that own raw memory must pass one.
+template <typename T>
+QueuePush<T> queuePush(
+    BufferQueue<T>& queue, T item,
+    const std::shared_ptr<PipelineStats>& stats = nullptr,
+    PipelineStats::Queue statsQueue = PipelineStats::Queue::COUNT,
+    typename QueuePush<T>::Disposer dispose = nullptr) {
+    return QueuePush<T>(queue, std::move(item), stats, statsQueue,
+                        std::move(dispose));
+}
+
+// co_await stageSleep(us) resumes after delayUs, or earlier on interrupt
+inline StageSleep stageSleep(int64_t delayUs) { return StageSleep(delayUs); }
+
+// co_await stageWaitUntil(condition) resumes once condition holds; whoever
+// makes it true must wake the runner
+inline StageCondition stageWaitUntil(std::function<bool()> condition) {
+    return StageCondition(std::move(condition));
+}
+
+inline StageYield stageYield() { return StageYield(); }
+
+}  // namespace yffplayer
@@ -4,9 +4,13 @@
 #include <atomic>
 #include <memory>
 #include <string>
-#include <thread>
 
+#include "CoStage.h"
+#include "Executor.h"
+#include "PipelineStats.h"
 #include "PlayerTypes.h"
+#include "SeekGeneration.h"
+#include "StageRunner.h"
 
 extern "C" {
 struct AVCodecParameters;
@@ -30,13 +34,70 @@ class Decoder {
     virtual void stop() = 0;
     virtual void close() = 0;
 
+    // Request low-delay decoding, applies to the next open()
+    void setLowDelay(bool lowDelay) { mLowDelay = lowDelay; }
+
+    // Counters for decode and convert times, set before start()
+    void setStats(std::shared_ptr<PipelineStats> stats) { mStats = stats; }
+
+    // Seek generation of the pipeline, set before start(). Packets of an
+    // earlier generation are discarded, the codec is flushed once per new
+    // generation and frames carry the generation they were decoded in.
+    void setSeekGeneration(std::shared_ptr<SeekGeneration> generation) {
+        mGeneration = generation;
+    }
+
+    // Decode as a task of this executor group instead of on a dedicated
+    // thread; set before open(), codec threads are then limited to the
+    // cores the executor leaves idle
+    void setTaskGroup(std::shared_ptr<TaskGroup> group) {
+        mRunner.setTaskGroup(group);
+    }
+
    protected:
     std::shared_ptr<Logger> mLogger;
     DecoderType mType;
     std::atomic<bool> mIsRunning{false};
-    std::thread mDecodeThread;
+    std::atomic<bool> mLowDelay{false};
+    StageRunner mRunner;
+    std::shared_ptr<PipelineStats> mStats;
+
+    CoStage mDecodeLoop;
+    std::shared_ptr<SeekGeneration> mGeneration;
+    // Generation the codec state belongs to, used by the stage only
+    uint32_t mDecodeGeneration{0};
+    // Precise seek target of that generation, see SeekGeneration::advance()
+    int64_t mDecodeStartUs{SeekGeneration::kNoStartPosition};
+
+    uint32_t currentGeneration() const {
+        return mGeneration ? mGeneration->current() : 0;
+    }
+
+    // Flush the codec once when the pipeline moved to generation
+    void syncGeneration(uint32_t generation) {
+        if (generation != mDecodeGeneration) {
+            flushCodec();
+            mDecodeGeneration = generation;
+            mDecodeStartUs = SeekGeneration::kNoStartPosition;
+            if (mGeneration) {
+                mDecodeStartUs = mGeneration->startPosition(generation);
+            }
+        }
+    }
+
+    // Whether a frame ends before the precise seek target; such frames are
+    // only decoded as references and never converted or queued
+    bool isBeforeStart(int64_t pts, int64_t duration) const {
+        return mDecodeStartUs != SeekGeneration::kNoStartPosition &&
+               pts + duration <= mDecodeStartUs;
+    }
+
+    // Drop reference and delayed frames after a seek
+    virtual void flushCodec() = 0;
 
-    virtual void decodeLoop() = 0;
+    // The decode stage body: pop a packet, decode it and push the frames,
+    // suspending while a queue is empty or full
+    virtual CoStage decodeLoop() = 0;
 };
 
 }  // namespace yffplayer
@@ -1,5 +1,12 @@
 #include "Demuxer.h"
 
+#include <algorithm>
+
+#include "CachedIO.h"
+#include "MmapIO.h"
+#include "ReadAheadIO.h"
+#include "Tracer.h"
+
 extern "C" {
 #include <libavformat/avformat.h>
 #include <libavutil/time.h>
@@ -7,6 +14,58 @@ extern "C" {
 
 namespace yffplayer {
 
+// 快速启动：探测少量数据，尽早开始播放
+constexpr int64_t FAST_START_PROBE_SIZE = 64 * 1024;
+constexpr int64_t FAST_START_ANALYZE_DURATION = 500000;  // 0.5秒
+constexpr int FAST_START_FPS_PROBE_FRAMES = 3;
+
+// 完整探测：适用于码流异常或流信息靠后的文件
+constexpr int64_t THOROUGH_PROBE_SIZE = 50 * 1024 * 1024;
+constexpr int64_t THOROUGH_ANALYZE_DURATION = 20000000;  // 20秒
+
+// 等待读取线程完成切换轨道的上限
+constexpr auto TRACK_SWITCH_TIMEOUT = std::chrono::seconds(2);
+
+// 读取状态在start()中创建，随读取协程挂起保留，在endRead()中释放
+struct Demuxer::ReadState {
+    AVFormatContext* formatContext{nullptr};
+    std::unique_ptr<IOBackend> io;
+    int audioStreamIndex{-1};
+    int videoStreamIndex{-1};
+    AVPacket* avPacket{nullptr};
+    std::shared_ptr<PipelineStats> stats;
+
+    // 直播时移：读到的数据包先写入环形缓冲区，再从读取位置送出
+    std::shared_ptr<TimeshiftBuffer> timeshift;
+
+    // 循环播放状态：缓存中的数据包时间戳为微秒，且不含循环偏移。
+    // 只有从片段开头连续读到结尾、期间没有跳转和切换循环开关的一轮
+    // 才能作为完整的缓存
+    std::vector<AVPacket*> loopCache;
+    int64_t loopCacheBytes{0};
+    bool loopCacheComplete{false};
+    bool loopCacheEnabled{true};
+    bool atClipStart{true};
+    uint32_t loopChanges{0};
+    size_t replayIndex{0};
+    int64_t loopOffsetUs{0};
+    int64_t clipStartUs{AV_NOPTS_VALUE};
+    int64_t clipEndUs{AV_NOPTS_VALUE};
+
+    // 切换轨道状态：已送出的最后解码时间戳，以及需要跳过的范围
+    int64_t lastAudioDts{AV_NOPTS_VALUE};
+    int64_t lastVideoDts{AV_NOPTS_VALUE};
+    int64_t dropAudioUntilDts{AV_NOPTS_VALUE};
+    int64_t dropVideoUntilDts{AV_NOPTS_VALUE};
+    int64_t dropAudioBeforeUs{AV_NOPTS_VALUE};
+
+    // 直播追赶：丢弃该时间戳之前的数据包，直到遇到关键帧
+    int64_t skipUntilPts{AV_NOPTS_VALUE};
+
+    // 送出的数据包所属的跳转代号
+    uint32_t generation{0};
+};
+
 Demuxer::Demuxer(std::shared_ptr<BufferQueue<AVPacket*>> audioBuffer,
                  std::shared_ptr<BufferQueue<AVPacket*>> videoBuffer,
                  std::shared_ptr<Logger> logger,
@@ -15,13 +74,14 @@ Demuxer::Demuxer(std::shared_ptr<BufferQueue<AVPacket*>> audioBuffer,
       mVideoBuffer(videoBuffer),
       mLogger(logger),
       mCallback(callback) {
-    mLogger->log(LogLevel::Info, "Demuxer", "解复用器已创建");
+    YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "解复用器已创建");
     updateState(DemuxerState::IDLE);
 }
 
 Demuxer::~Demuxer() {
     stop();
-    mLogger->log(LogLevel::Info, "Demuxer", "解复用器已销毁");
+    freeTrackParams();
+    YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "解复用器已销毁");
 }
 
 void Demuxer::setCallback(std::shared_ptr<DemuxerCallback> callback) {
@@ -40,7 +100,7 @@ void Demuxer::notifyError(ErrorCode code, const std::string& message) {
     error.code = code;
     error.message = message;
 
-    mLogger->log(LogLevel::Error, "Demuxer", message);
+    YFF_LOG(mLogger, LogLevel::Error, "Demuxer", "%s", message.c_str());
 
     if (mCallback) {
         mCallback->onDemuxerError(error);
@@ -57,84 +117,77 @@ bool Demuxer::open(const std::string& url) {
 
     updateState(DemuxerState::INITIALIZED);
 
-    // 打开输入文件
+    // 打开输入文件并查找流信息
+    mAbortRequested = false;
     AVFormatContext* formatContext = nullptr;
-    if (avformat_open_input(&formatContext, url.c_str(), nullptr, nullptr) !=
-        0) {
-        notifyError(ErrorCode::DEMUXER_OPEN_FAILED, "无法打开媒体文件: " + url);
-        return false;
-    }
-
-    // 查找流信息
-    if (avformat_find_stream_info(formatContext, nullptr) < 0) {
-        notifyError(ErrorCode::DEMUXER_FIND_STREAM_FAILED, "无法查找流信息");
-        avformat_close_input(&formatContext);
+    std::unique_ptr<IOBackend> io;
+    if (openInput(&formatContext, io) != ErrorCode::SUCCESS) {
         return false;
     }
 
     // 检查是否为直播流
     mIsLive = (formatContext->duration == AV_NOPTS_VALUE);
 
-    // 查找音视频流
-    int audioStreamIndex = -1;
-    int videoStreamIndex = -1;
-
+    // 记录所有可选的音视频轨道，参数由解复用器持有
+    freeTrackParams();
+    mMediaInfo.tracks.clear();
     for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
         AVStream* stream = formatContext->streams[i];
-        if (stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
-            audioStreamIndex < 0) {
-            audioStreamIndex = i;
-            AVCodecParameters* codecParams = avcodec_parameters_alloc();
-            avcodec_parameters_copy(codecParams, stream->codecpar);
-            mMediaInfo.audioCodecParam = codecParams;
-        } else if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
-                   videoStreamIndex < 0) {
-            videoStreamIndex = i;
-            AVCodecParameters* codecParams = avcodec_parameters_alloc();
-            avcodec_parameters_copy(codecParams, stream->codecpar);
-            mMediaInfo.videoCodecParam = codecParams;
+        AVMediaType codecType = stream->codecpar->codec_type;
+        if ((codecType != AVMEDIA_TYPE_AUDIO &&
+             codecType != AVMEDIA_TYPE_VIDEO) ||
+            (stream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+            continue;
         }
-    }
 
-    mMediaInfo.durationMs = formatContext->duration / AV_TIME_BASE;
-    mMediaInfo.hasAudio = (audioStreamIndex >= 0);
-    mMediaInfo.hasVideo = (videoStreamIndex >= 0);
+        AVCodecParameters* codecParams = avcodec_parameters_alloc();
+        avcodec_parameters_copy(codecParams, stream->codecpar);
+        mTrackParams[i] = codecParams;
 
-    if (mMediaInfo.hasAudio) {
-        mMediaInfo.audiochannels =
-            formatContext->streams[audioStreamIndex]->codecpar->channels;
-        mMediaInfo.audioSampleRate =
-            formatContext->streams[audioStreamIndex]->codecpar->sample_rate;
+        TrackInfo track;
+        track.streamIndex = i;
+        track.type = codecType == AVMEDIA_TYPE_AUDIO ? MediaType::AUDIO
+                                                     : MediaType::VIDEO;
+        AVDictionaryEntry* language =
+            av_dict_get(stream->metadata, "language", nullptr, 0);
+        track.language = language ? language->value : "";
+        track.codecName = avcodec_get_name(stream->codecpar->codec_id);
+        track.isDefault = (stream->disposition & AV_DISPOSITION_DEFAULT) != 0;
+        mMediaInfo.tracks.push_back(track);
     }
 
-    if (mMediaInfo.hasVideo) {
-        mMediaInfo.videoWidth =
-            formatContext->streams[videoStreamIndex]->codecpar->width;
-        mMediaInfo.videoHeight =
-            formatContext->streams[videoStreamIndex]->codecpar->height;
-    }
+    // 选择音视频流
+    int audioStreamIndex = -1;
+    int videoStreamIndex = -1;
+    selectStreams(formatContext, audioStreamIndex, videoStreamIndex);
+    mAudioStreamIndex = audioStreamIndex;
+    mVideoStreamIndex = videoStreamIndex;
 
-    if (mMediaInfo.hasAudio) {
-        if (mMediaInfo.hasVideo) {
-            mMediaInfo.type = MediaType::AUDIO_VIDEO;
-        } else {
-            mMediaInfo.type = MediaType::AUDIO;
-        }
-    } else {
-        if (mMediaInfo.hasVideo) {
-            mMediaInfo.type = MediaType::VIDEO;
-        } else {
-            mMediaInfo.type = MediaType::UNKNOWN;
+    mMediaInfo.durationMs = mIsLive ? 0 : formatContext->duration / 1000;
+    updateSelectedTracks(audioStreamIndex, videoStreamIndex);
+
+    // 记录视频流索引中的关键帧时间，抽帧时据此按GOP分组
+    mMediaInfo.videoKeyframesUs.clear();
+    if (videoStreamIndex >= 0) {
+        AVStream* stream = formatContext->streams[videoStreamIndex];
+        int entryCount = avformat_index_get_entries_count(stream);
+        for (int i = 0; i < entryCount; i++) {
+            const AVIndexEntry* entry = avformat_index_get_entry(stream, i);
+            if (entry && (entry->flags & AVINDEX_KEYFRAME)) {
+                mMediaInfo.videoKeyframesUs.push_back(av_rescale_q(
+                    entry->timestamp, stream->time_base, AV_TIME_BASE_Q));
+            }
         }
     }
 
     // 关闭输入文件，实际播放时会重新打开
     avformat_close_input(&formatContext);
 
-    mLogger->log(LogLevel::Info, "Demuxer", "媒体文件打开成功: " + url);
-    mLogger->log(LogLevel::Info, "Demuxer",
-                 "音频流索引: " + std::to_string(audioStreamIndex) +
-                     ", 视频流索引: " + std::to_string(videoStreamIndex));
+    YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "媒体文件打开成功: %s",
+            url.c_str());
+    YFF_LOG(mLogger, LogLevel::Info, "Demuxer",
+            "音频流索引: %d, 视频流索引: %d", audioStreamIndex,
+            videoStreamIndex);
 
     // 通知媒体信息已准备好
     if (mCallback) {
@@ -150,193 +203,1289 @@ void Demuxer::start() {
     }
 
     mIsRunning = true;
-    mReadThread = std::thread(&Demuxer::readLoop, this);
-    mLogger->log(LogLevel::Info, "Demuxer", "解复用线程已启动");
+    mIsEndOfFile = false;
+    mAbortRequested = false;
+    mLoopClipLengthUs = 0;
+
+    std::shared_ptr<PipelineStats> stats;
+    std::shared_ptr<TaskGroup> group;
+    {
+        std::lock_guard<std::mutex> lock(mConfigMutex);
+        stats = mStats;
+        group = mTaskGroup;
+    }
+    // 网络输入的读取会阻塞，只有本地文件交给执行器
+    if (group && !MmapIO::isLocalPath(mUrl)) {
+        group.reset();
+    }
+    mRunner.setTaskGroup(group);
+    if (group) {
+        auto wake = [this]() { mRunner.wake(); };
+        mAudioBuffer->setPopListener(wake);
+        mVideoBuffer->setPopListener(wake);
+    }
+    mRead = std::make_unique<ReadState>();
+    mRead->stats = stats;
+    mRead->generation = mGeneration->current();
+    mRead->loopChanges = mLoopChanges;
+    mReadLoop = readLoop();
+    // 跳转和切换轨道时放弃等待队列空间，回到循环开头处理
+    mReadLoop.setInterrupt(
+        [this]() { return mIsSeeking || mTrackSwitchPending; });
+    mRunner.start(
+        "yff-demux", [this]() { return mReadLoop.step(); }, stats,
+        PipelineStats::Stage::DEMUX);
+    YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "解复用线程已启动");
     updateState(DemuxerState::RUNNING);
 }
 
 void Demuxer::stop() {
+    // 先中断阻塞中的I/O，保证停止耗时有上限
+    abort();
+    stopRecording();
     if (!mIsRunning) {
         return;
     }
 
+    int64_t stopStartTime = av_gettime_relative();
     mIsRunning = false;
-    if (mReadThread.joinable()) {
-        mReadThread.join();
-    }
-    mLogger->log(LogLevel::Info, "Demuxer", "解复用线程已停止");
+    mRunner.stop();
+    // 读取协程停在等待处时随之销毁，未送出的数据包由queuePush释放，
+    // 读取状态由这里释放
+    mReadLoop = CoStage();
+    endRead();
+    mAudioBuffer->setPopListener(nullptr);
+    mVideoBuffer->setPopListener(nullptr);
+    mLastStopLatencyUs = av_gettime_relative() - stopStartTime;
+    YFF_LOG(mLogger, LogLevel::Info, "Demuxer",
+            "解复用线程已停止, 耗时 %lld 微秒",
+            static_cast<long long>(mLastStopLatencyUs));
     updateState(DemuxerState::STOPPED);
 }
 
-void Demuxer::seek(int64_t position) {
-    mIsSeeking = true;
-    mSeekPosition = position;
+void Demuxer::abort() { mAbortRequested = true; }
+
+uint32_t Demuxer::seek(int64_t position, bool precise) {
+    uint32_t generation = 0;
+    bool coalesced = false;
+    {
+        // 读取线程尚未执行的跳转被新的目标替换
+        std::lock_guard<std::mutex> lock(mSeekMutex);
+        coalesced = mIsSeeking;
+        mSeekPosition = position;
+        generation = mGeneration->advance(
+            precise ? position : SeekGeneration::kNoStartPosition);
+        mIsSeeking = true;
+    }
+    mIsEndOfFile = false;
+    std::shared_ptr<PipelineStats> stats;
+    {
+        std::lock_guard<std::mutex> lock(mConfigMutex);
+        stats = mStats;
+    }
+    if (stats) {
+        stats->addSeek(coalesced);
+    }
     updateState(DemuxerState::SEEKING);
-    mLogger->log(LogLevel::Info, "Demuxer",
-                 "请求跳转到: " + std::to_string(position) + " 微秒");
+    mRunner.wake();
+    YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "请求跳转到: %lld 微秒",
+            static_cast<long long>(position));
+    return generation;
 }
 
-void Demuxer::setPlaybackRate(float rate) {
-    mPlaybackRate = rate;
-    mLogger->log(LogLevel::Info, "Demuxer",
-                 "播放速率设置为: " + std::to_string(rate));
+bool Demuxer::isLive() const { return mIsLive; }
+
+bool Demuxer::isProbeCacheHit() const { return mProbeCacheHit; }
+
+bool Demuxer::isEndOfFile() const { return mIsEndOfFile; }
+
+void Demuxer::setLoop(bool loop) {
+    if (mLoop.exchange(loop) != loop) {
+        mLoopChanges++;
+    }
+    YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "循环播放: %s",
+            (loop ? "开启" : "关闭"));
 }
 
-bool Demuxer::isLive() const { return mIsLive; }
+bool Demuxer::isLoop() const { return mLoop; }
 
-MediaInfo Demuxer::getMediaInfo() const { return mMediaInfo; }
+void Demuxer::setLoopCacheLimit(int64_t bytes) { mLoopCacheLimit = bytes; }
 
-void Demuxer::readLoop() {
-    AVFormatContext* formatContext = nullptr;
-    int audioStreamIndex = -1;
-    int videoStreamIndex = -1;
-    AVPacket* avPacket = nullptr;
+bool Demuxer::getLoopClip(int64_t& startUs, int64_t& lengthUs) const {
+    lengthUs = mLoopClipLengthUs;
+    startUs = mLoopClipStartUs;
+    return lengthUs > 0;
+}
 
-    try {
-        // 打开输入文件
-        if (avformat_open_input(&formatContext, mUrl.c_str(), nullptr,
-                                nullptr) != 0) {
+InputStats Demuxer::getInputStats() const {
+    InputStats stats;
+    stats.bytesRead = mBytesRead;
+    stats.readTimeUs = mReadTimeUs;
+    stats.mediaTimeUs = mMediaTimeRead;
+    stats.lastPtsUs = mLastReadPts;
+    return stats;
+}
+
+void Demuxer::setIoTimeouts(const IoTimeouts& timeouts) {
+    mOpenTimeoutUs = timeouts.openUs;
+    mProbeTimeoutUs = timeouts.probeUs;
+    mReadTimeoutUs = timeouts.readUs;
+}
+
+int64_t Demuxer::getLastStopLatency() const { return mLastStopLatencyUs; }
+
+uint32_t Demuxer::skipToKeyframe() {
+    uint32_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(mSeekMutex);
+        generation = mGeneration->advance();
+        mSkipToKeyframe = true;
+    }
+    mRunner.wake();
+    YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "跳到最新关键帧");
+    return generation;
+}
+
+std::shared_ptr<SeekGeneration> Demuxer::getSeekGeneration() const {
+    return mGeneration;
+}
+
+void Demuxer::setOpenProfile(OpenProfile profile) { mOpenProfile = profile; }
+
+void Demuxer::applyOpenProfile(AVFormatContext* context) {
+    switch (mOpenProfile.load()) {
+        case OpenProfile::FAST_START:
+            context->probesize = FAST_START_PROBE_SIZE;
+            context->format_probesize = FAST_START_PROBE_SIZE;
+            context->max_analyze_duration = FAST_START_ANALYZE_DURATION;
+            context->fps_probe_size = FAST_START_FPS_PROBE_FRAMES;
+            // 不缓存探测阶段读到的数据包，直接交给播放
+            context->flags |= AVFMT_FLAG_NOBUFFER;
+            break;
+        case OpenProfile::THOROUGH:
+            context->probesize = THOROUGH_PROBE_SIZE;
+            context->max_analyze_duration = THOROUGH_ANALYZE_DURATION;
+            break;
+        default:
+            break;
+    }
+}
+
+bool Demuxer::canSkipProbe(AVFormatContext* context) {
+    if (mOpenProfile != OpenProfile::FAST_START) {
+        return false;
+    }
+
+    // 每个音视频流都需要在文件头中给出解码器和基本参数
+    bool hasStream = false;
+    int64_t duration = AV_NOPTS_VALUE;
+    for (unsigned int i = 0; i < context->nb_streams; i++) {
+        AVStream* stream = context->streams[i];
+        AVCodecParameters* params = stream->codecpar;
+        if (params->codec_type == AVMEDIA_TYPE_AUDIO) {
+            if (params->codec_id == AV_CODEC_ID_NONE ||
+                params->sample_rate <= 0 ||
+                params->ch_layout.nb_channels <= 0) {
+                return false;
+            }
+        } else if (params->codec_type == AVMEDIA_TYPE_VIDEO) {
+            if (params->codec_id == AV_CODEC_ID_NONE || params->width <= 0 ||
+                params->height <= 0) {
+                return false;
+            }
+        } else {
+            continue;
+        }
+        hasStream = true;
+
+        if (stream->duration != AV_NOPTS_VALUE) {
+            duration = std::max(duration, av_rescale_q(stream->duration,
+                                                       stream->time_base,
+                                                       AV_TIME_BASE_Q));
+        }
+    }
+
+    // 时长通常由探测阶段估算，文件头中没有时长时无法区分点播和直播
+    if (context->duration == AV_NOPTS_VALUE) {
+        if (duration == AV_NOPTS_VALUE) {
+            return false;
+        }
+        context->duration = duration;
+    }
+    return hasStream;
+}
+
+void Demuxer::setProbeCache(std::shared_ptr<ProbeCache> cache) {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mProbeCache = cache;
+}
+
+void Demuxer::setStats(std::shared_ptr<PipelineStats> stats) {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mStats = stats;
+}
+
+void Demuxer::setTaskGroup(std::shared_ptr<TaskGroup> group) {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mTaskGroup = group;
+}
+
+void Demuxer::setInputConfig(const InputConfig& config) {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mInputConfig = config;
+}
+
+std::unique_ptr<IOBackend> Demuxer::createIOBackend() {
+    InputConfig config;
+    {
+        std::lock_guard<std::mutex> lock(mConfigMutex);
+        config = mInputConfig;
+    }
+
+    switch (config.backend) {
+        case InputBackend::READ_AHEAD:
+            return std::make_unique<ReadAheadIO>(config.readAheadBlockSize,
+                                                 config.readAheadBlockCount,
+                                                 mLogger);
+        case InputBackend::MMAP:
+            if (MmapIO::isLocalPath(mUrl)) {
+                return std::make_unique<MmapIO>(mLogger);
+            }
+            return nullptr;
+        case InputBackend::DISK_CACHE:
+            if (CachedIO::isNetworkUrl(mUrl) &&
+                !config.cacheDirectory.empty()) {
+                return std::make_unique<CachedIO>(
+                    config.cacheDirectory, config.cacheSizeLimit, mLogger);
+            }
+            return nullptr;
+        default:
+            return nullptr;
+    }
+}
+
+void Demuxer::setTimeshiftConfig(const TimeshiftConfig& config) {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mTimeshiftConfig = config;
+}
+
+bool Demuxer::getTimeshiftRange(int64_t& startUs, int64_t& endUs) const {
+    std::shared_ptr<TimeshiftBuffer> timeshift;
+    {
+        std::lock_guard<std::mutex> lock(mConfigMutex);
+        timeshift = mTimeshift;
+    }
+    return timeshift && timeshift->getRange(startUs, endUs);
+}
+
+std::shared_ptr<TimeshiftBuffer> Demuxer::createTimeshiftBuffer(
+    int keyStreamIndex) {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mTimeshift.reset();
+    if (!mIsLive || !mTimeshiftConfig.enabled || keyStreamIndex < 0) {
+        return nullptr;
+    }
+
+    auto timeshift = std::make_shared<TimeshiftBuffer>(
+        mTimeshiftConfig, keyStreamIndex, mLogger);
+    if (!timeshift->open()) {
+        return nullptr;
+    }
+    mTimeshift = timeshift;
+    return timeshift;
+}
+
+bool Demuxer::startRecording(const std::string& path) {
+    auto recorder = std::make_shared<Recorder>(path, mLogger);
+    {
+        // 录制当前选中的音视频流，参数来自打开时的探测结果
+        std::lock_guard<std::mutex> lock(mMutex);
+        int keyStreamIndex = mMediaInfo.videoStreamIndex >= 0
+                                 ? mMediaInfo.videoStreamIndex
+                                 : mMediaInfo.audioStreamIndex;
+        for (int streamIndex :
+             {mMediaInfo.videoStreamIndex, mMediaInfo.audioStreamIndex}) {
+            auto params = mTrackParams.find(streamIndex);
+            if (params != mTrackParams.end() &&
+                !recorder->addStream(streamIndex, params->second,
+                                     streamIndex == keyStreamIndex)) {
+                return false;
+            }
+        }
+    }
+    if (!recorder->start()) {
+        return false;
+    }
+
+    std::shared_ptr<Recorder> previous;
+    {
+        std::lock_guard<std::mutex> lock(mRecorderMutex);
+        previous = mRecorder;
+        mRecorder = recorder;
+        mRecording = true;
+    }
+    if (previous) {
+        previous->stop();
+    }
+    return true;
+}
+
+void Demuxer::stopRecording() {
+    std::shared_ptr<Recorder> recorder;
+    {
+        std::lock_guard<std::mutex> lock(mRecorderMutex);
+        recorder = mRecorder;
+        mRecorder.reset();
+        mRecording = false;
+    }
+    // 在调用线程上写完剩余数据并关闭文件，解复用线程不等待
+    if (recorder) {
+        recorder->stop();
+    }
+}
+
+RecordingStats Demuxer::getRecordingStats() const {
+    std::lock_guard<std::mutex> lock(mRecorderMutex);
+    return mRecorder ? mRecorder->getStats() : RecordingStats();
+}
+
+ErrorCode Demuxer::openInput(AVFormatContext** formatContext,
+                             std::unique_ptr<IOBackend>& io) {
+    mProbeCacheHit = false;
+    AVFormatContext* context = avformat_alloc_context();
+    if (!context) {
+        notifyError(ErrorCode::DEMUXER_OPEN_FAILED, "无法创建解复用上下文");
+        return ErrorCode::DEMUXER_OPEN_FAILED;
+    }
+
+    // 安装中断回调，停止、跳转和超时都能打断阻塞的I/O
+    context->interrupt_callback.callback = &Demuxer::interruptCallback;
+    context->interrupt_callback.opaque = this;
+    applyOpenProfile(context);
+
+    // 自定义I/O后端，FFmpeg通过AVIOContext从后端读取
+    io = createIOBackend();
+    if (io) {
+        beginIo(IoOperation::OPEN);
+        bool opened = io->open(mUrl, context->interrupt_callback);
+        endIo();
+        AVIOContext* avioContext = opened ? io->getAVIOContext() : nullptr;
+        if (!avioContext) {
+            avformat_free_context(context);
+            io.reset();
+            if (mAbortRequested) {
+                YFF_LOG(mLogger, LogLevel::Info, "Demuxer",
+                        "打开媒体文件已取消");
+            } else if (mIoTimedOut) {
+                notifyError(ErrorCode::DEMUXER_TIMEOUT,
+                            "打开媒体文件超时: " + mUrl);
+            } else {
+                notifyError(ErrorCode::DEMUXER_OPEN_FAILED,
+                            "无法打开媒体文件: " + mUrl);
+            }
+            return ErrorCode::DEMUXER_OPEN_FAILED;
+        }
+        context->pb = avioContext;
+        context->flags |= AVFMT_FLAG_CUSTOM_IO;
+    }
+
+    // 打开输入文件，失败时context由FFmpeg释放
+    beginIo(IoOperation::OPEN);
+    int ret = avformat_open_input(&context, mUrl.c_str(), nullptr, nullptr);
+    endIo();
+    if (ret != 0) {
+        if (mAbortRequested) {
+            YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "打开媒体文件已取消");
+        } else if (mIoTimedOut) {
+            notifyError(ErrorCode::DEMUXER_TIMEOUT, "打开媒体文件超时: " + mUrl);
+        } else {
             notifyError(ErrorCode::DEMUXER_OPEN_FAILED,
                         "无法打开媒体文件: " + mUrl);
-            return;
         }
+        return ErrorCode::DEMUXER_OPEN_FAILED;
+    }
+
+    // 命中探测缓存时跳过查找流信息
+    std::shared_ptr<ProbeCache> probeCache;
+    {
+        std::lock_guard<std::mutex> lock(mConfigMutex);
+        probeCache = mProbeCache;
+    }
+    std::string probeKey =
+        probeCache ? ProbeCache::makeKey(mUrl, context) : std::string();
+    if (probeCache && probeCache->apply(probeKey, context)) {
+        YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "使用缓存的流信息: %s",
+                mUrl.c_str());
+        mProbeCacheHit = true;
+        *formatContext = context;
+        return ErrorCode::SUCCESS;
+    }
 
-        // 查找流信息
-        if (avformat_find_stream_info(formatContext, nullptr) < 0) {
+    // 快速启动时文件头已足够，跳过读取数据的探测
+    if (canSkipProbe(context)) {
+        YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "文件头信息完整，跳过探测");
+        *formatContext = context;
+        return ErrorCode::SUCCESS;
+    }
+
+    // 查找流信息
+    beginIo(IoOperation::PROBE);
+    ret = avformat_find_stream_info(context, nullptr);
+    endIo();
+    if (ret < 0) {
+        if (mAbortRequested) {
+            YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "查找流信息已取消");
+        } else if (mIoTimedOut) {
+            notifyError(ErrorCode::DEMUXER_TIMEOUT, "查找流信息超时");
+        } else {
             notifyError(ErrorCode::DEMUXER_FIND_STREAM_FAILED,
                         "无法查找流信息");
-            avformat_close_input(&formatContext);
-            return;
         }
+        avformat_close_input(&context);
+        return ErrorCode::DEMUXER_FIND_STREAM_FAILED;
+    }
+    if (probeCache) {
+        probeCache->store(probeKey, context);
+    }
+
+    *formatContext = context;
+    return ErrorCode::SUCCESS;
+}
+
+void Demuxer::beginIo(IoOperation operation) {
+    int64_t timeout = 0;
+    switch (operation) {
+        case IoOperation::OPEN:
+            timeout = mOpenTimeoutUs;
+            break;
+        case IoOperation::PROBE:
+            timeout = mProbeTimeoutUs;
+            break;
+        case IoOperation::READ:
+        case IoOperation::SEEK:
+            timeout = mReadTimeoutUs;
+            break;
+        default:
+            break;
+    }
+
+    mIoTimedOut = false;
+    mIoDeadline = timeout > 0 ? av_gettime_relative() + timeout : 0;
+    mIoOperation = operation;
+}
+
+void Demuxer::endIo() {
+    mIoOperation = IoOperation::NONE;
+    mIoDeadline = 0;
+}
+
+int Demuxer::interruptCallback(void* opaque) {
+    Demuxer* demuxer = static_cast<Demuxer*>(opaque);
+
+    if (demuxer->mAbortRequested) {
+        return 1;
+    }
+
+    // 读取过程中收到跳转或切换轨道请求，立即返回去处理
+    if (demuxer->mIoOperation == IoOperation::READ &&
+        (demuxer->mIsSeeking || demuxer->mTrackSwitchPending)) {
+        return 1;
+    }
+
+    int64_t deadline = demuxer->mIoDeadline;
+    if (deadline > 0 && av_gettime_relative() > deadline) {
+        demuxer->mIoTimedOut = true;
+        return 1;
+    }
+    return 0;
+}
+
+void Demuxer::clearLoopCache(std::vector<AVPacket*>& cache) {
+    for (AVPacket* packet : cache) {
+        av_packet_free(&packet);
+    }
+    cache.clear();
+}
+
+MediaInfo Demuxer::getMediaInfo() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMediaInfo;
+}
+
+void Demuxer::setTrackPreferences(const TrackPreferences& preferences) {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mTrackPreferences = preferences;
+}
+
+bool Demuxer::selectTrack(int streamIndex, int64_t positionUs) {
+    MediaType type = MediaType::UNKNOWN;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const TrackInfo& track : mMediaInfo.tracks) {
+            if (track.streamIndex == streamIndex) {
+                if (track.selected) {
+                    return true;
+                }
+                type = track.type;
+            }
+        }
+    }
+    if (type == MediaType::UNKNOWN) {
+        YFF_LOG(mLogger, LogLevel::Warning, "Demuxer", "无效的轨道: %d",
+                streamIndex);
+        return false;
+    }
 
-        // 查找音视频流
-        for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
-            AVStream* stream = formatContext->streams[i];
-            if (stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
-                audioStreamIndex < 0) {
-                audioStreamIndex = i;
-            } else if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
-                       videoStreamIndex < 0) {
+    // 读取线程运行时由其完成切换，保证旧轨道的数据包不再入队
+    if (mIsRunning) {
+        std::unique_lock<std::mutex> lock(mTrackSwitchMutex);
+        mPendingTrackIndex = streamIndex;
+        mPendingTrackPosition = positionUs;
+        mTrackSwitchPending = true;
+        mRunner.wake();
+        mTrackSwitchDone.wait_for(lock, TRACK_SWITCH_TIMEOUT, [this]() {
+            return !mTrackSwitchPending || !mIsRunning;
+        });
+        if (mTrackSwitchPending) {
+            mTrackSwitchPending = false;
+            YFF_LOG(mLogger, LogLevel::Error, "Demuxer", "切换轨道超时");
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (type == MediaType::AUDIO) {
+        mAudioStreamIndex = streamIndex;
+    } else {
+        mVideoStreamIndex = streamIndex;
+    }
+    updateSelectedTracks(mAudioStreamIndex, mVideoStreamIndex);
+    YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "已切换到轨道: %d",
+            streamIndex);
+    return true;
+}
+
+void Demuxer::selectStreams(AVFormatContext* context, int& audioStreamIndex,
+                            int& videoStreamIndex) {
+    TrackPreferences preferences;
+    {
+        std::lock_guard<std::mutex> lock(mConfigMutex);
+        preferences = mTrackPreferences;
+    }
+
+    // 先按偏好找出候选流，再由av_find_best_stream确认
+    int wantedVideo = findPreferredStream(context, AVMEDIA_TYPE_VIDEO, "",
+                                          preferences.videoCodec);
+    videoStreamIndex = av_find_best_stream(context, AVMEDIA_TYPE_VIDEO,
+                                           wantedVideo, -1, nullptr, 0);
+    if (videoStreamIndex < 0) {
+        videoStreamIndex = wantedVideo;
+    }
+    if (videoStreamIndex >= 0 &&
+        (context->streams[videoStreamIndex]->disposition &
+         AV_DISPOSITION_ATTACHED_PIC)) {
+        // 封面图不作为视频流播放
+        videoStreamIndex = -1;
+        for (unsigned int i = 0; i < context->nb_streams; i++) {
+            AVStream* stream = context->streams[i];
+            if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
+                !(stream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
                 videoStreamIndex = i;
+                break;
             }
         }
+    }
 
-        // 分配AVPacket
-        avPacket = av_packet_alloc();
+    // 音频优先选择与视频同一节目的流
+    int wantedAudio =
+        findPreferredStream(context, AVMEDIA_TYPE_AUDIO,
+                            preferences.audioLanguage, preferences.audioCodec);
+    audioStreamIndex = av_find_best_stream(context, AVMEDIA_TYPE_AUDIO,
+                                           wantedAudio, videoStreamIndex,
+                                           nullptr, 0);
+    if (audioStreamIndex < 0) {
+        audioStreamIndex = wantedAudio;
+    }
+    if (preferences.videoOnly) {
+        audioStreamIndex = -1;
+    }
+
+    applyStreamDiscard(context, audioStreamIndex, videoStreamIndex);
+}
+
+int Demuxer::findPreferredStream(AVFormatContext* context, AVMediaType type,
+                                 const std::string& language,
+                                 const std::string& codec) {
+    if (language.empty() && codec.empty()) {
+        return -1;
+    }
+
+    // 语言和编码都匹配优先，其次语言匹配，最后编码匹配
+    int languageMatch = -1;
+    int codecMatch = -1;
+    for (unsigned int i = 0; i < context->nb_streams; i++) {
+        AVStream* stream = context->streams[i];
+        if (stream->codecpar->codec_type != type ||
+            (stream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+            continue;
+        }
+
+        AVDictionaryEntry* entry =
+            av_dict_get(stream->metadata, "language", nullptr, 0);
+        bool languageMatched =
+            language.empty() || (entry && language == entry->value);
+        bool codecMatched =
+            codec.empty() ||
+            codec == avcodec_get_name(stream->codecpar->codec_id);
+        if (languageMatched && codecMatched) {
+            return i;
+        }
+        if (languageMatched && !language.empty() && languageMatch < 0) {
+            languageMatch = i;
+        }
+        if (codecMatched && !codec.empty() && codecMatch < 0) {
+            codecMatch = i;
+        }
+    }
+    return languageMatch >= 0 ? languageMatch : codecMatch;
+}
+
+void Demuxer::applyStreamDiscard(AVFormatContext* context,
+                                 int audioStreamIndex, int videoStreamIndex) {
+    // 未选中的流（字幕、数据、其他语言音轨、封面等）由解复用器直接跳过
+    for (unsigned int i = 0; i < context->nb_streams; i++) {
+        bool selected = static_cast<int>(i) == audioStreamIndex ||
+                        static_cast<int>(i) == videoStreamIndex;
+        context->streams[i]->discard =
+            selected ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+}
+
+void Demuxer::updateSelectedTracks(int audioStreamIndex,
+                                   int videoStreamIndex) {
+    auto audioParams = mTrackParams.find(audioStreamIndex);
+    auto videoParams = mTrackParams.find(videoStreamIndex);
+
+    mMediaInfo.hasAudio = audioParams != mTrackParams.end();
+    mMediaInfo.hasVideo = videoParams != mTrackParams.end();
+    mMediaInfo.audioStreamIndex = mMediaInfo.hasAudio ? audioStreamIndex : -1;
+    mMediaInfo.videoStreamIndex = mMediaInfo.hasVideo ? videoStreamIndex : -1;
+    mMediaInfo.audioCodecParam =
+        mMediaInfo.hasAudio ? audioParams->second : nullptr;
+    mMediaInfo.videoCodecParam =
+        mMediaInfo.hasVideo ? videoParams->second : nullptr;
+
+    if (mMediaInfo.hasAudio) {
+        mMediaInfo.audiochannels = audioParams->second->ch_layout.nb_channels;
+        mMediaInfo.audioSampleRate = audioParams->second->sample_rate;
+    }
+
+    if (mMediaInfo.hasVideo) {
+        mMediaInfo.videoWidth = videoParams->second->width;
+        mMediaInfo.videoHeight = videoParams->second->height;
+    }
+
+    if (mMediaInfo.hasAudio) {
+        if (mMediaInfo.hasVideo) {
+            mMediaInfo.type = MediaType::AUDIO_VIDEO;
+        } else {
+            mMediaInfo.type = MediaType::AUDIO;
+        }
+    } else {
+        if (mMediaInfo.hasVideo) {
+            mMediaInfo.type = MediaType::VIDEO;
+        } else {
+            mMediaInfo.type = MediaType::UNKNOWN;
+        }
+    }
+
+    for (TrackInfo& track : mMediaInfo.tracks) {
+        track.selected = track.streamIndex == mMediaInfo.audioStreamIndex ||
+                         track.streamIndex == mMediaInfo.videoStreamIndex;
+    }
+}
+
+void Demuxer::freeTrackParams() {
+    for (auto& entry : mTrackParams) {
+        avcodec_parameters_free(&entry.second);
+    }
+    mTrackParams.clear();
+    mMediaInfo.audioCodecParam = nullptr;
+    mMediaInfo.videoCodecParam = nullptr;
+}
+
+void Demuxer::recordPacket(const AVPacket* packet, uint32_t generation) {
+    if (!mRecording) {
+        return;
+    }
+    std::shared_ptr<Recorder> recorder;
+    {
+        std::lock_guard<std::mutex> lock(mRecorderMutex);
+        recorder = mRecorder;
+    }
+    if (recorder) {
+        recorder->write(packet, generation);
+    }
+}
+
+void Demuxer::clearPacketQueue(BufferQueue<AVPacket*>& queue) {
+    AVPacket* packet = nullptr;
+    while (queue.tryPop(packet)) {
+        av_packet_free(&packet);
+    }
+}
+
+bool Demuxer::beginRead() {
+    ReadState& read = *mRead;
+
+    // 打开输入文件并查找流信息
+    if (openInput(&read.formatContext, read.io) != ErrorCode::SUCCESS) {
+        return false;
+    }
+
+    // 使用open()选定的流，其余流由解复用器丢弃
+    read.audioStreamIndex = mAudioStreamIndex;
+    read.videoStreamIndex = mVideoStreamIndex;
+    int streamCount = static_cast<int>(read.formatContext->nb_streams);
+    if (read.audioStreamIndex >= streamCount ||
+        read.videoStreamIndex >= streamCount) {
+        selectStreams(read.formatContext, read.audioStreamIndex,
+                      read.videoStreamIndex);
+    } else {
+        applyStreamDiscard(read.formatContext, read.audioStreamIndex,
+                           read.videoStreamIndex);
+    }
+
+    // 分配AVPacket
+    read.avPacket = av_packet_alloc();
+
+    read.timeshift = createTimeshiftBuffer(read.videoStreamIndex >= 0
+                                               ? read.videoStreamIndex
+                                               : read.audioStreamIndex);
+    return true;
+}
+
+CoStage Demuxer::readLoop() {
+    try {
+        if (!beginRead()) {
+            endRead();
+            co_return;
+        }
+        ReadState& read = *mRead;
 
-        // 主循环
         while (mIsRunning) {
-            // 处理seek请求
+            // 每次循环处理一个数据包，之后让出执行权
+            co_await stageYield();
+
+            // 处理seek请求，连续的请求只执行最后一个
             if (mIsSeeking) {
-                int64_t seekTarget = mSeekPosition;
-
-                // 将微秒转换为AVStream时间基
-                if (videoStreamIndex >= 0) {
-                    AVStream* stream = formatContext->streams[videoStreamIndex];
-                    seekTarget = av_rescale_q(seekTarget, AV_TIME_BASE_Q,
-                                              stream->time_base);
-                    av_seek_frame(formatContext, videoStreamIndex, seekTarget,
-                                  AVSEEK_FLAG_BACKWARD);
-                } else if (audioStreamIndex >= 0) {
-                    AVStream* stream = formatContext->streams[audioStreamIndex];
-                    seekTarget = av_rescale_q(seekTarget, AV_TIME_BASE_Q,
-                                              stream->time_base);
-                    av_seek_frame(formatContext, audioStreamIndex, seekTarget,
-                                  AVSEEK_FLAG_BACKWARD);
+                int64_t position = 0;
+                {
+                    std::lock_guard<std::mutex> lock(mSeekMutex);
+                    position = mSeekPosition;
+                    read.generation = mGeneration->current();
+                    mIsSeeking = false;
                 }
+                int64_t seekTarget = position;
 
-                mIsSeeking = false;
-                mLogger->log(LogLevel::Info, "Demuxer", "跳转完成");
+                // 已排队的旧数据包由解码器按代号丢弃，这里不清空队列
+                if (read.timeshift) {
+                    // 时移窗口内的跳转由环形缓冲区提供，不重新连接
+                    if (!read.timeshift->seek(seekTarget)) {
+                        YFF_LOG(mLogger, LogLevel::Warning, "Demuxer",
+                                "跳转位置不在时移窗口内");
+                    }
+                } else if (read.loopCacheComplete) {
+                    // 从缓存中定位到目标之前最近的关键帧
+                    int keyStreamIndex = read.videoStreamIndex >= 0
+                                             ? read.videoStreamIndex
+                                             : read.audioStreamIndex;
+                    read.replayIndex = 0;
+                    for (size_t i = 0; i < read.loopCache.size(); i++) {
+                        AVPacket* cached = read.loopCache[i];
+                        if (cached->stream_index == keyStreamIndex &&
+                            (cached->flags & AV_PKT_FLAG_KEY) &&
+                            cached->pts != AV_NOPTS_VALUE &&
+                            cached->pts <= seekTarget) {
+                            read.replayIndex = i;
+                        }
+                    }
+                } else {
+                    // 将微秒转换为AVStream时间基
+                    if (read.videoStreamIndex >= 0) {
+                        AVStream* stream =
+                            read.formatContext->streams[read.videoStreamIndex];
+                        seekTarget = av_rescale_q(seekTarget, AV_TIME_BASE_Q,
+                                                  stream->time_base);
+                        beginIo(IoOperation::SEEK);
+                        av_seek_frame(read.formatContext, read.videoStreamIndex,
+                                      seekTarget, AVSEEK_FLAG_BACKWARD);
+                        endIo();
+                    } else if (read.audioStreamIndex >= 0) {
+                        AVStream* stream =
+                            read.formatContext->streams[read.audioStreamIndex];
+                        seekTarget = av_rescale_q(seekTarget, AV_TIME_BASE_Q,
+                                                  stream->time_base);
+                        beginIo(IoOperation::SEEK);
+                        av_seek_frame(read.formatContext, read.audioStreamIndex,
+                                      seekTarget, AVSEEK_FLAG_BACKWARD);
+                        endIo();
+                    }
+
+                    // 缓存必须从片段开头完整读取，只有跳回开头才重新缓存
+                    clearLoopCache(read.loopCache);
+                    read.loopCacheBytes = 0;
+                    read.loopCacheEnabled = true;
+                    read.atClipStart =
+                        position <= 0 || (read.clipStartUs != AV_NOPTS_VALUE &&
+                                          position <= read.clipStartUs);
+                }
+
+                // 跳转后时间戳回到媒体时间
+                read.loopOffsetUs = 0;
+                read.lastAudioDts = AV_NOPTS_VALUE;
+                read.lastVideoDts = AV_NOPTS_VALUE;
+                read.dropAudioUntilDts = AV_NOPTS_VALUE;
+                read.dropVideoUntilDts = AV_NOPTS_VALUE;
+                read.dropAudioBeforeUs = AV_NOPTS_VALUE;
+                read.skipUntilPts = AV_NOPTS_VALUE;
+                if (!read.timeshift) {
+                    mLastReadPts = -1;
+                }
+                mIsEndOfFile = false;
+                YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "跳转完成");
 
                 // 通知跳转完成
                 if (mCallback) {
-                    mCallback->onSeekCompleted(mSeekPosition);
+                    mCallback->onSeekCompleted(position);
                 }
 
                 updateState(DemuxerState::RUNNING);
                 continue;
             }
 
-            // 检查缓冲区是否已满
-            if (mAudioBuffer->full() || mVideoBuffer->full()) {
-                // 如果缓冲区已满，睡眠一段时间后继续
-                //                mLogger->log(LogLevel::Warning, "Demuxer",
-                //                                "缓冲区已满，等待数据处理");
-                av_usleep(10000);  // 10毫秒 = 10000微秒
+            // 处理切换轨道请求，只有被替换的流重新读取
+            if (mTrackSwitchPending) {
+                int streamIndex = mPendingTrackIndex;
+                int64_t position = mPendingTrackPosition;
+                AVStream* switchStream =
+                    read.formatContext->streams[streamIndex];
+                bool isAudio =
+                    switchStream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO;
+                if (isAudio) {
+                    read.audioStreamIndex = streamIndex;
+                } else {
+                    read.videoStreamIndex = streamIndex;
+                }
+                applyStreamDiscard(read.formatContext, read.audioStreamIndex,
+                                   read.videoStreamIndex);
+
+                // 丢弃旧轨道已排队的数据包，解码器此时已停止
+                clearPacketQueue(isAudio ? *mAudioBuffer : *mVideoBuffer);
+
+                // 缓存中没有新轨道的数据，改为从文件读取
+                clearLoopCache(read.loopCache);
+                read.loopCacheBytes = 0;
+                read.loopCacheComplete = false;
+                read.loopCacheEnabled = false;
+                read.atClipStart = false;
+
+                // 回到播放位置；另一条流不能出现空洞，
+                // 跳转点不晚于其已送出的位置
+                int64_t otherLastDts =
+                    isAudio ? read.lastVideoDts : read.lastAudioDts;
+                int64_t target = position;
+                if (otherLastDts != AV_NOPTS_VALUE) {
+                    target = std::min(target, otherLastDts);
+                }
+                target = std::max<int64_t>(target - read.loopOffsetUs, 0);
+                int seekStreamIndex = read.videoStreamIndex >= 0
+                                          ? read.videoStreamIndex
+                                          : read.audioStreamIndex;
+                AVStream* seekStream =
+                    read.formatContext->streams[seekStreamIndex];
+                beginIo(IoOperation::SEEK);
+                av_seek_frame(read.formatContext, seekStreamIndex,
+                              av_rescale_q(target, AV_TIME_BASE_Q,
+                                           seekStream->time_base),
+                              AVSEEK_FLAG_BACKWARD);
+                endIo();
+
+                // 环形缓冲区中没有新轨道的数据，重新建立时移窗口
+                if (read.timeshift) {
+                    read.timeshift = createTimeshiftBuffer(
+                        read.videoStreamIndex >= 0 ? read.videoStreamIndex
+                                                   : read.audioStreamIndex);
+                }
+
+                if (isAudio) {
+                    read.dropVideoUntilDts = read.lastVideoDts;
+                    read.dropAudioBeforeUs = position;
+                    read.lastAudioDts = AV_NOPTS_VALUE;
+                } else {
+                    read.dropAudioUntilDts = read.lastAudioDts;
+                    read.lastVideoDts = AV_NOPTS_VALUE;
+                }
+                mIsEndOfFile = false;
+
+                {
+                    std::lock_guard<std::mutex> lock(mTrackSwitchMutex);
+                    mTrackSwitchPending = false;
+                }
+                mTrackSwitchDone.notify_all();
                 continue;
             }
 
-            // 读取下一个数据包
-            int ret = av_read_frame(formatContext, avPacket);
-            if (ret < 0) {
-                if (ret == AVERROR_EOF ||
-                    (formatContext->pb && formatContext->pb->eof_reached)) {
-                    // 文件结束
-                    mLogger->log(LogLevel::Info, "Demuxer", "文件结束");
-
-                    // 通知文件结束
-                    if (mCallback) {
-                        mCallback->onEndOfFile();
-                    }
+            // 已到达文件末尾，等待跳转或停止
+            if (mIsEndOfFile) {
+                co_await stageWaitUntil([this]() { return !mIsEndOfFile; });
+                continue;
+            }
+
+            // 检查缓冲区是否已满，时移模式下据此决定是否从环形缓冲区送出
+            bool queueFull = mAudioBuffer->full() || mVideoBuffer->full();
+
+            AVPacket* packet = nullptr;
+            bool endOfClip = false;
 
-                    // 对于非直播流，可以选择循环播放或停止
-                    if (!mIsLive) {
-                        // 回到文件开头
-                        av_seek_frame(formatContext, -1, 0,
-                                      AVSEEK_FLAG_BACKWARD);
+            if (read.timeshift && !queueFull &&
+                (packet = read.timeshift->read())) {
+                // 队列有空间时先送出环形缓冲区中读取位置之后的数据包；
+                // 队列已满（如暂停）时继续接收直播数据，不断开连接
+            } else if (read.loopCacheComplete) {
+                // 从内存缓存回放，不读取输入
+                if (read.replayIndex < read.loopCache.size()) {
+                    packet = av_packet_clone(
+                        read.loopCache[read.replayIndex++]);
+                    if (!packet) {
                         continue;
-                    } else {
-                        break;
                     }
                 } else {
-                    // 其他错误
-                    notifyError(ErrorCode::DEMUXER_READ_FAILED,
-                                "读取帧错误: " + std::to_string(ret));
-                    av_usleep(10000);  // 10毫秒 = 10000微秒
+                    endOfClip = true;
+                }
+            } else {
+                // 读取下一个数据包，记录读取耗时用于吞吐量统计
+                int64_t readStartTime = av_gettime_relative();
+                int ret = 0;
+                {
+                    TraceSpan readSpan(TraceEvent::DEMUX_READ);
+                    beginIo(IoOperation::READ);
+                    ret = av_read_frame(read.formatContext, read.avPacket);
+                    endIo();
+                    if (kTracingCompiled && ret >= 0 &&
+                        read.avPacket->pts != AV_NOPTS_VALUE) {
+                        int streamIndex = read.avPacket->stream_index;
+                        AVStream* stream =
+                            read.formatContext->streams[streamIndex];
+                        readSpan.setId(av_rescale_q(read.avPacket->pts,
+                                                    stream->time_base,
+                                                    AV_TIME_BASE_Q));
+                    }
+                }
+                int64_t readUs = av_gettime_relative() - readStartTime;
+                mReadTimeUs += readUs;
+                if (read.stats && ret >= 0) {
+                    read.stats->recordStage(PipelineStats::Stage::DEMUX,
+                                            readUs);
+                }
+                if (ret == AVERROR_EXIT && !mIoTimedOut) {
+                    // 被停止或跳转请求中断，回到循环开头处理
+                    continue;
+                }
+                if (ret < 0) {
+                    if (mIoTimedOut) {
+                        notifyError(ErrorCode::DEMUXER_TIMEOUT, "读取数据超时");
+                        continue;
+                    }
+                    AVIOContext* pb = read.formatContext->pb;
+                    if (ret == AVERROR_EOF || (pb && pb->eof_reached)) {
+                        endOfClip = true;
+                    } else {
+                        // 其他错误
+                        notifyError(ErrorCode::DEMUXER_READ_FAILED,
+                                    "读取帧错误: " + std::to_string(ret));
+                        co_await stageSleep(10000);  // 10毫秒
+                        continue;
+                    }
+                } else if (read.avPacket->stream_index ==
+                               read.audioStreamIndex ||
+                           read.avPacket->stream_index ==
+                               read.videoStreamIndex) {
+                    packet = av_packet_clone(read.avPacket);
+                    // 队列中的数据包统一使用微秒时间戳
+                    if (packet) {
+                        AVStream* stream =
+                            read.formatContext->streams[packet->stream_index];
+                        av_packet_rescale_ts(packet, stream->time_base,
+                                             AV_TIME_BASE_Q);
+
+                        // 部分容器的视频包没有时长，按帧率补齐
+                        if (packet->duration <= 0 &&
+                            packet->stream_index == read.videoStreamIndex &&
+                            stream->avg_frame_rate.num > 0 &&
+                            stream->avg_frame_rate.den > 0) {
+                            packet->duration =
+                                av_rescale(AV_TIME_BASE,
+                                           stream->avg_frame_rate.den,
+                                           stream->avg_frame_rate.num);
+                        }
+
+                        mBytesRead += packet->size;
+                        int primaryStreamIndex = read.videoStreamIndex >= 0
+                                                     ? read.videoStreamIndex
+                                                     : read.audioStreamIndex;
+                        if (packet->stream_index == primaryStreamIndex) {
+                            mMediaTimeRead +=
+                                std::max<int64_t>(packet->duration, 0);
+                        }
+
+                        // 时移模式录制直播的最新数据，而不是回看的位置
+                        if (read.timeshift) {
+                            recordPacket(packet, read.generation);
+                        }
+                    }
+                }
+
+                // 释放AVPacket
+                av_packet_unref(read.avPacket);
+
+                if (read.timeshift && packet) {
+                    if (packet->pts != AV_NOPTS_VALUE &&
+                        packet->pts > mLastReadPts) {
+                        mLastReadPts = packet->pts;
+                    }
+                    read.timeshift->append(packet);
+                    av_packet_free(&packet);
                     continue;
                 }
             }
 
-            // 处理音视频数据包
-            if (avPacket->stream_index == audioStreamIndex ||
-                avPacket->stream_index == videoStreamIndex) {
-                AVPacket* packet = av_packet_clone(avPacket);
+            if (endOfClip) {
+                // 对于非直播流，在循环模式下回到开头并偏移时间戳
+                if (mLoop && !mIsLive) {
+                    int64_t clipLengthUs =
+                        (read.clipStartUs != AV_NOPTS_VALUE &&
+                         read.clipEndUs != AV_NOPTS_VALUE)
+                            ? read.clipEndUs - read.clipStartUs
+                            : read.formatContext->duration;
+                    clipLengthUs = std::max<int64_t>(clipLengthUs, 0);
+                    read.loopOffsetUs += clipLengthUs;
+                    // 供播放器把单调递增的时钟换算回片段内的位置
+                    mLoopClipStartUs = read.clipStartUs != AV_NOPTS_VALUE
+                                           ? read.clipStartUs
+                                           : 0;
+                    mLoopClipLengthUs = clipLengthUs;
 
-                if (!packet) {
+                    if (!read.loopCacheComplete) {
+                        if (read.atClipStart && read.loopCacheEnabled &&
+                            !read.loopCache.empty()) {
+                            read.loopCacheComplete = true;
+                            YFF_LOG(
+                                mLogger, LogLevel::Info, "Demuxer",
+                                "循环片段已缓存: %lld 字节",
+                                static_cast<long long>(read.loopCacheBytes));
+                        } else {
+                            clearLoopCache(read.loopCache);
+                            read.loopCacheBytes = 0;
+                            read.loopCacheEnabled = true;
+                            read.atClipStart = true;
+                            av_seek_frame(read.formatContext, -1, 0,
+                                          AVSEEK_FLAG_BACKWARD);
+                        }
+                    }
+                    read.replayIndex = 0;
                     continue;
                 }
-                // 将数据包放入缓冲区
-                if (avPacket->stream_index == audioStreamIndex) {
-                    mAudioBuffer->tryPush(packet);
-                } else if (avPacket->stream_index == videoStreamIndex) {
-                    mVideoBuffer->tryPush(packet);
+
+                // 文件结束
+                YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "文件结束");
+                mIsEndOfFile = true;
+
+                // 通知文件结束
+                if (mCallback) {
+                    mCallback->onEndOfFile();
                 }
 
-                // 根据播放速率控制读取速度
-                if (mPlaybackRate < 2.0f) {
-                    av_usleep(static_cast<unsigned int>(
-                        10000 / mPlaybackRate));  // 10毫秒 / 播放速率
+                if (mIsLive) {
+                    break;
                 }
+                continue;
             }
 
-            // 释放AVPacket
-            av_packet_unref(avPacket);
+            if (!packet) {
+                continue;
+            }
+
+            // 记录片段时间范围，用于计算循环偏移
+            if (packet->pts != AV_NOPTS_VALUE) {
+                int64_t endUs =
+                    packet->pts + std::max<int64_t>(packet->duration, 0);
+                if (read.clipStartUs == AV_NOPTS_VALUE ||
+                    packet->pts < read.clipStartUs) {
+                    read.clipStartUs = packet->pts;
+                }
+                if (read.clipEndUs == AV_NOPTS_VALUE ||
+                    endUs > read.clipEndUs) {
+                    read.clipEndUs = endUs;
+                }
+            }
+
+            // 本轮中途切换过循环开关时，已读部分不完整，放弃本轮缓存
+            uint32_t loopChanges = mLoopChanges;
+            if (loopChanges != read.loopChanges) {
+                read.loopChanges = loopChanges;
+                if (!read.loopCacheComplete) {
+                    clearLoopCache(read.loopCache);
+                    read.loopCacheBytes = 0;
+                    read.atClipStart = false;
+                }
+            }
+
+            // 从片段开头读取的一轮缓存数据包，超过限制则放弃缓存
+            if (mLoop && !mIsLive && !read.loopCacheComplete &&
+                read.atClipStart && read.loopCacheEnabled) {
+                if (read.loopCacheBytes + packet->size <= mLoopCacheLimit) {
+                    AVPacket* cached = av_packet_clone(packet);
+                    if (cached) {
+                        read.loopCache.push_back(cached);
+                        read.loopCacheBytes += packet->size;
+                    }
+                } else {
+                    clearLoopCache(read.loopCache);
+                    read.loopCacheBytes = 0;
+                    read.loopCacheEnabled = false;
+                }
+            }
+
+            // 叠加循环偏移，保证时钟单调递增
+            if (read.loopOffsetUs > 0) {
+                if (packet->pts != AV_NOPTS_VALUE) {
+                    packet->pts += read.loopOffsetUs;
+                }
+                if (packet->dts != AV_NOPTS_VALUE) {
+                    packet->dts += read.loopOffsetUs;
+                }
+            }
+
+            // 录制：转发已解复用的数据包，包括从缓存回放的循环，
+            // 不解码也不额外读取
+            if (!read.timeshift) {
+                recordPacket(packet, read.generation);
+            }
+
+            // 跳到最新关键帧：从已读到的最新位置之后的第一个关键帧开始送出
+            if (mSkipToKeyframe.exchange(false)) {
+                read.skipUntilPts = mLastReadPts;
+                read.generation = mGeneration->current();
+            }
+            if (packet->pts != AV_NOPTS_VALUE && packet->pts > mLastReadPts) {
+                mLastReadPts = packet->pts;
+            }
+            if (read.skipUntilPts != AV_NOPTS_VALUE) {
+                int keyStreamIndex = read.videoStreamIndex >= 0
+                                         ? read.videoStreamIndex
+                                         : read.audioStreamIndex;
+                if (packet->stream_index != keyStreamIndex ||
+                    !(packet->flags & AV_PKT_FLAG_KEY) ||
+                    packet->pts == AV_NOPTS_VALUE ||
+                    packet->pts < read.skipUntilPts) {
+                    av_packet_free(&packet);
+                    continue;
+                }
+                read.dropAudioBeforeUs = packet->pts;
+                read.skipUntilPts = AV_NOPTS_VALUE;
+            }
+
+            // 切换轨道后，未受影响的流跳过已经送出的数据包
+            bool isAudioPacket = packet->stream_index == read.audioStreamIndex;
+            int64_t& dropUntilDts =
+                isAudioPacket ? read.dropAudioUntilDts : read.dropVideoUntilDts;
+            if (dropUntilDts != AV_NOPTS_VALUE) {
+                if (packet->dts != AV_NOPTS_VALUE &&
+                    packet->dts <= dropUntilDts) {
+                    av_packet_free(&packet);
+                    continue;
+                }
+                dropUntilDts = AV_NOPTS_VALUE;
+            }
+
+            // 新音轨从播放位置开始送出
+            if (isAudioPacket && read.dropAudioBeforeUs != AV_NOPTS_VALUE) {
+                if (packet->pts != AV_NOPTS_VALUE &&
+                    packet->pts + packet->duration < read.dropAudioBeforeUs) {
+                    av_packet_free(&packet);
+                    continue;
+                }
+                read.dropAudioBeforeUs = AV_NOPTS_VALUE;
+            }
+
+            // 将数据包放入缓冲区
+            BufferQueue<AVPacket*>& queue =
+                isAudioPacket ? *mAudioBuffer : *mVideoBuffer;
+            PipelineStats::Queue statsQueue =
+                isAudioPacket ? PipelineStats::Queue::AUDIO_PACKETS
+                              : PipelineStats::Queue::VIDEO_PACKETS;
+            int64_t dts = packet->dts;
+            int64_t pts = packet->pts;
+            bool pushed = false;
+            setPacketGeneration(packet, read.generation);
+            if (read.timeshift) {
+                // 时移模式不等待，队列满时丢弃，数据包仍在环形缓冲区中
+                pushed = queue.tryPush(packet);
+                if (!pushed && read.stats) {
+                    read.stats->addDropped(statsQueue);
+                }
+            } else {
+                // 缓冲区已满时挂起，等待解码器取走数据包；
+                // 等待中停止时协程被销毁，由释放函数回收数据包
+                pushed = co_await queuePush(
+                    queue, packet, read.stats, statsQueue,
+                    [](AVPacket*& pending) { av_packet_free(&pending); });
+            }
+            if (!pushed) {
+                av_packet_free(&packet);
+                continue;
+            }
+            if (isAudioPacket) {
+                read.lastAudioDts = dts;
+            } else {
+                read.lastVideoDts = dts;
+            }
+            traceInstant(TraceEvent::ENQUEUE, pts);
         }
     } catch (const std::exception& e) {
         notifyError(ErrorCode::DEMUXER_EXCEPTION,
                     std::string("解复用循环异常: ") + e.what());
     }
+    endRead();
+}
+
+void Demuxer::endRead() {
+    if (!mRead) {
+        return;
+    }
+    ReadState& read = *mRead;
 
     // 清理资源
-    if (avPacket) {
-        av_packet_free(&avPacket);
+    clearLoopCache(read.loopCache);
+    if (read.avPacket) {
+        av_packet_free(&read.avPacket);
     }
 
-    if (formatContext) {
-        avformat_close_input(&formatContext);
+    if (read.formatContext) {
+        avformat_close_input(&read.formatContext);
     }
+    read.io.reset();
+    {
+        std::lock_guard<std::mutex> lock(mConfigMutex);
+        mTimeshift.reset();
+    }
+    mRead.reset();
+
+    // 唤醒等待切换轨道的调用方
+    mTrackSwitchDone.notify_all();
 
-    mLogger->log(LogLevel::Info, "Demuxer", "解复用线程已退出");
+    YFF_LOG(mLogger, LogLevel::Info, "Demuxer", "解复用线程已退出");
 }
 
 }  // namespace yffplayer
@@ -1,18 +1,32 @@
 #pragma once
 
+#include <condition_variable>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
-#include <thread>
+#include <vector>
 
 #include "BufferQueue.h"
+#include "CoStage.h"
 #include "DemuxerCallback.h"
+#include "Executor.h"
+#include "IOBackend.h"
 #include "Logger.h"
 #include "MediaInfo.h"
+#include "PipelineStats.h"
 #include "PlayerTypes.h"
+#include "ProbeCache.h"
+#include "Recorder.h"
+#include "SeekGeneration.h"
+#include "StageRunner.h"
+#include "TimeshiftBuffer.h"
 
 extern "C" {
 #include <libavcodec/packet.h>
+#include <libavutil/avutil.h>
+struct AVFormatContext;
+struct AVCodecParameters;
 }
 
 namespace yffplayer {
@@ -31,36 +45,204 @@ class Demuxer {
 
     void stop();
 
-    void seek(int64_t position);
+    // Interrupt blocking I/O (open, probe, read) without waiting
+    void abort();
 
-    void setPlaybackRate(float rate);
+    // Request a seek and return its generation. Packets read afterwards
+    // carry it; a request the read loop has not reached yet is replaced,
+    // so rapid seeks coalesce to the latest target. Reading resumes at the
+    // keyframe before position; a precise seek makes the decoders drop the
+    // frames between that keyframe and position.
+    uint32_t seek(int64_t position, bool precise = false);
 
     bool isLive() const;
 
+    // Whether the last open() took its stream info from the probe cache
+    bool isProbeCacheHit() const;
+
+    // Whether the input reached its end (never set while looping)
+    bool isEndOfFile() const;
+
+    // Loop playback: restart at EOF with timestamps offset by the clip length
+    void setLoop(bool loop);
+    bool isLoop() const;
+
+    // Clips whose packets fit in this many bytes are replayed from memory
+    void setLoopCacheLimit(int64_t bytes);
+
+    // Start and length of the clip in loop playback; each pass offsets the
+    // timestamps by the length. False until the input first wrapped.
+    bool getLoopClip(int64_t& startUs, int64_t& lengthUs) const;
+
+    // Input counters for throughput measurement
+    InputStats getInputStats() const;
+
+    // Set deadlines for blocking I/O
+    void setIoTimeouts(const IoTimeouts& timeouts);
+
+    // Preferences for choosing streams in the next open
+    void setTrackPreferences(const TrackPreferences& preferences);
+
+    // Switch the audio or video stream while reading. Queued packets of
+    // the replaced stream are dropped and reading restarts at positionUs;
+    // the other stream continues after its last queued packet. Blocks
+    // until the read thread applied the switch.
+    bool selectTrack(int streamIndex, int64_t positionUs);
+
+    // Drop packets until a keyframe at or after the newest packet read,
+    // used to jump to the live edge. Starts a new generation like seek().
+    uint32_t skipToKeyframe();
+
+    // Generation counter of this pipeline, shared with the decoders and
+    // the player
+    std::shared_ptr<SeekGeneration> getSeekGeneration() const;
+
+    // Probe limits and flags used when opening the input
+    void setOpenProfile(OpenProfile profile);
+
+    // Share probe results across opens, nullptr always probes
+    void setProbeCache(std::shared_ptr<ProbeCache> cache);
+
+    // Select the input I/O backend, applies to the next open
+    void setInputConfig(const InputConfig& config);
+
+    // Counters for read times, queue waits and drops, applies to the
+    // next start()
+    void setStats(std::shared_ptr<PipelineStats> stats);
+
+    // Read as a task of this group instead of a dedicated thread, applies
+    // to the next start(). Network inputs keep their thread since a read
+    // may block for the whole I/O timeout.
+    void setTaskGroup(std::shared_ptr<TaskGroup> group);
+
+    // Keep a ring of live packets, applies to the next start(). Seeks
+    // inside the window are then served from the ring.
+    void setTimeshiftConfig(const TimeshiftConfig& config);
+
+    // Keyframe positions available for seeking, false without a window
+    bool getTimeshiftRange(int64_t& startUs, int64_t& endUs) const;
+
+    // Stream-copy the selected streams into a file while reading, the
+    // container follows the extension. Recording stops with stop().
+    bool startRecording(const std::string& path);
+    void stopRecording();
+    RecordingStats getRecordingStats() const;
+
+    // Time the last stop() waited for the read thread, microseconds
+    int64_t getLastStopLatency() const;
+
     MediaInfo getMediaInfo() const;
 
     // Set callback
     void setCallback(std::shared_ptr<DemuxerCallback> callback);
 
    private:
+    // Blocking I/O operation in progress, checked by the interrupt callback
+    enum class IoOperation { NONE, OPEN, PROBE, READ, SEEK };
+
     std::shared_ptr<BufferQueue<AVPacket*>> mAudioBuffer;
     std::shared_ptr<BufferQueue<AVPacket*>> mVideoBuffer;
     std::shared_ptr<Logger> mLogger;
     std::shared_ptr<DemuxerCallback> mCallback;
 
-    void readLoop();
+    // State of the read loop, lives from start() to endRead()
+    struct ReadState;
+
+    // The demux stage body: opens the input, then reads and queues
+    // packets, suspending while the target packet queue is full
+    CoStage readLoop();
+    bool beginRead();
+    void endRead();
     void updateState(DemuxerState state);
     void notifyError(ErrorCode code, const std::string& message);
+    void clearLoopCache(std::vector<AVPacket*>& cache);
+    void clearPacketQueue(BufferQueue<AVPacket*>& queue);
+    // Hand a packet to the active recorder, if any
+    void recordPacket(const AVPacket* packet, uint32_t generation);
+
+    // Pick streams with av_find_best_stream and discard all others
+    void selectStreams(AVFormatContext* context, int& audioStreamIndex,
+                       int& videoStreamIndex);
+    int findPreferredStream(AVFormatContext* context, AVMediaType type,
+                            const std::string& language,
+                            const std::string& codec);
+    void applyStreamDiscard(AVFormatContext* context, int audioStreamIndex,
+                            int videoStreamIndex);
+    // Refresh the selected stream fields of mMediaInfo, mMutex held
+    void updateSelectedTracks(int audioStreamIndex, int videoStreamIndex);
+    void freeTrackParams();
+
+    // Open the input and probe streams with interrupt and deadlines,
+    // io receives the custom backend, if any, and must outlive the context
+    ErrorCode openInput(AVFormatContext** formatContext,
+                        std::unique_ptr<IOBackend>& io);
+    std::unique_ptr<IOBackend> createIOBackend();
+    // Ring for a live input keyed on keyStreamIndex, nullptr if disabled
+    std::shared_ptr<TimeshiftBuffer> createTimeshiftBuffer(int keyStreamIndex);
+    void applyOpenProfile(AVFormatContext* context);
+    // Whether the header alone describes the streams well enough to play
+    bool canSkipProbe(AVFormatContext* context);
+    void beginIo(IoOperation operation);
+    void endIo();
+    static int interruptCallback(void* opaque);
 
     std::atomic<DemuxerState> mState{DemuxerState::IDLE};
     std::atomic<bool> mIsRunning{false};
     std::atomic<bool> mIsSeeking{false};
     std::atomic<int64_t> mSeekPosition{0};
+    // Orders seek requests with their generations
+    std::mutex mSeekMutex;
+    std::shared_ptr<SeekGeneration> mGeneration{
+        std::make_shared<SeekGeneration>()};
     std::atomic<bool> mIsLive{false};
-    std::atomic<float> mPlaybackRate{1.0f};
-    std::mutex mMutex;
+    std::atomic<bool> mIsEndOfFile{false};
+    std::atomic<bool> mLoop{false};
+    // Counts setLoop() changes, a pass read across one is not cached
+    std::atomic<uint32_t> mLoopChanges{0};
+    std::atomic<int64_t> mLoopCacheLimit{32 * 1024 * 1024};
+    // Clip of the last wrap, length 0 before the first one
+    std::atomic<int64_t> mLoopClipStartUs{0};
+    std::atomic<int64_t> mLoopClipLengthUs{0};
+    std::atomic<int64_t> mBytesRead{0};
+    std::atomic<int64_t> mReadTimeUs{0};
+    std::atomic<int64_t> mMediaTimeRead{0};
+    std::atomic<int64_t> mLastReadPts{-1};
+    std::atomic<bool> mSkipToKeyframe{false};
+    std::atomic<bool> mAbortRequested{false};
+    std::atomic<IoOperation> mIoOperation{IoOperation::NONE};
+    std::atomic<int64_t> mIoDeadline{0};
+    std::atomic<bool> mIoTimedOut{false};
+    std::atomic<int64_t> mOpenTimeoutUs{IoTimeouts().openUs};
+    std::atomic<int64_t> mProbeTimeoutUs{IoTimeouts().probeUs};
+    std::atomic<int64_t> mReadTimeoutUs{IoTimeouts().readUs};
+    std::atomic<int64_t> mLastStopLatencyUs{0};
+    std::atomic<OpenProfile> mOpenProfile{OpenProfile::DEFAULT};
+    std::atomic<int> mAudioStreamIndex{-1};
+    std::atomic<int> mVideoStreamIndex{-1};
+    std::atomic<bool> mTrackSwitchPending{false};
+    std::atomic<int> mPendingTrackIndex{-1};
+    std::atomic<int64_t> mPendingTrackPosition{0};
+    std::mutex mTrackSwitchMutex;
+    std::condition_variable mTrackSwitchDone;
+    // Codec parameters of every selectable stream, by stream index
+    std::map<int, AVCodecParameters*> mTrackParams;
+    mutable std::mutex mMutex;
+    mutable std::mutex mConfigMutex;
+    InputConfig mInputConfig;
+    TimeshiftConfig mTimeshiftConfig;
+    std::shared_ptr<TimeshiftBuffer> mTimeshift;
+    mutable std::mutex mRecorderMutex;
+    std::shared_ptr<Recorder> mRecorder;
+    std::atomic<bool> mRecording{false};
+    TrackPreferences mTrackPreferences;
+    std::shared_ptr<ProbeCache> mProbeCache;
+    std::atomic<bool> mProbeCacheHit{false};
+    std::shared_ptr<PipelineStats> mStats;
     std::string mUrl;
-    std::thread mReadThread;
+    std::shared_ptr<TaskGroup> mTaskGroup;
+    StageRunner mRunner;
+    CoStage mReadLoop;
+    std::unique_ptr<ReadState> mRead;
     MediaInfo mMediaInfo;
 };
 }  // namespace yffplayer
@@ -0,0 +1,380 @@
+#include "Executor.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "ThreadUtil.h"
+
+namespace yffplayer {
+
+namespace {
+
+// 一次运行的时间片（微秒），用完后任务排到队尾，保证各播放器轮流执行
+constexpr int64_t TASK_SLICE_US = 2000;
+
+// 等待队列的任务即使没有被唤醒，也在该时间后重新运行一次（微秒）
+constexpr int64_t IDLE_TIMEOUT_US = 100000;
+
+// 每隔这么多次取任务优先取后台任务，避免后台播放器饿死
+constexpr uint64_t BACKGROUND_TURN = 8;
+
+// 任务被取消时等待其当前步骤结束的轮询间隔
+constexpr auto CANCEL_POLL_INTERVAL = std::chrono::microseconds(100);
+
+thread_local Executor* tCurrentExecutor = nullptr;
+thread_local int tWorkerIndex = -1;
+thread_local Task* tCurrentTask = nullptr;
+
+int64_t monotonicTimeUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace
+
+void Task::wake() {
+    int state = mState.load();
+    while (true) {
+        if (state == PARKED) {
+            if (mState.compare_exchange_weak(state, QUEUED)) {
+                mExecutor->mWakes.fetch_add(1, std::memory_order_relaxed);
+                mExecutor->enqueue(shared_from_this());
+                return;
+            }
+        } else if (state == RUNNING) {
+            // 正在运行，步骤结束后再运行一次
+            if (mState.compare_exchange_weak(state, NOTIFIED)) {
+                return;
+            }
+        } else {
+            return;
+        }
+    }
+}
+
+void Task::cancel() {
+    mCancelled = true;
+    while (true) {
+        int state = mState.load();
+        if (state == PARKED) {
+            if (mState.compare_exchange_strong(state, FINISHED)) {
+                return;
+            }
+        } else if (state == RUNNING || state == NOTIFIED) {
+            // 在任务自身的步骤中取消时不能等待
+            if (tCurrentTask == this) {
+                return;
+            }
+            std::this_thread::sleep_for(CANCEL_POLL_INTERVAL);
+        } else {
+            // 已排队的任务出队时发现已取消，不再运行
+            return;
+        }
+    }
+}
+
+bool Task::isFinished() const { return mState == FINISHED; }
+
+TaskGroup::TaskGroup(std::shared_ptr<Executor> executor,
+                     TaskPriority priority)
+    : mExecutor(executor),
+      mPriority(std::make_shared<std::atomic<TaskPriority>>(priority)) {}
+
+void TaskGroup::setPriority(TaskPriority priority) { *mPriority = priority; }
+
+TaskPriority TaskGroup::getPriority() const { return *mPriority; }
+
+std::shared_ptr<Task> TaskGroup::spawn(
+    std::function<TaskStep()> step, std::function<void(int64_t)> cpuObserver) {
+    std::shared_ptr<Task> task = std::make_shared<Task>();
+    task->mExecutor = mExecutor.get();
+    task->mPriority = mPriority;
+    task->mStep = std::move(step);
+    task->mCpuObserver = std::move(cpuObserver);
+    mExecutor->enqueue(task);
+    return task;
+}
+
+Executor::Executor(int threadCount) {
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threadCount; i++) {
+        mWorkers.push_back(std::make_unique<Worker>());
+    }
+    for (int i = 0; i < threadCount; i++) {
+        mWorkers[i]->thread = std::thread(&Executor::workerLoop, this, i);
+    }
+}
+
+Executor::~Executor() {
+    {
+        std::lock_guard<std::mutex> lock(mIdleMutex);
+        mRunning = false;
+        mIdleCondition.notify_all();
+        mTimerCondition.notify_all();
+    }
+    for (auto& worker : mWorkers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+std::shared_ptr<Executor> Executor::shared() {
+    static std::shared_ptr<Executor> executor = std::make_shared<Executor>();
+    return executor;
+}
+
+int Executor::getThreadCount() const {
+    return static_cast<int>(mWorkers.size());
+}
+
+ExecutorStats Executor::getStats() const {
+    ExecutorStats stats;
+    stats.threads = getThreadCount();
+    stats.runs = mRuns.load(std::memory_order_relaxed);
+    stats.steps = mSteps.load(std::memory_order_relaxed);
+    stats.steals = mSteals.load(std::memory_order_relaxed);
+    stats.wakes = mWakes.load(std::memory_order_relaxed);
+    stats.timeouts = mTimeouts.load(std::memory_order_relaxed);
+    stats.sleeps = mSleeps.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void Executor::enqueue(std::shared_ptr<Task> task) {
+    int priority = static_cast<int>(task->mPriority->load());
+    if (tCurrentExecutor == this) {
+        // 工作线程上唤醒的任务留在本线程，空闲线程再来窃取
+        Worker& worker = *mWorkers[tWorkerIndex];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.queues[priority].push_back(std::move(task));
+    } else {
+        std::lock_guard<std::mutex> lock(mGlobalMutex);
+        mGlobalQueues[priority].push_back(std::move(task));
+    }
+    mReadyCount++;
+    wakeWorker();
+}
+
+void Executor::wakeWorker() {
+    // 休眠的线程先登记再检查就绪数，这里先增加就绪数再检查登记，不会漏掉唤醒
+    if (mSleepingCount == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mIdleMutex);
+    if (mIdleWaiters > 0) {
+        mIdleCondition.notify_one();
+    } else if (mTimerKeeperSleeping) {
+        mTimerCondition.notify_one();
+    }
+}
+
+void Executor::addTimer(std::shared_ptr<Task> task, uint64_t parkCount,
+                        int64_t deadlineUs) {
+    bool earliest = false;
+    {
+        std::lock_guard<std::mutex> lock(mTimerMutex);
+        mTimers.push_back({deadlineUs, parkCount, std::move(task)});
+        std::push_heap(mTimers.begin(), mTimers.end(), std::greater<Timer>());
+        if (deadlineUs < mNextTimerUs) {
+            mNextTimerUs = deadlineUs;
+            earliest = true;
+        }
+    }
+
+    // 负责定时的线程按旧的截止时间休眠，需要提前叫醒
+    if (earliest && mTimerKeeperSleeping) {
+        std::lock_guard<std::mutex> lock(mIdleMutex);
+        mTimerCondition.notify_one();
+    }
+}
+
+void Executor::fireTimers() {
+    std::vector<std::shared_ptr<Task>> due;
+    {
+        std::lock_guard<std::mutex> lock(mTimerMutex);
+        int64_t now = monotonicTimeUs();
+        while (!mTimers.empty() && mTimers.front().deadlineUs <= now) {
+            std::pop_heap(mTimers.begin(), mTimers.end(),
+                          std::greater<Timer>());
+            Timer& timer = mTimers.back();
+            // 任务之后又被唤醒并重新挂起过，这个超时已经失效
+            if (timer.task->mParkCount == timer.parkCount) {
+                due.push_back(std::move(timer.task));
+            }
+            mTimers.pop_back();
+        }
+        mNextTimerUs = mTimers.empty() ? INT64_MAX : mTimers.front().deadlineUs;
+    }
+
+    for (std::shared_ptr<Task>& task : due) {
+        int expected = Task::PARKED;
+        if (task->mState.compare_exchange_strong(expected, Task::QUEUED)) {
+            mTimeouts.fetch_add(1, std::memory_order_relaxed);
+            enqueue(std::move(task));
+        }
+    }
+}
+
+bool Executor::popFrom(Worker& worker, int priority, bool steal,
+                       std::shared_ptr<Task>& task) {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    RunQueue& queue = worker.queues[priority];
+    if (queue.empty()) {
+        return false;
+    }
+    // 本线程从队头取，窃取者从队尾取
+    if (steal) {
+        task = std::move(queue.back());
+        queue.pop_back();
+    } else {
+        task = std::move(queue.front());
+        queue.pop_front();
+    }
+    return true;
+}
+
+std::shared_ptr<Task> Executor::nextTask(int workerIndex) {
+    Worker& self = *mWorkers[workerIndex];
+    int first = ++self.picks % BACKGROUND_TURN == 0 ? 1 : 0;
+    std::shared_ptr<Task> task;
+    for (int n = 0; n < kPriorities; n++) {
+        int priority = (first + n) % kPriorities;
+        if (popFrom(self, priority, false, task)) {
+            mReadyCount--;
+            return task;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mGlobalMutex);
+            RunQueue& queue = mGlobalQueues[priority];
+            if (!queue.empty()) {
+                task = std::move(queue.front());
+                queue.pop_front();
+                mReadyCount--;
+                return task;
+            }
+        }
+        size_t count = mWorkers.size();
+        for (size_t i = 1; i < count; i++) {
+            Worker& other = *mWorkers[(workerIndex + i) % count];
+            if (popFrom(other, priority, true, task)) {
+                mReadyCount--;
+                mSteals.fetch_add(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void Executor::run(std::shared_ptr<Task> task) {
+    int expected = Task::QUEUED;
+    if (!task->mState.compare_exchange_strong(expected, Task::RUNNING)) {
+        return;
+    }
+    if (task->mCancelled) {
+        task->mState = Task::FINISHED;
+        return;
+    }
+    mRuns.fetch_add(1, std::memory_order_relaxed);
+
+    // 连续运行就绪的步骤，直到任务开始等待或时间片用完
+    tCurrentTask = task.get();
+    int64_t cpuStartUs = task->mCpuObserver ? currentThreadCpuTimeUs() : 0;
+    int64_t sliceEndUs = monotonicTimeUs() + TASK_SLICE_US;
+    TaskStep step = TaskStep::done();
+    int64_t steps = 0;
+    do {
+        try {
+            step = task->mStep();
+        } catch (const std::exception&) {
+            step = TaskStep::done();
+        }
+        steps++;
+    } while (step.kind() == TaskStep::Kind::AGAIN && !task->mCancelled &&
+             monotonicTimeUs() < sliceEndUs);
+    mSteps.fetch_add(steps, std::memory_order_relaxed);
+    if (task->mCpuObserver) {
+        task->mCpuObserver(currentThreadCpuTimeUs() - cpuStartUs);
+    }
+    tCurrentTask = nullptr;
+
+    if (step.kind() == TaskStep::Kind::DONE || task->mCancelled) {
+        task->mState = Task::FINISHED;
+        return;
+    }
+    if (step.kind() == TaskStep::Kind::AGAIN) {
+        task->mState = Task::QUEUED;
+        enqueue(std::move(task));
+        return;
+    }
+
+    // 挂起，等待唤醒或超时；步骤运行期间被唤醒过则直接重新排队
+    uint64_t parkCount = ++task->mParkCount;
+    expected = Task::RUNNING;
+    if (task->mState.compare_exchange_strong(expected, Task::PARKED)) {
+        int64_t delayUs = step.kind() == TaskStep::Kind::SLEEP
+                              ? std::max<int64_t>(step.delayUs(), 0)
+                              : IDLE_TIMEOUT_US;
+        addTimer(std::move(task), parkCount, monotonicTimeUs() + delayUs);
+    } else {
+        task->mState = Task::QUEUED;
+        enqueue(std::move(task));
+    }
+}
+
+void Executor::workerLoop(int workerIndex) {
+    tCurrentExecutor = this;
+    tWorkerIndex = workerIndex;
+    setCurrentThreadName("yff-exec-" + std::to_string(workerIndex));
+
+    bool wasTimerKeeper = false;
+    while (mRunning) {
+        if (monotonicTimeUs() >= mNextTimerUs) {
+            fireTimers();
+        }
+
+        std::shared_ptr<Task> task = nextTask(workerIndex);
+        if (task) {
+            // 还有就绪任务时再叫醒一个线程分担；定时线程开始干活时，
+            // 叫醒另一个休眠线程接替定时
+            if (mReadyCount > 0 || wasTimerKeeper) {
+                wakeWorker();
+            }
+            wasTimerKeeper = false;
+            run(std::move(task));
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mIdleMutex);
+        mSleepingCount++;
+        if (mReadyCount == 0 && mRunning) {
+            mSleeps.fetch_add(1, std::memory_order_relaxed);
+            if (!mTimerKeeperSleeping) {
+                // 只有一个休眠线程按最近的超时醒来，其余线程等待唤醒
+                mTimerKeeperSleeping = true;
+                int64_t nextTimerUs = mNextTimerUs;
+                if (nextTimerUs == INT64_MAX) {
+                    mTimerCondition.wait(lock);
+                } else {
+                    mTimerCondition.wait_until(
+                        lock, std::chrono::steady_clock::time_point(
+                                  std::chrono::microseconds(nextTimerUs)));
+                }
+                mTimerKeeperSleeping = false;
+                wasTimerKeeper = true;
+            } else {
+                mIdleWaiters++;
+                mIdleCondition.wait(lock);
+                mIdleWaiters--;
+            }
+        }
+        mSleepingCount--;
+    }
+
+    tCurrentExecutor = nullptr;
+}
+
+}  // namespace yffplayer
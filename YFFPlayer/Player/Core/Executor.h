@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace yffplayer {
+
+class Executor;
+
+// Result of one step of a task
+class TaskStep {
+   public:
+    enum class Kind { AGAIN, IDLE, SLEEP, DONE };
+
+    // More work is ready; runs again after other ready tasks
+    static TaskStep again() { return TaskStep(Kind::AGAIN, 0); }
+    // Waiting on a queue or a flag; runs again after wake(), a task also
+    // after a safety timeout, a dedicated thread after a short poll
+    static TaskStep idle() { return TaskStep(Kind::IDLE, 0); }
+    // Runs again after delayUs, or earlier after wake()
+    static TaskStep sleep(int64_t delayUs) {
+        return TaskStep(Kind::SLEEP, delayUs);
+    }
+    static TaskStep done() { return TaskStep(Kind::DONE, 0); }
+
+    Kind kind() const { return mKind; }
+    int64_t delayUs() const { return mDelayUs; }
+
+   private:
+    TaskStep(Kind kind, int64_t delayUs) : mKind(kind), mDelayUs(delayUs) {}
+
+    Kind mKind;
+    int64_t mDelayUs;
+};
+
+enum class TaskPriority {
+    FOREGROUND,  // Visible players, scheduled first
+    BACKGROUND,  // Preloading and hidden players
+};
+
+// A step function run repeatedly by an Executor until it returns done()
+// or is cancelled. A task never runs on two threads at once.
+class Task : public std::enable_shared_from_this<Task> {
+   public:
+    // Make a parked task ready; a wake during a step runs it once more
+    void wake();
+
+    // No further steps after this returns. Waits for a running step to
+    // finish, unless called from inside the task.
+    void cancel();
+
+    bool isFinished() const;
+
+   private:
+    friend class Executor;
+    friend class TaskGroup;
+
+    enum State { PARKED, QUEUED, RUNNING, NOTIFIED, FINISHED };
+
+    Executor* mExecutor{nullptr};
+    // Shared with the group so setPriority() applies to live tasks
+    std::shared_ptr<std::atomic<TaskPriority>> mPriority;
+    std::function<TaskStep()> mStep;
+    std::function<void(int64_t)> mCpuObserver;
+    std::atomic<int> mState{QUEUED};
+    std::atomic<bool> mCancelled{false};
+    // Invalidates the timeout of an earlier park
+    std::atomic<uint64_t> mParkCount{0};
+};
+
+// Tasks of one player. Tasks of a group run round-robin with all other
+// ready tasks of the same priority.
+class TaskGroup {
+   public:
+    TaskGroup(std::shared_ptr<Executor> executor, TaskPriority priority);
+
+    void setPriority(TaskPriority priority);
+    TaskPriority getPriority() const;
+
+    // Create a task and schedule its first step. cpuObserver, if set,
+    // receives the thread CPU time of each run in microseconds.
+    std::shared_ptr<Task> spawn(std::function<TaskStep()> step,
+                                std::function<void(int64_t)> cpuObserver =
+                                    std::function<void(int64_t)>());
+
+    std::shared_ptr<Executor> getExecutor() const { return mExecutor; }
+
+   private:
+    std::shared_ptr<Executor> mExecutor;
+    std::shared_ptr<std::atomic<TaskPriority>> mPriority;
+};
+
+struct ExecutorStats {
+    int threads{0};
+    int64_t runs{0};      // Tasks taken from a queue and run
+    int64_t steps{0};     // Step function calls
+    int64_t steals{0};    // Runs taken from another worker's queue
+    int64_t wakes{0};     // Parked tasks made ready by wake()
+    int64_t timeouts{0};  // Parked tasks made ready by their timeout
+    int64_t sleeps{0};    // Times a worker found no work and slept
+};
+
+// Work-stealing pool of a fixed number of worker threads. Each worker
+// keeps a run queue per priority; tasks woken or requeued on a worker stay
+// on that worker, idle workers steal from the others. A run lasts at most
+// one time slice, then the task goes to the back of the queue, so every
+// ready task gets its turn. Foreground tasks run first; every eighth pick
+// prefers background tasks so they are never starved.
+//
+// Tasks hold a plain pointer to the executor: keep it alive, through a
+// TaskGroup, until every task is cancelled or finished.
+class Executor {
+   public:
+    // threadCount <= 0 uses one thread per core
+    explicit Executor(int threadCount = 0);
+    ~Executor();
+
+    // Process-wide executor with one thread per core
+    static std::shared_ptr<Executor> shared();
+
+    int getThreadCount() const;
+    ExecutorStats getStats() const;
+
+   private:
+    friend class Task;
+    friend class TaskGroup;
+
+    static constexpr int kPriorities = 2;
+
+    using RunQueue = std::deque<std::shared_ptr<Task>>;
+
+    struct Worker {
+        std::mutex mutex;
+        RunQueue queues[kPriorities];
+        std::thread thread;
+        uint64_t picks{0};
+    };
+
+    struct Timer {
+        int64_t deadlineUs;
+        uint64_t parkCount;
+        std::shared_ptr<Task> task;
+        bool operator>(const Timer& other) const {
+            return deadlineUs > other.deadlineUs;
+        }
+    };
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+
+    // Tasks made ready outside the worker threads
+    std::mutex mGlobalMutex;
+    RunQueue mGlobalQueues[kPriorities];
+
+    // Ready tasks in all queues, checked before a worker sleeps
+    std::atomic<int64_t> mReadyCount{0};
+    // Sleeping workers register under mIdleMutex; one of them, the timer
+    // keeper, wakes at the next park timeout, the others only on demand
+    std::atomic<int> mSleepingCount{0};
+    std::mutex mIdleMutex;
+    std::condition_variable mIdleCondition;
+    std::condition_variable mTimerCondition;
+    int mIdleWaiters{0};
+    std::atomic<bool> mTimerKeeperSleeping{false};
+
+    // Min-heap of park timeouts
+    std::mutex mTimerMutex;
+    std::vector<Timer> mTimers;
+    std::atomic<int64_t> mNextTimerUs{INT64_MAX};
+
+    std::atomic<bool> mRunning{true};
+
+    std::atomic<int64_t> mRuns{0};
+    std::atomic<int64_t> mSteps{0};
+    std::atomic<int64_t> mSteals{0};
+    std::atomic<int64_t> mWakes{0};
+    std::atomic<int64_t> mTimeouts{0};
+    std::atomic<int64_t> mSleeps{0};
+
+    void enqueue(std::shared_ptr<Task> task);
+    void wakeWorker();
+    void addTimer(std::shared_ptr<Task> task, uint64_t parkCount,
+                  int64_t deadlineUs);
+    void fireTimers();
+    std::shared_ptr<Task> nextTask(int workerIndex);
+    bool popFrom(Worker& worker, int priority, bool steal,
+                 std::shared_ptr<Task>& task);
+    void run(std::shared_ptr<Task> task);
+    void workerLoop(int workerIndex);
+};
+
+}  // namespace yffplayer
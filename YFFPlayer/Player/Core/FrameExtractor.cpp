@@ -0,0 +1,398 @@
+#include "FrameExtractor.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <numeric>
+#include <thread>
+
+#include "BufferQueue.h"
+#include "Demuxer.h"
+#include "FrameScaler.h"
+#include "ThreadUtil.h"
+#include "VideoDecoder.h"
+
+extern "C" {
+#include <libavcodec/packet.h>
+#include <libavutil/mem.h>
+#include <libavutil/time.h>
+}
+
+namespace yffplayer {
+
+// 抽帧只需少量预读，段结束后流水线多解码的帧也随之有限
+constexpr int PACKET_QUEUE_SIZE = 32;
+constexpr int FRAME_QUEUE_SIZE = 2;
+
+// 没有关键帧索引时，相距不超过此值的时间点顺序解码而不再跳转
+constexpr int64_t MAX_FORWARD_DECODE_US = 2000000;  // 2秒
+
+// 文件结束且数据包取完后，再等待解码器送出剩余帧的时间
+constexpr int64_t END_OF_INPUT_WAIT_US = 100000;  // 100毫秒
+
+// 超过此时间没有新帧则放弃当前时间点
+constexpr int64_t FRAME_TIMEOUT_US = 5000000;  // 5秒
+constexpr int64_t FRAME_WAIT_US = 10000;       // 10毫秒
+
+struct FrameExtractor::Worker {
+    std::shared_ptr<BufferQueue<AVPacket*>> audioPackets;
+    std::shared_ptr<BufferQueue<AVPacket*>> videoPackets;
+    std::shared_ptr<BufferQueue<std::shared_ptr<VideoFrame>>> frames;
+    std::shared_ptr<Demuxer> demuxer;
+    std::shared_ptr<VideoDecoder> decoder;
+    FrameScaler scaler;
+
+    // Signalled by pushes to the frame queue
+    std::mutex mutex;
+    std::condition_variable framePushed;
+    bool pushed{false};
+};
+
+struct FrameExtractor::Job {
+    ExtractConfig config;
+    // Requested timestamps in ascending order and their frames
+    std::vector<int64_t> timestampsUs;
+    std::vector<std::shared_ptr<VideoFrame>> frames;
+    std::vector<Segment> segments;
+    std::atomic<size_t> nextSegment{0};
+    std::atomic<int64_t> framesDecoded{0};
+};
+
+// 解码器输出的帧没有删除器，用完后由此释放平面
+static void freeDecodedFrame(std::shared_ptr<VideoFrame>& frame) {
+    if (!frame) {
+        return;
+    }
+    for (int i = 0; i < 3; i++) {
+        av_free(frame->data[i]);
+        frame->data[i] = nullptr;
+    }
+    frame = nullptr;
+}
+
+FrameExtractor::FrameExtractor(std::shared_ptr<Logger> logger)
+    : mLogger(logger) {}
+
+FrameExtractor::~FrameExtractor() = default;
+
+void FrameExtractor::setExecutor(std::shared_ptr<Executor> executor) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mExecutor = executor;
+}
+
+ExtractStats FrameExtractor::getLastStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mLastStats;
+}
+
+std::vector<std::shared_ptr<VideoFrame>> FrameExtractor::extract(
+    const std::string& url, const std::vector<int64_t>& timestampsUs,
+    const ExtractConfig& config) {
+    int64_t startTime = av_gettime_relative();
+    std::vector<std::shared_ptr<VideoFrame>> results(timestampsUs.size());
+    ExtractStats stats;
+    stats.requested = static_cast<int64_t>(timestampsUs.size());
+
+    // 按时间排序后分段解码，结果再按请求顺序放回
+    std::vector<size_t> order(timestampsUs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return timestampsUs[a] < timestampsUs[b];
+    });
+    Job job;
+    job.config = config;
+    for (size_t index : order) {
+        job.timestampsUs.push_back(timestampsUs[index]);
+    }
+    job.frames.resize(order.size());
+
+    // 第一条流水线在调用线程上打开，其关键帧索引决定分段
+    std::unique_ptr<Worker> first;
+    if (!order.empty()) {
+        first = openWorker(url);
+        if (!first) {
+            YFF_LOG(mLogger, LogLevel::Error, "FrameExtractor",
+                    "无法打开输入: %s", url.c_str());
+        }
+    }
+    if (first) {
+        job.segments = buildSegments(
+            job.timestampsUs,
+            first->demuxer->getMediaInfo().videoKeyframesUs);
+
+        std::shared_ptr<Executor> executor;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            executor = mExecutor ? mExecutor : Executor::shared();
+        }
+        // 离线抽帧不与前台播放器争抢执行器
+        std::shared_ptr<TaskGroup> group =
+            std::make_shared<TaskGroup>(executor, TaskPriority::BACKGROUND);
+
+        int workerCount = config.workers;
+        if (workerCount <= 0) {
+            workerCount = static_cast<int>(
+                std::max(1u, std::thread::hardware_concurrency()));
+        }
+        workerCount = static_cast<int>(std::min<size_t>(
+            static_cast<size_t>(workerCount), job.segments.size()));
+        stats.workers = workerCount;
+
+        // 其余流水线在各自线程上打开，先就绪的先领取分段
+        std::vector<std::thread> threads;
+        for (int i = 1; i < workerCount; i++) {
+            threads.emplace_back([this, &url, &job, group]() {
+                setCurrentThreadName("yff-extract");
+                std::unique_ptr<Worker> worker = openWorker(url);
+                if (!worker) {
+                    return;
+                }
+                if (startWorker(*worker, group)) {
+                    runWorker(*worker, job);
+                }
+                closeWorker(*worker);
+            });
+        }
+        if (startWorker(*first, group)) {
+            runWorker(*first, job);
+        }
+        closeWorker(*first);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    for (size_t i = 0; i < order.size(); i++) {
+        results[order[i]] = job.frames[i];
+        if (job.frames[i]) {
+            stats.extracted++;
+        }
+    }
+    stats.segments = static_cast<int64_t>(job.segments.size());
+    stats.framesDecoded = job.framesDecoded;
+    stats.elapsedUs = av_gettime_relative() - startTime;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mLastStats = stats;
+    }
+    YFF_LOG(mLogger, LogLevel::Info, "FrameExtractor",
+            "抽帧完成: %lld/%lld 帧, %lld 段, %d 条流水线, 耗时 %lld 微秒",
+            static_cast<long long>(stats.extracted),
+            static_cast<long long>(stats.requested),
+            static_cast<long long>(stats.segments), stats.workers,
+            static_cast<long long>(stats.elapsedUs));
+    return results;
+}
+
+std::unique_ptr<FrameExtractor::Worker> FrameExtractor::openWorker(
+    const std::string& url) {
+    std::unique_ptr<Worker> worker = std::make_unique<Worker>();
+    // 只读取视频流，音频队列不会有数据
+    worker->audioPackets = std::make_shared<BufferQueue<AVPacket*>>(1);
+    worker->videoPackets =
+        std::make_shared<BufferQueue<AVPacket*>>(PACKET_QUEUE_SIZE);
+    worker->frames =
+        std::make_shared<BufferQueue<std::shared_ptr<VideoFrame>>>(
+            FRAME_QUEUE_SIZE);
+    worker->demuxer = std::make_shared<Demuxer>(
+        worker->audioPackets, worker->videoPackets, mLogger);
+    TrackPreferences preferences;
+    preferences.videoOnly = true;
+    worker->demuxer->setTrackPreferences(preferences);
+    // 各流水线打开同一输入，只有第一次需要探测
+    worker->demuxer->setProbeCache(mProbeCache);
+    if (!worker->demuxer->open(url)) {
+        return nullptr;
+    }
+    return worker;
+}
+
+bool FrameExtractor::startWorker(Worker& worker,
+                                 const std::shared_ptr<TaskGroup>& group) {
+    MediaInfo mediaInfo = worker.demuxer->getMediaInfo();
+    if (!mediaInfo.hasVideo) {
+        YFF_LOG(mLogger, LogLevel::Error, "FrameExtractor", "输入没有视频流");
+        return false;
+    }
+
+    worker.demuxer->setTaskGroup(group);
+    worker.decoder = std::make_shared<VideoDecoder>(
+        worker.videoPackets, worker.frames, mLogger);
+    worker.decoder->setSeekGeneration(worker.demuxer->getSeekGeneration());
+    worker.decoder->setTaskGroup(group);
+    // 并行来自多条流水线，每个解码器单线程
+    worker.decoder->setThreadCount(1);
+    if (!worker.decoder->open(mediaInfo.videoCodecParam)) {
+        worker.decoder = nullptr;
+        return false;
+    }
+
+    Worker* target = &worker;
+    worker.frames->setPushListener([target]() {
+        {
+            std::lock_guard<std::mutex> lock(target->mutex);
+            target->pushed = true;
+        }
+        target->framePushed.notify_one();
+    });
+    worker.demuxer->start();
+    worker.decoder->start();
+    return true;
+}
+
+void FrameExtractor::closeWorker(Worker& worker) {
+    if (worker.decoder) {
+        worker.decoder->stop();
+    }
+    worker.demuxer->stop();
+    worker.frames->setPushListener(nullptr);
+
+    // 释放仍在队列中的帧和数据包
+    std::shared_ptr<VideoFrame> frame;
+    while (worker.frames->tryPop(frame)) {
+        freeDecodedFrame(frame);
+    }
+    AVPacket* packet = nullptr;
+    while (worker.videoPackets->tryPop(packet)) {
+        av_packet_free(&packet);
+    }
+    while (worker.audioPackets->tryPop(packet)) {
+        av_packet_free(&packet);
+    }
+
+    if (worker.decoder) {
+        worker.decoder->close();
+        worker.decoder = nullptr;
+    }
+}
+
+void FrameExtractor::runWorker(Worker& worker, Job& job) {
+    while (true) {
+        size_t index = job.nextSegment++;
+        if (index >= job.segments.size()) {
+            break;
+        }
+        extractSegment(worker, job, job.segments[index]);
+    }
+}
+
+void FrameExtractor::extractSegment(Worker& worker, Job& job,
+                                    const Segment& segment) {
+    // 精确跳转：解码器丢弃第一个时间点之前结束的帧
+    int64_t firstUs = job.timestampsUs[segment.indexes.front()];
+    uint32_t generation = worker.demuxer->seek(firstUs, true);
+
+    // current 是不晚于当前时间点开始的最后一帧，pending 是已解码但在
+    // 时间点之后开始的帧，留给下一个时间点
+    std::shared_ptr<VideoFrame> current;
+    std::shared_ptr<VideoFrame> pending;
+    std::shared_ptr<VideoFrame> scaled;
+    bool firstTimestamp = true;
+    for (size_t index : segment.indexes) {
+        int64_t timestampUs = job.timestampsUs[index];
+        while (true) {
+            if (!pending) {
+                pending = nextFrame(worker, generation);
+                if (!pending) {
+                    // 输入结束或解码停滞，沿用最后一帧
+                    break;
+                }
+                job.framesDecoded++;
+            }
+            if (current && pending->pts > timestampUs) {
+                break;
+            }
+            freeDecodedFrame(current);
+            current = std::move(pending);
+            pending = nullptr;
+            scaled = nullptr;
+            // 跳转后的第一帧在目标之后结束，开始不晚于目标时即为所求，
+            // 无需再解码下一帧确认
+            if (firstTimestamp || current->pts > timestampUs) {
+                break;
+            }
+        }
+        firstTimestamp = false;
+
+        // 相邻时间点落在同一帧时共用缩放结果
+        if (current && !scaled) {
+            int width = 0;
+            int height = 0;
+            FrameScaler::fitSize(current->width, current->height,
+                                 job.config.maxWidth, job.config.maxHeight,
+                                 job.config.format, width, height);
+            scaled = worker.scaler.scale(*current, width, height,
+                                         job.config.format);
+        }
+        job.frames[index] = scaled;
+    }
+
+    freeDecodedFrame(current);
+    freeDecodedFrame(pending);
+}
+
+std::shared_ptr<VideoFrame> FrameExtractor::nextFrame(Worker& worker,
+                                                      uint32_t generation) {
+    int64_t deadline = av_gettime_relative() + FRAME_TIMEOUT_US;
+    int64_t endOfInputTime = -1;
+    while (true) {
+        std::shared_ptr<VideoFrame> frame;
+        while (worker.frames->tryPop(frame)) {
+            if (frame->generation == generation) {
+                return frame;
+            }
+            // 上一段跳转前解码的帧
+            freeDecodedFrame(frame);
+        }
+
+        // 数据包已读完且全部送入解码器后，剩余的帧很快送出
+        int64_t now = av_gettime_relative();
+        if (worker.demuxer->isEndOfFile() && worker.videoPackets->empty()) {
+            if (endOfInputTime < 0) {
+                endOfInputTime = now;
+            } else if (now - endOfInputTime > END_OF_INPUT_WAIT_US) {
+                return nullptr;
+            }
+        } else {
+            endOfInputTime = -1;
+        }
+        if (now > deadline) {
+            YFF_LOG(mLogger, LogLevel::Warning, "FrameExtractor",
+                    "等待解码帧超时");
+            return nullptr;
+        }
+
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        worker.framePushed.wait_for(
+            lock, std::chrono::microseconds(FRAME_WAIT_US),
+            [&worker]() { return worker.pushed; });
+        worker.pushed = false;
+    }
+}
+
+std::vector<FrameExtractor::Segment> FrameExtractor::buildSegments(
+    const std::vector<int64_t>& timestampsUs,
+    const std::vector<int64_t>& keyframesUs) {
+    std::vector<Segment> segments;
+    for (size_t i = 0; i < timestampsUs.size(); i++) {
+        bool join = false;
+        if (i > 0) {
+            int64_t previous = timestampsUs[i - 1];
+            if (keyframesUs.empty()) {
+                join = timestampsUs[i] - previous <= MAX_FORWARD_DECODE_US;
+            } else {
+                // 两个时间点之间没有关键帧时属于同一GOP，继续向后解码；
+                // 否则跳转到下一个关键帧比解码完本GOP更快
+                auto next = std::upper_bound(keyframesUs.begin(),
+                                             keyframesUs.end(), previous);
+                join = next == keyframesUs.end() || *next > timestampsUs[i];
+            }
+        }
+        if (!join) {
+            segments.emplace_back();
+        }
+        segments.back().indexes.push_back(i);
+    }
+    return segments;
+}
+
+}  // namespace yffplayer
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Executor.h"
+#include "Logger.h"
+#include "ProbeCache.h"
+#include "VideoFrame.h"
+
+namespace yffplayer {
+
+// Options of FrameExtractor::extract()
+struct ExtractConfig {
+    // Frames are scaled to fit these bounds keeping the aspect ratio, 0
+    // leaves a side unconstrained
+    int maxWidth{320};
+    int maxHeight{0};
+    PixelFormat format{PixelFormat::RGB24};
+    int workers{0};  // Decoding pipelines, 0 for one per core
+};
+
+// Counters of the last extract() call
+struct ExtractStats {
+    int64_t requested{0};      // Timestamps asked for
+    int64_t extracted{0};      // Frames returned
+    int64_t segments{0};       // Seeks, one per group of timestamps
+    int64_t framesDecoded{0};  // Frames decoded at or after seek targets
+    int workers{0};
+    int64_t elapsedUs{0};
+};
+
+// Offline batch extraction of the frames shown at given times, e.g. for
+// thumbnail strips. Timestamps are grouped by the GOP they fall in using
+// the container's keyframe index; each group costs one precise seek to its
+// first timestamp and is decoded forward only up to its last one. Groups
+// are spread over several video-only Demuxer + VideoDecoder pipelines
+// running as tasks of an executor, so distant timestamps decode on
+// different cores while each codec stays single-threaded.
+class FrameExtractor {
+   public:
+    explicit FrameExtractor(std::shared_ptr<Logger> logger);
+    ~FrameExtractor();
+
+    // Run the pipelines on this executor, nullptr uses Executor::shared()
+    void setExecutor(std::shared_ptr<Executor> executor);
+
+    // The frame shown at each of timestampsUs (microseconds, any order) of
+    // the video of url, scaled and converted per config. Results follow
+    // the order of timestampsUs; an entry is nullptr if its frame could not
+    // be decoded. Blocks until all frames are done. Frames own their
+    // planes.
+    std::vector<std::shared_ptr<VideoFrame>> extract(
+        const std::string& url, const std::vector<int64_t>& timestampsUs,
+        const ExtractConfig& config);
+
+    ExtractStats getLastStats() const;
+
+   private:
+    // Timestamps decoded in one pass after one seek, indexes into the
+    // request in ascending time order
+    struct Segment {
+        std::vector<size_t> indexes;
+    };
+
+    // One Demuxer + VideoDecoder pipeline and its queues
+    struct Worker;
+
+    // State shared by the workers of one extract() call
+    struct Job;
+
+    std::unique_ptr<Worker> openWorker(const std::string& url);
+    bool startWorker(Worker& worker, const std::shared_ptr<TaskGroup>& group);
+    void closeWorker(Worker& worker);
+    void runWorker(Worker& worker, Job& job);
+
+    // Decode the frames of one segment
+    void extractSegment(Worker& worker, Job& job, const Segment& segment);
+
+    // Next frame of generation from the decoder, nullptr at the end of
+    // the input or when decoding stalls
+    std::shared_ptr<VideoFrame> nextFrame(Worker& worker, uint32_t generation);
+
+    // Group sorted timestamps by the keyframe interval they fall in
+    static std::vector<Segment> buildSegments(
+        const std::vector<int64_t>& timestampsUs,
+        const std::vector<int64_t>& keyframesUs);
+
+    std::shared_ptr<Logger> mLogger;
+    std::shared_ptr<ProbeCache> mProbeCache{std::make_shared<ProbeCache>()};
+
+    mutable std::mutex mMutex;
+    std::shared_ptr<Executor> mExecutor;
+    ExtractStats mLastStats;
+};
+
+}  // namespace yffplayer
@@ -0,0 +1,132 @@
+#include "FrameScaler.h"
+
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/mem.h>
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+
+namespace yffplayer {
+
+FrameScaler::~FrameScaler() {
+    if (mSwsContext) {
+        sws_freeContext(mSwsContext);
+        mSwsContext = nullptr;
+    }
+}
+
+void FrameScaler::fitSize(int width, int height, int maxWidth, int maxHeight,
+                          PixelFormat format, int& outWidth, int& outHeight) {
+    outWidth = width;
+    outHeight = height;
+    if (maxWidth > 0 && outWidth > maxWidth) {
+        outHeight = static_cast<int>(static_cast<int64_t>(outHeight) *
+                                     maxWidth / outWidth);
+        outWidth = maxWidth;
+    }
+    if (maxHeight > 0 && outHeight > maxHeight) {
+        outWidth = static_cast<int>(static_cast<int64_t>(outWidth) *
+                                    maxHeight / outHeight);
+        outHeight = maxHeight;
+    }
+
+    // 4:2:0 格式的色度平面宽高减半，要求偶数尺寸
+    if (format == PixelFormat::RGB24) {
+        outWidth = std::max(1, outWidth);
+        outHeight = std::max(1, outHeight);
+    } else {
+        outWidth = std::max(2, outWidth & ~1);
+        outHeight = std::max(2, outHeight & ~1);
+    }
+}
+
+std::shared_ptr<VideoFrame> FrameScaler::allocFrame(int width, int height,
+                                                    PixelFormat format) {
+    std::shared_ptr<VideoFrame> frame(new VideoFrame(), [](VideoFrame* f) {
+        for (int i = 0; i < 3; i++) {
+            av_free(f->data[i]);
+        }
+        delete f;
+    });
+    frame->width = width;
+    frame->height = height;
+    frame->format = format;
+
+    int planes = 0;
+    int planeHeight[3] = {height, 0, 0};
+    switch (format) {
+        case PixelFormat::YUV420P:
+            planes = 3;
+            frame->linesize[0] = width;
+            frame->linesize[1] = width / 2;
+            frame->linesize[2] = width / 2;
+            planeHeight[1] = height / 2;
+            planeHeight[2] = height / 2;
+            break;
+        case PixelFormat::NV12:
+            planes = 2;
+            frame->linesize[0] = width;
+            frame->linesize[1] = width;
+            planeHeight[1] = height / 2;
+            break;
+        case PixelFormat::RGB24:
+            planes = 1;
+            frame->linesize[0] = width * 3;
+            break;
+    }
+    for (int i = 0; i < planes; i++) {
+        frame->data[i] =
+            (uint8_t*)av_malloc(frame->linesize[i] * planeHeight[i]);
+        if (!frame->data[i]) {
+            return nullptr;
+        }
+    }
+    return frame;
+}
+
+int FrameScaler::toAVPixelFormat(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::YUV420P:
+            return AV_PIX_FMT_YUV420P;
+        case PixelFormat::NV12:
+            return AV_PIX_FMT_NV12;
+        case PixelFormat::RGB24:
+            return AV_PIX_FMT_RGB24;
+    }
+    return AV_PIX_FMT_NONE;
+}
+
+bool FrameScaler::scale(const uint8_t* const data[], const int linesize[],
+                        int width, int height, int srcFormat, VideoFrame& dst) {
+    // 尺寸和格式不变时复用上一次的转换上下文
+    mSwsContext = sws_getCachedContext(
+        mSwsContext, width, height, (AVPixelFormat)srcFormat, dst.width,
+        dst.height, (AVPixelFormat)toAVPixelFormat(dst.format),
+        SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+    if (!mSwsContext) {
+        return false;
+    }
+    return sws_scale(mSwsContext, data, linesize, 0, height, dst.data,
+                     dst.linesize) > 0;
+}
+
+std::shared_ptr<VideoFrame> FrameScaler::scale(const VideoFrame& frame,
+                                               int width, int height,
+                                               PixelFormat format) {
+    std::shared_ptr<VideoFrame> scaled = allocFrame(width, height, format);
+    if (!scaled) {
+        return nullptr;
+    }
+    if (!scale(frame.data, frame.linesize, frame.width, frame.height,
+               toAVPixelFormat(frame.format), *scaled)) {
+        return nullptr;
+    }
+    scaled->pts = frame.pts;
+    scaled->duration = frame.duration;
+    scaled->generation = frame.generation;
+    return scaled;
+}
+
+}  // namespace yffplayer
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "VideoFrame.h"
+
+extern "C" {
+struct SwsContext;
+}
+
+namespace yffplayer {
+
+// Scales images to a target size and PixelFormat with a cached SwsContext.
+// Frames it allocates own their planes: the deleter of the shared_ptr frees
+// them, so such frames can be cached or handed out without further
+// bookkeeping. Not thread-safe, use one scaler per thread.
+class FrameScaler {
+   public:
+    FrameScaler() = default;
+    ~FrameScaler();
+
+    FrameScaler(const FrameScaler&) = delete;
+    FrameScaler& operator=(const FrameScaler&) = delete;
+
+    // Fit width x height into maxWidth x maxHeight keeping the aspect
+    // ratio, 0 leaves a side unconstrained. Images are never enlarged;
+    // 4:2:0 formats get even sizes.
+    static void fitSize(int width, int height, int maxWidth, int maxHeight,
+                        PixelFormat format, int& outWidth, int& outHeight);
+
+    // A frame with tightly packed planes, nullptr if allocation failed
+    static std::shared_ptr<VideoFrame> allocFrame(int width, int height,
+                                                  PixelFormat format);
+
+    // The AVPixelFormat of format
+    static int toAVPixelFormat(PixelFormat format);
+
+    // Scale an image of srcFormat (an AVPixelFormat) into the planes of dst
+    bool scale(const uint8_t* const data[], const int linesize[], int width,
+               int height, int srcFormat, VideoFrame& dst);
+
+    // A scaled copy of frame; pts, duration and generation are kept
+    std::shared_ptr<VideoFrame> scale(const VideoFrame& frame, int width,
+                                      int height, PixelFormat format);
+
+   private:
+    SwsContext* mSwsContext{nullptr};
+};
+
+}  // namespace yffplayer
@@ -0,0 +1,58 @@
+#include "IOBackend.h"
+
+extern "C" {
+#include <libavutil/mem.h>
+}
+
+namespace yffplayer {
+
+// FFmpeg侧的AVIO缓冲区大小，数据从后端内存拷贝，不需要太大
+constexpr int AVIO_BUFFER_SIZE = 64 * 1024;
+
+IOBackend::~IOBackend() { releaseAVIOContext(); }
+
+AVIOContext* IOBackend::getAVIOContext() {
+    if (mAVIOContext) {
+        return mAVIOContext;
+    }
+
+    unsigned char* buffer =
+        static_cast<unsigned char*>(av_malloc(AVIO_BUFFER_SIZE));
+    if (!buffer) {
+        return nullptr;
+    }
+
+    mAVIOContext =
+        avio_alloc_context(buffer, AVIO_BUFFER_SIZE, 0, this,
+                           &IOBackend::readPacket, nullptr,
+                           isSeekable() ? &IOBackend::seekPacket : nullptr);
+    if (!mAVIOContext) {
+        av_free(buffer);
+        return nullptr;
+    }
+    mAVIOContext->seekable = isSeekable() ? AVIO_SEEKABLE_NORMAL : 0;
+    return mAVIOContext;
+}
+
+bool IOBackend::isInterrupted() const {
+    return mInterrupt.callback && mInterrupt.callback(mInterrupt.opaque);
+}
+
+void IOBackend::releaseAVIOContext() {
+    if (mAVIOContext) {
+        av_freep(&mAVIOContext->buffer);
+        avio_context_free(&mAVIOContext);
+    }
+}
+
+int IOBackend::readPacket(void* opaque, uint8_t* buffer, int size) {
+    IOBackend* backend = static_cast<IOBackend*>(opaque);
+    int ret = backend->read(buffer, size);
+    return ret == 0 ? AVERROR_EOF : ret;
+}
+
+int64_t IOBackend::seekPacket(void* opaque, int64_t offset, int whence) {
+    return static_cast<IOBackend*>(opaque)->seek(offset, whence);
+}
+
+}  // namespace yffplayer
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+extern "C" {
+#include <libavformat/avio.h>
+}
+
+namespace yffplayer {
+
+// Custom input I/O for the demuxer. Subclasses implement AVIO-style read
+// and seek; the base class exposes them to FFmpeg as an AVIOContext.
+class IOBackend {
+   public:
+    virtual ~IOBackend();
+
+    // Open the input, interrupt is polled while blocking
+    virtual bool open(const std::string& url,
+                      const AVIOInterruptCB& interrupt) = 0;
+
+    // Read up to size bytes, returns bytes read, AVERROR_EOF or an error
+    virtual int read(uint8_t* buffer, int size) = 0;
+
+    // Seek like avio_seek, supports AVSEEK_SIZE
+    virtual int64_t seek(int64_t offset, int whence) = 0;
+
+    // Whether seek() can move to arbitrary offsets
+    virtual bool isSeekable() const = 0;
+
+    // Release the input, stops background work
+    virtual void close() = 0;
+
+    // AVIOContext reading through this backend, owned by the backend
+    AVIOContext* getAVIOContext();
+
+   protected:
+    // Interrupt callback of the owner
+    AVIOInterruptCB mInterrupt{nullptr, nullptr};
+
+    // Whether the owner asked to interrupt a blocking call
+    bool isInterrupted() const;
+
+    // Free the AVIOContext, subclasses call this from close()
+    void releaseAVIOContext();
+
+   private:
+    AVIOContext* mAVIOContext{nullptr};
+
+    static int readPacket(void* opaque, uint8_t* buffer, int size);
+    static int64_t seekPacket(void* opaque, int64_t offset, int whence);
+};
+
+}  // namespace yffplayer
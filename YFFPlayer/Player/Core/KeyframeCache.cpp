@@ -0,0 +1,90 @@
+#include "KeyframeCache.h"
+
+namespace yffplayer {
+
+KeyframeCache::KeyframeCache(int64_t sizeLimit) : mSizeLimit(sizeLimit) {}
+
+void KeyframeCache::setSizeLimit(int64_t bytes) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSizeLimit = bytes;
+    evict();
+}
+
+std::shared_ptr<VideoFrame> KeyframeCache::find(int64_t keyUs) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto found = mIndex.find(keyUs);
+    if (found == mIndex.end()) {
+        return nullptr;
+    }
+
+    // 命中的帧移到最前，最后淘汰
+    mEntries.splice(mEntries.begin(), mEntries, found->second);
+    return found->second->frame;
+}
+
+void KeyframeCache::insert(int64_t keyUs, std::shared_ptr<VideoFrame> frame) {
+    if (!frame) {
+        return;
+    }
+    int64_t bytes = frameBytes(*frame);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto found = mIndex.find(keyUs);
+    if (found != mIndex.end()) {
+        mSize -= found->second->bytes;
+        mEntries.erase(found->second);
+        mIndex.erase(found);
+    }
+    if (bytes > mSizeLimit) {
+        return;
+    }
+
+    mEntries.push_front(Entry{keyUs, std::move(frame), bytes});
+    mIndex[keyUs] = mEntries.begin();
+    mSize += bytes;
+    evict();
+}
+
+void KeyframeCache::clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.clear();
+    mIndex.clear();
+    mSize = 0;
+}
+
+int64_t KeyframeCache::getSize() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSize;
+}
+
+size_t KeyframeCache::getCount() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.size();
+}
+
+int64_t KeyframeCache::frameBytes(const VideoFrame& frame) {
+    int64_t bytes = 0;
+    for (int i = 0; i < 3; i++) {
+        if (!frame.data[i]) {
+            continue;
+        }
+        // 4:2:0 格式的色度平面只有一半高度
+        int height = frame.height;
+        if (i > 0 && frame.format != PixelFormat::RGB24) {
+            height = (frame.height + 1) / 2;
+        }
+        bytes += static_cast<int64_t>(frame.linesize[i]) * height;
+    }
+    return bytes;
+}
+
+void KeyframeCache::evict() {
+    while (mSize > mSizeLimit && !mEntries.empty()) {
+        const Entry& oldest = mEntries.back();
+        mSize -= oldest.bytes;
+        mIndex.erase(oldest.keyUs);
+        mEntries.pop_back();
+    }
+}
+
+}  // namespace yffplayer
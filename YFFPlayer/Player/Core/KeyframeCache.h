@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "VideoFrame.h"
+
+namespace yffplayer {
+
+// Decoded keyframes of one input keyed by timestamp, bounded by the bytes
+// of their planes. Scrubbing back and forth over the same range is then
+// served from memory; the least recently used frames are evicted first.
+// The cache only holds references: a frame's planes are released by the
+// deleter of its shared_ptr once nobody else uses it either.
+class KeyframeCache {
+   public:
+    explicit KeyframeCache(int64_t sizeLimit = 64 * 1024 * 1024);
+
+    // Evicts at once when the cache is over the new limit
+    void setSizeLimit(int64_t bytes);
+
+    // The frame stored for keyUs, nullptr on a miss
+    std::shared_ptr<VideoFrame> find(int64_t keyUs);
+
+    // Replaces an existing entry. A frame larger than the limit is not
+    // stored.
+    void insert(int64_t keyUs, std::shared_ptr<VideoFrame> frame);
+
+    void clear();
+
+    int64_t getSize() const;
+    size_t getCount() const;
+
+    // Bytes of the planes of frame
+    static int64_t frameBytes(const VideoFrame& frame);
+
+   private:
+    struct Entry {
+        int64_t keyUs;
+        std::shared_ptr<VideoFrame> frame;
+        int64_t bytes;
+    };
+
+    // Drop least recently used entries until the size fits, mMutex held
+    void evict();
+
+    mutable std::mutex mMutex;
+    int64_t mSizeLimit;
+    int64_t mSize{0};
+    // Most recently used first
+    std::list<Entry> mEntries;
+    std::unordered_map<int64_t, std::list<Entry>::iterator> mIndex;
+};
+
+}  // namespace yffplayer
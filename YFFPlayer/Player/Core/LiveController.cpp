@@ -0,0 +1,78 @@
+#include "LiveController.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace yffplayer {
+
+// 每秒延迟误差对应的变速幅度
+constexpr double SPEED_GAIN_PER_SECOND = 0.05;
+
+// 误差在目标延迟的该比例以内时保持原速，避免来回调整
+constexpr double LATENCY_DEADBAND = 0.1;
+
+LiveController::LiveController(const LiveConfig& config) : mConfig(config) {}
+
+void LiveController::setConfig(const LiveConfig& config) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mConfig = config;
+}
+
+LiveConfig LiveController::getConfig() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mConfig;
+}
+
+void LiveController::reset(bool active) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mActive = active;
+    mLatencyUs = -1;
+    mSpeed = 1.0f;
+    mJumpCount = 0;
+}
+
+bool LiveController::isActive() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mActive;
+}
+
+float LiveController::update(int64_t latencyUs) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLatencyUs = latencyUs;
+
+    // 按误差比例调整速度，并限制在配置的范围内
+    double error = static_cast<double>(latencyUs - mConfig.targetLatencyUs);
+    if (std::fabs(error) <= mConfig.targetLatencyUs * LATENCY_DEADBAND) {
+        mSpeed = 1.0f;
+    } else {
+        double speed = 1.0 + error / 1000000.0 * SPEED_GAIN_PER_SECOND;
+        mSpeed = static_cast<float>(
+            std::clamp(speed, static_cast<double>(mConfig.minSpeed),
+                       static_cast<double>(mConfig.maxSpeed)));
+    }
+    return mSpeed;
+}
+
+bool LiveController::shouldJump(int64_t latencyUs) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mConfig.jumpThresholdUs > 0 && latencyUs > mConfig.jumpThresholdUs;
+}
+
+void LiveController::onJump() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mJumpCount++;
+    mSpeed = 1.0f;
+}
+
+LiveStats LiveController::getStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    LiveStats stats;
+    stats.active = mActive;
+    stats.latencyUs = mLatencyUs;
+    stats.targetLatencyUs = mConfig.targetLatencyUs;
+    stats.playbackSpeed = mSpeed;
+    stats.jumpCount = mJumpCount;
+    return stats;
+}
+
+}  // namespace yffplayer
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include "PlayerTypes.h"
+
+namespace yffplayer {
+
+// Keeps live playback near a target latency. Small latency errors are
+// corrected by playing slightly faster or slower; beyond the jump
+// threshold playback skips ahead to the newest keyframe.
+class LiveController {
+   public:
+    explicit LiveController(const LiveConfig& config = LiveConfig());
+
+    void setConfig(const LiveConfig& config);
+    LiveConfig getConfig() const;
+
+    // Start or stop control for the current media, clears statistics
+    void reset(bool active);
+    bool isActive() const;
+
+    // Feed the measured latency, returns the playback speed to use
+    float update(int64_t latencyUs);
+
+    // Whether latency is too high to catch up by speeding up
+    bool shouldJump(int64_t latencyUs) const;
+    void onJump();
+
+    LiveStats getStats() const;
+
+   private:
+    mutable std::mutex mMutex;
+    LiveConfig mConfig;
+    bool mActive{false};
+    int64_t mLatencyUs{-1};
+    float mSpeed{1.0f};
+    int64_t mJumpCount{0};
+};
+
+}  // namespace yffplayer
@@ -0,0 +1,43 @@
+#include "Logger.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+namespace yffplayer {
+
+void logFormat(Logger& logger, LogLevel level, const char* tag,
+               const char* format, ...) {
+    // 每个线程一个格式化缓冲区，格式化过程不分配内存
+    thread_local char buffer[kLogMessageMax];
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) {
+        return;
+    }
+
+    size_t size = static_cast<size_t>(length);
+    if (size >= sizeof(buffer)) {
+        // 截断时去掉不完整的 UTF-8 字符
+        size = sizeof(buffer) - 1;
+        size_t start = size;
+        while (start > 0 && (buffer[start - 1] & 0xC0) == 0x80) {
+            start--;
+        }
+        if (start > 0) {
+            unsigned char lead = static_cast<unsigned char>(buffer[start - 1]);
+            size_t charLength = lead >= 0xF0   ? 4
+                                : lead >= 0xE0 ? 3
+                                : lead >= 0xC0 ? 2
+                                               : 1;
+            if (start - 1 + charLength > size) {
+                size = start - 1;
+            }
+        }
+    }
+    logger.write(level, tag, buffer, size);
+}
+
+}  // namespace yffplayer
@@ -1,17 +1,63 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <string>
 
 namespace yffplayer {
 
 enum class LogLevel { Verbose, Info, Warning, Error };
 
+// Levels below this are removed at compile time by YFF_LOG, 0 keeps all
+#ifndef YFF_LOG_MIN_LEVEL
+#define YFF_LOG_MIN_LEVEL 0
+#endif
+
+// Longest message formatted by YFF_LOG, longer ones are truncated
+constexpr size_t kLogMessageMax = 512;
+
 class Logger {
    public:
     virtual ~Logger() = default;
 
     virtual void log(LogLevel level, const std::string& tag,
                      const std::string& message) = 0;
+
+    // Preformatted message; the default copies it into a std::string,
+    // AsyncLogger queues it without allocating
+    virtual void write(LogLevel level, const char* tag, const char* message,
+                       size_t length) {
+        log(level, tag, std::string(message, length));
+    }
+
+    // Runtime level filter, checked by YFF_LOG before formatting
+    void setMinLevel(LogLevel level) {
+        mMinLevel.store(level, std::memory_order_relaxed);
+    }
+    virtual bool isEnabled(LogLevel level) const {
+        return level >= mMinLevel.load(std::memory_order_relaxed);
+    }
+
+   private:
+    std::atomic<LogLevel> mMinLevel{LogLevel::Verbose};
 };
 
+// printf-style formatting into a thread-local buffer, used by YFF_LOG
+void logFormat(Logger& logger, LogLevel level, const char* tag,
+               const char* format, ...)
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((format(printf, 4, 5)))
+#endif
+    ;
+
 }  // namespace yffplayer
+
+// Arguments are only evaluated when the level is compiled in and enabled:
+//   YFF_LOG(mLogger, LogLevel::Verbose, "Player", "state %d", state);
+#define YFF_LOG(logger, level, tag, ...)                                 \
+    do {                                                                \
+        if (static_cast<int>(level) >= YFF_LOG_MIN_LEVEL && (logger) && \
+            (logger)->isEnabled(level)) {                               \
+            ::yffplayer::logFormat(*(logger), level, tag, __VA_ARGS__); \
+        }                                                               \
+    } while (0)
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "PlayerTypes.h"
 
@@ -12,6 +13,7 @@ struct AVCodecParameters;
 namespace yffplayer {
 struct MediaInfo {
     MediaType type{MediaType::UNKNOWN};           // Media type
+    // Codec parameters of the selected streams, owned by the demuxer
     AVCodecParameters *audioCodecParam{nullptr};  // Audio codec parameters
     AVCodecParameters *videoCodecParam{nullptr};  // Video codec parameters
     int64_t durationMs{0};                        // Total media duration (milliseconds)
@@ -22,5 +24,12 @@ struct MediaInfo {
     int videoHeight{0};      // Video height
     int audiochannels{0};    // Audio channels
     int audioSampleRate{0};  // Audio sample rate
+
+    int audioStreamIndex{-1};      // Selected audio stream
+    int videoStreamIndex{-1};      // Selected video stream
+    std::vector<TrackInfo> tracks;  // All selectable audio and video streams
+    // Keyframe times of the selected video stream from the container index,
+    // microseconds in ascending order; empty when the index is unknown
+    std::vector<int64_t> videoKeyframesUs;
 };
 }  // namespace yffplayer
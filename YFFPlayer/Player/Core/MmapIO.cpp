@@ -0,0 +1,267 @@
+#include "MmapIO.h"
+
+#include <fcntl.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+
+extern "C" {
+#include <libavutil/error.h>
+}
+
+namespace yffplayer {
+
+// 读取位置之后预取的范围，越过一半时再预取下一段
+constexpr int64_t WILLNEED_WINDOW = 8 * 1024 * 1024;
+
+constexpr const char* FILE_PROTOCOL_PREFIX = "file:";
+
+// 当前线程正在从映射拷贝时的跳转点，SIGBUS处理函数由此返回
+static thread_local sigjmp_buf* tCopyJump = nullptr;
+static struct sigaction sPreviousBusAction;
+static std::once_flag sBusHandlerOnce;
+
+static void busHandler(int signal, siginfo_t* info, void* context) {
+    if (tCopyJump) {
+        siglongjmp(*tCopyJump, 1);
+    }
+    // 不是映射拷贝引起的，交给原有的处理方式
+    if (sPreviousBusAction.sa_flags & SA_SIGINFO) {
+        sPreviousBusAction.sa_sigaction(signal, info, context);
+    } else if (sPreviousBusAction.sa_handler != SIG_DFL &&
+               sPreviousBusAction.sa_handler != SIG_IGN) {
+        sPreviousBusAction.sa_handler(signal);
+    } else {
+        sigaction(SIGBUS, &sPreviousBusAction, nullptr);
+        raise(SIGBUS);
+    }
+}
+
+// 从映射拷贝，文件在检查之后被截断时返回false而不是终止进程
+static bool copyFromMapping(uint8_t* buffer, const uint8_t* data, int size) {
+    std::call_once(sBusHandlerOnce, []() {
+        struct sigaction action{};
+        action.sa_sigaction = busHandler;
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGBUS, &action, &sPreviousBusAction);
+    });
+
+    sigjmp_buf jump;
+    if (sigsetjmp(jump, 1) != 0) {
+        tCopyJump = nullptr;
+        return false;
+    }
+    // 栅栏阻止编译器把跳转点的设置和清除移到拷贝之外
+    tCopyJump = &jump;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    memcpy(buffer, data, size);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    tCopyJump = nullptr;
+    return true;
+}
+
+MmapIO::MmapIO(std::shared_ptr<Logger> logger) : mLogger(logger) {}
+
+MmapIO::~MmapIO() { close(); }
+
+bool MmapIO::isLocalPath(const std::string& url) {
+    if (url.compare(0, strlen(FILE_PROTOCOL_PREFIX), FILE_PROTOCOL_PREFIX) ==
+        0) {
+        return true;
+    }
+    // 不含协议头的路径视为本地文件
+    return url.find("://") == std::string::npos;
+}
+
+bool MmapIO::open(const std::string& url, const AVIOInterruptCB& interrupt) {
+    mInterrupt = interrupt;
+
+    std::string path = url;
+    if (path.compare(0, strlen(FILE_PROTOCOL_PREFIX), FILE_PROTOCOL_PREFIX) ==
+        0) {
+        path = path.substr(strlen(FILE_PROTOCOL_PREFIX));
+    }
+
+    mFd = ::open(path.c_str(), O_RDONLY);
+    if (mFd < 0) {
+        YFF_LOG(mLogger, LogLevel::Error, "MmapIO",
+                "无法打开文件: %s, 错误: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(mFd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        YFF_LOG(mLogger, LogLevel::Error, "MmapIO", "不是普通文件: %s",
+                path.c_str());
+        close();
+        return false;
+    }
+    mSize = info.st_size;
+
+    // 空文件无法映射，读取直接返回EOF
+    if (mSize > 0) {
+        void* data = mmap(nullptr, static_cast<size_t>(mSize), PROT_READ,
+                          MAP_PRIVATE, mFd, 0);
+        if (data == MAP_FAILED) {
+            YFF_LOG(mLogger, LogLevel::Error, "MmapIO",
+                    "文件映射失败: %s, 错误: %s", path.c_str(),
+                    strerror(errno));
+            close();
+            return false;
+        }
+        mData = static_cast<uint8_t*>(data);
+        madvise(mData, static_cast<size_t>(mSize), MADV_SEQUENTIAL);
+        adviseWindow(0);
+    }
+
+    YFF_LOG(mLogger, LogLevel::Info, "MmapIO", "文件已映射: %s, 大小: %lld",
+            path.c_str(), static_cast<long long>(mSize));
+    return true;
+}
+
+void MmapIO::close() {
+    if (mData) {
+        munmap(mData, static_cast<size_t>(mSize));
+        mData = nullptr;
+    }
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+    mSize = 0;
+    mUsePread = false;
+    mPosition = 0;
+    mAdvisedStart = -1;
+    mAdvisedEnd = -1;
+    releaseAVIOContext();
+}
+
+bool MmapIO::isSeekable() const { return true; }
+
+int MmapIO::read(uint8_t* buffer, int size) {
+    if (mUsePread) {
+        return readFallback(buffer, size);
+    }
+    if (mPosition >= mSize) {
+        return AVERROR_EOF;
+    }
+    if (!adviseWindow(mPosition)) {
+        return readFallback(buffer, size);
+    }
+
+    // 直接从映射拷贝，不经过read系统调用；只拷贝已检查过文件大小的窗口
+    int bytes =
+        static_cast<int>(std::min<int64_t>(size, mAdvisedEnd - mPosition));
+    if (!copyFromMapping(buffer, mData + mPosition, bytes)) {
+        // 窗口内的页已随截断失效
+        if (checkMapping()) {
+            return AVERROR(EIO);
+        }
+        return readFallback(buffer, size);
+    }
+    mPosition += bytes;
+    return bytes;
+}
+
+bool MmapIO::checkMapping() {
+    // 映射期间文件被截断时，访问新结尾之后的页会触发SIGBUS，
+    // 确认文件仍覆盖整个映射
+    struct stat info;
+    if (fstat(mFd, &info) != 0) {
+        return true;
+    }
+    if (info.st_size >= mSize) {
+        return true;
+    }
+
+    YFF_LOG(mLogger, LogLevel::Warning, "MmapIO",
+            "文件在读取期间被截断: %lld -> %lld, 改用pread读取",
+            static_cast<long long>(mSize),
+            static_cast<long long>(info.st_size));
+    munmap(mData, static_cast<size_t>(mSize));
+    mData = nullptr;
+    mSize = info.st_size;
+    mUsePread = true;
+    return false;
+}
+
+int MmapIO::readFallback(uint8_t* buffer, int size) {
+    ssize_t bytes = pread(mFd, buffer, size, mPosition);
+    if (bytes < 0) {
+        return AVERROR(errno);
+    }
+    if (bytes == 0) {
+        return AVERROR_EOF;
+    }
+    mPosition += bytes;
+    return static_cast<int>(bytes);
+}
+
+int64_t MmapIO::seek(int64_t offset, int whence) {
+    if (whence & AVSEEK_SIZE) {
+        return mSize;
+    }
+
+    int64_t position;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET:
+            position = offset;
+            break;
+        case SEEK_CUR:
+            position = mPosition + offset;
+            break;
+        case SEEK_END:
+            position = mSize + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    if (position < 0) {
+        return AVERROR(EINVAL);
+    }
+
+    mPosition = position;
+    adviseWindow(position);
+    return position;
+}
+
+bool MmapIO::adviseWindow(int64_t position) {
+    if (!mData) {
+        return false;
+    }
+    if (position >= mSize) {
+        return true;
+    }
+
+    // 位置仍在已预取范围的前半段，或范围已到文件结尾时不重复提示
+    if (position >= mAdvisedStart &&
+        (position < mAdvisedEnd - WILLNEED_WINDOW / 2 ||
+         mAdvisedEnd == mSize)) {
+        return true;
+    }
+
+    // 每推进一次窗口检查一次文件大小，而不是每次读取
+    if (!checkMapping()) {
+        return false;
+    }
+
+    // madvise要求页对齐
+    int64_t pageSize = sysconf(_SC_PAGESIZE);
+    int64_t start = position / pageSize * pageSize;
+    int64_t end = std::min(position + WILLNEED_WINDOW, mSize);
+    madvise(mData + start, static_cast<size_t>(end - start), MADV_WILLNEED);
+    mAdvisedStart = start;
+    mAdvisedEnd = end;
+    return true;
+}
+
+}  // namespace yffplayer
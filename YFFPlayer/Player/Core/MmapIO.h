@@ -0,0 +1,52 @@
+#pragma once
+
+#include <memory>
+
+#include "IOBackend.h"
+#include "Logger.h"
+
+namespace yffplayer {
+
+// Serves reads of a local file straight from a read-only mapping, with
+// madvise hints following the read position and seek targets. Touching
+// mapped pages past the end of a file truncated while it is mapped raises
+// SIGBUS. The file size is checked each time the hint window advances,
+// and copies out of the mapping catch SIGBUS for a truncation inside the
+// window; once the file has shrunk the mapping is dropped and reads fall
+// back to pread.
+class MmapIO : public IOBackend {
+   public:
+    explicit MmapIO(std::shared_ptr<Logger> logger);
+    ~MmapIO() override;
+
+    // Whether url names a local file this backend can map
+    static bool isLocalPath(const std::string& url);
+
+    bool open(const std::string& url,
+              const AVIOInterruptCB& interrupt) override;
+    int read(uint8_t* buffer, int size) override;
+    int64_t seek(int64_t offset, int whence) override;
+    bool isSeekable() const override;
+    void close() override;
+
+   private:
+    // Ask the kernel to page in the range ahead of position. Advancing the
+    // window checks the file size; false once the mapping was dropped.
+    bool adviseWindow(int64_t position);
+
+    // Whether the file still covers the mapping; unmaps it if not
+    bool checkMapping();
+
+    int readFallback(uint8_t* buffer, int size);
+
+    std::shared_ptr<Logger> mLogger;
+    int mFd{-1};
+    uint8_t* mData{nullptr};
+    int64_t mSize{0};
+    bool mUsePread{false};  // The mapping was dropped after a truncation
+    int64_t mPosition{0};
+    int64_t mAdvisedStart{-1};
+    int64_t mAdvisedEnd{-1};
+};
+
+}  // namespace yffplayer
@@ -0,0 +1,312 @@
+#include "PipelineStats.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "ThreadUtil.h"
+
+namespace yffplayer {
+
+namespace {
+
+constexpr auto kRelaxed = std::memory_order_relaxed;
+
+// CPU 时间采样间隔（微秒），线程时钟读取是系统调用，不在每次循环都读
+constexpr int64_t CPU_SAMPLE_INTERVAL_US = 100000;
+
+int64_t monotonicTimeUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// 时长所在的桶：[2^i, 2^(i+1)) 微秒，0 和 1 都在第 0 个桶
+int bucketIndex(int64_t us) {
+    if (us < 2) {
+        return 0;
+    }
+    int index = 63 - __builtin_clzll(static_cast<uint64_t>(us));
+    return index < kHistogramBuckets ? index : kHistogramBuckets - 1;
+}
+
+// 第 percent 百分位所在桶的上界
+int64_t percentile(const HistogramStats& stats, int64_t total, int percent) {
+    if (total == 0) {
+        return 0;
+    }
+    int64_t rank = (total * percent + 99) / 100;
+    int64_t seen = 0;
+    for (int i = 0; i < kHistogramBuckets; i++) {
+        seen += stats.buckets[i];
+        if (seen >= rank) {
+            return std::min(int64_t(1) << (i + 1), stats.maxUs);
+        }
+    }
+    return stats.maxUs;
+}
+
+}  // namespace
+
+void LatencyHistogram::record(int64_t us) {
+    if (us < 0) {
+        us = 0;
+    }
+    mBuckets[bucketIndex(us)].fetch_add(1, kRelaxed);
+    mSumUs.fetch_add(us, kRelaxed);
+    mCount.fetch_add(1, kRelaxed);
+
+    int64_t max = mMaxUs.load(kRelaxed);
+    while (us > max && !mMaxUs.compare_exchange_weak(max, us, kRelaxed)) {
+    }
+}
+
+void LatencyHistogram::snapshot(HistogramStats& stats) const {
+    // 各计数器分别读取，与并发写入之间可能相差几个样本
+    int64_t total = 0;
+    for (int i = 0; i < kHistogramBuckets; i++) {
+        stats.buckets[i] = mBuckets[i].load(kRelaxed);
+        total += stats.buckets[i];
+    }
+    stats.count = mCount.load(kRelaxed);
+    stats.sumUs = mSumUs.load(kRelaxed);
+    stats.maxUs = mMaxUs.load(kRelaxed);
+    stats.p50Us = percentile(stats, total, 50);
+    stats.p90Us = percentile(stats, total, 90);
+    stats.p99Us = percentile(stats, total, 99);
+}
+
+void mergeHistogram(HistogramStats& into, const HistogramStats& from) {
+    int64_t total = 0;
+    for (int i = 0; i < kHistogramBuckets; i++) {
+        into.buckets[i] += from.buckets[i];
+        total += into.buckets[i];
+    }
+    into.count += from.count;
+    into.sumUs += from.sumUs;
+    into.maxUs = std::max(into.maxUs, from.maxUs);
+    into.p50Us = percentile(into, total, 50);
+    into.p90Us = percentile(into, total, 90);
+    into.p99Us = percentile(into, total, 99);
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : mBuckets) {
+        bucket.store(0, kRelaxed);
+    }
+    mCount.store(0, kRelaxed);
+    mSumUs.store(0, kRelaxed);
+    mMaxUs.store(0, kRelaxed);
+}
+
+void PipelineStats::recordStage(Stage stage, int64_t timeUs) {
+    StageCounters& counters = mStages[static_cast<int>(stage)];
+    counters.items.fetch_add(1, kRelaxed);
+    counters.timeUs.record(timeUs);
+}
+
+void PipelineStats::addCpuTime(Stage stage, int64_t us) {
+    mStages[static_cast<int>(stage)].cpuUs.fetch_add(us, kRelaxed);
+}
+
+void PipelineStats::addPushWait(Queue queue, int64_t us) {
+    mQueues[static_cast<int>(queue)].pushWaitUs.fetch_add(us, kRelaxed);
+}
+
+void PipelineStats::addPopWait(Queue queue, int64_t us) {
+    mQueues[static_cast<int>(queue)].popWaitUs.fetch_add(us, kRelaxed);
+}
+
+void PipelineStats::addDropped(Queue queue) {
+    mQueues[static_cast<int>(queue)].dropped.fetch_add(1, kRelaxed);
+}
+
+void PipelineStats::addStale(Queue queue) {
+    mQueues[static_cast<int>(queue)].stale.fetch_add(1, kRelaxed);
+}
+
+void PipelineStats::addAudioFrameRendered() {
+    mRender.audioFramesRendered.fetch_add(1, kRelaxed);
+}
+
+void PipelineStats::addAudioUnderrun() {
+    mRender.audioUnderruns.fetch_add(1, kRelaxed);
+}
+
+void PipelineStats::addVideoFrameDropped() {
+    mRender.videoFramesDropped.fetch_add(1, kRelaxed);
+}
+
+void PipelineStats::addVideoFrameLate() {
+    mRender.videoFramesLate.fetch_add(1, kRelaxed);
+}
+
+void PipelineStats::setAvOffset(int64_t us) {
+    mRender.avOffsetUs.store(us, kRelaxed);
+}
+
+void PipelineStats::recordPresentLateness(int64_t us) {
+    mRender.presentLateUs.record(us);
+}
+
+void PipelineStats::addSeek(bool coalesced) {
+    mSeek.seeks.fetch_add(1, kRelaxed);
+    if (coalesced) {
+        mSeek.coalesced.fetch_add(1, kRelaxed);
+    }
+}
+
+void PipelineStats::recordSeekLatency(int64_t us) {
+    mSeek.latencyUs.record(us);
+}
+
+void PipelineStats::addStaleFrameShown() {
+    mSeek.staleFramesShown.fetch_add(1, kRelaxed);
+}
+
+void PipelineStats::addScrubRequest() {
+    mScrub.requests.fetch_add(1, kRelaxed);
+}
+
+void PipelineStats::addScrubFrame(bool cached) {
+    mScrub.frames.fetch_add(1, kRelaxed);
+    if (cached) {
+        mScrub.cacheHits.fetch_add(1, kRelaxed);
+    }
+}
+
+void PipelineStats::recordScrubLatency(int64_t us) {
+    mScrub.latencyUs.record(us);
+}
+
+void PipelineStats::snapshot(PlayerStats& stats) const {
+    snapshotStage(Stage::DEMUX, stats.demux);
+    snapshotStage(Stage::AUDIO_DECODE, stats.audioDecode);
+    snapshotStage(Stage::VIDEO_DECODE, stats.videoDecode);
+    snapshotStage(Stage::AUDIO_CONVERT, stats.audioConvert);
+    snapshotStage(Stage::VIDEO_CONVERT, stats.videoConvert);
+    snapshotStage(Stage::VIDEO_PRESENT, stats.videoPresent);
+
+    snapshotQueue(Queue::AUDIO_PACKETS, stats.audioPackets);
+    snapshotQueue(Queue::VIDEO_PACKETS, stats.videoPackets);
+    snapshotQueue(Queue::AUDIO_FRAMES, stats.audioFrames);
+    snapshotQueue(Queue::VIDEO_FRAMES, stats.videoFrames);
+
+    stats.audioFramesRendered = mRender.audioFramesRendered.load(kRelaxed);
+    stats.audioUnderruns = mRender.audioUnderruns.load(kRelaxed);
+    stats.videoFramesDropped = mRender.videoFramesDropped.load(kRelaxed);
+    stats.videoFramesLate = mRender.videoFramesLate.load(kRelaxed);
+    stats.avOffsetUs = mRender.avOffsetUs.load(kRelaxed);
+    mRender.presentLateUs.snapshot(stats.presentLateUs);
+
+    stats.seeks = mSeek.seeks.load(kRelaxed);
+    stats.seeksCoalesced = mSeek.coalesced.load(kRelaxed);
+    stats.staleFramesShown = mSeek.staleFramesShown.load(kRelaxed);
+    mSeek.latencyUs.snapshot(stats.seekLatencyUs);
+
+    stats.scrubRequests = mScrub.requests.load(kRelaxed);
+    stats.scrubFrames = mScrub.frames.load(kRelaxed);
+    stats.scrubCacheHits = mScrub.cacheHits.load(kRelaxed);
+    mScrub.latencyUs.snapshot(stats.scrubLatencyUs);
+
+    stats.cpuUs = stats.demux.cpuUs + stats.audioDecode.cpuUs +
+                  stats.videoDecode.cpuUs + stats.audioConvert.cpuUs +
+                  stats.videoConvert.cpuUs + stats.videoPresent.cpuUs;
+}
+
+void PipelineStats::reset() {
+    for (auto& stage : mStages) {
+        stage.items.store(0, kRelaxed);
+        stage.cpuUs.store(0, kRelaxed);
+        stage.timeUs.reset();
+    }
+    for (auto& queue : mQueues) {
+        queue.pushWaitUs.store(0, kRelaxed);
+        queue.popWaitUs.store(0, kRelaxed);
+        queue.dropped.store(0, kRelaxed);
+        queue.stale.store(0, kRelaxed);
+    }
+    mRender.audioFramesRendered.store(0, kRelaxed);
+    mRender.audioUnderruns.store(0, kRelaxed);
+    mRender.videoFramesDropped.store(0, kRelaxed);
+    mRender.videoFramesLate.store(0, kRelaxed);
+    mRender.avOffsetUs.store(0, kRelaxed);
+    mRender.presentLateUs.reset();
+    mSeek.seeks.store(0, kRelaxed);
+    mSeek.coalesced.store(0, kRelaxed);
+    mSeek.staleFramesShown.store(0, kRelaxed);
+    mSeek.latencyUs.reset();
+    mScrub.requests.store(0, kRelaxed);
+    mScrub.frames.store(0, kRelaxed);
+    mScrub.cacheHits.store(0, kRelaxed);
+    mScrub.latencyUs.reset();
+}
+
+void PipelineStats::snapshotStage(Stage stage, StageStats& stats) const {
+    const StageCounters& counters = mStages[static_cast<int>(stage)];
+    stats.items = counters.items.load(kRelaxed);
+    stats.cpuUs = counters.cpuUs.load(kRelaxed);
+    counters.timeUs.snapshot(stats.timeUs);
+}
+
+void PipelineStats::snapshotQueue(Queue queue, QueueStats& stats) const {
+    const QueueCounters& counters = mQueues[static_cast<int>(queue)];
+    stats.pushWaitUs = counters.pushWaitUs.load(kRelaxed);
+    stats.popWaitUs = counters.popWaitUs.load(kRelaxed);
+    stats.dropped = counters.dropped.load(kRelaxed);
+    stats.stale = counters.stale.load(kRelaxed);
+}
+
+StageCpuMeter::StageCpuMeter(std::shared_ptr<PipelineStats> stats,
+                             PipelineStats::Stage stage)
+    : mStats(stats), mStage(stage) {
+    if (mStats) {
+        mLastSampleTimeUs = monotonicTimeUs();
+        mLastCpuUs = currentThreadCpuTimeUs();
+    }
+}
+
+StageCpuMeter::~StageCpuMeter() { flush(); }
+
+void StageCpuMeter::addHelperThreads(const std::vector<int>& threadIds) {
+    for (int id : threadIds) {
+        int64_t cpuUs = threadCpuTimeUs(id);
+        if (cpuUs >= 0) {
+            mHelpers.push_back({id, cpuUs});
+        }
+    }
+}
+
+void StageCpuMeter::sample() {
+    if (!mStats) {
+        return;
+    }
+    int64_t now = monotonicTimeUs();
+    if (now - mLastSampleTimeUs < CPU_SAMPLE_INTERVAL_US) {
+        return;
+    }
+    mLastSampleTimeUs = now;
+    flush();
+}
+
+void StageCpuMeter::flush() {
+    if (!mStats) {
+        return;
+    }
+    int64_t cpuUs = currentThreadCpuTimeUs();
+    int64_t delta = cpuUs - mLastCpuUs;
+    mLastCpuUs = cpuUs;
+
+    // 已退出的辅助线程保留最后一次采样的值
+    for (HelperThread& helper : mHelpers) {
+        int64_t helperCpuUs = threadCpuTimeUs(helper.id);
+        if (helperCpuUs > helper.lastCpuUs) {
+            delta += helperCpuUs - helper.lastCpuUs;
+            helper.lastCpuUs = helperCpuUs;
+        }
+    }
+    if (delta > 0) {
+        mStats->addCpuTime(mStage, delta);
+    }
+}
+
+}  // namespace yffplayer
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "PlayerTypes.h"
+
+namespace yffplayer {
+
+// Lock-free log2 histogram of durations in microseconds
+class LatencyHistogram {
+   public:
+    void record(int64_t us);
+    void snapshot(HistogramStats& stats) const;
+    void reset();
+
+   private:
+    std::atomic<int64_t> mCount{0};
+    std::atomic<int64_t> mSumUs{0};
+    std::atomic<int64_t> mMaxUs{0};
+    std::atomic<int64_t> mBuckets[kHistogramBuckets]{};
+};
+
+// Add the samples of from to into and recompute the percentiles, used to
+// aggregate several players
+void mergeHistogram(HistogramStats& into, const HistogramStats& from);
+
+// Counters shared by the demuxer, the decoders and the player. Every
+// update is a relaxed atomic operation; counters written by different
+// threads live on separate cache lines. A snapshot reads each counter
+// once and never blocks the pipeline.
+class PipelineStats {
+   public:
+    enum class Stage {
+        DEMUX,
+        AUDIO_DECODE,
+        VIDEO_DECODE,
+        AUDIO_CONVERT,
+        VIDEO_CONVERT,
+        VIDEO_PRESENT,
+        COUNT,
+    };
+
+    enum class Queue {
+        AUDIO_PACKETS,
+        VIDEO_PACKETS,
+        AUDIO_FRAMES,
+        VIDEO_FRAMES,
+        COUNT,
+    };
+
+    // One item processed by a stage in timeUs
+    void recordStage(Stage stage, int64_t timeUs);
+    void addCpuTime(Stage stage, int64_t us);
+
+    void addPushWait(Queue queue, int64_t us);
+    void addPopWait(Queue queue, int64_t us);
+    void addDropped(Queue queue);
+    // Item of an earlier seek generation discarded by its consumer
+    void addStale(Queue queue);
+
+    void addAudioFrameRendered();
+    void addAudioUnderrun();
+    void addVideoFrameDropped();
+    void addVideoFrameLate();
+    void setAvOffset(int64_t us);
+    // Lateness of a presented video frame, 0 if it was on time
+    void recordPresentLateness(int64_t us);
+
+    // A seek request; coalesced when it replaced one the demuxer had not
+    // carried out yet
+    void addSeek(bool coalesced);
+    // From the seek request to the first frame of the new position
+    void recordSeekLatency(int64_t us);
+    // Frame of an earlier generation presented or played after a seek
+    void addStaleFrameShown();
+
+    void addScrubRequest();
+    // Preview frame shown, cached if it came from the keyframe cache
+    void addScrubFrame(bool cached);
+    void recordScrubLatency(int64_t us);
+
+    // Fills everything but queue sizes and the buffered duration, which
+    // belong to the queues
+    void snapshot(PlayerStats& stats) const;
+    void reset();
+
+   private:
+    struct alignas(64) StageCounters {
+        std::atomic<int64_t> items{0};
+        std::atomic<int64_t> cpuUs{0};
+        LatencyHistogram timeUs;
+    };
+
+    struct alignas(64) QueueCounters {
+        std::atomic<int64_t> pushWaitUs{0};
+        std::atomic<int64_t> popWaitUs{0};
+        std::atomic<int64_t> dropped{0};
+        std::atomic<int64_t> stale{0};
+    };
+
+    struct alignas(64) RenderCounters {
+        std::atomic<int64_t> audioFramesRendered{0};
+        std::atomic<int64_t> audioUnderruns{0};
+        std::atomic<int64_t> videoFramesDropped{0};
+        std::atomic<int64_t> videoFramesLate{0};
+        std::atomic<int64_t> avOffsetUs{0};
+        LatencyHistogram presentLateUs;
+    };
+
+    struct alignas(64) SeekCounters {
+        std::atomic<int64_t> seeks{0};
+        std::atomic<int64_t> coalesced{0};
+        std::atomic<int64_t> staleFramesShown{0};
+        LatencyHistogram latencyUs;
+    };
+
+    struct alignas(64) ScrubCounters {
+        std::atomic<int64_t> requests{0};
+        std::atomic<int64_t> frames{0};
+        std::atomic<int64_t> cacheHits{0};
+        LatencyHistogram latencyUs;
+    };
+
+    StageCounters mStages[static_cast<int>(Stage::COUNT)];
+    QueueCounters mQueues[static_cast<int>(Queue::COUNT)];
+    RenderCounters mRender;
+    SeekCounters mSeek;
+    ScrubCounters mScrub;
+
+    void snapshotStage(Stage stage, StageStats& stats) const;
+    void snapshotQueue(Queue queue, QueueStats& stats) const;
+};
+
+// Charges the CPU time of the thread that created it, plus helper threads
+// such as codec workers, to a stage. sample() is rate limited and can be
+// called on every loop iteration; the destructor adds the remainder.
+class StageCpuMeter {
+   public:
+    StageCpuMeter(std::shared_ptr<PipelineStats> stats,
+                  PipelineStats::Stage stage);
+    ~StageCpuMeter();
+
+    // Kernel thread ids, see ThreadUtil.h
+    void addHelperThreads(const std::vector<int>& threadIds);
+    void sample();
+
+   private:
+    struct HelperThread {
+        int id;
+        int64_t lastCpuUs;
+    };
+
+    std::shared_ptr<PipelineStats> mStats;
+    PipelineStats::Stage mStage;
+    int64_t mLastSampleTimeUs{0};
+    int64_t mLastCpuUs{0};
+    std::vector<HelperThread> mHelpers;
+
+    void flush();
+};
+
+}  // namespace yffplayer
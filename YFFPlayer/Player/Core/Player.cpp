@@ -1,8 +1,15 @@
 #include "Player.h"
 
+#include <algorithm>
 #include <chrono>
+#include <future>
+#include <limits>
 #include <thread>
 
+#include "AsyncLogger.h"
+#include "ThreadUtil.h"
+#include "Tracer.h"
+
 extern "C" {
 #include <libavutil/time.h>
 }
@@ -13,6 +20,13 @@ namespace yffplayer {
 constexpr int PACKET_BUFFER_SIZE = 100;
 constexpr int FRAME_BUFFER_SIZE = 30;
 
+// 直播低延迟模式使用更小的队列，减少排队延迟
+constexpr int LIVE_PACKET_BUFFER_SIZE = 25;
+constexpr int LIVE_FRAME_BUFFER_SIZE = 8;
+
+// 直播延迟控制间隔（微秒）
+constexpr int64_t LIVE_CONTROL_INTERVAL_US = 200000;
+
 // 同步阈值常量（微秒）
 constexpr int64_t SYNC_THRESHOLD_US = 5000;  // 5毫秒
 
@@ -23,7 +37,7 @@ Player::Player(std::shared_ptr<PlayerCallback> callback,
     : mCallback(callback),
       mAudioRenderer(audioRenderer),
       mVideoRenderer(videoRenderer),
-      mLogger(logger) {
+      mLogger(AsyncLogger::wrap(logger)) {
     // 初始化缓冲区
     mAudioPacketBuffer =
         std::make_shared<BufferQueue<AVPacket *>>(PACKET_BUFFER_SIZE);
@@ -35,63 +49,149 @@ Player::Player(std::shared_ptr<PlayerCallback> callback,
     mVideoFrameBuffer =
         std::make_shared<BufferQueue<std::shared_ptr<VideoFrame>>>(
             FRAME_BUFFER_SIZE);
+    mBufferingController = std::make_shared<BufferingController>();
+    mProbeCache = std::make_shared<ProbeCache>();
+    mLiveController = std::make_shared<LiveController>();
+    mStats = std::make_shared<PipelineStats>();
 
-    mLogger->log(LogLevel::Info, "Player", "播放器初始化完成");
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "播放器初始化完成");
 }
 
 Player::~Player() {
     close();
-    mLogger->log(LogLevel::Info, "Player", "播放器已销毁");
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "播放器已销毁");
 }
 
 bool Player::open(const std::string &url) {
     //    std::lock_guard<std::mutex> lock(mStateMutex);
 
     if (mState != PlayerState::IDLE && mState != PlayerState::STOPPED) {
-        mLogger->log(LogLevel::Error, "Player", "播放器状态错误，无法打开媒体");
+        YFF_LOG(mLogger, LogLevel::Error, "Player",
+                "播放器状态错误，无法打开媒体");
         return false;
     }
 
     updateState(PlayerState::INITIALIZED);
+    int64_t openStartTime = getCurrentTimeUs();
+    mOpenTimeUs = -1;
+    mProbeCacheHit = false;
+    mStats->reset();
+    mAudioUnderrun = false;
+
+    // 使用执行器时，本次打开的各组件作为同一任务组的任务运行
+    std::shared_ptr<TaskGroup> taskGroup;
+    {
+        std::lock_guard<std::mutex> configLock(mConfigMutex);
+        mTaskGroup = mExecutor ? std::make_shared<TaskGroup>(mExecutor,
+                                                             mPriority.load())
+                               : nullptr;
+        taskGroup = mTaskGroup;
+    }
+    mPresentRunner.setTaskGroup(taskGroup);
+    mBufferingRunner.setTaskGroup(taskGroup);
+    if (taskGroup) {
+        mVideoFrameBuffer->setPushListener(
+            [this]() { mPresentRunner.wake(); });
+    } else {
+        mVideoFrameBuffer->setPushListener(nullptr);
+    }
 
     // 创建解复用器
     mDemuxer = std::make_shared<Demuxer>(mAudioPacketBuffer, mVideoPacketBuffer,
                                          mLogger);
+    mDemuxer->setTaskGroup(taskGroup);
+    mDemuxer->setLoop(mLooping);
+    mDemuxer->setLoopCacheLimit(mLoopCacheLimit);
+    mDemuxer->setOpenProfile(mOpenProfile);
+    mDemuxer->setStats(mStats);
+    {
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        mSeekGeneration = mDemuxer->getSeekGeneration();
+        mUrl = url;
+    }
+    mSeekRequestTime = -1;
+    mOpenedProfile = mOpenProfile.load();
+    {
+        std::lock_guard<std::mutex> configLock(mConfigMutex);
+        mDemuxer->setIoTimeouts(mIoTimeouts);
+        mDemuxer->setInputConfig(mInputConfig);
+        mDemuxer->setTimeshiftConfig(mTimeshiftConfig);
+        mDemuxer->setTrackPreferences(mTrackPreferences);
+        mDemuxer->setProbeCache(mProbeCacheEnabled ? mProbeCache : nullptr);
+    }
 
     // 打开媒体文件
     if (!mDemuxer->open(url)) {
-        mLogger->log(LogLevel::Error, "Player", "打开媒体文件失败: " + url);
+        YFF_LOG(mLogger, LogLevel::Error, "Player", "打开媒体文件失败: %s",
+                url.c_str());
         updateState(PlayerState::ERROR);
         return false;
     }
 
     // 获取媒体信息
     mMediaInfo = mDemuxer->getMediaInfo();
+    mProbeCacheHit = mDemuxer->isProbeCacheHit();
 
     // 通知回调
     if (mCallback) {
         mCallback->onMediaInfo(mMediaInfo);
     }
 
-    // 创建解码器
+    // 直播低延迟模式：小队列、低延迟解码，播放中按延迟目标追赶
+    bool lowLatencyLive =
+        mDemuxer->isLive() && mLiveController->getConfig().lowLatency;
+    mLiveController->reset(lowLatencyLive);
+    int packetBufferSize =
+        lowLatencyLive ? LIVE_PACKET_BUFFER_SIZE : PACKET_BUFFER_SIZE;
+    int frameBufferSize =
+        lowLatencyLive ? LIVE_FRAME_BUFFER_SIZE : FRAME_BUFFER_SIZE;
+    mAudioPacketBuffer->setMaxSize(packetBufferSize);
+    mVideoPacketBuffer->setMaxSize(packetBufferSize);
+    mAudioFrameBuffer->setMaxSize(frameBufferSize);
+    mVideoFrameBuffer->setMaxSize(frameBufferSize);
+
+    // 创建解码器，快速启动时音频解码器在独立线程中并行打开
+    std::future<bool> audioOpened;
     if (mMediaInfo.hasAudio) {
         mAudioDecoder = std::make_shared<AudioDecoder>(
             mAudioPacketBuffer, mAudioFrameBuffer, mLogger);
-        if (!mAudioDecoder->open(mMediaInfo.audioCodecParam)) {
-            mLogger->log(LogLevel::Error, "Player", "初始化音频解码器失败");
-            updateState(PlayerState::ERROR);
-            return false;
-        }
+        mAudioDecoder->setLowDelay(lowLatencyLive);
+        mAudioDecoder->setSpeed(mPlaybackRate);
+        mAudioDecoder->setStats(mStats);
+        mAudioDecoder->setSeekGeneration(mDemuxer->getSeekGeneration());
+        mAudioDecoder->setTaskGroup(taskGroup);
+        std::shared_ptr<AudioDecoder> audioDecoder = mAudioDecoder;
+        AVCodecParameters *audioParams = mMediaInfo.audioCodecParam;
+        audioOpened = std::async(
+            mOpenedProfile == OpenProfile::FAST_START ? std::launch::async
+                                                      : std::launch::deferred,
+            [audioDecoder, audioParams]() {
+                return audioDecoder->open(audioParams);
+            });
     }
 
+    bool videoOpened = true;
     if (mMediaInfo.hasVideo) {
         mVideoDecoder = std::make_shared<VideoDecoder>(
             mVideoPacketBuffer, mVideoFrameBuffer, mLogger);
-        if (!mVideoDecoder->open(mMediaInfo.videoCodecParam)) {
-            mLogger->log(LogLevel::Error, "Player", "初始化视频解码器失败");
-            updateState(PlayerState::ERROR);
-            return false;
-        }
+        mVideoDecoder->setLowDelay(lowLatencyLive);
+        mVideoDecoder->setStats(mStats);
+        mVideoDecoder->setSeekGeneration(mDemuxer->getSeekGeneration());
+        mVideoDecoder->setTaskGroup(taskGroup);
+        mVideoDecoder->setThreadCount(mVideoDecoderThreads);
+        videoOpened = mVideoDecoder->open(mMediaInfo.videoCodecParam);
+    }
+
+    if (audioOpened.valid() && !audioOpened.get()) {
+        YFF_LOG(mLogger, LogLevel::Error, "Player", "初始化音频解码器失败");
+        updateState(PlayerState::ERROR);
+        return false;
+    }
+
+    if (!videoOpened) {
+        YFF_LOG(mLogger, LogLevel::Error, "Player", "初始化视频解码器失败");
+        updateState(PlayerState::ERROR);
+        return false;
     }
 
     // 初始化渲染器
@@ -100,7 +200,7 @@ bool Player::open(const std::string &url) {
             kAudioTargetSampleRate, kAudioTargetChannels, kAudioTargetBitDepth,
             this->shared_from_this());
         if (!ret) {
-            mLogger->log(LogLevel::Error, "Player", "初始化音频渲染器失败");
+            YFF_LOG(mLogger, LogLevel::Error, "Player", "初始化音频渲染器失败");
             updateState(PlayerState::ERROR);
             return false;
         }
@@ -110,14 +210,17 @@ bool Player::open(const std::string &url) {
         if (!mVideoRenderer->init(mMediaInfo.videoWidth, mMediaInfo.videoHeight,
                                   PixelFormat::YUV420P,  // 假设默认使用YUV420P
                                   this->shared_from_this())) {
-            mLogger->log(LogLevel::Error, "Player", "初始化视频渲染器失败");
+            YFF_LOG(mLogger, LogLevel::Error, "Player", "初始化视频渲染器失败");
             updateState(PlayerState::ERROR);
             return false;
         }
     }
 
+    mOpenTimeUs = getCurrentTimeUs() - openStartTime;
     updateState(PlayerState::PREPARED);
-    mLogger->log(LogLevel::Info, "Player", "媒体准备完成: " + url);
+    YFF_LOG(mLogger, LogLevel::Info, "Player",
+            "媒体准备完成: %s, 耗时 %lld 微秒", url.c_str(),
+            static_cast<long long>(mOpenTimeUs));
     return true;
 }
 
@@ -126,10 +229,16 @@ bool Player::start() {
 
     if (mState != PlayerState::PREPARED && mState != PlayerState::PAUSED &&
         mState != PlayerState::COMPLETED) {
-        mLogger->log(LogLevel::Error, "Player", "播放器状态错误，无法开始播放");
+        YFF_LOG(mLogger, LogLevel::Error, "Player",
+                "播放器状态错误，无法开始播放");
         return false;
     }
 
+    mStartRequestTime = getCurrentTimeUs();
+    mPrerollTimeUs = -1;
+    mFirstFrameTimeUs = -1;
+    mFirstFramePending = true;
+
     // 启动解复用器
     mDemuxer->start();
 
@@ -142,50 +251,296 @@ bool Player::start() {
         mVideoDecoder->start();
     }
 
-    // 重置时钟
+    // 异步等待预缓冲完成后再开始渲染
+    mBufferingRunner.stop();
+    mBufferingController->reset();
+    mRenderingBegun = false;
+    // 预缓冲期间的跳转改写时钟，开始渲染时从这里起步
     mAudioClock = 0;
     mVideoClock = 0;
-    mStartTime = getCurrentTimeUs();
+    updateState(PlayerState::BUFFERING);
+    mBufferingRunning = true;
+    mSampledDemuxer = nullptr;
+    mSampledInput = InputStats();
+    mLastSampleTime = getCurrentTimeUs();
+    mLastLiveControlTime = mLastSampleTime;
+    mBufferingRunner.start("yff-buffering",
+                           [this]() { return bufferingStep(); });
+
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "开始缓冲");
+    return true;
+}
 
-    // 启动播放线程
-    mIsPlaying = true;
-    if (mMediaInfo.hasVideo && mVideoRenderer) {
-        mVideoPlayThread = std::thread(&Player::videoPlayLoop, this);
+TaskStep Player::bufferingStep() {
+    if (!mBufferingRunning) {
+        return TaskStep::done();
     }
 
-    // 如果有音频，开始播放第一帧
-    constexpr int minFrames = 30;  // 至少等待3帧
-    auto startTime = getCurrentTimeUs();
-    constexpr int64_t timeoutUs = 1000000;  // 1秒超时
-    while (mAudioFrameBuffer->size() < minFrames && mIsPlaying) {
-        if (getCurrentTimeUs() - startTime > timeoutUs) {
-            mLogger->log(LogLevel::Warning, "Player", "等待音频帧超时");
-            break;
+    int64_t now = getCurrentTimeUs();
+    Pipeline pipeline = getPipeline();
+
+    // 每500毫秒采样一次输入吞吐量，用于自适应水位
+    if (now - mLastSampleTime >= 500000) {
+        const std::shared_ptr<Demuxer> &current = pipeline.demuxer;
+        InputStats input = current ? current->getInputStats() : mSampledInput;
+        if (current == mSampledDemuxer) {
+            mBufferingController->updateThroughput(
+                input.mediaTimeUs - mSampledInput.mediaTimeUs,
+                input.readTimeUs - mSampledInput.readTimeUs);
         }
-        av_usleep(10000);  // 等待10ms
+        mSampledDemuxer = current;
+        mSampledInput = input;
+        mLastSampleTime = now;
     }
-    if (!mAudioFrameBuffer->empty()) {
-        playNextAudioFrame();  // 缓冲区有数据后再开始播放
-    } else {
-        mLogger->log(LogLevel::Error, "Player", "音频缓冲区为空，无法开始播放");
-        return false;
+
+    PlayerState state = mState;
+    if (state == PlayerState::BUFFERING && !mRenderingBegun) {
+        // 首次预缓冲
+        if (isPrerollReady(pipeline)) {
+            mRenderingBegun = true;
+            beginRendering();
+            mBufferingController->onPlaybackStarted(getCurrentTimeUs());
+            return TaskStep::again();
+        }
+        return TaskStep::sleep(2000);  // 2毫秒
+    }
+
+    if (state == PlayerState::STARTED &&
+        now - mLastLiveControlTime >= LIVE_CONTROL_INTERVAL_US) {
+        mLastLiveControlTime = now;
+        if (mLiveController->isActive()) {
+            updateLiveLatency();
+        }
+    }
+
+    if (state == PlayerState::STARTED && mClockMode == ClockMode::FREE_RUN) {
+        // 自由运行时渲染快于解码是常态，不进入缓冲，只重新驱动音频
+        if (pipeline.hasAudio && mAudioFramesInFlight == 0) {
+            playNextAudioFrame();
+        }
+    } else if (state == PlayerState::STARTED) {
+        if (mBufferingController->shouldStartBuffering(
+                getBufferedDuration(), isInputExhausted())) {
+            enterBuffering();
+        } else {
+            mSeekPending = false;
+        }
+    } else if (state == PlayerState::BUFFERING) {
+        if (mBufferingController->shouldStopBuffering(
+                getBufferedDuration(), isInputExhausted())) {
+            leaveBuffering();
+        }
+    }
+
+    return TaskStep::sleep(10000);  // 10毫秒
+}
+
+void Player::updateLiveLatency() {
+    // 首帧渲染前时钟尚未对齐到流的时间戳
+    if (mFirstFramePending) {
+        return;
+    }
+
+    Pipeline pipeline = getPipeline();
+    InputStats input =
+        pipeline.demuxer ? pipeline.demuxer->getInputStats() : InputStats();
+    if (input.lastPtsUs < 0) {
+        return;
+    }
+
+    int64_t position = pipeline.hasAudio ? mAudioClock : mVideoClock;
+    int64_t latency = input.lastPtsUs - position;
+    if (mLiveController->shouldJump(latency)) {
+        jumpToLiveEdge();
+        return;
+    }
+
+    // 音频通过重采样变速，视频跟随音频时钟；追赶倍速叠加在播放速率上
+    float speed = mLiveController->update(latency);
+    if (pipeline.audioDecoder) {
+        pipeline.audioDecoder->setSpeed(speed * mPlaybackRate);
+    }
+}
+
+void Player::jumpToLiveEdge() {
+    YFF_LOG(mLogger, LogLevel::Warning, "Player",
+            "直播延迟过大，跳到最新关键帧");
+
+    // 解复用器开始丢包并启用新的跳转代号，已排队的数据由各阶段丢弃
+    Pipeline pipeline = getPipeline();
+    if (pipeline.demuxer) {
+        pipeline.demuxer->skipToKeyframe();
+    }
+    mSeekPending = true;
+
+    mLiveController->onJump();
+    if (pipeline.audioDecoder) {
+        pipeline.audioDecoder->setSpeed(mPlaybackRate);
+    }
+}
+
+void Player::enterBuffering() {
+    std::unique_lock<std::mutex> lock(mStateMutex, std::try_to_lock);
+    if (!lock.owns_lock() || mState != PlayerState::STARTED) {
+        return;
+    }
+
+    // 暂停音频渲染，视频线程在缓冲状态下不再出帧，时钟随之停止
+    if (getPipeline().hasAudio && mAudioRenderer) {
+        mAudioRenderer->pause();
+    }
+
+    int64_t now = getCurrentTimeUs();
+    mBufferingStartTime = now;
+    // 跳转后的缓冲不计入卡顿次数
+    bool isRebuffer = !mSeekPending.exchange(false);
+    mBufferingController->onBufferingStarted(now, isRebuffer);
+
+    updateState(PlayerState::BUFFERING);
+    YFF_LOG(mLogger, LogLevel::Warning, "Player",
+            "缓冲不足，开始缓冲: %lld 微秒",
+            static_cast<long long>(getBufferedDuration()));
+}
+
+void Player::leaveBuffering() {
+    bool hasAudio = getPipeline().hasAudio;
+    {
+        std::unique_lock<std::mutex> lock(mStateMutex, std::try_to_lock);
+        if (!lock.owns_lock() || mState != PlayerState::BUFFERING) {
+            return;
+        }
+
+        int64_t now = getCurrentTimeUs();
+        // 无音频时视频以系统时钟同步，需要扣除缓冲时间
+        mStartTime += now - mBufferingStartTime;
+        mBufferingController->onBufferingEnded(now);
+
+        if (hasAudio && mAudioRenderer) {
+            mAudioRenderer->resume();
+        }
+
+        updateState(PlayerState::STARTED);
+        YFF_LOG(mLogger, LogLevel::Info, "Player",
+                "缓冲完成，恢复播放: %lld 微秒",
+                static_cast<long long>(getBufferedDuration()));
+    }
+
+    // 音频回调链在缓冲区耗尽时已经中断，重新驱动
+    if (hasAudio && mAudioFramesInFlight == 0) {
+        playNextAudioFrame();
+    }
+}
+
+Player::Pipeline Player::getPipeline() const {
+    std::lock_guard<std::mutex> lock(mPipelineMutex);
+    Pipeline pipeline;
+    pipeline.demuxer = mDemuxer;
+    pipeline.audioDecoder = mAudioDecoder;
+    pipeline.videoDecoder = mVideoDecoder;
+    pipeline.audioPacketBuffer = mAudioPacketBuffer;
+    pipeline.videoPacketBuffer = mVideoPacketBuffer;
+    pipeline.audioFrameBuffer = mAudioFrameBuffer;
+    pipeline.videoFrameBuffer = mVideoFrameBuffer;
+    pipeline.hasAudio = mMediaInfo.hasAudio;
+    pipeline.hasVideo = mMediaInfo.hasVideo;
+    pipeline.durationUs = mMediaInfo.durationMs * 1000;
+    pipeline.videoStreamIndex = mMediaInfo.videoStreamIndex;
+    return pipeline;
+}
+
+bool Player::isPrerollReady(const Pipeline &pipeline) {
+    PrerollConfig config = getPrerollConfig();
+
+    bool audioReady = !pipeline.hasAudio || !mAudioRenderer ||
+                      pipeline.audioFrameBuffer->duration() >=
+                          config.audioDurationUs;
+    bool videoReady = !pipeline.hasVideo || !mVideoRenderer ||
+                      pipeline.videoFrameBuffer->size() >=
+                          static_cast<size_t>(config.videoFrames);
+    if (audioReady && videoReady) {
+        return true;
+    }
+
+    // 输入已经结束（如很短的文件），不再等待
+    return pipeline.demuxer && pipeline.demuxer->isEndOfFile() &&
+           pipeline.audioPacketBuffer->empty() &&
+           pipeline.videoPacketBuffer->empty();
+}
+
+bool Player::isInputExhausted() {
+    std::lock_guard<std::mutex> lock(mPipelineMutex);
+    if (mDemuxer && mDemuxer->isEndOfFile()) {
+        return mAudioPacketBuffer->empty() && mVideoPacketBuffer->empty();
+    }
+
+    // 缓冲区已满时无法继续缓冲
+    return mAudioPacketBuffer->full() || mVideoPacketBuffer->full();
+}
+
+int64_t Player::getBufferedDuration() const {
+    std::lock_guard<std::mutex> lock(mPipelineMutex);
+    int64_t audio =
+        mAudioPacketBuffer->duration() + mAudioFrameBuffer->duration();
+    int64_t video =
+        mVideoPacketBuffer->duration() + mVideoFrameBuffer->duration();
+
+    if (mMediaInfo.hasAudio && mMediaInfo.hasVideo) {
+        return std::min(audio, video);
+    }
+    return mMediaInfo.hasAudio ? audio : video;
+}
+
+void Player::beginRendering() {
+    mPrerollTimeUs = getCurrentTimeUs() - mStartRequestTime;
+    Pipeline pipeline = getPipeline();
+
+    // 从起始位置或预缓冲期间跳转到的位置开始计时
+    int64_t position = mVideoClock;
+    mAudioClock = position;
+    mStartTime = getCurrentTimeUs() - position;
+
+    // 启动播放线程
+    mIsPlaying = true;
+    if (pipeline.hasVideo && mVideoRenderer) {
+        startPresenting();
+    }
+
+    // 驱动音频回调链
+    if (pipeline.hasAudio) {
+        playNextAudioFrame();
     }
 
     updateState(PlayerState::STARTED);
-    mLogger->log(LogLevel::Info, "Player", "开始播放");
-    return true;
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "开始播放, 预缓冲耗时 %lld 微秒",
+            static_cast<long long>(mPrerollTimeUs));
+}
+
+void Player::onFirstFrameRendered() {
+    bool expected = true;
+    if (!mFirstFramePending.compare_exchange_strong(expected, false)) {
+        return;
+    }
+
+    mFirstFrameTimeUs = getCurrentTimeUs() - mStartRequestTime;
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "首帧耗时: %lld 微秒",
+            static_cast<long long>(mFirstFrameTimeUs));
+    if (mCallback) {
+        mCallback->onFirstFrameRendered(mFirstFrameTimeUs);
+    }
 }
 
 bool Player::pause() {
     std::lock_guard<std::mutex> lock(mStateMutex);
 
-    if (mState != PlayerState::STARTED) {
-        mLogger->log(LogLevel::Error, "Player", "播放器状态错误，无法暂停");
+    if (mState != PlayerState::STARTED &&
+        !(mState == PlayerState::BUFFERING && mRenderingBegun)) {
+        YFF_LOG(mLogger, LogLevel::Error, "Player", "播放器状态错误，无法暂停");
         return false;
     }
+    mBufferingController->onPlaybackStopped(getCurrentTimeUs());
 
     // 暂停音频渲染
-    if (mMediaInfo.hasAudio && mAudioRenderer) {
+    if (getPipeline().hasAudio && mAudioRenderer) {
         mAudioRenderer->pause();
     }
 
@@ -193,7 +548,7 @@ bool Player::pause() {
     mIsPlaying = false;
 
     updateState(PlayerState::PAUSED);
-    mLogger->log(LogLevel::Info, "Player", "播放已暂停");
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "播放已暂停");
     return true;
 }
 
@@ -201,23 +556,26 @@ bool Player::resume() {
     std::lock_guard<std::mutex> lock(mStateMutex);
 
     if (mState != PlayerState::PAUSED) {
-        mLogger->log(LogLevel::Error, "Player", "播放器状态错误，无法恢复播放");
+        YFF_LOG(mLogger, LogLevel::Error, "Player",
+                "播放器状态错误，无法恢复播放");
         return false;
     }
 
     // 恢复音频渲染
-    if (mMediaInfo.hasAudio && mAudioRenderer) {
+    Pipeline pipeline = getPipeline();
+    if (pipeline.hasAudio && mAudioRenderer) {
         mAudioRenderer->resume();
     }
 
-    // 恢复播放线程
+    // 恢复播放线程，暂停时旧线程已经退出
     mIsPlaying = true;
-    if (mMediaInfo.hasVideo && mVideoRenderer && !mVideoPlayThread.joinable()) {
-        mVideoPlayThread = std::thread(&Player::videoPlayLoop, this);
+    if (pipeline.hasVideo && mVideoRenderer) {
+        startPresenting();
     }
+    mBufferingController->onPlaybackStarted(getCurrentTimeUs());
 
     updateState(PlayerState::STARTED);
-    mLogger->log(LogLevel::Info, "Player", "播放已恢复");
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "播放已恢复");
     return true;
 }
 
@@ -227,38 +585,70 @@ bool Player::stop() {
     if (mState == PlayerState::IDLE || mState == PlayerState::STOPPED) {
         return true;
     }
+    int64_t stopStartTime = getCurrentTimeUs();
 
-    // 停止播放线程
-    mIsPlaying = false;
-    if (mVideoPlayThread.joinable()) {
-        mVideoPlayThread.join();
+    // 先中断解复用器阻塞中的I/O，与其他线程的退出并行进行
+    std::shared_ptr<Demuxer> abortedDemuxer = getPipeline().demuxer;
+    if (abortedDemuxer) {
+        abortedDemuxer->abort();
     }
 
+    // 停止缓冲线程
+    mBufferingRunning = false;
+    mBufferingRunner.stop();
+    mBufferingController->onPlaybackStopped(getCurrentTimeUs());
+
+    // 停止拖动预览和播放线程
+    closeScrubPreview();
+    mIsPlaying = false;
+    mPresentRunner.stop();
+    mPendingFrame = nullptr;
+
+    // 停止播放后不再切换条目，此后的快照即最终的流水线
+    Pipeline pipeline = getPipeline();
+
     // 停止解码器
-    if (mAudioDecoder) {
-        mAudioDecoder->stop();
+    if (pipeline.audioDecoder) {
+        pipeline.audioDecoder->stop();
     }
 
-    if (mVideoDecoder) {
-        mVideoDecoder->stop();
+    if (pipeline.videoDecoder) {
+        pipeline.videoDecoder->stop();
     }
 
     // 停止解复用器
-    if (mDemuxer) {
-        mDemuxer->stop();
+    if (pipeline.demuxer) {
+        pipeline.demuxer->stop();
     }
 
     // 停止渲染器
     if (mAudioRenderer) {
         mAudioRenderer->stop();
     }
+    {
+        std::lock_guard<std::mutex> pipelineLock(mPipelineMutex);
+        mAudioFramesInFlight = 0;
+        mRetiredAudioFrames = 0;
+    }
 
+    // 丢弃预加载的下一条目
+    clearNext();
+    {
+        std::lock_guard<std::mutex> retireLock(mRetireMutex);
+        if (mRetireThread.joinable()) {
+            mRetireThread.join();
+        }
+    }
+
+    mStopTimeUs = getCurrentTimeUs() - stopStartTime;
     updateState(PlayerState::STOPPED);
-    mLogger->log(LogLevel::Info, "Player", "播放已停止");
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "播放已停止, 耗时 %lld 微秒",
+            static_cast<long long>(mStopTimeUs));
     return true;
 }
 
 bool Player::close() {
+    int64_t closeStartTime = getCurrentTimeUs();
     stop();
 
     std::lock_guard<std::mutex> lock(mStateMutex);
@@ -293,64 +683,213 @@ bool Player::close() {
     mAudioFrameBuffer->clear();
     mVideoFrameBuffer->clear();
 
+    mCloseTimeUs = getCurrentTimeUs() - closeStartTime;
     updateState(PlayerState::IDLE);
-    mLogger->log(LogLevel::Info, "Player", "播放器已关闭");
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "播放器已关闭, 耗时 %lld 微秒",
+            static_cast<long long>(mCloseTimeUs));
     return true;
 }
 
-bool Player::seek(int64_t position) {
+bool Player::seek(int64_t position) { return seekTo(position, false); }
+
+bool Player::seekTo(int64_t position, bool precise) {
     std::lock_guard<std::mutex> lock(mStateMutex);
 
     if (mState != PlayerState::STARTED && mState != PlayerState::PAUSED &&
-        mState != PlayerState::COMPLETED) {
-        mLogger->log(LogLevel::Error, "Player", "播放器状态错误，无法跳转");
+        mState != PlayerState::BUFFERING && mState != PlayerState::COMPLETED) {
+        YFF_LOG(mLogger, LogLevel::Error, "Player", "播放器状态错误，无法跳转");
         return false;
     }
 
-    // 暂停播放
-    bool wasPlaying = (mState == PlayerState::STARTED);
-    if (wasPlaying) {
-        pause();
-    }
+    // 跳转引起的缓冲不计入卡顿
+    mSeekPending = true;
 
-    // 清空缓冲区
-    clearPacketBuffer();
-    mAudioFrameBuffer->clear();
-    mVideoFrameBuffer->clear();
+    // 执行跳转：新的跳转代号使队列和解码器中的旧数据失效，由各阶段
+    // 自行丢弃，不清空正在使用的队列；连续跳转只执行最后一个目标
+    uint32_t generation = 0;
+    std::shared_ptr<Demuxer> demuxer = getPipeline().demuxer;
+    if (demuxer) {
+        generation = demuxer->seek(position, precise);
+    }
 
-    // 执行跳转
-    if (mDemuxer) {
-        mDemuxer->seek(position);
+    // 播放中（含缓冲中）的跳转统计到新位置首帧的耗时
+    if (mState == PlayerState::STARTED || mState == PlayerState::BUFFERING) {
+        mSeekLatencyGeneration = generation;
+        mSeekRequestTime = getCurrentTimeUs();
+    } else {
+        mSeekRequestTime = -1;
     }
 
-    // 重置时钟
+    // 重置时钟；缓冲中跳转时，恢复播放只扣除跳转之后的缓冲时间
+    int64_t now = getCurrentTimeUs();
     mAudioClock = position;
     mVideoClock = position;
-    mStartTime = getCurrentTimeUs() - position;
+    mStartTime = now - position;
+    if (mState == PlayerState::BUFFERING) {
+        mBufferingStartTime = now;
+    }
+
+    // 等待到期的旧帧在下一步被丢弃
+    mPresentRunner.wake();
 
-    // 如果之前在播放，恢复播放
-    if (wasPlaying) {
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "跳转到: %lld 微秒",
+            static_cast<long long>(position));
+    return true;
+}
+
+bool Player::beginScrub() {
+    if (mScrubbing) {
+        return true;
+    }
+    PlayerState state = mState;
+    Pipeline pipeline = getPipeline();
+    if ((state != PlayerState::STARTED && state != PlayerState::PAUSED &&
+         state != PlayerState::BUFFERING && state != PlayerState::COMPLETED) ||
+        !pipeline.hasVideo || !mVideoRenderer) {
+        YFF_LOG(mLogger, LogLevel::Error, "Player", "播放器状态错误，无法拖动");
+        return false;
+    }
+
+    // 拖动期间暂停播放，松开后恢复
+    mScrubResume =
+        state == PlayerState::STARTED || state == PlayerState::BUFFERING;
+    if (mScrubResume && !pause()) {
+        return false;
+    }
+    mSeekRequestTime = -1;
+
+    // 预览解码器按条目创建，同一条目的关键帧缓存在多次拖动间保留
+    std::string url;
+    {
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        url = mUrl;
+    }
+    if (!mScrubPreview || mScrubPreview->getUrl() != url) {
+        closeScrubPreview();
+        ScrubConfig config;
+        std::shared_ptr<TaskGroup> taskGroup;
+        IoTimeouts timeouts;
+        {
+            std::lock_guard<std::mutex> configLock(mConfigMutex);
+            config = mScrubConfig;
+            taskGroup = mTaskGroup;
+            timeouts = mIoTimeouts;
+        }
+        mScrubPreview = std::make_shared<ScrubPreview>(mLogger);
+        mScrubPreview->setStats(mStats);
+        mScrubPreview->setTaskGroup(taskGroup);
+        mScrubPreview->setIoTimeouts(timeouts);
+        mScrubPreview->open(url, pipeline.videoStreamIndex, config,
+                            [this](const std::shared_ptr<VideoFrame> &frame) {
+                                return showScrubFrame(frame);
+                            });
+    }
+    mScrubbing = true;
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "开始拖动");
+    return true;
+}
+
+bool Player::scrub(int64_t position) {
+    if (!mScrubbing || !mScrubPreview) {
+        return false;
+    }
+    // 只预览最近的关键帧，未处理的请求被新的位置替换
+    mScrubPreview->request(position);
+    return true;
+}
+
+bool Player::endScrub(int64_t position) {
+    if (!mScrubbing) {
+        return false;
+    }
+    {
+        // 此后预览帧不再显示，不会覆盖跳转后的画面
+        std::lock_guard<std::mutex> lock(mScrubMutex);
+        mScrubbing = false;
+    }
+    if (mScrubPreview) {
+        mScrubPreview->cancel();
+    }
+
+    // 松开时精确跳转到目标位置
+    bool sought = seekTo(position, true);
+    if (mScrubResume) {
         resume();
     }
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "结束拖动: %lld 微秒",
+            static_cast<long long>(position));
+    return sought;
+}
+
+void Player::setScrubConfig(const ScrubConfig &config) {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mScrubConfig = config;
+}
+
+bool Player::showScrubFrame(const std::shared_ptr<VideoFrame> &frame) {
+    std::lock_guard<std::mutex> lock(mScrubMutex);
+    if (!mScrubbing || !mVideoRenderer) {
+        return false;
+    }
 
-    mLogger->log(LogLevel::Info, "Player",
-                 "跳转到: " + std::to_string(position) + " 微秒");
+    // 缓存中的帧可能被再次显示，渲染副本并标记为当前代号
+    VideoFrame shown = *frame;
+    {
+        std::lock_guard<std::mutex> pipelineLock(mPipelineMutex);
+        shown.generation = currentGeneration();
+    }
+    // 拖动期间对外报告预览帧的位置
+    mAudioClock = shown.pts;
+    if (!mVideoRenderer->render(shown)) {
+        YFF_LOG(mLogger, LogLevel::Error, "Player", "渲染预览帧失败");
+        return false;
+    }
     return true;
 }
 
+void Player::closeScrubPreview() {
+    mScrubbing = false;
+    if (mScrubPreview) {
+        mScrubPreview->close();
+        mScrubPreview = nullptr;
+    }
+}
+
 PlayerState Player::getState() const { return mState; }
 
 int64_t Player::getCurrentPosition() const {
     // 优先使用音频时钟，如果没有音频则使用视频时钟
-    if (mMediaInfo.hasAudio) {
-        return mAudioClock;
-    } else if (mMediaInfo.hasVideo) {
-        return mVideoClock;
+    bool hasAudio = false;
+    bool hasVideo = false;
+    std::shared_ptr<Demuxer> demuxer;
+    {
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        hasAudio = mMediaInfo.hasAudio;
+        hasVideo = mMediaInfo.hasVideo;
+        demuxer = mDemuxer;
+    }
+    int64_t position = 0;
+    if (hasAudio) {
+        position = mAudioClock;
+    } else if (hasVideo) {
+        position = mVideoClock;
+    }
+
+    // 循环播放时时钟单调递增，每轮增加解复用器测得的片段长度，
+    // 按同样的起点和长度换算回片段内的位置；中途关闭循环后，
+    // 已累加的偏移仍在时钟里
+    int64_t clipStartUs = 0;
+    int64_t clipLengthUs = 0;
+    if (demuxer &&
+        demuxer->getLoopClip(clipStartUs, clipLengthUs) &&
+        position >= clipStartUs + clipLengthUs) {
+        position = clipStartUs + (position - clipStartUs) % clipLengthUs;
     }
-    return 0;
+    return position;
 }
 
 int64_t Player::getDuration() const {
+    std::lock_guard<std::mutex> lock(mPipelineMutex);
     return mMediaInfo.durationMs * 1000;  // 转换为微秒
 }
 
@@ -368,10 +907,19 @@ float Player::getVolume() const {
 }
 
 void Player::setPlaybackRate(float rate) {
+    if (rate <= 0.0f) {
+        YFF_LOG(mLogger, LogLevel::Error, "Player", "播放速率无效: %.2f", rate);
+        return;
+    }
     mPlaybackRate = rate;
-    if (mDemuxer) {
-        mDemuxer->setPlaybackRate(rate);
+
+    // 音频通过重采样变速，视频跟随音频时钟
+    std::shared_ptr<AudioDecoder> audioDecoder = getPipeline().audioDecoder;
+    if (audioDecoder) {
+        audioDecoder->setSpeed(rate *
+                               mLiveController->getStats().playbackSpeed);
     }
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "播放速率设置为: %.2f", rate);
 }
 
 float Player::getPlaybackRate() const { return mPlaybackRate; }
@@ -389,14 +937,372 @@ bool Player::isMuted() const {
     return false;
 }
 
+void Player::setClockMode(ClockMode mode) {
+    mClockMode = mode;
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "时钟模式: %s",
+            (mode == ClockMode::FREE_RUN ? "自由运行" : "实时"));
+}
+
+ClockMode Player::getClockMode() const { return mClockMode; }
+
+void Player::setVideoDecoderThreads(int threads) {
+    mVideoDecoderThreads = std::max(0, threads);
+}
+
+void Player::setLooping(bool looping) {
+    mLooping = looping;
+    std::shared_ptr<Demuxer> demuxer = getPipeline().demuxer;
+    if (demuxer) {
+        demuxer->setLoop(looping);
+    }
+}
+
+bool Player::isLooping() const { return mLooping; }
+
+void Player::setPrerollConfig(const PrerollConfig &config) {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mPrerollConfig = config;
+}
+
+PrerollConfig Player::getPrerollConfig() const {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    return mPrerollConfig;
+}
+
+void Player::setBufferingConfig(const BufferingConfig &config) {
+    mBufferingController->setConfig(config);
+}
+
+BufferingConfig Player::getBufferingConfig() const {
+    return mBufferingController->getConfig();
+}
+
+void Player::setLogLevel(LogLevel level) { mLogger->setMinLevel(level); }
+
+void Player::setExecutor(std::shared_ptr<Executor> executor) {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mExecutor = executor;
+}
+
+void Player::setPriority(TaskPriority priority) {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mPriority = priority;
+    if (mTaskGroup) {
+        mTaskGroup->setPriority(priority);
+    }
+}
+
+RebufferStats Player::getRebufferStats() const {
+    return mBufferingController->getStats(av_gettime());
+}
+
+PlayerStats Player::getStats() const {
+    PlayerStats stats;
+    mStats->snapshot(stats);
+
+    auto fillQueue = [](const auto &queue, QueueStats &queueStats) {
+        queueStats.size = static_cast<int64_t>(queue->size());
+        queueStats.capacity = static_cast<int64_t>(queue->maxSize());
+        queueStats.durationUs = queue->duration();
+    };
+    {
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        fillQueue(mAudioPacketBuffer, stats.audioPackets);
+        fillQueue(mVideoPacketBuffer, stats.videoPackets);
+        fillQueue(mAudioFrameBuffer, stats.audioFrames);
+        fillQueue(mVideoFrameBuffer, stats.videoFrames);
+    }
+    stats.bufferedDurationUs = getBufferedDuration();
+    return stats;
+}
+
+void Player::setLiveConfig(const LiveConfig &config) {
+    mLiveController->setConfig(config);
+}
+
+LiveConfig Player::getLiveConfig() const { return mLiveController->getConfig(); }
+
+LiveStats Player::getLiveStats() const { return mLiveController->getStats(); }
+
+void Player::setTimeshiftConfig(const TimeshiftConfig &config) {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mTimeshiftConfig = config;
+}
+
+bool Player::getTimeshiftRange(int64_t &startUs, int64_t &endUs) const {
+    std::lock_guard<std::mutex> lock(mPipelineMutex);
+    return mDemuxer && mDemuxer->getTimeshiftRange(startUs, endUs);
+}
+
+bool Player::seekTimeshift(int64_t position) {
+    std::shared_ptr<Demuxer> demuxer;
+    {
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        demuxer = mDemuxer;
+    }
+    int64_t startUs = 0;
+    int64_t endUs = 0;
+    if (!demuxer || !demuxer->getTimeshiftRange(startUs, endUs) ||
+        position < startUs) {
+        YFF_LOG(mLogger, LogLevel::Error, "Player", "跳转位置不在时移窗口内");
+        return false;
+    }
+
+    // 由解复用线程在环形缓冲区中定位，已排队的数据按跳转代号丢弃
+    position = std::min(position, endUs);
+    mSeekPending = true;
+    demuxer->seek(position);
+    mPresentRunner.wake();
+
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "时移跳转到: %lld 微秒",
+            static_cast<long long>(position));
+    return true;
+}
+
+bool Player::seekToLive() {
+    return seekTimeshift(std::numeric_limits<int64_t>::max());
+}
+
+bool Player::startRecording(const std::string &path) {
+    std::lock_guard<std::mutex> lock(mPipelineMutex);
+    if (!mDemuxer) {
+        YFF_LOG(mLogger, LogLevel::Error, "Player", "没有打开的媒体，无法录制");
+        return false;
+    }
+    return mDemuxer->startRecording(path);
+}
+
+void Player::stopRecording() {
+    std::shared_ptr<Demuxer> demuxer;
+    {
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        demuxer = mDemuxer;
+    }
+    if (demuxer) {
+        demuxer->stopRecording();
+    }
+}
+
+RecordingStats Player::getRecordingStats() const {
+    std::lock_guard<std::mutex> lock(mPipelineMutex);
+    return mDemuxer ? mDemuxer->getRecordingStats() : RecordingStats();
+}
+
+void Player::setIoTimeouts(const IoTimeouts &timeouts) {
+    {
+        std::lock_guard<std::mutex> lock(mConfigMutex);
+        mIoTimeouts = timeouts;
+    }
+    std::shared_ptr<Demuxer> demuxer = getPipeline().demuxer;
+    if (demuxer) {
+        demuxer->setIoTimeouts(timeouts);
+    }
+}
+
+void Player::setInputConfig(const InputConfig &config) {
+    {
+        std::lock_guard<std::mutex> lock(mConfigMutex);
+        mInputConfig = config;
+    }
+    std::shared_ptr<Demuxer> demuxer = getPipeline().demuxer;
+    if (demuxer) {
+        demuxer->setInputConfig(config);
+    }
+}
+
+void Player::setProbeCacheEnabled(bool enabled) {
+    mProbeCacheEnabled = enabled;
+    if (!enabled) {
+        mProbeCache->clear();
+    }
+}
+
+TeardownMetrics Player::getTeardownMetrics() const {
+    TeardownMetrics metrics;
+    metrics.stopUs = mStopTimeUs;
+    metrics.closeUs = mCloseTimeUs;
+    return metrics;
+}
+
+StartupMetrics Player::getStartupMetrics() const {
+    StartupMetrics metrics;
+    metrics.profile = mOpenedProfile;
+    metrics.openUs = mOpenTimeUs;
+    metrics.prerollUs = mPrerollTimeUs;
+    metrics.firstFrameUs = mFirstFrameTimeUs;
+    metrics.probeCacheHit = mProbeCacheHit;
+    return metrics;
+}
+
+std::vector<TrackInfo> Player::getTracks() const {
+    std::shared_ptr<Demuxer> demuxer;
+    {
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        demuxer = mDemuxer;
+    }
+    return demuxer ? demuxer->getMediaInfo().tracks : std::vector<TrackInfo>();
+}
+
+bool Player::selectTrack(int streamIndex) {
+    // 解复用器切换需要与读取线程握手，最长约2秒；状态锁只在检查状态和
+    // 重启解码器时持有，握手期间暂停、跳转等调用不被阻塞
+    std::lock_guard<std::mutex> switchLock(mTrackSwitchMutex);
+
+    Pipeline pipeline;
+    MediaInfo previous;
+    std::shared_ptr<Decoder> decoder;
+    bool isAudio = false;
+    {
+        std::lock_guard<std::mutex> lock(mStateMutex);
+        pipeline = getPipeline();
+        if (!pipeline.demuxer ||
+            (mState != PlayerState::PREPARED &&
+             mState != PlayerState::STARTED && mState != PlayerState::PAUSED &&
+             mState != PlayerState::BUFFERING)) {
+            YFF_LOG(mLogger, LogLevel::Error, "Player",
+                    "播放器状态错误，无法切换轨道");
+            return false;
+        }
+
+        MediaType type = MediaType::UNKNOWN;
+        previous = pipeline.demuxer->getMediaInfo();
+        for (const TrackInfo &track : previous.tracks) {
+            if (track.streamIndex == streamIndex) {
+                if (track.selected) {
+                    return true;
+                }
+                type = track.type;
+            }
+        }
+
+        isAudio = type == MediaType::AUDIO;
+        if (isAudio) {
+            decoder = pipeline.audioDecoder;
+        } else if (type == MediaType::VIDEO) {
+            decoder = pipeline.videoDecoder;
+        }
+        if (!decoder) {
+            YFF_LOG(mLogger, LogLevel::Error, "Player", "无法切换到轨道: %d",
+                    streamIndex);
+            return false;
+        }
+
+        // 只停止受影响的解码器，另一条流继续播放
+        decoder->stop();
+    }
+
+    int64_t position = pipeline.hasAudio ? mAudioClock : mVideoClock;
+    bool switched = pipeline.demuxer->selectTrack(streamIndex, position);
+
+    std::lock_guard<std::mutex> lock(mStateMutex);
+    PlayerState state = mState;
+    bool decoding = state == PlayerState::STARTED ||
+                    state == PlayerState::PAUSED ||
+                    state == PlayerState::BUFFERING;
+    {
+        // 握手期间停止或切换到了下一条目时，解码器已不属于当前播放
+        std::lock_guard<std::mutex> pipelineLock(mPipelineMutex);
+        if (mDemuxer != pipeline.demuxer ||
+            (!decoding && state != PlayerState::PREPARED)) {
+            YFF_LOG(mLogger, LogLevel::Warning, "Player",
+                    "切换轨道期间播放已停止或切换条目");
+            return false;
+        }
+        if (switched) {
+            mMediaInfo = pipeline.demuxer->getMediaInfo();
+        }
+    }
+    if (!switched) {
+        if (decoding) {
+            decoder->start();
+        }
+        return false;
+    }
+    MediaInfo info = pipeline.demuxer->getMediaInfo();
+
+    // 旧轨道解出的帧已失效，用新轨道的参数重新打开解码器
+    if (isAudio) {
+        pipeline.audioFrameBuffer->clear();
+    } else {
+        pipeline.videoFrameBuffer->clear();
+    }
+    decoder->close();
+    if (!decoder->open(isAudio ? info.audioCodecParam
+                               : info.videoCodecParam)) {
+        YFF_LOG(mLogger, LogLevel::Error, "Player", "切换轨道后打开解码器失败");
+        updateState(PlayerState::ERROR);
+        return false;
+    }
+    // 视角切换可能改变画面尺寸
+    reinitRenderers(previous, info);
+    if (decoding) {
+        decoder->start();
+    }
+
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "已切换到轨道: %d", streamIndex);
+    return true;
+}
+
+void Player::setTrackPreferences(const TrackPreferences &preferences) {
+    std::lock_guard<std::mutex> lock(mConfigMutex);
+    mTrackPreferences = preferences;
+}
+
+void Player::setOpenProfile(OpenProfile profile) { mOpenProfile = profile; }
+
+OpenProfile Player::getOpenProfile() const { return mOpenProfile; }
+
+void Player::setLoopCacheLimit(int64_t bytes) {
+    mLoopCacheLimit = bytes;
+    std::shared_ptr<Demuxer> demuxer = getPipeline().demuxer;
+    if (demuxer) {
+        demuxer->setLoopCacheLimit(bytes);
+    }
+}
+
 void Player::onAudioFrameRendered(const AudioFrame &frame) {
+    bool retired = false;
+    {
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        if (mAudioFramesInFlight > 0) {
+            mAudioFramesInFlight--;
+        }
+        if (mRetiredAudioFrames > 0) {
+            mRetiredAudioFrames--;
+            retired = true;
+        }
+    }
+
+    traceInstant(TraceEvent::AUDIO_CALLBACK, frame.pts);
+    mStats->addAudioFrameRendered();
+
+    // 切换条目前送入渲染器的上一条目的尾部，不更新新条目的时钟和进度
+    if (retired) {
+        playNextAudioFrame();
+        return;
+    }
+
+    // 跳转前已送入渲染器的帧，不更新音频时钟
+    if (isStaleGeneration(frame.generation)) {
+        mStats->addStaleFrameShown();
+        playNextAudioFrame();
+        return;
+    }
+
     // 更新音频时钟
     mAudioClock = frame.pts + frame.duration;
+    Pipeline pipeline = getPipeline();
+
+    // 纯音频文件以首个音频帧作为首帧
+    if (!pipeline.hasVideo) {
+        recordSeekLatency(frame.generation);
+        onFirstFrameRendered();
+    }
 
     // 通知进度回调
     if (mCallback) {
         mCallback->onPlaybackProgress(getCurrentPosition() / 1000000.0,
-                                      mMediaInfo.durationMs / 1000.0);
+                                      pipeline.durationUs / 1000000.0);
     }
 
     // 播放下一帧音频
@@ -404,79 +1310,152 @@ void Player::onAudioFrameRendered(const AudioFrame &frame) {
 }
 
 void Player::onVideoFrameRendered(const VideoFrame &frame) {
+    // 渲染期间发生了跳转，旧帧不更新视频时钟
+    if (isStaleGeneration(frame.generation)) {
+        mStats->addStaleFrameShown();
+        return;
+    }
+    recordSeekLatency(frame.generation);
+
     // 更新视频时钟
     mVideoClock = frame.pts + frame.duration;
+    onFirstFrameRendered();
 
     // 如果没有音频，通过视频帧通知进度
-    if (!mMediaInfo.hasAudio && mCallback) {
+    Pipeline pipeline = getPipeline();
+    if (!pipeline.hasAudio && mCallback) {
         mCallback->onPlaybackProgress(getCurrentPosition() / 1000000.0,
-                                      mMediaInfo.durationMs / 1000.0);
+                                      pipeline.durationUs / 1000000.0);
     }
 }
 
-void Player::videoPlayLoop() {
-    mLogger->log(LogLevel::Info, "Player", "视频播放线程已启动");
+void Player::startPresenting() {
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "视频播放线程已启动");
+    mPresentRunner.start(
+        "yff-present", [this]() { return presentStep(); }, mStats,
+        PipelineStats::Stage::VIDEO_PRESENT);
+}
+
+TaskStep Player::presentStep() {
+    if (!mIsPlaying) {
+        return TaskStep::done();
+    }
+
+    try {
+        // 缓冲期间暂停出帧
+        if (mState == PlayerState::BUFFERING) {
+            return TaskStep::sleep(10000);  // 10毫秒 = 10000微秒
+        }
 
-    while (mIsPlaying) {
-        try {
-            // 从缓冲区获取视频帧
-            std::shared_ptr<VideoFrame> frame;
-            if (!mVideoFrameBuffer->tryPop(frame)) {
-                // 如果缓冲区为空，睡眠一段时间后继续
-                av_usleep(10000);  // 10毫秒 = 10000微秒
-                continue;
+        // 先处理等待到期的帧，否则从缓冲区获取视频帧
+        std::shared_ptr<VideoFrame> frame = std::move(mPendingFrame);
+        bool pending = frame != nullptr;
+        std::shared_ptr<PlaylistItem> retired;
+        bool completed = false;
+        bool endOfInput = false;
+        bool hasAudio = false;
+        uint32_t generation = 0;
+        {
+            std::lock_guard<std::mutex> lock(mPipelineMutex);
+            if (!pending && !mVideoFrameBuffer->tryPop(frame) &&
+                isCurrentItemDrained()) {
+                // 当前条目播放结束，切换到预加载的下一条目
+                retired = switchToNextItem();
+                // 没有下一条目时，等渲染器中剩余的音频播放完再结束
+                completed = !retired && mAudioFramesInFlight == 0;
             }
+            endOfInput = mDemuxer && mDemuxer->isEndOfFile();
+            hasAudio = mMediaInfo.hasAudio;
+            generation = currentGeneration();
+        }
 
-            // 计算音视频同步延迟
-            int64_t delay = calculateSyncDelay(frame->pts);
-
-            // 如果需要等待以保持同步，则睡眠
-            if (delay > 0) {
-                av_usleep(delay);
-            } else if (delay < -SYNC_THRESHOLD_US * 2) {
-                // 如果视频落后太多，跳过这一帧
-                //                mLogger->log(
-                //                    LogLevel::Verbose, "Player",
-                //                    "视频帧丢弃，延迟: " +
-                //                    std::to_string(delay) + " 微秒");
-                continue;
+        // 回调和回收旧条目都在锁外进行
+        if (completed) {
+            completePlayback();
+            return TaskStep::done();
+        }
+        if (retired) {
+            finishSwitch(std::move(retired));
+
+            // 切换后音频回调链可能已经中断，重新驱动
+            if (mAudioFramesInFlight == 0) {
+                playNextAudioFrame();
             }
+        }
 
-            // 渲染视频帧
-            if (mVideoRenderer) {
-                if (!mVideoRenderer->render(*frame)) {
-                    mLogger->log(LogLevel::Error, "Player", "渲染视频帧失败");
-                }
+        if (!frame) {
+            // 缓冲区为空时等待解码器送出新帧；输入已结束时不会再有新帧，
+            // 定时检查当前条目是否播放完毕
+            return endOfInput ? TaskStep::sleep(10000) : TaskStep::idle();
+        }
+
+        // 跳转前解出的帧直接丢弃，包括等待到期的帧
+        if (frame->generation != generation) {
+            mStats->addStale(PipelineStats::Queue::VIDEO_FRAMES);
+            return TaskStep::again();
+        }
+
+        // 计算音视频同步延迟，等待中的帧按原定的到期时间
+        int64_t delay = 0;
+        if (pending) {
+            delay = mPendingDueUs - getCurrentTimeUs();
+        } else {
+            traceInstant(TraceEvent::DEQUEUE, frame->pts);
+            delay = calculateSyncDelay(frame->pts, hasAudio);
+        }
+
+        // 如果需要等待以保持同步，则保留该帧到期后再渲染
+        if (delay > 0) {
+            if (!pending) {
+                mPendingDueUs = getCurrentTimeUs() + delay;
             }
+            mPendingFrame = std::move(frame);
+            return TaskStep::sleep(delay);
+        } else if (!pending && delay < -SYNC_THRESHOLD_US * 2) {
+            // 如果视频落后太多，跳过这一帧
+            //                mLogger->log(
+            //                    LogLevel::Verbose, "Player",
+            //                    "视频帧丢弃，延迟: " +
+            //                    std::to_string(delay) + " 微秒");
+            mStats->addVideoFrameDropped();
+            return TaskStep::again();
+        } else if (!pending && delay < -SYNC_THRESHOLD_US) {
+            mStats->addVideoFrameLate();
+        }
 
-            // 检查是否到达文件末尾
-            if (frame->pts >= mMediaInfo.durationMs * 1000 &&
-                !mDemuxer->isLive()) {
-                // 如果是最后一帧，并且没有更多帧，则播放完成
-                if (mVideoFrameBuffer->empty()) {
-                    updateState(PlayerState::COMPLETED);
-                    mIsPlaying = false;
-                    mLogger->log(LogLevel::Info, "Player", "播放完成");
-
-                    // 通知回调
-                    if (mCallback) {
-                        mCallback->onPlaybackProgress(1.0, 1.0);  // 100%
-                    }
+        // 渲染视频帧
+        if (mVideoRenderer) {
+            mStats->recordPresentLateness(-delay);
+            int64_t presentStartTime = av_gettime_relative();
+            {
+                TraceSpan span(TraceEvent::PRESENT, frame->pts);
+                if (!mVideoRenderer->render(*frame)) {
+                    YFF_LOG(mLogger, LogLevel::Error, "Player",
+                            "渲染视频帧失败");
                 }
             }
-        } catch (const std::exception &e) {
-            mLogger->log(LogLevel::Error, "Player",
-                         std::string("视频播放线程异常: ") + e.what());
-            av_usleep(10000);  // 发生异常时等待一段时间
+            mStats->recordStage(PipelineStats::Stage::VIDEO_PRESENT,
+                                av_gettime_relative() - presentStartTime);
+            if (hasAudio) {
+                mStats->setAvOffset(frame->pts - mAudioClock);
+            }
         }
+    } catch (const std::exception &e) {
+        YFF_LOG(mLogger, LogLevel::Error, "Player", "视频播放线程异常: %s",
+                e.what());
+        return TaskStep::sleep(10000);  // 发生异常时等待一段时间
     }
-
-    mLogger->log(LogLevel::Info, "Player", "视频播放线程已退出");
+    return TaskStep::again();
 }
 
-int64_t Player::calculateSyncDelay(int64_t videoPts) {
+int64_t Player::calculateSyncDelay(int64_t videoPts, bool hasAudio) {
+    // 自由运行模式不等待也不丢帧
+    if (mClockMode == ClockMode::FREE_RUN) {
+        return 0;
+    }
+
     // 如果没有音频，则使用系统时钟同步
-    if (!mMediaInfo.hasAudio) {
+    if (!hasAudio) {
         int64_t elapsedTime = getCurrentTimeUs() - mStartTime;
         return videoPts - elapsedTime;
     }
@@ -500,53 +1479,409 @@ int64_t Player::getCurrentTimeUs() {
 }
 
 bool Player::playNextAudioFrame() {
-    if (!mAudioRenderer || !mMediaInfo.hasAudio) {
-        return false;
-    }
-
     // 从缓冲区获取音频帧
     std::shared_ptr<AudioFrame> frame;
-    if (!mAudioFrameBuffer->tryPop(frame)) {
-        // 如果缓冲区为空，返回失败
+    std::shared_ptr<PlaylistItem> retired;
+    bool completed = false;
+    {
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        if (!mAudioRenderer || !mMediaInfo.hasAudio) {
+            return false;
+        }
+
+        if (!popAudioFrame(frame)) {
+            // 当前条目播放结束，无缝切换到下一条目继续播放
+            if (!isCurrentItemDrained()) {
+                // 如果缓冲区为空，返回失败；输出已无待播放帧即为欠载
+                if (mState == PlayerState::STARTED &&
+                    mAudioFramesInFlight == 0 &&
+                    !mAudioUnderrun.exchange(true)) {
+                    mStats->addAudioUnderrun();
+                }
+                return false;
+            }
+            retired = switchToNextItem();
+            completed = !retired && !mMediaInfo.hasVideo &&
+                        mAudioFramesInFlight == 0;
+        }
+
+        // 在锁内计数，切换条目时据此区分渲染器中属于上一条目的帧
+        if (frame) {
+            mAudioFramesInFlight++;
+        }
+    }
+
+    // 回调和回收旧条目都在锁外进行，之后从新条目取帧
+    if (retired) {
+        finishSwitch(std::move(retired));
+        return playNextAudioFrame();
+    }
+    if (completed) {
+        completePlayback();
+    }
+    if (!frame) {
         return false;
     }
 
+    traceInstant(TraceEvent::DEQUEUE, frame->pts);
+    mAudioUnderrun = false;
+
     // 渲染音频帧
     if (!mAudioRenderer->play(*frame)) {
-        mLogger->log(LogLevel::Error, "Player", "渲染音频帧失败");
+        {
+            std::lock_guard<std::mutex> lock(mPipelineMutex);
+            mAudioFramesInFlight--;
+            mRetiredAudioFrames =
+                std::min<int>(mRetiredAudioFrames, mAudioFramesInFlight);
+        }
+        YFF_LOG(mLogger, LogLevel::Error, "Player", "渲染音频帧失败");
         return false;
     }
 
-    // 检查是否到达文件末尾
-    if (frame->pts >= mMediaInfo.durationMs * 1000 && !mDemuxer->isLive()) {
-        // 如果是最后一帧，并且没有更多帧，则播放完成
-        if (mAudioFrameBuffer->empty() && !mMediaInfo.hasVideo) {
-            updateState(PlayerState::COMPLETED);
-            mIsPlaying = false;
-            mLogger->log(LogLevel::Info, "Player", "播放完成");
+    return true;
+}
 
-            // 通知回调
-            if (mCallback) {
-                mCallback->onPlaybackProgress(1.0, 1.0);  // 100%
-            }
+bool Player::popAudioFrame(std::shared_ptr<AudioFrame> &frame) {
+    // 跳转前解出的帧直接丢弃
+    uint32_t generation = currentGeneration();
+    while (mAudioFrameBuffer->tryPop(frame)) {
+        if (frame->generation == generation) {
+            return true;
         }
+        mStats->addStale(PipelineStats::Queue::AUDIO_FRAMES);
+    }
+    return false;
+}
+
+uint32_t Player::currentGeneration() const {
+    return mSeekGeneration ? mSeekGeneration->current() : 0;
+}
+
+bool Player::isStaleGeneration(uint32_t generation) const {
+    std::lock_guard<std::mutex> lock(mPipelineMutex);
+    return generation != currentGeneration();
+}
+
+void Player::recordSeekLatency(uint32_t generation) {
+    if (generation != mSeekLatencyGeneration) {
+        return;
+    }
+    int64_t requestTime = mSeekRequestTime.exchange(-1);
+    if (requestTime >= 0) {
+        mStats->recordSeekLatency(getCurrentTimeUs() - requestTime);
+    }
+}
+
+bool Player::enqueueNext(const std::string &url) {
+    if (mState != PlayerState::PREPARED && mState != PlayerState::STARTED &&
+        mState != PlayerState::PAUSED && mState != PlayerState::BUFFERING) {
+        YFF_LOG(mLogger, LogLevel::Error, "Player",
+                "播放器状态错误，无法预加载下一条目");
+        return false;
     }
 
+    // 只保留一个预加载条目，新的请求替换旧的
+    clearNext();
+
+    mPreloadCancelled = false;
+    mPreloadThread = std::thread(&Player::preloadItem, this, url);
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "开始预加载下一条目: %s",
+            url.c_str());
     return true;
 }
 
-void Player::clearPacketBuffer() {
-    while (!mAudioPacketBuffer->empty()) {
-        auto packet = mAudioPacketBuffer->pop();
-        if (packet) {
-            av_packet_free(&packet);
+void Player::clearNext() {
+    mPreloadCancelled = true;
+    {
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        if (mPreloadingDemuxer) {
+            mPreloadingDemuxer->abort();
+        }
+    }
+    if (mPreloadThread.joinable()) {
+        mPreloadThread.join();
+    }
+
+    std::shared_ptr<PlaylistItem> item;
+    {
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        item = std::move(mNextItem);
+    }
+    if (item) {
+        retireItem(item);
+    }
+}
+
+bool Player::hasNext() const {
+    std::lock_guard<std::mutex> lock(mPipelineMutex);
+    return mNextItem != nullptr;
+}
+
+void Player::preloadItem(const std::string &url) {
+    setCurrentThreadName("yff-preload");
+    auto item = std::make_shared<PlaylistItem>();
+    item->url = url;
+    item->audioPacketBuffer =
+        std::make_shared<BufferQueue<AVPacket *>>(PACKET_BUFFER_SIZE);
+    item->videoPacketBuffer =
+        std::make_shared<BufferQueue<AVPacket *>>(PACKET_BUFFER_SIZE);
+    item->audioFrameBuffer =
+        std::make_shared<BufferQueue<std::shared_ptr<AudioFrame>>>(
+            FRAME_BUFFER_SIZE);
+    item->videoFrameBuffer =
+        std::make_shared<BufferQueue<std::shared_ptr<VideoFrame>>>(
+            FRAME_BUFFER_SIZE);
+
+    item->demuxer = std::make_shared<Demuxer>(
+        item->audioPacketBuffer, item->videoPacketBuffer, mLogger);
+    // 预加载条目的统计计入同一个播放器
+    item->demuxer->setStats(mStats);
+    std::shared_ptr<TaskGroup> taskGroup;
+    {
+        std::lock_guard<std::mutex> configLock(mConfigMutex);
+        taskGroup = mTaskGroup;
+        item->demuxer->setIoTimeouts(mIoTimeouts);
+        item->demuxer->setInputConfig(mInputConfig);
+        item->demuxer->setTimeshiftConfig(mTimeshiftConfig);
+        item->demuxer->setOpenProfile(mOpenProfile);
+        item->demuxer->setTrackPreferences(mTrackPreferences);
+        item->demuxer->setProbeCache(mProbeCacheEnabled ? mProbeCache
+                                                        : nullptr);
+    }
+    // 预加载条目与当前条目在同一任务组中运行，切换后由播放任务消费
+    item->demuxer->setTaskGroup(taskGroup);
+    if (taskGroup) {
+        item->videoFrameBuffer->setPushListener(
+            [this]() { mPresentRunner.wake(); });
+    }
+    {
+        // 记录正在预加载的解复用器，取消时可以中断其I/O
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        if (mPreloadCancelled) {
+            return;
+        }
+        mPreloadingDemuxer = item->demuxer;
+    }
+    bool opened = item->demuxer->open(url);
+    {
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        mPreloadingDemuxer = nullptr;
+    }
+    if (!opened) {
+        YFF_LOG(mLogger, LogLevel::Error, "Player", "预加载媒体文件失败: %s",
+                url.c_str());
+        if (mCallback) {
+            mCallback->onError(
+                {ErrorCode::OPEN_FILE_FAILED, "预加载媒体文件失败: " + url});
+        }
+        return;
+    }
+    item->mediaInfo = item->demuxer->getMediaInfo();
+
+    if (item->mediaInfo.hasAudio) {
+        item->audioDecoder = std::make_shared<AudioDecoder>(
+            item->audioPacketBuffer, item->audioFrameBuffer, mLogger);
+        item->audioDecoder->setSpeed(mPlaybackRate);
+        item->audioDecoder->setStats(mStats);
+        item->audioDecoder->setSeekGeneration(
+            item->demuxer->getSeekGeneration());
+        item->audioDecoder->setTaskGroup(taskGroup);
+        if (!item->audioDecoder->open(item->mediaInfo.audioCodecParam)) {
+            YFF_LOG(mLogger, LogLevel::Error, "Player",
+                    "预加载条目初始化音频解码器失败");
+            retireItem(item);
+            return;
+        }
+    }
+
+    if (item->mediaInfo.hasVideo) {
+        item->videoDecoder = std::make_shared<VideoDecoder>(
+            item->videoPacketBuffer, item->videoFrameBuffer, mLogger);
+        item->videoDecoder->setStats(mStats);
+        item->videoDecoder->setSeekGeneration(
+            item->demuxer->getSeekGeneration());
+        item->videoDecoder->setTaskGroup(taskGroup);
+        item->videoDecoder->setThreadCount(mVideoDecoderThreads);
+        if (!item->videoDecoder->open(item->mediaInfo.videoCodecParam)) {
+            YFF_LOG(mLogger, LogLevel::Error, "Player",
+                    "预加载条目初始化视频解码器失败");
+            retireItem(item);
+            return;
+        }
+    }
+
+    // 提前启动解复用和解码，缓冲区填满后自然停下等待切换
+    item->demuxer->start();
+    if (item->audioDecoder) {
+        item->audioDecoder->start();
+    }
+    if (item->videoDecoder) {
+        item->videoDecoder->start();
+    }
+
+    bool cancelled = false;
+    {
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        cancelled = mPreloadCancelled;
+        if (!cancelled) {
+            mNextItem = item;
         }
     }
-    while (!mVideoPacketBuffer->empty()) {
-        auto packet = mVideoPacketBuffer->pop();
-        if (packet) {
+    if (cancelled) {
+        retireItem(item);
+        return;
+    }
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "下一条目预加载完成: %s",
+            url.c_str());
+}
+
+void Player::retireItem(std::shared_ptr<PlaylistItem> item) {
+    // 在独立线程中停止旧条目，避免阻塞渲染线程
+    std::lock_guard<std::mutex> lock(mRetireMutex);
+    if (mRetireThread.joinable()) {
+        mRetireThread.join();
+    }
+
+    mRetireThread = std::thread([item]() {
+        setCurrentThreadName("yff-retire");
+        if (item->audioDecoder) {
+            item->audioDecoder->close();
+        }
+        if (item->videoDecoder) {
+            item->videoDecoder->close();
+        }
+        if (item->demuxer) {
+            item->demuxer->stop();
+        }
+
+        AVPacket *packet = nullptr;
+        while (item->audioPacketBuffer->tryPop(packet)) {
+            av_packet_free(&packet);
+        }
+        while (item->videoPacketBuffer->tryPop(packet)) {
             av_packet_free(&packet);
         }
+        item->audioFrameBuffer->clear();
+        item->videoFrameBuffer->clear();
+    });
+}
+
+bool Player::isCurrentItemDrained() const {
+    if (!mDemuxer || !mDemuxer->isEndOfFile()) {
+        return false;
+    }
+
+    // 不等待渲染器中的音频播放完，切换后新条目的音频紧接着送入渲染器
+    return mAudioPacketBuffer->empty() && mVideoPacketBuffer->empty() &&
+           mAudioFrameBuffer->empty() && mVideoFrameBuffer->empty();
+}
+
+std::shared_ptr<Player::PlaylistItem> Player::switchToNextItem() {
+    // 停止播放后不再切换，stop() 之后取得的流水线快照即为最终状态
+    if (!mNextItem || !mIsPlaying) {
+        return nullptr;
+    }
+
+    // 只在锁内交换流水线，旧条目由调用者在锁外回收
+    std::shared_ptr<PlaylistItem> next = std::move(mNextItem);
+    auto current = std::make_shared<PlaylistItem>();
+    current->url = mUrl;
+    current->mediaInfo = mMediaInfo;
+    current->audioPacketBuffer = mAudioPacketBuffer;
+    current->videoPacketBuffer = mVideoPacketBuffer;
+    current->audioFrameBuffer = mAudioFrameBuffer;
+    current->videoFrameBuffer = mVideoFrameBuffer;
+    current->demuxer = mDemuxer;
+    current->audioDecoder = mAudioDecoder;
+    current->videoDecoder = mVideoDecoder;
+
+    mMediaInfo = next->mediaInfo;
+    mAudioPacketBuffer = next->audioPacketBuffer;
+    mVideoPacketBuffer = next->videoPacketBuffer;
+    mAudioFrameBuffer = next->audioFrameBuffer;
+    mVideoFrameBuffer = next->videoFrameBuffer;
+    mDemuxer = next->demuxer;
+    mAudioDecoder = next->audioDecoder;
+    mVideoDecoder = next->videoDecoder;
+    mSeekGeneration = mDemuxer->getSeekGeneration();
+    mUrl = next->url;
+    mRetiredAudioFrames = mAudioFramesInFlight.load();
+    mDemuxer->setLoop(mLooping);
+    mDemuxer->setLoopCacheLimit(mLoopCacheLimit);
+    // 预加载之后速率可能又被修改
+    if (mAudioDecoder) {
+        mAudioDecoder->setSpeed(mPlaybackRate);
+    }
+
+    // 新条目时间戳从头开始，重置时钟
+    mAudioClock = 0;
+    mVideoClock = 0;
+    mStartTime = getCurrentTimeUs();
+    return current;
+}
+
+void Player::finishSwitch(std::shared_ptr<PlaylistItem> retired) {
+    const MediaInfo &previous = retired->mediaInfo;
+    MediaInfo info;
+    std::string url;
+    {
+        std::lock_guard<std::mutex> lock(mPipelineMutex);
+        info = mMediaInfo;
+        url = mUrl;
+    }
+
+    reinitRenderers(previous, info);
+
+    // 旧条目交给回收线程，等待上一次回收结束不再阻塞其他线程取锁
+    retireItem(std::move(retired));
+
+    // 之前没有视频时需要启动视频播放线程
+    if (info.hasVideo && mVideoRenderer && !mPresentRunner.isStarted()) {
+        startPresenting();
+    }
+
+    if (mCallback) {
+        mCallback->onMediaInfo(info);
+    }
+
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "已切换到下一条目: %s",
+            url.c_str());
+}
+
+void Player::reinitRenderers(const MediaInfo &previous,
+                             const MediaInfo &info) {
+    // 仅在格式变化时重新初始化渲染器
+    if (info.hasAudio && !previous.hasAudio && mAudioRenderer) {
+        if (!mAudioRenderer->init(kAudioTargetSampleRate,
+                                  kAudioTargetChannels, kAudioTargetBitDepth,
+                                  this->shared_from_this())) {
+            YFF_LOG(mLogger, LogLevel::Error, "Player", "初始化音频渲染器失败");
+        }
+    }
+
+    if (info.hasVideo && mVideoRenderer &&
+        (!previous.hasVideo || info.videoWidth != previous.videoWidth ||
+         info.videoHeight != previous.videoHeight)) {
+        if (!mVideoRenderer->init(info.videoWidth, info.videoHeight,
+                                  PixelFormat::YUV420P,
+                                  this->shared_from_this())) {
+            YFF_LOG(mLogger, LogLevel::Error, "Player", "初始化视频渲染器失败");
+        }
+    }
+}
+
+void Player::completePlayback() {
+    // 音频和视频线程可能同时播放到结尾，也可能已经被 stop() 停止
+    if (!mIsPlaying.exchange(false)) {
+        return;
+    }
+    mBufferingController->onPlaybackStopped(getCurrentTimeUs());
+    updateState(PlayerState::COMPLETED);
+    YFF_LOG(mLogger, LogLevel::Info, "Player", "播放完成");
+
+    // 通知回调
+    if (mCallback) {
+        mCallback->onPlaybackProgress(1.0, 1.0);  // 100%
     }
 }
 
@@ -559,10 +1894,8 @@ void Player::updateState(PlayerState state) {
         mCallback->onPlayerStateChanged(state);
     }
 
-    mLogger->log(
-        LogLevel::Verbose, "Player",
-        "播放器状态变更: " + std::to_string(static_cast<int>(oldState)) +
-            " -> " + std::to_string(static_cast<int>(state)));
+    YFF_LOG(mLogger, LogLevel::Verbose, "Player", "播放器状态变更: %d -> %d",
+            static_cast<int>(oldState), static_cast<int>(state));
 }
 
 void Player::onDemuxerStateChanged(DemuxerState state) {}
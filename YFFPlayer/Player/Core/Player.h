@@ -5,16 +5,24 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "AudioDecoder.h"
 #include "AudioRenderer.h"
 #include "BufferQueue.h"
+#include "BufferingController.h"
 #include "Demuxer.h"
 #include "DemuxerCallback.h"
+#include "Executor.h"
+#include "LiveController.h"
 #include "Logger.h"
 #include "MediaInfo.h"
+#include "PipelineStats.h"
 #include "PlayerCallback.h"
 #include "PlayerTypes.h"
+#include "ScrubPreview.h"
+#include "SeekGeneration.h"
+#include "StageRunner.h"
 #include "VideoDecoder.h"
 #include "VideoRenderer.h"
 
@@ -30,13 +38,35 @@ class Player : public RendererCallback, public DemuxerCallback {
 
     // Playback control
     bool open(const std::string& url);
+    // Returns immediately, rendering begins once the preroll is buffered
     bool start();
     bool pause();
     bool resume();
     bool stop();
     bool close();
+    // Returns without waiting for the pipeline; data of the previous
+    // position is discarded by generation and rapid seeks coalesce to the
+    // latest target. Also accepted while buffering.
     bool seek(int64_t position);
 
+    // Seek bar scrubbing. beginScrub() pauses playback; each scrub() then
+    // shows the keyframe nearest to position, decoded by a separate
+    // keyframe-only preview decoder instead of the pipeline, and rapid
+    // calls coalesce to the latest. endScrub() seeks precisely to the
+    // release position and resumes playback if it was running.
+    bool beginScrub();
+    bool scrub(int64_t position);
+    bool endScrub(int64_t position);
+    // Preview size and keyframe cache limit, applies from the next item
+    // scrubbed
+    void setScrubConfig(const ScrubConfig& config);
+
+    // Gapless playlist: open and preroll the next item in the background,
+    // switch to it without a gap when the current item ends
+    bool enqueueNext(const std::string& url);
+    void clearNext();
+    bool hasNext() const;
+
     // Get playback status
     PlayerState getState() const;
     int64_t getCurrentPosition() const;
@@ -46,7 +76,9 @@ class Player : public RendererCallback, public DemuxerCallback {
     void setVolume(float volume);
     float getVolume() const;
 
-    // Set playback speed
+    // Playback speed, applied by resampling the audio so pitch shifts with
+    // it; video follows the audio clock, video-only inputs play at 1x.
+    // Live catch-up speeds multiply it.
     void setPlaybackRate(float rate);
     float getPlaybackRate() const;
 
@@ -54,6 +86,104 @@ class Player : public RendererCallback, public DemuxerCallback {
     void setMute(bool mute);
     bool isMuted() const;
 
+    // Pace rendering by timestamps or run as fast as possible
+    void setClockMode(ClockMode mode);
+    ClockMode getClockMode() const;
+
+    // Video codec worker threads, applies to the next open(). 0 (the
+    // default) chooses from the frame size and the executor's idle cores.
+    void setVideoDecoderThreads(int threads);
+
+    // Set loop playback, timestamps keep increasing across iterations
+    void setLooping(bool looping);
+    bool isLooping() const;
+
+    // Clips up to this many bytes of packets are looped from memory
+    void setLoopCacheLimit(int64_t bytes);
+
+    // Set how much media start() buffers before rendering
+    void setPrerollConfig(const PrerollConfig& config);
+    PrerollConfig getPrerollConfig() const;
+
+    // Startup timing of the last open()/start()
+    StartupMetrics getStartupMetrics() const;
+
+    // Selectable audio and video tracks of the current media
+    std::vector<TrackInfo> getTracks() const;
+
+    // Switch the audio or video track; only the affected decoder restarts
+    bool selectTrack(int streamIndex);
+
+    // Language and codec preferences for the next open()
+    void setTrackPreferences(const TrackPreferences& preferences);
+
+    // Probe limits for the next open(); FAST_START also opens the audio
+    // and video decoders in parallel
+    void setOpenProfile(OpenProfile profile);
+    OpenProfile getOpenProfile() const;
+
+    // Set rebuffering watermarks
+    void setBufferingConfig(const BufferingConfig& config);
+    BufferingConfig getBufferingConfig() const;
+
+    // Low-latency mode for live inputs, applies to the next open()
+    void setLiveConfig(const LiveConfig& config);
+    LiveConfig getLiveConfig() const;
+
+    // Live-edge latency and catch-up state
+    LiveStats getLiveStats() const;
+
+    // Timeshift window for live inputs, applies to the next open()
+    void setTimeshiftConfig(const TimeshiftConfig& config);
+
+    // Positions inside the timeshift window, false without a window
+    bool getTimeshiftRange(int64_t& startUs, int64_t& endUs) const;
+
+    // Seek inside the timeshift window without reconnecting
+    bool seekTimeshift(int64_t position);
+    // Return to the newest keyframe of the live stream
+    bool seekToLive();
+
+    // Record the playing input without re-encoding or extra downloads;
+    // the container follows the extension (.mp4, .ts, .mkv)
+    bool startRecording(const std::string& path);
+    void stopRecording();
+    RecordingStats getRecordingStats() const;
+
+    // Rebuffer count, duration and ratio since start()
+    RebufferStats getRebufferStats() const;
+
+    // Media buffered in the packet and frame queues, microseconds
+    int64_t getBufferedDuration() const;
+
+    // Stage timings, queue depths and waits, drops and A/V offset since
+    // open(); counters are lock-free, cheap enough to poll periodically
+    PlayerStats getStats() const;
+
+    // Set deadlines for blocking demuxer I/O
+    void setIoTimeouts(const IoTimeouts& timeouts);
+
+    // Select the demuxer input I/O backend, applies to the next open
+    void setInputConfig(const InputConfig& config);
+
+    // Reuse stream probing results when reopening the same asset
+    void setProbeCacheEnabled(bool enabled);
+
+    // Teardown timing of the last stop()/close()
+    TeardownMetrics getTeardownMetrics() const;
+
+    // Run demuxing, decoding and presentation as tasks of this executor
+    // instead of one thread per component, applies to the next open().
+    // Players sharing an executor, e.g. Executor::shared(), share its
+    // threads; nullptr goes back to dedicated threads.
+    void setExecutor(std::shared_ptr<Executor> executor);
+    // Scheduling priority on the executor, e.g. BACKGROUND while hidden
+    void setPriority(TaskPriority priority);
+
+    // Messages below this level are skipped before formatting; shared by
+    // the players given the same logger, whose own level also applies
+    void setLogLevel(LogLevel level);
+
     // AudioRenderCallback interface implementation
     void onAudioFrameRendered(const AudioFrame& frame) override;
 
@@ -73,6 +203,40 @@ class Player : public RendererCallback, public DemuxerCallback {
     void onSeekCompleted(int64_t position) override;
 
    private:
+    // Demuxer, decoders and buffers of one playlist item
+    struct PlaylistItem {
+        std::string url;
+        MediaInfo mediaInfo;
+        std::shared_ptr<BufferQueue<AVPacket*>> audioPacketBuffer;
+        std::shared_ptr<BufferQueue<AVPacket*>> videoPacketBuffer;
+        std::shared_ptr<BufferQueue<std::shared_ptr<AudioFrame>>>
+            audioFrameBuffer;
+        std::shared_ptr<BufferQueue<std::shared_ptr<VideoFrame>>>
+            videoFrameBuffer;
+        std::shared_ptr<Demuxer> demuxer;
+        std::shared_ptr<AudioDecoder> audioDecoder;
+        std::shared_ptr<VideoDecoder> videoDecoder;
+    };
+
+    // The current pipeline copied under mPipelineMutex, so a playlist
+    // switch on the present or audio thread cannot swap it out while a
+    // call is using it
+    struct Pipeline {
+        std::shared_ptr<Demuxer> demuxer;
+        std::shared_ptr<AudioDecoder> audioDecoder;
+        std::shared_ptr<VideoDecoder> videoDecoder;
+        std::shared_ptr<BufferQueue<AVPacket*>> audioPacketBuffer;
+        std::shared_ptr<BufferQueue<AVPacket*>> videoPacketBuffer;
+        std::shared_ptr<BufferQueue<std::shared_ptr<AudioFrame>>>
+            audioFrameBuffer;
+        std::shared_ptr<BufferQueue<std::shared_ptr<VideoFrame>>>
+            videoFrameBuffer;
+        bool hasAudio{false};
+        bool hasVideo{false};
+        int64_t durationUs{0};
+        int videoStreamIndex{-1};
+    };
+
     // Player state
     std::atomic<PlayerState> mState{PlayerState::IDLE};
 
@@ -83,10 +247,14 @@ class Player : public RendererCallback, public DemuxerCallback {
     std::shared_ptr<AudioRenderer> mAudioRenderer;
     std::shared_ptr<VideoRenderer> mVideoRenderer;
 
-    // Logger
+    // Logger; the one passed in is wrapped in the AsyncLogger shared by
+    // all players logging to it, so pipeline and render threads never
+    // wait on log output
     std::shared_ptr<Logger> mLogger;
 
-    // Media information
+    // Media information; like the buffers, demuxer and decoders below it
+    // is replaced by a playlist switch and needs mPipelineMutex once
+    // playback has started
     MediaInfo mMediaInfo;
 
     // Buffers
@@ -100,9 +268,90 @@ class Player : public RendererCallback, public DemuxerCallback {
     std::shared_ptr<AudioDecoder> mAudioDecoder;
     std::shared_ptr<VideoDecoder> mVideoDecoder;
 
-    // Playback thread
-    std::thread mVideoPlayThread;
+    // Executor and the task group of the opened media, nullptr for
+    // dedicated threads
+    std::shared_ptr<Executor> mExecutor;
+    std::shared_ptr<TaskGroup> mTaskGroup;
+    std::atomic<TaskPriority> mPriority{TaskPriority::FOREGROUND};
+    std::atomic<int> mVideoDecoderThreads{0};
+
+    // Video presentation; a frame waiting for its due time is kept
+    // across steps
+    StageRunner mPresentRunner;
     std::atomic<bool> mIsPlaying{false};
+    std::shared_ptr<VideoFrame> mPendingFrame;
+    int64_t mPendingDueUs{0};
+
+    // Seek generation of the current item, needs mPipelineMutex
+    std::shared_ptr<SeekGeneration> mSeekGeneration;
+    // Request time of the seek whose first frame is awaited, -1 if none
+    std::atomic<int64_t> mSeekRequestTime{-1};
+    std::atomic<uint32_t> mSeekLatencyGeneration{0};
+
+    // Scrubbing; the preview decoder and its keyframe cache are kept
+    // while the same item is playing
+    std::shared_ptr<ScrubPreview> mScrubPreview;
+    std::atomic<bool> mScrubbing{false};
+    bool mScrubResume{false};
+    // Orders preview frames with endScrub()
+    std::mutex mScrubMutex;
+    ScrubConfig mScrubConfig;
+    // URL of the current item, needs mPipelineMutex
+    std::string mUrl;
+
+    // Buffering stage: initial preroll, then rebuffering on stalls
+    StageRunner mBufferingRunner;
+    std::shared_ptr<Demuxer> mSampledDemuxer;
+    InputStats mSampledInput;
+    int64_t mLastSampleTime{0};
+    int64_t mLastLiveControlTime{0};
+    std::atomic<bool> mBufferingRunning{false};
+    std::atomic<bool> mRenderingBegun{false};
+    std::atomic<bool> mSeekPending{false};
+    std::atomic<int64_t> mBufferingStartTime{0};
+    std::shared_ptr<BufferingController> mBufferingController;
+    std::shared_ptr<LiveController> mLiveController;
+    std::shared_ptr<PipelineStats> mStats;
+    PrerollConfig mPrerollConfig;
+    IoTimeouts mIoTimeouts;
+    InputConfig mInputConfig;
+    TimeshiftConfig mTimeshiftConfig;
+    TrackPreferences mTrackPreferences;
+    std::shared_ptr<ProbeCache> mProbeCache;
+    std::atomic<bool> mProbeCacheEnabled{true};
+    std::atomic<OpenProfile> mOpenProfile{OpenProfile::DEFAULT};
+    std::atomic<OpenProfile> mOpenedProfile{OpenProfile::DEFAULT};
+    mutable std::mutex mConfigMutex;
+
+    // Startup instrumentation, microseconds
+    std::atomic<int64_t> mStartRequestTime{0};
+    std::atomic<int64_t> mOpenTimeUs{-1};
+    std::atomic<bool> mProbeCacheHit{false};
+    std::atomic<int64_t> mPrerollTimeUs{-1};
+    std::atomic<int64_t> mFirstFrameTimeUs{-1};
+    std::atomic<bool> mFirstFramePending{false};
+
+    // Teardown instrumentation, microseconds
+    std::atomic<int64_t> mStopTimeUs{-1};
+    std::atomic<int64_t> mCloseTimeUs{-1};
+
+    // Audio frames handed to the renderer and not yet rendered, and how
+    // many of them belong to the item before the last playlist switch.
+    // Changed together under mPipelineMutex.
+    std::atomic<int> mAudioFramesInFlight{0};
+    std::atomic<int> mRetiredAudioFrames{0};
+    // Audio output ran dry, counted once per underrun
+    std::atomic<bool> mAudioUnderrun{false};
+
+    // Playlist: preloaded next item and teardown of finished items
+    std::shared_ptr<PlaylistItem> mNextItem;
+    std::shared_ptr<Demuxer> mPreloadingDemuxer;
+    std::thread mPreloadThread;
+    std::thread mRetireThread;
+    std::mutex mRetireMutex;
+    std::atomic<bool> mPreloadCancelled{false};
+    // Guards the current pipeline members against a playlist switch
+    mutable std::mutex mPipelineMutex;
 
     // Clock synchronization
     std::atomic<int64_t> mAudioClock{0};  // Audio clock, microseconds
@@ -111,10 +360,46 @@ class Player : public RendererCallback, public DemuxerCallback {
 
     // Playback control
     std::atomic<float> mPlaybackRate{1.0f};
+    std::atomic<ClockMode> mClockMode{ClockMode::REALTIME};
+    std::atomic<bool> mLooping{false};
+    std::atomic<int64_t> mLoopCacheLimit{32 * 1024 * 1024};
     std::mutex mStateMutex;
+    // Serializes selectTrack(), which holds mStateMutex only to check the
+    // state and to restart the decoder, not across the demuxer handshake
+    std::mutex mTrackSwitchMutex;
+
+    // One frame of video playback
+    TaskStep presentStep();
+
+    // One poll of the buffering state
+    TaskStep bufferingStep();
+
+    // Start the present stage for the current renderer
+    void startPresenting();
+
+    // Stall rendering until the high watermark is buffered
+    void enterBuffering();
+    // Live catch-up: adjust playback speed or jump to the live edge
+    void updateLiveLatency();
+    void jumpToLiveEdge();
+
+    // Resume rendering after a stall
+    void leaveBuffering();
+
+    // Snapshot of the current pipeline, takes mPipelineMutex
+    Pipeline getPipeline() const;
 
-    // Video playback thread function
-    void videoPlayLoop();
+    // Whether enough media is buffered to begin rendering
+    bool isPrerollReady(const Pipeline& pipeline);
+
+    // Whether no more media can be buffered: input ended or queues full
+    bool isInputExhausted();
+
+    // Begin rendering after the preroll
+    void beginRendering();
+
+    // Record time to first frame and notify the callback
+    void onFirstFrameRendered();
 
     // Update player state
     void updateState(PlayerState state);
@@ -123,13 +408,55 @@ class Player : public RendererCallback, public DemuxerCallback {
     int64_t getCurrentTimeUs();
 
     // Calculate audio-video sync delay
-    int64_t calculateSyncDelay(int64_t videoPts);
+    int64_t calculateSyncDelay(int64_t videoPts, bool hasAudio);
 
     // Play next audio frame
     bool playNextAudioFrame();
 
-    // Clear packet buffer
-    void clearPacketBuffer();
+    // Pop the next audio frame, dropping stale ones; needs mPipelineMutex
+    bool popAudioFrame(std::shared_ptr<AudioFrame>& frame);
+
+    // Current seek generation, needs mPipelineMutex
+    uint32_t currentGeneration() const;
+    bool isStaleGeneration(uint32_t generation) const;
+
+    // Record the seek latency on the first frame of the awaited generation
+    void recordSeekLatency(uint32_t generation);
+
+    // Seek to position; a precise seek presents from position instead of
+    // the keyframe before it
+    bool seekTo(int64_t position, bool precise);
+
+    // Render a preview frame of the scrub preview stage
+    bool showScrubFrame(const std::shared_ptr<VideoFrame>& frame);
+    void closeScrubPreview();
+
+    // Open and preroll a playlist item, runs on mPreloadThread
+    void preloadItem(const std::string& url);
+
+    // Stop and close an item's components on mRetireThread
+    void retireItem(std::shared_ptr<PlaylistItem> item);
+
+    // Whether the current item's input is used up: end of file and all
+    // its queues empty, though its last audio frames may still be playing
+    // in the renderer. Needs mPipelineMutex.
+    bool isCurrentItemDrained() const;
+
+    // Swap in the preloaded item's pipeline and return the replaced one,
+    // nullptr if there is none or playback has stopped. Needs
+    // mPipelineMutex; call finishSwitch() after releasing it.
+    std::shared_ptr<PlaylistItem> switchToNextItem();
+
+    // Reinitialize renderers, retire the replaced item and notify the
+    // callback after a switch, without mPipelineMutex
+    void finishSwitch(std::shared_ptr<PlaylistItem> retired);
+
+    // Reinitialize the renderers whose format changed from previous to
+    // info, after a playlist switch or a track switch
+    void reinitRenderers(const MediaInfo& previous, const MediaInfo& info);
+
+    // Mark playback as completed, once; without mPipelineMutex
+    void completePlayback();
 };
 
 }  // namespace yffplayer
@@ -28,6 +28,9 @@ class PlayerCallback {
 
     // Audio frame callback
     virtual void onAudioFrame(AudioFrame& frame) = 0;
+
+    // First frame after start() rendered, with the time it took
+    virtual void onFirstFrameRendered(int64_t timeToFirstFrameUs) = 0;
 };
 
 }  // namespace yffplayer
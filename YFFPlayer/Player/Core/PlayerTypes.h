@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <string>
 
 namespace yffplayer {
@@ -20,6 +22,7 @@ enum class PlayerState {
     INITIALIZED,
     PREPARING,
     PREPARED,
+    BUFFERING,
     STARTED,
     PAUSED,
     STOPPED,
@@ -39,6 +42,7 @@ enum class ErrorCode {
     DEMUXER_FIND_STREAM_FAILED = -106,
     DEMUXER_READ_FAILED = -107,
     DEMUXER_EXCEPTION = -108,
+    DEMUXER_TIMEOUT = -109,
     NETWORK_ERROR = -200,
 };
 
@@ -47,6 +51,224 @@ struct Error {
     std::string message;
 };
 
+// How much media start() buffers before rendering begins
+struct PrerollConfig {
+    int64_t audioDurationUs{100000};  // Decoded audio to buffer
+    int videoFrames{1};               // Decoded video frames to buffer
+};
+
+// A selectable audio or video stream of the opened media
+struct TrackInfo {
+    int streamIndex{-1};
+    MediaType type{MediaType::UNKNOWN};  // AUDIO or VIDEO
+    std::string language;                // Container language tag, may be empty
+    std::string codecName;
+    bool isDefault{false};               // Marked default by the container
+    bool selected{false};
+};
+
+// Preferences for the initial stream selection, empty means any
+struct TrackPreferences {
+    std::string audioLanguage;  // e.g. "eng"
+    std::string audioCodec;     // FFmpeg codec name, e.g. "aac"
+    std::string videoCodec;     // FFmpeg codec name, e.g. "h264"
+    bool videoOnly{false};      // Select no audio, e.g. for frame extraction
+};
+
+// Stream probing trade-off between open latency and accuracy
+enum class OpenProfile {
+    FAST_START,  // Small probe limits, skip probing when headers suffice
+    DEFAULT,     // FFmpeg defaults
+    THOROUGH,    // Large probe limits for unusual or damaged inputs
+};
+
+// How the player paces rendering
+enum class ClockMode {
+    REALTIME,  // Present frames at their timestamps
+    FREE_RUN,  // Present as fast as the pipeline delivers, for benchmarks
+};
+
+// Startup timing in microseconds, -1 until measured
+struct StartupMetrics {
+    OpenProfile profile{OpenProfile::DEFAULT};  // Profile used by open()
+    int64_t openUs{-1};         // open(): probing and codec setup
+    int64_t prerollUs{-1};      // start() until the preroll is buffered
+    int64_t firstFrameUs{-1};   // start() until the first frame is rendered
+    bool probeCacheHit{false};  // open() reused cached stream info
+};
+
+// Rebuffering thresholds on buffered media duration, microseconds
+struct BufferingConfig {
+    int64_t lowWatermarkUs{500000};        // Enter BUFFERING below this
+    int64_t highWatermarkUs{2000000};      // Resume playback above this
+    bool adaptive{true};                   // Scale by measured input speed
+    int64_t maxHighWatermarkUs{10000000};  // Upper bound when adapting
+};
+
+// Rebuffering statistics since start()
+struct RebufferStats {
+    int rebufferCount{0};             // Stalls after playback began
+    int64_t rebufferDurationUs{0};    // Time spent stalled
+    int64_t playbackDurationUs{0};    // Time spent rendering
+    double rebufferRatio{0.0};        // Stalled / (stalled + rendering)
+    double inputSpeed{0.0};           // Media time read per time reading
+    int64_t lowWatermarkUs{0};        // Current low watermark
+    int64_t highWatermarkUs{0};       // Current high watermark
+};
+
+// Demuxer input counters, used to measure input throughput
+struct InputStats {
+    int64_t bytesRead{0};    // Bytes of packets read from the input
+    int64_t readTimeUs{0};   // Time spent inside read calls
+    int64_t mediaTimeUs{0};  // Media duration of the packets read
+    int64_t lastPtsUs{-1};   // Newest packet pts, -1 before the first one
+};
+
+// Deadlines for blocking demuxer I/O in microseconds, 0 disables
+struct IoTimeouts {
+    int64_t openUs{10000000};   // avformat_open_input
+    int64_t probeUs{10000000};  // avformat_find_stream_info
+    int64_t readUs{10000000};   // each av_read_frame
+};
+
+// Live low-latency mode, latency is the newest demuxed pts minus the
+// playback position
+struct LiveConfig {
+    bool lowLatency{false};            // Enable for live inputs
+    int64_t targetLatencyUs{2000000};  // Latency to converge on
+    int64_t jumpThresholdUs{8000000};  // Skip to the newest keyframe above
+    float minSpeed{0.9f};              // Slowest catch-up speed
+    float maxSpeed{1.1f};              // Fastest catch-up speed
+};
+
+struct LiveStats {
+    bool active{false};         // Live input with low-latency mode on
+    int64_t latencyUs{-1};      // Last measured latency
+    int64_t targetLatencyUs{0};
+    float playbackSpeed{1.0f};  // Current catch-up speed
+    int64_t jumpCount{0};       // Skips to the newest keyframe
+};
+
+// Timeshift window for live inputs: pause, rewind and return to live
+// without reconnecting
+struct TimeshiftConfig {
+    bool enabled{false};
+    int64_t maxDurationUs{30LL * 60 * 1000000};  // Window length
+    int64_t maxBytes{256LL * 1024 * 1024};       // Ring capacity
+    std::string directory;  // Ring file location, empty keeps it in memory
+};
+
+// Seek bar scrubbing, see Player::beginScrub()
+struct ScrubConfig {
+    // Preview frames are scaled down to this height, 0 keeps the source
+    int maxHeight{360};
+    int64_t cacheSizeLimit{64 * 1024 * 1024};  // Decoded keyframes, bytes
+};
+
+// Stream-copy recording counters
+struct RecordingStats {
+    bool active{false};
+    int64_t packetsWritten{0};
+    int64_t bytesWritten{0};
+    int64_t packetsDropped{0};  // Dropped while the writer fell behind
+};
+
+// Log2 duration histogram: bucket i counts durations in [2^i, 2^(i+1))
+// microseconds, bucket 0 also holds 0. Buckets of several players can be
+// summed before taking percentiles.
+constexpr int kHistogramBuckets = 24;
+
+struct HistogramStats {
+    int64_t count{0};
+    int64_t sumUs{0};
+    int64_t maxUs{0};
+    int64_t p50Us{0};  // Percentiles are bucket upper bounds
+    int64_t p90Us{0};
+    int64_t p99Us{0};
+    std::array<int64_t, kHistogramBuckets> buckets{};
+};
+
+// Items processed by one pipeline stage and the time spent per item
+struct StageStats {
+    int64_t items{0};
+    HistogramStats timeUs;
+    // CPU time of the threads running the stage; only set for demux,
+    // decode (including convert and codec worker threads) and present
+    int64_t cpuUs{0};
+};
+
+struct QueueStats {
+    int64_t size{0};
+    int64_t capacity{0};
+    int64_t durationUs{0};  // Media duration of the queued items
+    int64_t pushWaitUs{0};  // Producer time spent waiting on a full queue
+    int64_t popWaitUs{0};   // Consumer time spent waiting on an empty queue
+    int64_t dropped{0};     // Items freed after a failed push
+    int64_t stale{0};       // Items of an earlier seek generation discarded
+};
+
+// Pipeline metrics since open()
+struct PlayerStats {
+    StageStats demux;         // Per packet read from the input
+    StageStats audioDecode;   // Per packet, send and receive calls
+    StageStats videoDecode;
+    StageStats audioConvert;  // Per frame
+    StageStats videoConvert;
+    StageStats videoPresent;  // Per frame handed to the video renderer
+
+    QueueStats audioPackets;
+    QueueStats videoPackets;
+    QueueStats audioFrames;
+    QueueStats videoFrames;
+
+    int64_t audioFramesRendered{0};
+    int64_t audioUnderruns{0};      // Audio output ran out of frames
+    int64_t videoFramesDropped{0};  // Skipped for being too late
+    int64_t videoFramesLate{0};     // Presented behind the audio clock
+    int64_t avOffsetUs{0};  // Video pts minus audio clock at last present
+    // Time video frames were handed to the renderer after they were due
+    HistogramStats presentLateUs;
+    int64_t bufferedDurationUs{0};
+
+    int64_t seeks{0};
+    int64_t seeksCoalesced{0};  // Replaced before the demuxer reached them
+    // From seek() to the first frame of the new position, for seeks made
+    // while playing
+    HistogramStats seekLatencyUs;
+    // Frames of an earlier generation presented or played after a seek
+    int64_t staleFramesShown{0};
+
+    int64_t scrubRequests{0};
+    int64_t scrubFrames{0};     // Preview frames shown, see ScrubPreview
+    int64_t scrubCacheHits{0};  // Of those, served from the keyframe cache
+    // From scrub() to its preview frame handed to the renderer
+    HistogramStats scrubLatencyUs;
+
+    int64_t cpuUs{0};  // Sum of the stage CPU times
+};
+
+// Input I/O path used by the demuxer
+enum class InputBackend {
+    DEFAULT,     // FFmpeg protocol I/O on the demuxer thread
+    READ_AHEAD,  // Background thread reading large blocks
+    MMAP,        // Memory-mapped local files, others use DEFAULT
+    DISK_CACHE,  // Byte-range disk cache for HTTP inputs, others use DEFAULT
+};
+
+struct InputConfig {
+    InputBackend backend{InputBackend::DEFAULT};
+    int readAheadBlockSize{2 * 1024 * 1024};  // Bytes per read-ahead block
+    int readAheadBlockCount{4};               // Blocks kept in memory
+    std::string cacheDirectory;               // Required for DISK_CACHE
+    int64_t cacheSizeLimit{512 * 1024 * 1024};  // LRU limit in bytes
+};
+
+// Teardown timing of the last stop()/close() in microseconds
+struct TeardownMetrics {
+    int64_t stopUs{-1};
+    int64_t closeUs{-1};
+};
+
 enum class StreamType {
     AUDIO,
     VIDEO,
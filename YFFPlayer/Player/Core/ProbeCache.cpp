@@ -0,0 +1,139 @@
+#include "ProbeCache.h"
+
+#include <sys/stat.h>
+
+#include "MmapIO.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+namespace yffplayer {
+
+ProbeCache::ProbeCache(size_t capacity) : mCapacity(capacity) {}
+
+ProbeCache::~ProbeCache() { clear(); }
+
+std::string ProbeCache::makeKey(const std::string& url,
+                                AVFormatContext* context) {
+    int64_t size = -1;
+    int64_t modifiedTime = 0;
+
+    // 本地文件使用大小和修改时间，网络输入只能使用内容长度
+    struct stat info;
+    std::string path = url.compare(0, 5, "file:") == 0 ? url.substr(5) : url;
+    if (MmapIO::isLocalPath(url) && stat(path.c_str(), &info) == 0) {
+        size = info.st_size;
+        modifiedTime = info.st_mtime;
+    } else if (context->pb) {
+        size = avio_size(context->pb);
+    }
+
+    return url + "|" + std::to_string(size) + "|" +
+           std::to_string(modifiedTime);
+}
+
+bool ProbeCache::apply(const std::string& key, AVFormatContext* context) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mEntries.begin();
+    while (it != mEntries.end() && it->key != key) {
+        ++it;
+    }
+    if (it == mEntries.end()) {
+        return false;
+    }
+
+    // 打开时得到的流结构必须与缓存一致，否则需要完整探测
+    bool matched = it->streams.size() == context->nb_streams;
+    for (unsigned int i = 0; matched && i < context->nb_streams; i++) {
+        const AVCodecParameters* cached = it->streams[i].codecParams;
+        const AVCodecParameters* current = context->streams[i]->codecpar;
+        matched = cached->codec_type == current->codec_type &&
+                  cached->codec_id == current->codec_id;
+    }
+    if (!matched) {
+        freeEntry(*it);
+        mEntries.erase(it);
+        return false;
+    }
+
+    for (unsigned int i = 0; i < context->nb_streams; i++) {
+        const StreamInfo& info = it->streams[i];
+        AVStream* stream = context->streams[i];
+        if (avcodec_parameters_copy(stream->codecpar, info.codecParams) < 0) {
+            return false;
+        }
+        stream->avg_frame_rate = {info.avgFrameRateNum, info.avgFrameRateDen};
+        stream->r_frame_rate = {info.realFrameRateNum, info.realFrameRateDen};
+        stream->duration = info.duration;
+        stream->start_time = info.startTime;
+    }
+    context->duration = it->duration;
+    context->start_time = it->startTime;
+    context->bit_rate = it->bitRate;
+
+    // 移到最前，表示最近使用
+    mEntries.splice(mEntries.begin(), mEntries, it);
+    return true;
+}
+
+void ProbeCache::store(const std::string& key,
+                       const AVFormatContext* context) {
+    Entry entry;
+    entry.key = key;
+    entry.duration = context->duration;
+    entry.startTime = context->start_time;
+    entry.bitRate = context->bit_rate;
+    for (unsigned int i = 0; i < context->nb_streams; i++) {
+        const AVStream* stream = context->streams[i];
+        StreamInfo info;
+        info.codecParams = avcodec_parameters_alloc();
+        if (!info.codecParams ||
+            avcodec_parameters_copy(info.codecParams, stream->codecpar) < 0) {
+            avcodec_parameters_free(&info.codecParams);
+            freeEntry(entry);
+            return;
+        }
+        info.avgFrameRateNum = stream->avg_frame_rate.num;
+        info.avgFrameRateDen = stream->avg_frame_rate.den;
+        info.realFrameRateNum = stream->r_frame_rate.num;
+        info.realFrameRateDen = stream->r_frame_rate.den;
+        info.duration = stream->duration;
+        info.startTime = stream->start_time;
+        entry.streams.push_back(info);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        if (it->key == key) {
+            freeEntry(*it);
+            mEntries.erase(it);
+            break;
+        }
+    }
+    mEntries.push_front(std::move(entry));
+
+    // 超出容量时淘汰最久未使用的条目
+    while (mEntries.size() > mCapacity) {
+        freeEntry(mEntries.back());
+        mEntries.pop_back();
+    }
+}
+
+void ProbeCache::clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (Entry& entry : mEntries) {
+        freeEntry(entry);
+    }
+    mEntries.clear();
+}
+
+void ProbeCache::freeEntry(Entry& entry) {
+    for (StreamInfo& info : entry.streams) {
+        avcodec_parameters_free(&info.codecParams);
+    }
+    entry.streams.clear();
+}
+
+}  // namespace yffplayer
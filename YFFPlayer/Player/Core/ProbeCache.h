@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+extern "C" {
+struct AVFormatContext;
+struct AVCodecParameters;
+}
+
+namespace yffplayer {
+
+// Remembers avformat_find_stream_info results so reopening the same
+// asset can skip probing. Entries are keyed by URL, size and mtime and
+// are only applied when the stream layout still matches.
+class ProbeCache {
+   public:
+    explicit ProbeCache(size_t capacity = 16);
+    ~ProbeCache();
+
+    // Cache key of an input opened with avformat_open_input
+    static std::string makeKey(const std::string& url,
+                               AVFormatContext* context);
+
+    // Fill codec parameters and timings from the cache, returns false
+    // on a miss or when the streams no longer match
+    bool apply(const std::string& key, AVFormatContext* context);
+
+    // Record the probe result of context
+    void store(const std::string& key, const AVFormatContext* context);
+
+    void clear();
+
+   private:
+    struct StreamInfo {
+        AVCodecParameters* codecParams{nullptr};
+        int avgFrameRateNum{0};
+        int avgFrameRateDen{0};
+        int realFrameRateNum{0};
+        int realFrameRateDen{0};
+        int64_t duration{0};
+        int64_t startTime{0};
+    };
+
+    struct Entry {
+        std::string key;
+        std::vector<StreamInfo> streams;
+        int64_t duration{0};
+        int64_t startTime{0};
+        int64_t bitRate{0};
+    };
+
+    static void freeEntry(Entry& entry);
+
+    size_t mCapacity;
+    std::mutex mMutex;
+    // Most recently used first
+    std::list<Entry> mEntries;
+};
+
+}  // namespace yffplayer
@@ -0,0 +1,295 @@
+#include "ReadAheadIO.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "ThreadUtil.h"
+
+extern "C" {
+#include <libavutil/error.h>
+}
+
+namespace yffplayer {
+
+// 等待数据时检查中断的间隔
+constexpr auto READ_WAIT_INTERVAL = std::chrono::milliseconds(10);
+
+ReadAheadIO::ReadAheadIO(int blockSize, int blockCount,
+                         std::shared_ptr<Logger> logger)
+    : mLogger(logger),
+      mBlockSize(std::max(blockSize, 64 * 1024)),
+      mBlocks(std::max(blockCount, 2)) {}
+
+ReadAheadIO::~ReadAheadIO() { close(); }
+
+bool ReadAheadIO::open(const std::string& url,
+                       const AVIOInterruptCB& interrupt) {
+    mInterrupt = interrupt;
+
+    // 打开阶段同时响应调用方的中断，之后只响应自身的停止
+    AVIOInterruptCB sourceInterrupt{&ReadAheadIO::sourceInterruptCallback,
+                                    this};
+    mOpening = true;
+    int ret = avio_open2(&mSource, url.c_str(), AVIO_FLAG_READ,
+                         &sourceInterrupt, nullptr);
+    mOpening = false;
+    if (ret < 0) {
+        YFF_LOG(mLogger, LogLevel::Error, "ReadAheadIO",
+                "无法打开输入: %s, 错误: %d", url.c_str(), ret);
+        return false;
+    }
+
+    mSeekable = (mSource->seekable & AVIO_SEEKABLE_NORMAL) != 0;
+    mSourceSize = avio_size(mSource);
+    if (mSourceSize >= 0) {
+        mEndOffset = mSourceSize;
+    }
+
+    for (Block& block : mBlocks) {
+        block.data.resize(mBlockSize);
+    }
+
+    mStopping = false;
+    mThread = std::thread(&ReadAheadIO::readAheadLoop, this);
+    YFF_LOG(mLogger, LogLevel::Info, "ReadAheadIO",
+            "预读已启动, 块大小: %lld, 块数: %zu",
+            static_cast<long long>(mBlockSize), mBlocks.size());
+    return true;
+}
+
+void ReadAheadIO::close() {
+    mStopping = true;
+    mWindowMoved.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+    if (mSource) {
+        avio_closep(&mSource);
+    }
+    releaseAVIOContext();
+}
+
+bool ReadAheadIO::isSeekable() const { return mSeekable; }
+
+int ReadAheadIO::read(uint8_t* buffer, int size) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        if (mEndOffset >= 0 && mPosition >= mEndOffset) {
+            return AVERROR_EOF;
+        }
+
+        // 命中已填充的块时只有一次内存拷贝
+        Block* block = findBlock(mPosition);
+        if (block) {
+            int offset = static_cast<int>(mPosition - block->offset);
+            int bytes = std::min(size, block->size - offset);
+            if (bytes > 0) {
+                memcpy(buffer, block->data.data() + offset, bytes);
+                mPosition += bytes;
+                mWindowMoved.notify_one();
+                return bytes;
+            }
+        }
+
+        if (mError < 0) {
+            return mError;
+        }
+        if (isInterrupted()) {
+            return AVERROR_EXIT;
+        }
+        mDataReady.wait_for(lock, READ_WAIT_INTERVAL);
+    }
+}
+
+int64_t ReadAheadIO::seek(int64_t offset, int whence) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (whence & AVSEEK_SIZE) {
+        return mSourceSize >= 0 ? mSourceSize : AVERROR(ENOSYS);
+    }
+
+    int64_t position;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET:
+            position = offset;
+            break;
+        case SEEK_CUR:
+            position = mPosition + offset;
+            break;
+        case SEEK_END:
+            if (mSourceSize < 0) {
+                return AVERROR(ENOSYS);
+            }
+            position = mSourceSize + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    if (position < 0) {
+        return AVERROR(EINVAL);
+    }
+
+    // 只移动读取位置，窗口内的块继续复用，其余由预读线程补齐
+    mPosition = position;
+    mError = 0;
+    mWindowMoved.notify_one();
+    return position;
+}
+
+ReadAheadIO::Block* ReadAheadIO::findBlock(int64_t position) {
+    for (Block& block : mBlocks) {
+        if (block.ready && block.offset >= 0 && position >= block.offset &&
+            position < block.offset + block.size) {
+            return &block;
+        }
+    }
+    return nullptr;
+}
+
+int64_t ReadAheadIO::nextMissingBlock() const {
+    // 保留读取位置之前的一个块给小范围回跳，其余块都用于向前预读
+    int64_t windowStart = mPosition / mBlockSize * mBlockSize;
+    int ahead = static_cast<int>(mBlocks.size()) - 1;
+    for (int i = 0; i < ahead; i++) {
+        int64_t offset = windowStart + static_cast<int64_t>(i) * mBlockSize;
+        if (mEndOffset >= 0 && offset >= mEndOffset) {
+            break;
+        }
+        // 读取出错留下的不完整块仍需补齐
+        bool present = false;
+        for (const Block& block : mBlocks) {
+            if (block.offset == offset) {
+                present = block.size == mBlockSize ||
+                          (mEndOffset >= 0 &&
+                           offset + block.size >= mEndOffset);
+                break;
+            }
+        }
+        if (!present) {
+            return offset;
+        }
+    }
+    return -1;
+}
+
+ReadAheadIO::Block* ReadAheadIO::pickVictim(int64_t windowStart) {
+    // 优先使用空块，其次淘汰窗口外最远的块，最后才是保留的回跳块
+    int64_t windowEnd =
+        windowStart + static_cast<int64_t>(mBlocks.size() - 1) * mBlockSize;
+    Block* victim = nullptr;
+    int64_t farthest = -1;
+    for (Block& block : mBlocks) {
+        if (block.offset < 0) {
+            return &block;
+        }
+        if (block.offset >= windowStart && block.offset < windowEnd) {
+            continue;
+        }
+        int64_t distance = block.offset < windowStart
+                               ? windowStart - block.offset
+                               : block.offset - windowEnd + mBlockSize;
+        if (distance > farthest) {
+            farthest = distance;
+            victim = &block;
+        }
+    }
+    return victim;
+}
+
+int ReadAheadIO::fillBlock(Block& block, int64_t offset, int& filled) {
+    int64_t start = offset + filled;
+    if (mSourcePosition != start) {
+        int64_t ret = avio_seek(mSource, start, SEEK_SET);
+        if (ret < 0) {
+            return static_cast<int>(ret);
+        }
+        mSourcePosition = start;
+    }
+
+    // 大块连续读取，FFmpeg对大请求直接读入目标内存
+    int ret = 0;
+    while (filled < mBlockSize && !mStopping) {
+        ret = avio_read(mSource, block.data.data() + filled,
+                        mBlockSize - filled);
+        if (ret == 0) {
+            ret = AVERROR_EOF;
+        }
+        if (ret < 0) {
+            break;
+        }
+        filled += ret;
+        ret = 0;
+    }
+    mSourcePosition = offset + filled;
+    return ret;
+}
+
+void ReadAheadIO::readAheadLoop() {
+    setCurrentThreadName("yff-readahead");
+    while (!mStopping) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        int64_t offset = mError < 0 ? -1 : nextMissingBlock();
+        if (offset < 0) {
+            // 窗口已满或出错，等待读取位置移动
+            mWindowMoved.wait_for(lock, READ_WAIT_INTERVAL);
+            continue;
+        }
+        // 不完整的块从已有数据之后续读，否则取一个空闲块
+        Block* block = nullptr;
+        for (Block& candidate : mBlocks) {
+            if (candidate.offset == offset) {
+                block = &candidate;
+                break;
+            }
+        }
+        int64_t start = offset + (block ? block->size : 0);
+        if (!mSeekable && start != mSourcePosition) {
+            // 不可跳转的输入只能顺序读取
+            mError = AVERROR(ESPIPE);
+            mDataReady.notify_all();
+            continue;
+        }
+        if (!block) {
+            block = pickVictim(mPosition / mBlockSize * mBlockSize);
+            if (!block) {
+                mWindowMoved.wait_for(lock, READ_WAIT_INTERVAL);
+                continue;
+            }
+            block->offset = offset;
+            block->size = 0;
+            block->ready = false;
+        }
+        int filled = block->size;
+        lock.unlock();
+
+        // 在锁外读取，只写入块内已有数据之后的部分，
+        // 读取线程只访问已就绪的块中前size字节
+        int ret = fillBlock(*block, offset, filled);
+
+        lock.lock();
+        // 出错前读到的数据保留，读取位置消费完后才报告错误
+        block->size = filled;
+        block->ready = filled > 0;
+        if (filled == 0) {
+            block->offset = -1;
+        }
+        if (ret == AVERROR_EOF) {
+            mEndOffset = offset + filled;
+        } else if (ret < 0 && !mStopping) {
+            mError = ret;
+            YFF_LOG(mLogger, LogLevel::Error, "ReadAheadIO",
+                    "预读失败, 错误: %d", ret);
+        }
+        mDataReady.notify_all();
+    }
+}
+
+int ReadAheadIO::sourceInterruptCallback(void* opaque) {
+    ReadAheadIO* io = static_cast<ReadAheadIO*>(opaque);
+    if (io->mStopping) {
+        return 1;
+    }
+    return io->mOpening && io->isInterrupted();
+}
+
+}  // namespace yffplayer
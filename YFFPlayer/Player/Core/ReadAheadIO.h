@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "IOBackend.h"
+#include "Logger.h"
+
+namespace yffplayer {
+
+// Reads the input on a background thread in large blocks kept in a small
+// ring. Demuxer reads are served from memory; blocks around the read
+// position survive seeks so short backward jumps need no I/O.
+class ReadAheadIO : public IOBackend {
+   public:
+    ReadAheadIO(int blockSize, int blockCount, std::shared_ptr<Logger> logger);
+    ~ReadAheadIO() override;
+
+    bool open(const std::string& url,
+              const AVIOInterruptCB& interrupt) override;
+    int read(uint8_t* buffer, int size) override;
+    int64_t seek(int64_t offset, int whence) override;
+    bool isSeekable() const override;
+    void close() override;
+
+   private:
+    struct Block {
+        int64_t offset{-1};  // Input offset of data[0], -1 if unused
+        int size{0};         // Valid bytes
+        bool ready{false};   // False while being filled
+        std::vector<uint8_t> data;
+    };
+
+    void readAheadLoop();
+    // Next block offset the reader will need, -1 if the window is full
+    int64_t nextMissingBlock() const;
+    Block* findBlock(int64_t position);
+    Block* pickVictim(int64_t windowStart);
+    // Read from offset + filled until the block is full. Returns 0,
+    // AVERROR_EOF or the source error; filled counts the valid bytes
+    // either way.
+    int fillBlock(Block& block, int64_t offset, int& filled);
+    static int sourceInterruptCallback(void* opaque);
+
+    std::shared_ptr<Logger> mLogger;
+    int mBlockSize;
+    std::vector<Block> mBlocks;
+
+    // Accessed only by the open and read-ahead threads
+    AVIOContext* mSource{nullptr};
+    int64_t mSourcePosition{0};
+    bool mSeekable{false};
+    int64_t mSourceSize{-1};
+
+    std::mutex mMutex;
+    std::condition_variable mDataReady;
+    std::condition_variable mWindowMoved;
+    int64_t mPosition{0};   // Reader position
+    int64_t mEndOffset{-1}; // End of input once known
+    int mError{0};          // Last source error, cleared by seek
+
+    std::atomic<bool> mOpening{false};
+    std::atomic<bool> mStopping{false};
+    std::thread mThread;
+};
+
+}  // namespace yffplayer
@@ -0,0 +1,225 @@
+#include "Recorder.h"
+
+#include <algorithm>
+
+#include "ThreadUtil.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace yffplayer {
+
+Recorder::Recorder(const std::string& path, std::shared_ptr<Logger> logger,
+                   int64_t queueLimitBytes)
+    : mPath(path), mLogger(logger), mQueueLimitBytes(queueLimitBytes) {}
+
+Recorder::~Recorder() { stop(); }
+
+bool Recorder::addStream(int sourceIndex, const AVCodecParameters* params,
+                         bool isKeyStream) {
+    if (!mOutput) {
+        // 根据文件扩展名选择封装格式（mp4/ts/mkv等）
+        if (avformat_alloc_output_context2(&mOutput, nullptr, nullptr,
+                                           mPath.c_str()) < 0 ||
+            !mOutput) {
+            YFF_LOG(mLogger, LogLevel::Error, "Recorder",
+                    "不支持的录制格式: %s", mPath.c_str());
+            return false;
+        }
+        // 录制从任意位置开始，时间戳平移到0
+        mOutput->avoid_negative_ts = AVFMT_AVOID_NEG_TS_MAKE_ZERO;
+    }
+
+    AVStream* stream = avformat_new_stream(mOutput, nullptr);
+    if (!stream || avcodec_parameters_copy(stream->codecpar, params) < 0) {
+        YFF_LOG(mLogger, LogLevel::Error, "Recorder", "无法创建录制流");
+        return false;
+    }
+    // 源容器的codec_tag在目标容器中不一定有效，由封装器重新选择
+    stream->codecpar->codec_tag = 0;
+    stream->time_base = AV_TIME_BASE_Q;
+
+    mStreamMap[sourceIndex] = stream->index;
+    if (isKeyStream) {
+        mKeyStreamIndex = sourceIndex;
+    }
+    return true;
+}
+
+bool Recorder::start() {
+    if (!mOutput || mStreamMap.empty()) {
+        return false;
+    }
+
+    if (!(mOutput->oformat->flags & AVFMT_NOFILE) &&
+        avio_open(&mOutput->pb, mPath.c_str(), AVIO_FLAG_WRITE) < 0) {
+        YFF_LOG(mLogger, LogLevel::Error, "Recorder", "无法创建录制文件: %s",
+                mPath.c_str());
+        closeOutput();
+        return false;
+    }
+
+    if (avformat_write_header(mOutput, nullptr) < 0) {
+        YFF_LOG(mLogger, LogLevel::Error, "Recorder", "写入文件头失败: %s",
+                mPath.c_str());
+        closeOutput();
+        return false;
+    }
+    mHeaderWritten = true;
+
+    mIsRunning = true;
+    mWriteThread = std::thread(&Recorder::writeLoop, this);
+    YFF_LOG(mLogger, LogLevel::Info, "Recorder", "开始录制: %s", mPath.c_str());
+    return true;
+}
+
+void Recorder::write(const AVPacket* packet, uint32_t generation) {
+    auto it = mStreamMap.find(packet->stream_index);
+    if (!mIsRunning || it == mStreamMap.end()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        // 跳转等造成时间戳不连续，从下一个关键帧接着输出时间线继续写
+        if (!mHasGeneration) {
+            mHasGeneration = true;
+            mGeneration = generation;
+        } else if (generation != mGeneration) {
+            mGeneration = generation;
+            mRebasePending = true;
+            mWaitKeyframe = true;
+        }
+
+        if (mWaitKeyframe) {
+            bool isKeyframe = packet->stream_index == mKeyStreamIndex &&
+                              (packet->flags & AV_PKT_FLAG_KEY);
+            if (!isKeyframe) {
+                return;
+            }
+            mWaitKeyframe = false;
+        }
+
+        int64_t timestamp =
+            packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+        if (mRebasePending && timestamp != AV_NOPTS_VALUE) {
+            mOffsetUs = mEndUs - timestamp;
+            mRebasePending = false;
+        }
+
+        // 输出的解码时间戳必须递增，否则封装器拒绝写入
+        int64_t dts = packet->dts != AV_NOPTS_VALUE ? packet->dts + mOffsetUs
+                                                    : AV_NOPTS_VALUE;
+        if (dts != AV_NOPTS_VALUE) {
+            auto last = mLastDts.find(it->second);
+            if (last != mLastDts.end() && dts <= last->second) {
+                mPacketsDropped++;
+                return;
+            }
+        }
+
+        // 写入跟不上时丢弃，等到下一个关键帧再继续，不阻塞解复用线程
+        if (mQueuedBytes + packet->size > mQueueLimitBytes) {
+            mPacketsDropped++;
+            mWaitKeyframe = true;
+            return;
+        }
+
+        AVPacket* queued = av_packet_clone(packet);
+        if (!queued) {
+            return;
+        }
+        queued->stream_index = it->second;
+        if (queued->pts != AV_NOPTS_VALUE) {
+            queued->pts += mOffsetUs;
+        }
+        if (dts != AV_NOPTS_VALUE) {
+            queued->dts = dts;
+            mLastDts[it->second] = dts;
+        }
+        if (timestamp != AV_NOPTS_VALUE) {
+            int64_t endUs = timestamp + mOffsetUs +
+                            std::max<int64_t>(queued->duration, 0);
+            mEndUs = std::max(mEndUs, endUs);
+        }
+        mQueue.push_back(queued);
+        mQueuedBytes += queued->size;
+    }
+    mQueueCond.notify_one();
+}
+
+void Recorder::writeLoop() {
+    setCurrentThreadName("yff-record");
+    while (true) {
+        AVPacket* packet = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mQueueCond.wait(lock,
+                            [this] { return !mQueue.empty() || !mIsRunning; });
+            if (mQueue.empty()) {
+                break;
+            }
+            packet = mQueue.front();
+            mQueue.pop_front();
+            mQueuedBytes -= packet->size;
+        }
+
+        int size = packet->size;
+        AVStream* stream = mOutput->streams[packet->stream_index];
+        av_packet_rescale_ts(packet, AV_TIME_BASE_Q, stream->time_base);
+        // av_interleaved_write_frame接管数据包的引用
+        if (av_interleaved_write_frame(mOutput, packet) < 0) {
+            YFF_LOG(mLogger, LogLevel::Warning, "Recorder", "写入数据包失败");
+        } else {
+            mPacketsWritten++;
+            mBytesWritten += size;
+        }
+        av_packet_free(&packet);
+    }
+}
+
+void Recorder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsRunning = false;
+    }
+    mQueueCond.notify_all();
+
+    // 写线程退出前会写完队列中剩余的数据包
+    if (mWriteThread.joinable()) {
+        mWriteThread.join();
+        YFF_LOG(mLogger, LogLevel::Info, "Recorder",
+                "录制结束: %s, %lld 个数据包, 丢弃 %lld 个", mPath.c_str(),
+                static_cast<long long>(mPacketsWritten),
+                static_cast<long long>(mPacketsDropped));
+    }
+    closeOutput();
+}
+
+void Recorder::closeOutput() {
+    if (!mOutput) {
+        return;
+    }
+    if (mHeaderWritten) {
+        av_write_trailer(mOutput);
+        mHeaderWritten = false;
+    }
+    if (!(mOutput->oformat->flags & AVFMT_NOFILE)) {
+        avio_closep(&mOutput->pb);
+    }
+    avformat_free_context(mOutput);
+    mOutput = nullptr;
+}
+
+RecordingStats Recorder::getStats() const {
+    RecordingStats stats;
+    stats.active = mIsRunning;
+    stats.packetsWritten = mPacketsWritten;
+    stats.bytesWritten = mBytesWritten;
+    stats.packetsDropped = mPacketsDropped;
+    return stats;
+}
+
+}  // namespace yffplayer
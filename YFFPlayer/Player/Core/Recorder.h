@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Logger.h"
+#include "PlayerTypes.h"
+
+extern "C" {
+struct AVCodecParameters;
+struct AVFormatContext;
+struct AVPacket;
+}
+
+namespace yffplayer {
+
+// Stream-copy recorder: remuxes demuxed packets into a file on its own
+// thread, the container is chosen by the file extension. write() never
+// blocks; when the queue is full packets are dropped until the next
+// keyframe, so a slow disk cannot stall playback.
+class Recorder {
+   public:
+    Recorder(const std::string& path, std::shared_ptr<Logger> logger,
+             int64_t queueLimitBytes = 8 * 1024 * 1024);
+    ~Recorder();
+
+    // Add an output stream copying the source stream, before start()
+    bool addStream(int sourceIndex, const AVCodecParameters* params,
+                   bool isKeyStream);
+
+    // Write the header and start the writer thread
+    bool start();
+
+    // Queue a packet with microsecond timestamps. A new generation marks
+    // a discontinuity such as a seek: recording resumes at the next
+    // keyframe, re-based to continue the output timeline, and packets
+    // whose DTS would not increase are dropped.
+    void write(const AVPacket* packet, uint32_t generation);
+
+    // Write the queued packets and finalize the file
+    void stop();
+
+    RecordingStats getStats() const;
+
+   private:
+    void writeLoop();
+    void closeOutput();
+
+    std::string mPath;
+    std::shared_ptr<Logger> mLogger;
+    int64_t mQueueLimitBytes;
+
+    AVFormatContext* mOutput{nullptr};
+    // Source stream index to output stream index
+    std::map<int, int> mStreamMap;
+    int mKeyStreamIndex{-1};
+    bool mHeaderWritten{false};
+
+    std::mutex mMutex;
+    std::condition_variable mQueueCond;
+    std::deque<AVPacket*> mQueue;
+    int64_t mQueuedBytes{0};
+    // Start at a keyframe, and resume at one after dropping packets
+    bool mWaitKeyframe{true};
+
+    // Output timeline: added to input timestamps of the current
+    // generation, end of the written packets and last DTS per output
+    // stream, all microseconds
+    bool mHasGeneration{false};
+    uint32_t mGeneration{0};
+    bool mRebasePending{false};
+    int64_t mOffsetUs{0};
+    int64_t mEndUs{0};
+    std::map<int, int64_t> mLastDts;
+
+    std::thread mWriteThread;
+    std::atomic<bool> mIsRunning{false};
+    std::atomic<int64_t> mPacketsWritten{0};
+    std::atomic<int64_t> mBytesWritten{0};
+    std::atomic<int64_t> mPacketsDropped{0};
+};
+
+}  // namespace yffplayer
@@ -0,0 +1,324 @@
+#include "ScrubPreview.h"
+
+#include "MmapIO.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/time.h>
+}
+
+namespace yffplayer {
+
+// 跳转后最多读取的数据包数，仍未遇到关键帧则放弃本次预览
+constexpr int MAX_PACKETS_TO_KEYFRAME = 1024;
+
+ScrubPreview::ScrubPreview(std::shared_ptr<Logger> logger)
+    : mLogger(logger) {}
+
+ScrubPreview::~ScrubPreview() { close(); }
+
+void ScrubPreview::open(const std::string& url, int streamIndex,
+                        const ScrubConfig& config, FrameCallback callback) {
+    close();
+
+    mUrl = url;
+    mStreamIndex = streamIndex;
+    mConfig = config;
+    mCallback = std::move(callback);
+    mCache.setSizeLimit(config.cacheSizeLimit);
+    mAbortRequested = false;
+    mOpenFailed = false;
+    // 网络输入的读取会阻塞，只有本地文件交给执行器
+    mRunner.setTaskGroup(MmapIO::isLocalPath(url) ? mTaskGroup : nullptr);
+    mRunner.start("yff-scrub", [this]() { return step(); });
+}
+
+void ScrubPreview::close() {
+    // 先中断可能阻塞的读取，再等待预览阶段退出
+    mAbortRequested = true;
+    mRunner.stop();
+    cancel();
+    closeInput();
+    mCache.clear();
+}
+
+void ScrubPreview::request(int64_t position) {
+    {
+        std::lock_guard<std::mutex> lock(mRequestMutex);
+        mHasRequest = true;
+        mRequestPosition = position;
+        mRequestTimeUs = av_gettime_relative();
+    }
+    if (mStats) {
+        mStats->addScrubRequest();
+    }
+    mRunner.wake();
+}
+
+void ScrubPreview::cancel() {
+    std::lock_guard<std::mutex> lock(mRequestMutex);
+    mHasRequest = false;
+}
+
+TaskStep ScrubPreview::step() {
+    // 只处理最新的请求，之前未开始的请求已被替换
+    int64_t position = 0;
+    int64_t requestTimeUs = 0;
+    {
+        std::lock_guard<std::mutex> lock(mRequestMutex);
+        if (!mHasRequest) {
+            return TaskStep::idle();
+        }
+        position = mRequestPosition;
+        requestTimeUs = mRequestTimeUs;
+        mHasRequest = false;
+    }
+
+    // 输入在第一次请求时打开，打开失败后不再重试
+    if (!mFormatContext && !mOpenFailed && !openInput()) {
+        mOpenFailed = true;
+        closeInput();
+    }
+    if (mOpenFailed) {
+        return TaskStep::again();
+    }
+
+    bool cached = false;
+    std::shared_ptr<VideoFrame> frame = previewFrame(position, cached);
+    if (frame && mCallback && mCallback(frame) && mStats) {
+        mStats->addScrubFrame(cached);
+        mStats->recordScrubLatency(av_gettime_relative() - requestTimeUs);
+    }
+    return TaskStep::again();
+}
+
+bool ScrubPreview::openInput() {
+    mFormatContext = avformat_alloc_context();
+    if (!mFormatContext) {
+        return false;
+    }
+    mFormatContext->interrupt_callback.callback =
+        &ScrubPreview::interruptCallback;
+    mFormatContext->interrupt_callback.opaque = this;
+    beginIo(mIoTimeouts.openUs);
+    int ret =
+        avformat_open_input(&mFormatContext, mUrl.c_str(), nullptr, nullptr);
+    endIo();
+    if (ret < 0) {
+        // 失败时FFmpeg已释放上下文
+        mFormatContext = nullptr;
+        YFF_LOG(mLogger, LogLevel::Error, "ScrubPreview",
+                "无法打开预览输入: %s", mUrl.c_str());
+        return false;
+    }
+    beginIo(mIoTimeouts.probeUs);
+    ret = avformat_find_stream_info(mFormatContext, nullptr);
+    endIo();
+    if (ret < 0 || mStreamIndex < 0 ||
+        mStreamIndex >= static_cast<int>(mFormatContext->nb_streams)) {
+        YFF_LOG(mLogger, LogLevel::Error, "ScrubPreview", "找不到预览视频流");
+        return false;
+    }
+
+    // 只读取预览的视频流
+    for (unsigned int i = 0; i < mFormatContext->nb_streams; i++) {
+        if (static_cast<int>(i) != mStreamIndex) {
+            mFormatContext->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+
+    AVStream* stream = mFormatContext->streams[mStreamIndex];
+    const AVCodec* decoder = avcodec_find_decoder(stream->codecpar->codec_id);
+    mCodecContext = decoder ? avcodec_alloc_context3(decoder) : nullptr;
+    if (!mCodecContext ||
+        avcodec_parameters_to_context(mCodecContext, stream->codecpar) < 0) {
+        YFF_LOG(mLogger, LogLevel::Error, "ScrubPreview", "无法创建预览解码器");
+        return false;
+    }
+    // 每次只解码一个关键帧：单线程避免帧级多线程的输出延迟，
+    // 跳过非关键帧，预览画面不需要环路滤波
+    mCodecContext->thread_count = 1;
+    mCodecContext->skip_frame = AVDISCARD_NONKEY;
+    mCodecContext->skip_loop_filter = AVDISCARD_ALL;
+    mCodecContext->pkt_timebase = stream->time_base;
+    if (avcodec_open2(mCodecContext, decoder, nullptr) < 0) {
+        YFF_LOG(mLogger, LogLevel::Error, "ScrubPreview", "无法打开预览解码器");
+        return false;
+    }
+
+    mPacket = av_packet_alloc();
+    mFrame = av_frame_alloc();
+    if (!mPacket || !mFrame) {
+        return false;
+    }
+    YFF_LOG(mLogger, LogLevel::Info, "ScrubPreview", "预览输入已打开");
+    return true;
+}
+
+void ScrubPreview::closeInput() {
+    av_packet_free(&mPacket);
+    av_frame_free(&mFrame);
+    avcodec_free_context(&mCodecContext);
+    if (mFormatContext) {
+        avformat_close_input(&mFormatContext);
+    }
+}
+
+int64_t ScrubPreview::findKeyframe(AVStream* stream, int64_t position) {
+    if (avformat_index_get_entries_count(stream) <= 0) {
+        return AV_NOPTS_VALUE;
+    }
+
+    // 取目标前后两个关键帧中较近的一个
+    int64_t target = av_rescale_q(position, AV_TIME_BASE_Q, stream->time_base);
+    const AVIndexEntry* before = avformat_index_get_entry_from_timestamp(
+        stream, target, AVSEEK_FLAG_BACKWARD);
+    const AVIndexEntry* after =
+        avformat_index_get_entry_from_timestamp(stream, target, 0);
+    const AVIndexEntry* nearest = before;
+    if (!before || (after && after->timestamp - target <
+                                 target - before->timestamp)) {
+        nearest = after;
+    }
+    return nearest ? nearest->timestamp : AV_NOPTS_VALUE;
+}
+
+std::shared_ptr<VideoFrame> ScrubPreview::previewFrame(int64_t position,
+                                                       bool& cached) {
+    AVStream* stream = mFormatContext->streams[mStreamIndex];
+
+    // 有索引时先按索引确定关键帧，命中缓存则无需读取和解码
+    int64_t keyframe = findKeyframe(stream, position);
+    int64_t keyUs = AV_NOPTS_VALUE;
+    if (keyframe != AV_NOPTS_VALUE) {
+        keyUs = av_rescale_q(keyframe, stream->time_base, AV_TIME_BASE_Q);
+        std::shared_ptr<VideoFrame> frame = mCache.find(keyUs);
+        if (frame) {
+            cached = true;
+            return frame;
+        }
+    }
+
+    int64_t seekTarget = keyframe;
+    if (seekTarget == AV_NOPTS_VALUE) {
+        seekTarget = av_rescale_q(position, AV_TIME_BASE_Q, stream->time_base);
+    }
+    if (!readKeyframe(stream, seekTarget)) {
+        return nullptr;
+    }
+
+    // 没有索引时以读到的关键帧时间戳作为缓存键
+    if (keyUs == AV_NOPTS_VALUE) {
+        int64_t timestamp =
+            mPacket->pts != AV_NOPTS_VALUE ? mPacket->pts : mPacket->dts;
+        keyUs = av_rescale_q(timestamp, stream->time_base, AV_TIME_BASE_Q);
+        std::shared_ptr<VideoFrame> frame = mCache.find(keyUs);
+        if (frame) {
+            av_packet_unref(mPacket);
+            cached = true;
+            return frame;
+        }
+    }
+
+    std::shared_ptr<VideoFrame> frame = decodeKeyframe(stream);
+    if (frame) {
+        if (frame->pts == AV_NOPTS_VALUE) {
+            frame->pts = keyUs;
+        }
+        mCache.insert(keyUs, frame);
+    }
+    return frame;
+}
+
+bool ScrubPreview::readKeyframe(AVStream* stream, int64_t timestamp) {
+    beginIo(mIoTimeouts.readUs);
+    int ret = av_seek_frame(mFormatContext, mStreamIndex, timestamp,
+                            AVSEEK_FLAG_BACKWARD);
+    endIo();
+    if (ret < 0) {
+        YFF_LOG(mLogger, LogLevel::Warning, "ScrubPreview", "预览跳转失败");
+        return false;
+    }
+
+    for (int i = 0; i < MAX_PACKETS_TO_KEYFRAME; i++) {
+        beginIo(mIoTimeouts.readUs);
+        ret = av_read_frame(mFormatContext, mPacket);
+        endIo();
+        if (ret < 0) {
+            return false;
+        }
+        if (mPacket->stream_index == mStreamIndex &&
+            (mPacket->flags & AV_PKT_FLAG_KEY)) {
+            return true;
+        }
+        av_packet_unref(mPacket);
+    }
+    YFF_LOG(mLogger, LogLevel::Warning, "ScrubPreview", "跳转后未找到关键帧");
+    return false;
+}
+
+std::shared_ptr<VideoFrame> ScrubPreview::decodeKeyframe(AVStream* stream) {
+    // 送入关键帧后立即冲刷解码器取出这一帧，再复位供下次使用
+    int ret = avcodec_send_packet(mCodecContext, mPacket);
+    av_packet_unref(mPacket);
+    if (ret >= 0) {
+        ret = avcodec_send_packet(mCodecContext, nullptr);
+    }
+    std::shared_ptr<VideoFrame> frame;
+    if (ret >= 0 && avcodec_receive_frame(mCodecContext, mFrame) >= 0) {
+        frame = scaleFrame(mFrame, stream);
+        av_frame_unref(mFrame);
+    }
+    avcodec_flush_buffers(mCodecContext);
+    if (!frame) {
+        YFF_LOG(mLogger, LogLevel::Warning, "ScrubPreview", "关键帧解码失败");
+    }
+    return frame;
+}
+
+std::shared_ptr<VideoFrame> ScrubPreview::scaleFrame(AVFrame* frame,
+                                                     AVStream* stream) {
+    // 按最大高度等比缩小
+    int width = 0;
+    int height = 0;
+    FrameScaler::fitSize(frame->width, frame->height, 0, mConfig.maxHeight,
+                         PixelFormat::YUV420P, width, height);
+    std::shared_ptr<VideoFrame> preview =
+        FrameScaler::allocFrame(width, height, PixelFormat::YUV420P);
+    if (!preview ||
+        !mScaler.scale(frame->data, frame->linesize, frame->width,
+                       frame->height, frame->format, *preview)) {
+        return nullptr;
+    }
+
+    preview->pts = frame->best_effort_timestamp;
+    if (preview->pts != AV_NOPTS_VALUE) {
+        preview->pts =
+            av_rescale_q(preview->pts, stream->time_base, AV_TIME_BASE_Q);
+    }
+    AVRational frameRate = stream->avg_frame_rate;
+    preview->duration = frameRate.num > 0 && frameRate.den > 0
+                            ? 1000000LL * frameRate.den / frameRate.num
+                            : 40000;  // 默认25fps
+    return preview;
+}
+
+void ScrubPreview::beginIo(int64_t timeoutUs) {
+    mIoDeadlineUs = timeoutUs > 0 ? av_gettime_relative() + timeoutUs : 0;
+}
+
+void ScrubPreview::endIo() { mIoDeadlineUs = 0; }
+
+int ScrubPreview::interruptCallback(void* opaque) {
+    ScrubPreview* preview = static_cast<ScrubPreview*>(opaque);
+    if (preview->mAbortRequested) {
+        return 1;
+    }
+
+    // 单次阻塞调用超过期限则中断，拖动时不会卡住预览阶段
+    int64_t deadline = preview->mIoDeadlineUs;
+    return deadline > 0 && av_gettime_relative() > deadline ? 1 : 0;
+}
+
+}  // namespace yffplayer
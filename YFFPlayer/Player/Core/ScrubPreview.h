@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "Executor.h"
+#include "FrameScaler.h"
+#include "KeyframeCache.h"
+#include "Logger.h"
+#include "PipelineStats.h"
+#include "PlayerTypes.h"
+#include "StageRunner.h"
+#include "VideoFrame.h"
+
+extern "C" {
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+struct AVStream;
+}
+
+namespace yffplayer {
+
+// Keyframe-only preview decoder for seek bar scrubbing. It keeps its own
+// input and codec beside the playback pipeline, so a request costs one
+// seek, one packet and one decoded frame: the position is resolved to the
+// nearest keyframe, that frame alone is decoded, scaled down and handed to
+// the frame callback. Requests the stage has not started yet are replaced
+// by newer ones, and decoded keyframes stay in a KeyframeCache.
+class ScrubPreview {
+   public:
+    // Called by the preview stage; returns false if the frame was not
+    // shown, e.g. because scrubbing ended meanwhile
+    using FrameCallback =
+        std::function<bool(const std::shared_ptr<VideoFrame>& frame)>;
+
+    explicit ScrubPreview(std::shared_ptr<Logger> logger);
+    ~ScrubPreview();
+
+    // Start the preview stage for stream streamIndex of url. The stage
+    // opens the input on the first request, so this returns at once.
+    void open(const std::string& url, int streamIndex,
+              const ScrubConfig& config, FrameCallback callback);
+
+    // Stop the stage, then free the input, the codec and the cache
+    void close();
+
+    // Show the keyframe nearest to position, microseconds
+    void request(int64_t position);
+
+    // Forget a pending request; a frame being decoded is still delivered
+    void cancel();
+
+    const std::string& getUrl() const { return mUrl; }
+
+    // Scrub counters, set before open()
+    void setStats(std::shared_ptr<PipelineStats> stats) { mStats = stats; }
+
+    // Decode as a task of this group instead of a dedicated thread, set
+    // before open(). Like the Demuxer, network inputs keep their thread
+    // since a read may block for the whole I/O timeout.
+    void setTaskGroup(std::shared_ptr<TaskGroup> group) { mTaskGroup = group; }
+
+    // Deadlines of the preview input's open, probe and reads, set before
+    // open()
+    void setIoTimeouts(const IoTimeouts& timeouts) { mIoTimeouts = timeouts; }
+
+   private:
+    std::shared_ptr<Logger> mLogger;
+    std::string mUrl;
+    int mStreamIndex{-1};
+    ScrubConfig mConfig;
+    FrameCallback mCallback;
+    std::shared_ptr<PipelineStats> mStats;
+    std::shared_ptr<TaskGroup> mTaskGroup;
+    IoTimeouts mIoTimeouts;
+    StageRunner mRunner;
+    KeyframeCache mCache;
+    std::atomic<bool> mAbortRequested{false};
+    // Deadline of the blocking call in progress, 0 when there is none
+    std::atomic<int64_t> mIoDeadlineUs{0};
+
+    // Latest request not taken by the stage yet
+    std::mutex mRequestMutex;
+    bool mHasRequest{false};
+    int64_t mRequestPosition{0};
+    int64_t mRequestTimeUs{0};
+
+    // Used by the stage only
+    AVFormatContext* mFormatContext{nullptr};
+    AVCodecContext* mCodecContext{nullptr};
+    FrameScaler mScaler;
+    AVPacket* mPacket{nullptr};
+    AVFrame* mFrame{nullptr};
+    bool mOpenFailed{false};
+
+    // One request: decode or look up its keyframe and hand it over
+    TaskStep step();
+
+    bool openInput();
+    void closeInput();
+
+    // Timestamp of the keyframe nearest to position from the stream
+    // index, in stream time base; AV_NOPTS_VALUE without an index
+    int64_t findKeyframe(AVStream* stream, int64_t position);
+
+    // The keyframe for position; cached tells whether it came from the
+    // cache
+    std::shared_ptr<VideoFrame> previewFrame(int64_t position, bool& cached);
+
+    // Seek to timestamp and read the next keyframe packet into mPacket
+    bool readKeyframe(AVStream* stream, int64_t timestamp);
+
+    // Decode the keyframe in mPacket on its own
+    std::shared_ptr<VideoFrame> decodeKeyframe(AVStream* stream);
+
+    // Scale to the preview size as YUV420P
+    std::shared_ptr<VideoFrame> scaleFrame(AVFrame* frame, AVStream* stream);
+
+    // Arm the deadline for one blocking call, timeoutUs <= 0 disables it
+    void beginIo(int64_t timeoutUs);
+    void endIo();
+    static int interruptCallback(void* opaque);
+};
+
+}  // namespace yffplayer
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+extern "C" {
+#include <libavcodec/packet.h>
+}
+
+namespace yffplayer {
+
+// Seek generation of one pipeline. Every seek or jump advances it; the
+// demuxer tags each packet with the generation it was read for and the
+// decoders copy the tag to their frames. Consumers then drop items of an
+// earlier generation with one comparison, instead of the player clearing
+// queues under running stages.
+class SeekGeneration {
+   public:
+    // No start position: a generation shows everything from its keyframe
+    static constexpr int64_t kNoStartPosition = INT64_MIN;
+
+    uint32_t current() const { return mValue.load(std::memory_order_acquire); }
+
+    // Returns the new generation. For a precise seek the decoders drop the
+    // frames that end before startUs instead of converting them.
+    uint32_t advance(int64_t startUs = kNoStartPosition) {
+        std::lock_guard<std::mutex> lock(mStartMutex);
+        uint32_t generation =
+            mValue.fetch_add(1, std::memory_order_acq_rel) + 1;
+        mStartGeneration = generation;
+        mStartUs = startUs;
+        return generation;
+    }
+
+    // Start position of generation, kNoStartPosition once it is not the
+    // latest one any more
+    int64_t startPosition(uint32_t generation) const {
+        std::lock_guard<std::mutex> lock(mStartMutex);
+        return generation == mStartGeneration ? mStartUs : kNoStartPosition;
+    }
+
+   private:
+    std::atomic<uint32_t> mValue{0};
+    mutable std::mutex mStartMutex;
+    uint32_t mStartGeneration{0};
+    int64_t mStartUs{kNoStartPosition};
+};
+
+// Packets carry their generation in AVPacket::opaque, which
+// av_packet_clone() and av_packet_ref() preserve
+inline void setPacketGeneration(AVPacket* packet, uint32_t generation) {
+    packet->opaque =
+        reinterpret_cast<void*>(static_cast<uintptr_t>(generation));
+}
+
+inline uint32_t packetGeneration(const AVPacket* packet) {
+    return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(packet->opaque));
+}
+
+}  // namespace yffplayer
@@ -0,0 +1,119 @@
+#include "StageRunner.h"
+
+#include <chrono>
+
+#include "ThreadUtil.h"
+
+namespace yffplayer {
+
+// 独立线程等待队列时的轮询间隔，与原先各循环的10毫秒睡眠一致
+constexpr auto IDLE_POLL_INTERVAL = std::chrono::milliseconds(10);
+
+StageRunner::~StageRunner() { stop(); }
+
+void StageRunner::setTaskGroup(std::shared_ptr<TaskGroup> group) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mGroup = group;
+}
+
+bool StageRunner::hasTaskGroup() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mGroup != nullptr;
+}
+
+std::shared_ptr<TaskGroup> StageRunner::getTaskGroup() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mGroup;
+}
+
+void StageRunner::start(const std::string& threadName,
+                        std::function<TaskStep()> step,
+                        std::shared_ptr<PipelineStats> stats,
+                        PipelineStats::Stage stage,
+                        const std::vector<int>& helperThreads) {
+    stop();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRunning = true;
+    mStarted = true;
+    if (!mGroup) {
+        mThread = std::thread(&StageRunner::threadLoop, this, threadName,
+                              std::move(step), stats, stage, helperThreads);
+        return;
+    }
+
+    // 任务在执行器线程上运行，CPU 时间按每次运行累计
+    std::function<void(int64_t)> cpuObserver;
+    if (stats && stage != PipelineStats::Stage::COUNT) {
+        cpuObserver = [stats, stage](int64_t us) {
+            stats->addCpuTime(stage, us);
+        };
+    }
+    mTask = mGroup->spawn(std::move(step), std::move(cpuObserver));
+}
+
+void StageRunner::stop() {
+    std::shared_ptr<Task> task;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning = false;
+        mStarted = false;
+        task = std::move(mTask);
+    }
+    mWakeCondition.notify_all();
+    if (task) {
+        task->cancel();
+    }
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+void StageRunner::wake() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mTask) {
+            mTask->wake();
+            return;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mWakeMutex);
+    mWoken = true;
+    mWakeCondition.notify_one();
+}
+
+bool StageRunner::isStarted() const { return mStarted; }
+
+void StageRunner::threadLoop(std::string threadName,
+                             std::function<TaskStep()> step,
+                             std::shared_ptr<PipelineStats> stats,
+                             PipelineStats::Stage stage,
+                             std::vector<int> helperThreads) {
+    setCurrentThreadName(threadName);
+    std::unique_ptr<StageCpuMeter> cpuMeter;
+    if (stats && stage != PipelineStats::Stage::COUNT) {
+        cpuMeter = std::make_unique<StageCpuMeter>(stats, stage);
+        cpuMeter->addHelperThreads(helperThreads);
+    }
+
+    while (mRunning) {
+        if (cpuMeter) {
+            cpuMeter->sample();
+        }
+        TaskStep result = step();
+        if (result.kind() == TaskStep::Kind::DONE) {
+            break;
+        } else if (result.kind() == TaskStep::Kind::IDLE) {
+            // wake() 提前结束等待，之前的唤醒不会丢失
+            std::unique_lock<std::mutex> lock(mWakeMutex);
+            mWakeCondition.wait_for(lock, IDLE_POLL_INTERVAL,
+                                    [this]() { return mWoken || !mRunning; });
+            mWoken = false;
+        } else if (result.kind() == TaskStep::Kind::SLEEP) {
+            std::this_thread::sleep_for(
+                std::chrono::microseconds(result.delayUs()));
+        }
+    }
+}
+
+}  // namespace yffplayer
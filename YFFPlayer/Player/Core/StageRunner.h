@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Executor.h"
+#include "PipelineStats.h"
+
+namespace yffplayer {
+
+// Runs a pipeline stage as a sequence of steps, on a dedicated thread by
+// default or as a task of an executor group. A step returns
+// TaskStep::idle() while it waits on a queue: the thread polls again after
+// 10 ms or on wake(), the task parks until wake(), which the queues trigger
+// when items arrive or space frees up. Coroutine stages pass
+// CoStage::step().
+class StageRunner {
+   public:
+    ~StageRunner();
+
+    // Run on this group from the next start(), nullptr for a thread
+    void setTaskGroup(std::shared_ptr<TaskGroup> group);
+    bool hasTaskGroup() const;
+    std::shared_ptr<TaskGroup> getTaskGroup() const;
+
+    // Start calling step until it returns done() or stop(). CPU time is
+    // charged to stage when stats is set; helperThreads are codec workers
+    // of a threaded runner, see StageCpuMeter.
+    void start(const std::string& threadName, std::function<TaskStep()> step,
+               std::shared_ptr<PipelineStats> stats = nullptr,
+               PipelineStats::Stage stage = PipelineStats::Stage::COUNT,
+               const std::vector<int>& helperThreads = std::vector<int>());
+
+    // Blocks until a running step returned, no steps afterwards. Must not
+    // be called from the stage itself.
+    void stop();
+
+    // Run a parked task now; an idle thread polls at once
+    void wake();
+
+    // Between start() and stop(), also after the step returned done()
+    bool isStarted() const;
+
+   private:
+    mutable std::mutex mMutex;
+    std::shared_ptr<TaskGroup> mGroup;
+    std::shared_ptr<Task> mTask;
+    std::thread mThread;
+    std::atomic<bool> mRunning{false};
+    std::atomic<bool> mStarted{false};
+    // Ends the idle poll interval of a thread early
+    std::mutex mWakeMutex;
+    std::condition_variable mWakeCondition;
+    bool mWoken{false};
+    void threadLoop(std::string threadName, std::function<TaskStep()> step,
+                    std::shared_ptr<PipelineStats> stats,
+                    PipelineStats::Stage stage,
+                    std::vector<int> helperThreads);
+};
+
+}  // namespace yffplayer
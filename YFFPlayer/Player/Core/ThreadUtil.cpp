@@ -0,0 +1,93 @@
+#include "ThreadUtil.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <cstdlib>
+#include <fstream>
+
+namespace yffplayer {
+
+// 系统限制的线程名长度，不含结尾的 0
+constexpr size_t THREAD_NAME_MAX = 15;
+
+void setCurrentThreadName(const std::string& name) {
+    std::string truncated = name.substr(0, THREAD_NAME_MAX);
+#if defined(__APPLE__)
+    pthread_setname_np(truncated.c_str());
+#else
+    pthread_setname_np(pthread_self(), truncated.c_str());
+#endif
+}
+
+std::string getCurrentThreadName() {
+    char name[64] = {0};
+    if (pthread_getname_np(pthread_self(), name, sizeof(name)) != 0) {
+        return std::string();
+    }
+    return name;
+}
+
+int64_t currentThreadCpuTimeUs() {
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+#if defined(__linux__)
+
+std::vector<int> listThreadIds() {
+    std::vector<int> ids;
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) {
+        return ids;
+    }
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            ids.push_back(atoi(entry->d_name));
+        }
+    }
+    closedir(dir);
+    return ids;
+}
+
+std::string getThreadName(int threadId) {
+    std::ifstream file("/proc/self/task/" + std::to_string(threadId) +
+                       "/comm");
+    std::string name;
+    std::getline(file, name);
+    return name;
+}
+
+void setThreadName(int threadId, const std::string& name) {
+    std::ofstream file("/proc/self/task/" + std::to_string(threadId) +
+                       "/comm");
+    file << name.substr(0, THREAD_NAME_MAX);
+}
+
+int64_t threadCpuTimeUs(int threadId) {
+    // 内核按线程 id 编码的 CPU 时钟，与 pthread_getcpuclockid 的结果相同
+    clockid_t clock = (~static_cast<clockid_t>(threadId) << 3) | 6;
+    timespec ts;
+    if (clock_gettime(clock, &ts) != 0) {
+        return -1;
+    }
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+#else
+
+std::vector<int> listThreadIds() { return std::vector<int>(); }
+
+std::string getThreadName(int threadId) { return std::string(); }
+
+void setThreadName(int threadId, const std::string& name) {}
+
+int64_t threadCpuTimeUs(int threadId) { return -1; }
+
+#endif
+
+}  // namespace yffplayer
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace yffplayer {
+
+// Name the calling thread for top, debuggers and trace tools. Names are
+// truncated to 15 characters.
+void setCurrentThreadName(const std::string& name);
+std::string getCurrentThreadName();
+
+// CPU time used by the calling thread (CLOCK_THREAD_CPUTIME_ID),
+// microseconds
+int64_t currentThreadCpuTimeUs();
+
+// Access to other threads of the process by kernel thread id. Only
+// implemented on Linux; elsewhere the list is empty and the CPU time -1.
+std::vector<int> listThreadIds();
+std::string getThreadName(int threadId);
+void setThreadName(int threadId, const std::string& name);
+// -1 once the thread has exited
+int64_t threadCpuTimeUs(int threadId);
+
+}  // namespace yffplayer
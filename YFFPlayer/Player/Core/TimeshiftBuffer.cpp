@@ -0,0 +1,242 @@
+#include "TimeshiftBuffer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include <libavcodec/packet.h>
+#include <libavutil/avutil.h>
+}
+
+namespace yffplayer {
+
+// 内存环形缓冲区按块分配，未写到的部分不占内存
+constexpr uint64_t MEMORY_CHUNK_SIZE = 1024 * 1024;
+
+TimeshiftBuffer::TimeshiftBuffer(const TimeshiftConfig& config,
+                                 int keyStreamIndex,
+                                 std::shared_ptr<Logger> logger)
+    : mConfig(config),
+      mKeyStreamIndex(keyStreamIndex),
+      mLogger(logger),
+      mCapacity(static_cast<uint64_t>(
+          std::max<int64_t>(config.maxBytes, MEMORY_CHUNK_SIZE))) {}
+
+TimeshiftBuffer::~TimeshiftBuffer() {
+    if (mFd >= 0) {
+        ::close(mFd);
+    }
+}
+
+bool TimeshiftBuffer::open() {
+    if (mConfig.directory.empty()) {
+        mChunks.resize((mCapacity + MEMORY_CHUNK_SIZE - 1) / MEMORY_CHUNK_SIZE);
+        YFF_LOG(mLogger, LogLevel::Info, "TimeshiftBuffer",
+                "时移缓冲区已创建(内存), 容量: %lld 字节",
+                static_cast<long long>(mCapacity));
+        return true;
+    }
+
+    // 创建后立即删除文件名，进程退出时由系统回收
+    std::string path = mConfig.directory + "/timeshift-XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    mFd = mkstemp(name.data());
+    if (mFd < 0) {
+        YFF_LOG(mLogger, LogLevel::Error, "TimeshiftBuffer",
+                "无法创建时移文件: %s", path.c_str());
+        return false;
+    }
+    unlink(name.data());
+    YFF_LOG(mLogger, LogLevel::Info, "TimeshiftBuffer",
+            "时移缓冲区已创建(磁盘), 容量: %lld 字节",
+            static_cast<long long>(mCapacity));
+    return true;
+}
+
+void TimeshiftBuffer::append(const AVPacket* packet) {
+    RecordHeader header;
+    header.pts = packet->pts;
+    header.dts = packet->dts;
+    header.duration = packet->duration;
+    header.size = packet->size;
+    header.streamIndex = packet->stream_index;
+    header.flags = packet->flags;
+    header.reserved = 0;
+
+    uint64_t length = sizeof(header) + packet->size;
+    if (length > mCapacity) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    evict(length, packet->pts);
+
+    // 记录顺序追加：定长头部加负载，写入代价只有两次拷贝
+    writeBytes(mWriteOffset, reinterpret_cast<const uint8_t*>(&header),
+               sizeof(header));
+    if (packet->size > 0) {
+        writeBytes(mWriteOffset + sizeof(header), packet->data, packet->size);
+    }
+
+    uint64_t sequence = mFirstSequence + mRecords.size();
+    mRecords.push_back({mWriteOffset, static_cast<uint32_t>(length)});
+    mWriteOffset += length;
+
+    if (packet->stream_index == mKeyStreamIndex &&
+        (packet->flags & AV_PKT_FLAG_KEY) && packet->pts != AV_NOPTS_VALUE) {
+        mKeyframes.push_back({packet->pts, sequence});
+    }
+}
+
+void TimeshiftBuffer::evict(uint64_t bytesNeeded, int64_t newestPts) {
+    // 按容量和时长两个上限淘汰最旧的记录
+    while (!mRecords.empty()) {
+        bool overCapacity =
+            mWriteOffset + bytesNeeded - mTailOffset > mCapacity;
+        bool overDuration =
+            newestPts != AV_NOPTS_VALUE && !mKeyframes.empty() &&
+            mConfig.maxDurationUs > 0 &&
+            newestPts - mKeyframes.front().pts > mConfig.maxDurationUs;
+        if (!overCapacity && !overDuration) {
+            break;
+        }
+
+        // 以关键帧为单位淘汰，窗口始终从关键帧开始
+        uint64_t dropUntil = mFirstSequence + mRecords.size();
+        if (mKeyframes.size() > 1) {
+            dropUntil = mKeyframes[1].sequence;
+        }
+        while (mFirstSequence < dropUntil && !mRecords.empty()) {
+            const Record& record = mRecords.front();
+            mTailOffset = record.offset + record.length;
+            mRecords.pop_front();
+            mFirstSequence++;
+        }
+        while (!mKeyframes.empty() &&
+               mKeyframes.front().sequence < mFirstSequence) {
+            mKeyframes.pop_front();
+        }
+    }
+    if (mRecords.empty()) {
+        mTailOffset = mWriteOffset;
+    }
+
+    // 读取位置被淘汰时跳到窗口起点
+    if (mReadSequence < mFirstSequence) {
+        mReadSequence = mFirstSequence;
+        YFF_LOG(mLogger, LogLevel::Warning, "TimeshiftBuffer",
+                "读取位置已超出时移窗口，跳到窗口起点");
+    }
+}
+
+AVPacket* TimeshiftBuffer::read() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mReadSequence >= mFirstSequence + mRecords.size()) {
+        return nullptr;
+    }
+
+    const Record& record = mRecords[mReadSequence - mFirstSequence];
+    RecordHeader header;
+    readBytes(record.offset, reinterpret_cast<uint8_t*>(&header),
+              sizeof(header));
+
+    AVPacket* packet = av_packet_alloc();
+    if (!packet || av_new_packet(packet, header.size) < 0) {
+        av_packet_free(&packet);
+        return nullptr;
+    }
+    readBytes(record.offset + sizeof(header), packet->data, header.size);
+    packet->pts = header.pts;
+    packet->dts = header.dts;
+    packet->duration = header.duration;
+    packet->stream_index = header.streamIndex;
+    packet->flags = header.flags;
+
+    mReadSequence++;
+    return packet;
+}
+
+bool TimeshiftBuffer::seek(int64_t positionUs) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mKeyframes.empty() || positionUs < mKeyframes.front().pts) {
+        return false;
+    }
+
+    // 关键帧索引按时间递增，二分查找目标之前最近的关键帧
+    auto it = std::upper_bound(
+        mKeyframes.begin(), mKeyframes.end(), positionUs,
+        [](int64_t position, const Keyframe& keyframe) {
+            return position < keyframe.pts;
+        });
+    mReadSequence = std::prev(it)->sequence;
+    return true;
+}
+
+bool TimeshiftBuffer::getRange(int64_t& startUs, int64_t& endUs) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mKeyframes.empty()) {
+        return false;
+    }
+    startUs = mKeyframes.front().pts;
+    endUs = mKeyframes.back().pts;
+    return true;
+}
+
+void TimeshiftBuffer::writeBytes(uint64_t offset, const uint8_t* data,
+                                 size_t size) {
+    while (size > 0) {
+        uint64_t position = offset % mCapacity;
+        size_t bytes = static_cast<size_t>(
+            std::min<uint64_t>(size, mCapacity - position));
+        if (mFd >= 0) {
+            if (pwrite(mFd, data, bytes, static_cast<off_t>(position)) < 0) {
+                YFF_LOG(mLogger, LogLevel::Error, "TimeshiftBuffer",
+                        "写入时移文件失败");
+                return;
+            }
+        } else {
+            uint64_t inChunk = position % MEMORY_CHUNK_SIZE;
+            bytes = static_cast<size_t>(
+                std::min<uint64_t>(bytes, MEMORY_CHUNK_SIZE - inChunk));
+            std::unique_ptr<uint8_t[]>& chunk =
+                mChunks[position / MEMORY_CHUNK_SIZE];
+            if (!chunk) {
+                chunk.reset(new uint8_t[MEMORY_CHUNK_SIZE]);
+            }
+            memcpy(chunk.get() + inChunk, data, bytes);
+        }
+        offset += bytes;
+        data += bytes;
+        size -= bytes;
+    }
+}
+
+void TimeshiftBuffer::readBytes(uint64_t offset, uint8_t* data,
+                                size_t size) const {
+    while (size > 0) {
+        uint64_t position = offset % mCapacity;
+        size_t bytes = static_cast<size_t>(
+            std::min<uint64_t>(size, mCapacity - position));
+        if (mFd >= 0) {
+            if (pread(mFd, data, bytes, static_cast<off_t>(position)) < 0) {
+                memset(data, 0, size);
+                return;
+            }
+        } else {
+            uint64_t inChunk = position % MEMORY_CHUNK_SIZE;
+            bytes = static_cast<size_t>(
+                std::min<uint64_t>(bytes, MEMORY_CHUNK_SIZE - inChunk));
+            memcpy(data, mChunks[position / MEMORY_CHUNK_SIZE].get() + inChunk,
+                   bytes);
+        }
+        offset += bytes;
+        data += bytes;
+        size -= bytes;
+    }
+}
+
+}  // namespace yffplayer
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Logger.h"
+#include "PlayerTypes.h"
+
+extern "C" {
+struct AVPacket;
+}
+
+namespace yffplayer {
+
+// Bounded ring of demuxed live packets. Packets are appended at the live
+// edge in a compact record format, in memory or in a file, and read back
+// from a cursor that can be moved to any keyframe inside the window.
+class TimeshiftBuffer {
+   public:
+    TimeshiftBuffer(const TimeshiftConfig& config, int keyStreamIndex,
+                    std::shared_ptr<Logger> logger);
+    ~TimeshiftBuffer();
+
+    // Allocate the backing store
+    bool open();
+
+    // Append a packet with microsecond timestamps at the live edge
+    void append(const AVPacket* packet);
+
+    // Next packet at the read cursor, nullptr when caught up with the edge
+    AVPacket* read();
+
+    // Move the cursor to the last keyframe at or before positionUs,
+    // false if the position is outside the window
+    bool seek(int64_t positionUs);
+
+    // Window of keyframe positions that seek() accepts
+    bool getRange(int64_t& startUs, int64_t& endUs) const;
+
+   private:
+    // Fixed-size header written before each packet payload
+    struct RecordHeader {
+        int64_t pts;
+        int64_t dts;
+        int64_t duration;
+        int32_t size;
+        int32_t streamIndex;
+        int32_t flags;
+        int32_t reserved;
+    };
+
+    struct Record {
+        uint64_t offset;  // Logical byte offset of the header
+        uint32_t length;  // Header plus payload
+    };
+
+    struct Keyframe {
+        int64_t pts;
+        uint64_t sequence;
+    };
+
+    void evict(uint64_t bytesNeeded, int64_t newestPts);
+    void writeBytes(uint64_t offset, const uint8_t* data, size_t size);
+    void readBytes(uint64_t offset, uint8_t* data, size_t size) const;
+
+    TimeshiftConfig mConfig;
+    int mKeyStreamIndex;
+    std::shared_ptr<Logger> mLogger;
+    uint64_t mCapacity;
+
+    mutable std::mutex mMutex;
+
+    // Backing store: memory chunks allocated on first write, or a file
+    std::vector<std::unique_ptr<uint8_t[]>> mChunks;
+    int mFd{-1};
+
+    // Logical byte range [mTailOffset, mWriteOffset) holds live records
+    uint64_t mTailOffset{0};
+    uint64_t mWriteOffset{0};
+
+    // Records by sequence number, front is mFirstSequence
+    std::deque<Record> mRecords;
+    uint64_t mFirstSequence{0};
+    uint64_t mReadSequence{0};
+    std::deque<Keyframe> mKeyframes;
+};
+
+}  // namespace yffplayer
@@ -0,0 +1,193 @@
+#include "Tracer.h"
+
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+
+namespace yffplayer {
+
+// 每个线程的环形缓冲区记录数，写满后覆盖最旧的记录
+constexpr size_t THREAD_BUFFER_RECORDS = 64 * 1024;
+
+// 保留的已退出线程缓冲区个数，超出后新线程复用其中最早的一个
+constexpr size_t MAX_EXITED_BUFFERS = 8;
+
+static const char* eventName(TraceEvent event) {
+    switch (event) {
+        case TraceEvent::DEMUX_READ:
+            return "demux-read";
+        case TraceEvent::SEND_PACKET:
+            return "send_packet";
+        case TraceEvent::RECEIVE_FRAME:
+            return "receive_frame";
+        case TraceEvent::CONVERT:
+            return "convert";
+        case TraceEvent::ENQUEUE:
+            return "enqueue";
+        case TraceEvent::DEQUEUE:
+            return "dequeue";
+        case TraceEvent::PRESENT:
+            return "present";
+        case TraceEvent::AUDIO_CALLBACK:
+            return "audio-callback";
+    }
+    return "unknown";
+}
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::setEnabled(bool enabled) {
+    mEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+int64_t Tracer::now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+Tracer::ThreadBuffer* Tracer::threadBuffer() {
+    // 线程退出时标记缓冲区已失效，之后可被回收
+    struct Owner {
+        std::shared_ptr<ThreadBuffer> buffer;
+        ~Owner() {
+            if (buffer) {
+                buffer->alive.store(false, std::memory_order_release);
+            }
+        }
+    };
+    thread_local Owner owner;
+    if (owner.buffer) {
+        return owner.buffer.get();
+    }
+
+    // 每个线程首次记录时注册一次，之后写入不再加锁
+    static std::atomic<int> nextThreadId{1};
+    int threadId = nextThreadId++;
+    char name[64] = {0};
+    std::string threadName;
+    if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0 &&
+        name[0]) {
+        threadName = name;
+    } else {
+        threadName = "thread-" + std::to_string(threadId);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::shared_ptr<ThreadBuffer> buffer;
+    size_t exited = 0;
+    for (const auto& candidate : mBuffers) {
+        if (!candidate->alive.load(std::memory_order_acquire)) {
+            exited++;
+        }
+    }
+    if (exited >= MAX_EXITED_BUFFERS) {
+        // 复用最早退出的线程的缓冲区，不再分配新的内存
+        for (auto it = mBuffers.begin(); it != mBuffers.end(); ++it) {
+            if (!(*it)->alive.load(std::memory_order_acquire)) {
+                buffer = *it;
+                mBuffers.erase(it);
+                break;
+            }
+        }
+        buffer->writeIndex.store(0, std::memory_order_relaxed);
+        buffer->beginIndex.store(0, std::memory_order_relaxed);
+        buffer->alive.store(true, std::memory_order_relaxed);
+    } else {
+        buffer = std::make_shared<ThreadBuffer>();
+        buffer->records.resize(THREAD_BUFFER_RECORDS);
+    }
+    buffer->threadId = threadId;
+    buffer->threadName = threadName;
+    mBuffers.push_back(buffer);
+    owner.buffer = buffer;
+    return buffer.get();
+}
+
+void Tracer::record(TraceEvent event, int64_t startNs, int64_t endNs,
+                    int64_t id) {
+    ThreadBuffer* buffer = threadBuffer();
+    uint64_t index = buffer->writeIndex.load(std::memory_order_relaxed);
+    Record& record = buffer->records[index % THREAD_BUFFER_RECORDS];
+    record.startNs = startNs;
+    record.durationNs = endNs - startNs;
+    record.id = id;
+    record.event = event;
+    buffer->writeIndex.store(index + 1, std::memory_order_release);
+}
+
+bool Tracer::writeChromeTrace(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        buffers = mBuffers;
+    }
+
+    int pid = static_cast<int>(getpid());
+    fprintf(file, "{\"traceEvents\":[\n");
+    const char* separator = "";
+    for (const auto& buffer : buffers) {
+        fprintf(file,
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+                "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                separator, pid, buffer->threadId, buffer->threadName.c_str());
+        separator = ",\n";
+
+        uint64_t end = buffer->writeIndex.load(std::memory_order_acquire);
+        uint64_t begin =
+            end > THREAD_BUFFER_RECORDS ? end - THREAD_BUFFER_RECORDS : 0;
+        begin = std::max(
+            begin, buffer->beginIndex.load(std::memory_order_relaxed));
+        for (uint64_t i = begin; i < end; i++) {
+            const Record& record = buffer->records[i % THREAD_BUFFER_RECORDS];
+            // 时长为0的记录导出为瞬时事件
+            if (record.durationNs > 0) {
+                fprintf(file,
+                        "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,"
+                        "\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                        "\"args\":{\"id\":%lld}}",
+                        separator, eventName(record.event), pid,
+                        buffer->threadId, record.startNs / 1000.0,
+                        record.durationNs / 1000.0, (long long)record.id);
+            } else {
+                fprintf(file,
+                        "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\","
+                        "\"pid\":%d,\"tid\":%d,\"ts\":%.3f,"
+                        "\"args\":{\"id\":%lld}}",
+                        separator, eventName(record.event), pid,
+                        buffer->threadId, record.startNs / 1000.0,
+                        (long long)record.id);
+            }
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    return fclose(file) == 0;
+}
+
+void Tracer::clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    // 已退出线程的缓冲区直接释放；运行中的线程仍在写入，只移动导出起点
+    std::vector<std::shared_ptr<ThreadBuffer>> alive;
+    for (const auto& buffer : mBuffers) {
+        if (buffer->alive.load(std::memory_order_acquire)) {
+            buffer->beginIndex.store(
+                buffer->writeIndex.load(std::memory_order_acquire),
+                std::memory_order_relaxed);
+            alive.push_back(buffer);
+        }
+    }
+    mBuffers.swap(alive);
+}
+
+}  // namespace yffplayer
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace yffplayer {
+
+// Pipeline stages recorded per packet or frame; the id is the pts in
+// microseconds so one frame can be followed from demuxing to presentation
+enum class TraceEvent : uint8_t {
+    DEMUX_READ,
+    SEND_PACKET,
+    RECEIVE_FRAME,
+    CONVERT,
+    ENQUEUE,
+    DEQUEUE,
+    PRESENT,
+    AUDIO_CALLBACK,
+};
+
+// Process-wide tracer. Each thread appends to its own ring of fixed-size
+// records without locks; the rings are merged when the trace is written.
+// Instrumentation compiles to nothing unless YFF_TRACING is defined, and
+// costs one relaxed load while tracing is disabled at runtime.
+class Tracer {
+   public:
+    static Tracer& instance();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+    // Record a span on the calling thread, timestamps from now()
+    void record(TraceEvent event, int64_t startNs, int64_t endNs, int64_t id);
+
+    // Write the recorded events as Chrome trace JSON, which Perfetto and
+    // chrome://tracing load. Best called while the pipeline is idle; events
+    // recorded during the write may be torn or missing.
+    bool writeChromeTrace(const std::string& path);
+
+    // Drop all recorded events and the buffers of exited threads
+    void clear();
+
+    static int64_t now();
+
+   private:
+    struct Record {
+        int64_t startNs;
+        int64_t durationNs;
+        int64_t id;
+        TraceEvent event;
+    };
+
+    struct ThreadBuffer {
+        std::vector<Record> records;
+        // Written only by the owning thread; clear() moves beginIndex
+        // instead so it never races with a write
+        std::atomic<uint64_t> writeIndex{0};
+        std::atomic<uint64_t> beginIndex{0};
+        // Cleared by the thread_local owner when its thread exits
+        std::atomic<bool> alive{true};
+        int threadId{0};
+        std::string threadName;
+    };
+
+    Tracer() = default;
+    ThreadBuffer* threadBuffer();
+
+    std::atomic<bool> mEnabled{false};
+    std::mutex mMutex;
+    // Buffers in registration order. Those of exited threads are kept
+    // for the next trace up to a limit, then reused by new threads.
+    std::vector<std::shared_ptr<ThreadBuffer>> mBuffers;
+};
+
+#ifdef YFF_TRACING
+
+// Guards work done only to compute trace ids
+constexpr bool kTracingCompiled = true;
+
+// Records the enclosing scope as a span
+class TraceSpan {
+   public:
+    explicit TraceSpan(TraceEvent event, int64_t id = -1)
+        : mEvent(event),
+          mId(id),
+          mStartNs(Tracer::instance().isEnabled() ? Tracer::now() : -1) {}
+
+    ~TraceSpan() {
+        if (mStartNs >= 0) {
+            Tracer::instance().record(mEvent, mStartNs, Tracer::now(), mId);
+        }
+    }
+
+    // The id is often known only after the traced call, e.g. a read
+    void setId(int64_t id) { mId = id; }
+
+   private:
+    TraceEvent mEvent;
+    int64_t mId;
+    int64_t mStartNs;
+};
+
+inline void traceInstant(TraceEvent event, int64_t id) {
+    Tracer& tracer = Tracer::instance();
+    if (tracer.isEnabled()) {
+        int64_t now = Tracer::now();
+        tracer.record(event, now, now, id);
+    }
+}
+
+#else
+
+constexpr bool kTracingCompiled = false;
+
+class TraceSpan {
+   public:
+    explicit TraceSpan(TraceEvent, int64_t = -1) {}
+    void setId(int64_t) {}
+};
+
+inline void traceInstant(TraceEvent, int64_t) {}
+
+#endif
+
+}  // namespace yffplayer
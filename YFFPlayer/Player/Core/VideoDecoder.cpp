@@ -1,8 +1,14 @@
 #include "VideoDecoder.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <mutex>
 #include <thread>
 
+#include "ThreadUtil.h"
+#include "Tracer.h"
+
 // 假设使用FFmpeg库
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -13,6 +19,45 @@ extern "C" {
 
 namespace yffplayer {
 
+// 自动选择线程数时每个解码线程分担的像素数，约为720p的一半
+constexpr int64_t PIXELS_PER_CODEC_THREAD = 460800;
+
+// 自动选择的解码线程数上限，再多时帧级多线程只增加延迟和内存
+constexpr int MAX_CODEC_THREADS = 8;
+
+// 串行化需要统计工作线程的视频解码器的打开。工作线程自行改名后无法
+// 按名称区分，并发打开时各自的线程列表差集会包含对方的线程；不统计或
+// 单线程解码的打开不创建需要找出的线程，不经过这把锁
+static std::mutex sCodecOpenMutex;
+
+// 打开解码器期间新建的解码工作线程：名称继承自调用线程，
+// FFmpeg 6.1 起工作线程自行命名为 "av:..."。调用时须持有 sCodecOpenMutex
+static std::vector<int> findCodecThreads(const std::vector<int>& before,
+                                         const std::string& inheritedName) {
+    std::vector<int> found;
+    for (int id : listThreadIds()) {
+        if (std::find(before.begin(), before.end(), id) != before.end()) {
+            continue;
+        }
+        std::string name = getThreadName(id);
+        if (name == inheritedName || name.compare(0, 3, "av:") == 0) {
+            setThreadName(id, "yff-vcodec");
+            found.push_back(id);
+        }
+    }
+    return found;
+}
+
+// 释放未送出的帧的图像平面，帧本身由shared_ptr回收
+static void freeFramePlanes(std::shared_ptr<VideoFrame>& frame) {
+    for (int i = 0; i < 3; i++) {
+        if (frame->data[i]) {
+            av_free(frame->data[i]);
+            frame->data[i] = nullptr;
+        }
+    }
+}
+
 VideoDecoder::VideoDecoder(
     std::shared_ptr<BufferQueue<AVPacket*>> packetBuffer,
     std::shared_ptr<BufferQueue<std::shared_ptr<VideoFrame>>> frameBuffer,
@@ -28,28 +73,60 @@ bool VideoDecoder::open(AVCodecParameters* codecParam) {
     // 查找解码器
     const AVCodec* decoder = avcodec_find_decoder(codecParam->codec_id);
     if (!decoder) {
-        mLogger->log(LogLevel::Error, "AudioDecoder",
-                     "找不到解码器: " + std::to_string(codecParam->codec_id));
+        YFF_LOG(mLogger, LogLevel::Error, "AudioDecoder", "找不到解码器: %d",
+                static_cast<int>(codecParam->codec_id));
         return false;
     }
 
     // 创建解码上下文
     mCodecContext = avcodec_alloc_context3(decoder);
     if (!mCodecContext) {
-        mLogger->log(LogLevel::Error, "VideoDecoder", "无法创建解码上下文");
+        YFF_LOG(mLogger, LogLevel::Error, "VideoDecoder", "无法创建解码上下文");
         return false;
     }
 
     if (avcodec_parameters_to_context((AVCodecContext*)mCodecContext,
                                       codecParam) < 0) {
-        mLogger->log(LogLevel::Error, "VideoDecoder", "无法设置解码器参数");
+        YFF_LOG(mLogger, LogLevel::Error, "VideoDecoder", "无法设置解码器参数");
         avcodec_free_context((AVCodecContext**)&mCodecContext);
         return false;
     }
-    ((AVCodecContext*)mCodecContext)->thread_count = 4;  // 设置线程数
-    // 打开解码器
-    if (avcodec_open2((AVCodecContext*)mCodecContext, decoder, nullptr) < 0) {
-        mLogger->log(LogLevel::Error, "VideoDecoder", "无法打开解码器");
+    int threads = mThreadCount;
+    if (threads <= 0) {
+        threads = chooseThreadCount(codecParam->width, codecParam->height);
+    }
+    ((AVCodecContext*)mCodecContext)->thread_count = threads;
+    if (mLowDelay) {
+        // 低延迟：帧级多线程会缓存多帧，改用片级多线程
+        ((AVCodecContext*)mCodecContext)->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        ((AVCodecContext*)mCodecContext)->thread_type = FF_THREAD_SLICE;
+    }
+    // 解复用器输出的数据包时间戳统一为微秒
+    ((AVCodecContext*)mCodecContext)->pkt_timebase = AV_TIME_BASE_Q;
+    // 打开解码器。需要统计时工作线程在此创建，打开期间调用线程临时使用
+    // 唯一名称，以便找出这些线程并将其 CPU 时间计入视频解码
+    int ret = 0;
+    mCodecThreadIds.clear();
+    if (mStats && threads > 1) {
+        static std::atomic<int> openCount{0};
+        std::lock_guard<std::mutex> openLock(sCodecOpenMutex);
+        std::vector<int> threadsBefore = listThreadIds();
+        std::string callerName = getCurrentThreadName();
+        std::string openName =
+            "yff-vopen-" + std::to_string(openCount++ % 100000);
+        if (!threadsBefore.empty()) {
+            setCurrentThreadName(openName);
+        }
+        ret = avcodec_open2((AVCodecContext*)mCodecContext, decoder, nullptr);
+        if (!threadsBefore.empty()) {
+            setCurrentThreadName(callerName);
+            mCodecThreadIds = findCodecThreads(threadsBefore, openName);
+        }
+    } else {
+        ret = avcodec_open2((AVCodecContext*)mCodecContext, decoder, nullptr);
+    }
+    if (ret < 0) {
+        YFF_LOG(mLogger, LogLevel::Error, "VideoDecoder", "无法打开解码器");
         avcodec_free_context((AVCodecContext**)&mCodecContext);
         return false;
     }
@@ -57,18 +134,51 @@ bool VideoDecoder::open(AVCodecParameters* codecParam) {
     // 创建图像转换上下文
     mSwsContext = nullptr;  // 将在第一帧时初始化
 
-    mLogger->log(LogLevel::Info, "VideoDecoder", "视频解码器初始化成功");
+    YFF_LOG(mLogger, LogLevel::Info, "VideoDecoder", "视频解码器初始化成功");
     return true;
 }
 
+int VideoDecoder::chooseThreadCount(int width, int height) const {
+    // 按分辨率估算：标清单线程足够，4K 需要多个线程才能实时解码
+    int64_t pixels = static_cast<int64_t>(width) * height;
+    int threads = static_cast<int>(std::clamp<int64_t>(
+        pixels / PIXELS_PER_CODEC_THREAD, 1, MAX_CODEC_THREADS));
+
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    if (cores > 0) {
+        threads = std::min(threads, cores);
+    }
+
+    // 在执行器上运行时执行器的线程已占满多个核心，解码线程只使用剩余的核心，
+    // 否则与其他播放器的任务争抢
+    std::shared_ptr<TaskGroup> group = mRunner.getTaskGroup();
+    if (group && cores > 0) {
+        int spare = cores - group->getExecutor()->getThreadCount();
+        threads = std::max(1, std::min(threads, spare));
+    }
+    return threads;
+}
+
 void VideoDecoder::start() {
     if (mIsRunning) {
         return;
     }
 
     mIsRunning = true;
-    mDecodeThread = std::thread(&VideoDecoder::decodeLoop, this);
-    mLogger->log(LogLevel::Info, "VideoDecoder", "视频解码线程已启动");
+    mFrame = av_frame_alloc();
+    mDecodeLoop = decodeLoop();
+    // 跳转后放弃等待，旧代号的帧不再送出
+    mDecodeLoop.setInterrupt(
+        [this]() { return currentGeneration() != mDecodeGeneration; });
+    if (mRunner.hasTaskGroup()) {
+        // 在执行器上运行时由队列唤醒：有新数据包，或帧队列腾出空间
+        mPacketBuffer->setPushListener([this]() { mRunner.wake(); });
+        mFrameBuffer->setPopListener([this]() { mRunner.wake(); });
+    }
+    mRunner.start(
+        "yff-vdec", [this]() { return mDecodeLoop.step(); }, mStats,
+        PipelineStats::Stage::VIDEO_DECODE, mCodecThreadIds);
+    YFF_LOG(mLogger, LogLevel::Info, "VideoDecoder", "视频解码线程已启动");
 }
 
 void VideoDecoder::stop() {
@@ -77,10 +187,12 @@ void VideoDecoder::stop() {
     }
 
     mIsRunning = false;
-    if (mDecodeThread.joinable()) {
-        mDecodeThread.join();
-    }
-    mLogger->log(LogLevel::Info, "VideoDecoder", "视频解码线程已停止");
+    mRunner.stop();
+    mDecodeLoop = CoStage();
+    mPacketBuffer->setPushListener(nullptr);
+    mFrameBuffer->setPopListener(nullptr);
+    av_frame_free(&mFrame);
+    YFF_LOG(mLogger, LogLevel::Info, "VideoDecoder", "视频解码线程已停止");
 }
 
 void VideoDecoder::close() {
@@ -92,12 +204,12 @@ void VideoDecoder::close() {
     }
 
     if (mCodecContext) {
-        avcodec_close((AVCodecContext*)mCodecContext);
         avcodec_free_context((AVCodecContext**)&mCodecContext);
         mCodecContext = nullptr;
     }
+    mCodecThreadIds.clear();
 
-    mLogger->log(LogLevel::Info, "VideoDecoder", "视频解码器已关闭");
+    YFF_LOG(mLogger, LogLevel::Info, "VideoDecoder", "视频解码器已关闭");
 }
 
 int64_t VideoDecoder::timestampToMicroseconds(int64_t timestamp,
@@ -149,50 +261,26 @@ bool VideoDecoder::convertFrame(AVFrame* srcFrame,
         dstFrame->format = PixelFormat::RGB24;
     }
 
-    // 如果源格式是我们支持的格式之一，可以直接复制数据而不需要转换
+    // 如果源格式是我们支持的格式之一，可以直接复制数据而不需要转换。
+    // 按行跨度整块复制平面，与复制过去的 linesize 一致
     if (srcFormat == dstFormat) {
-        // 分配内存并复制数据
-        if (dstFormat == AV_PIX_FMT_RGB24) {
-            int bufferSize = srcFrame->width * srcFrame->height * 3;
-            dstFrame->data[0] = (uint8_t*)av_malloc(bufferSize);
-            dstFrame->linesize[0] = srcFrame->linesize[0];
-            memcpy(dstFrame->data[0], srcFrame->data[0], bufferSize);
-            dstFrame->data[1] = nullptr;
-            dstFrame->data[2] = nullptr;
-            dstFrame->linesize[1] = 0;
-            dstFrame->linesize[2] = 0;
-        } else if (dstFormat == AV_PIX_FMT_YUV420P) {
-            // Y平面
-            int ySize = srcFrame->width * srcFrame->height;
-            dstFrame->data[0] = (uint8_t*)av_malloc(ySize);
-            dstFrame->linesize[0] = srcFrame->linesize[0];
-            memcpy(dstFrame->data[0], srcFrame->data[0], ySize);
-
-            // U平面
-            int uvSize = srcFrame->width * srcFrame->height / 4;
-            dstFrame->data[1] = (uint8_t*)av_malloc(uvSize);
-            dstFrame->linesize[1] = srcFrame->linesize[1];
-            memcpy(dstFrame->data[1], srcFrame->data[1], uvSize);
-
-            // V平面
-            dstFrame->data[2] = (uint8_t*)av_malloc(uvSize);
-            dstFrame->linesize[2] = srcFrame->linesize[2];
-            memcpy(dstFrame->data[2], srcFrame->data[2], uvSize);
+        int planeHeights[3] = {srcFrame->height, 0, 0};
+        if (dstFormat == AV_PIX_FMT_YUV420P) {
+            planeHeights[1] = (srcFrame->height + 1) / 2;
+            planeHeights[2] = (srcFrame->height + 1) / 2;
         } else if (dstFormat == AV_PIX_FMT_NV12) {
-            // Y平面
-            int ySize = srcFrame->width * srcFrame->height;
-            dstFrame->data[0] = (uint8_t*)av_malloc(ySize);
-            dstFrame->linesize[0] = srcFrame->linesize[0];
-            memcpy(dstFrame->data[0], srcFrame->data[0], ySize);
-
-            // UV平面
-            int uvSize = srcFrame->width * srcFrame->height / 2;
-            dstFrame->data[1] = (uint8_t*)av_malloc(uvSize);
-            dstFrame->linesize[1] = srcFrame->linesize[1];
-            memcpy(dstFrame->data[1], srcFrame->data[1], uvSize);
-
-            dstFrame->data[2] = nullptr;
-            dstFrame->linesize[2] = 0;
+            planeHeights[1] = (srcFrame->height + 1) / 2;
+        }
+        for (int i = 0; i < 3; i++) {
+            dstFrame->data[i] = nullptr;
+            dstFrame->linesize[i] = 0;
+            if (planeHeights[i] == 0) {
+                continue;
+            }
+            int planeSize = srcFrame->linesize[i] * planeHeights[i];
+            dstFrame->data[i] = (uint8_t*)av_malloc(planeSize);
+            dstFrame->linesize[i] = srcFrame->linesize[i];
+            memcpy(dstFrame->data[i], srcFrame->data[i], planeSize);
         }
 
         return true;
@@ -213,8 +301,8 @@ bool VideoDecoder::convertFrame(AVFrame* srcFrame,
                            SWS_BILINEAR, nullptr, nullptr, nullptr);
 
         if (!mSwsContext) {
-            mLogger->log(LogLevel::Error, "VideoDecoder",
-                         "无法创建图像转换上下文");
+            YFF_LOG(mLogger, LogLevel::Error, "VideoDecoder",
+                    "无法创建图像转换上下文");
             return false;
         }
 
@@ -267,7 +355,7 @@ bool VideoDecoder::convertFrame(AVFrame* srcFrame,
                   srcFrame->height, dstFrame->data, dstFrame->linesize);
 
     if (ret <= 0) {
-        mLogger->log(LogLevel::Error, "VideoDecoder", "图像转换失败");
+        YFF_LOG(mLogger, LogLevel::Error, "VideoDecoder", "图像转换失败");
         // 释放已分配的内存
         for (int i = 0; i < 3; i++) {
             if (dstFrame->data[i]) {
@@ -281,61 +369,102 @@ bool VideoDecoder::convertFrame(AVFrame* srcFrame,
     return true;
 }
 
-void VideoDecoder::decodeLoop() {
+void VideoDecoder::flushCodec() {
+    if (mCodecContext) {
+        avcodec_flush_buffers((AVCodecContext*)mCodecContext);
+    }
+}
+
+CoStage VideoDecoder::decodeLoop() {
     AVCodecContext* ctx = (AVCodecContext*)mCodecContext;
-    AVPacket* avPacket = nullptr;
-    AVFrame* avFrame = av_frame_alloc();
 
-    while (mIsRunning) {
+    while (true) {
+        bool failed = false;
         try {
-            // 首先检查输出帧缓冲区是否已满
-            if (mFrameBuffer->full()) {
-                // 如果缓冲区已满，睡眠一段时间后继续
-                av_usleep(10000);  // 10毫秒 = 10000微秒
+            // 跳转后即使没有新数据包也先清空解码器
+            syncGeneration(currentGeneration());
+
+            // 从缓冲区获取数据包，缓冲区为空时挂起等待新的数据包
+            std::optional<AVPacket*> popped = co_await queuePop(
+                *mPacketBuffer, mStats, PipelineStats::Queue::VIDEO_PACKETS);
+            AVPacket* packet = popped.value_or(nullptr);
+            if (!packet) {
                 continue;
             }
 
-            // 尝试从缓冲区获取数据包
-            if (!mPacketBuffer->tryPop(avPacket) || !avPacket) {
-                // 如果缓冲区为空，睡眠一段时间后继续
-                av_usleep(10000);  // 10毫秒 = 10000微秒
+            // 丢弃跳转前读出的数据包；新代号的第一个数据包前清空解码器
+            uint32_t generation = packetGeneration(packet);
+            if (generation != currentGeneration()) {
+                if (mStats) {
+                    mStats->addStale(PipelineStats::Queue::VIDEO_PACKETS);
+                }
+                av_packet_free(&packet);
                 continue;
             }
+            syncGeneration(generation);
 
-            // 发送数据包到解码器
-            int ret = avcodec_send_packet(ctx, avPacket);
+            traceInstant(TraceEvent::DEQUEUE, packet->pts);
+
+            // 发送数据包到解码器，发送后即释放数据包
+            // 解码耗时包括发送数据包和接收该包产生的所有帧
+            int ret = 0;
+            int64_t decodeStartTime = av_gettime_relative();
+            {
+                TraceSpan span(TraceEvent::SEND_PACKET, packet->pts);
+                ret = avcodec_send_packet(ctx, packet);
+            }
+            int64_t decodeUs = av_gettime_relative() - decodeStartTime;
+            av_packet_free(&packet);
             if (ret < 0) {
-                mLogger->log(LogLevel::Error, "VideoDecoder",
-                             "发送数据包到解码器失败");
+                YFF_LOG(mLogger, LogLevel::Error, "VideoDecoder",
+                        "发送数据包到解码器失败");
+                co_await stageYield();
                 continue;
             }
 
             // 接收解码后的帧
-            while (ret >= 0 && !mFrameBuffer->full()) {
-                ret = avcodec_receive_frame(ctx, avFrame);
+            while (ret >= 0) {
+                int64_t receiveStartTime = av_gettime_relative();
+                {
+                    TraceSpan span(TraceEvent::RECEIVE_FRAME);
+                    ret = avcodec_receive_frame(ctx, mFrame);
+                    if (ret >= 0) {
+                        span.setId(mFrame->pts);
+                    }
+                }
+                decodeUs += av_gettime_relative() - receiveStartTime;
                 if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
                     break;
                 } else if (ret < 0) {
-                    mLogger->log(LogLevel::Error, "VideoDecoder",
-                                 "从解码器接收帧失败");
+                    YFF_LOG(mLogger, LogLevel::Error, "VideoDecoder",
+                            "从解码器接收帧失败");
                     break;
                 }
 
+                // 精确跳转：目标位置之前结束的帧只用作参考帧，不转换；
+                // 帧时长未知时只送出时间戳不早于目标的帧
+                if (mFrame->pts != AV_NOPTS_VALUE &&
+                    isBeforeStart(mFrame->pts,
+                                  std::max<int64_t>(mFrame->duration, 1))) {
+                    continue;
+                }
+
                 // 创建视频帧
                 std::shared_ptr<VideoFrame> videoFrame =
                     std::make_shared<VideoFrame>();
+                videoFrame->generation = mDecodeGeneration;
 
                 // 转换时间戳为微秒
                 videoFrame->pts = timestampToMicroseconds(
-                    avFrame->pts, ctx->time_base.num, ctx->time_base.den);
+                    mFrame->pts, ctx->pkt_timebase.num, ctx->pkt_timebase.den);
 
                 // 计算持续时间（微秒）
                 // 如果有帧率信息，使用帧率计算持续时间
-                if (avFrame->sample_aspect_ratio.num > 0 &&
-                    avFrame->sample_aspect_ratio.den > 0) {
+                if (mFrame->sample_aspect_ratio.num > 0 &&
+                    mFrame->sample_aspect_ratio.den > 0) {
                     videoFrame->duration = 1000000 *
-                                           avFrame->sample_aspect_ratio.den /
-                                           avFrame->sample_aspect_ratio.num;
+                                           mFrame->sample_aspect_ratio.den /
+                                           mFrame->sample_aspect_ratio.num;
                 } else if (ctx->framerate.num > 0 && ctx->framerate.den > 0) {
                     videoFrame->duration =
                         1000000 * ctx->framerate.den / ctx->framerate.num;
@@ -345,33 +474,53 @@ void VideoDecoder::decodeLoop() {
                 }
 
                 // 转换帧格式（如果需要）
-                if (!convertFrame(avFrame, videoFrame)) {
-                    mLogger->log(LogLevel::Error, "VideoDecoder",
-                                 "帧格式转换失败");
+                bool converted = false;
+                int64_t convertStartTime = av_gettime_relative();
+                {
+                    TraceSpan span(TraceEvent::CONVERT, videoFrame->pts);
+                    converted = convertFrame(mFrame, videoFrame);
+                }
+                if (mStats) {
+                    mStats->recordStage(
+                        PipelineStats::Stage::VIDEO_CONVERT,
+                        av_gettime_relative() - convertStartTime);
+                }
+                if (!converted) {
+                    YFF_LOG(mLogger, LogLevel::Error, "VideoDecoder",
+                            "帧格式转换失败");
                     continue;
                 }
 
-                // 尝试将帧放入缓冲区
-                if (!mFrameBuffer->tryPush(videoFrame)) {
-                    // 如果推送失败（缓冲区已满），释放资源
-                    for (int i = 0; i < 3; i++) {
-                        if (videoFrame->data[i]) {
-                            av_free(videoFrame->data[i]);
-                        }
+                // 将帧放入缓冲区，缓冲区已满时挂起等待帧被取走；
+                // 等待中停止解码时协程被销毁，由freeFramePlanes释放
+                if (co_await queuePush(*mFrameBuffer, videoFrame, mStats,
+                                       PipelineStats::Queue::VIDEO_FRAMES,
+                                       freeFramePlanes)) {
+                    traceInstant(TraceEvent::ENQUEUE, videoFrame->pts);
+                } else {
+                    // 等待被跳转中断，帧已过期，释放资源
+                    if (mStats) {
+                        mStats->addStale(PipelineStats::Queue::VIDEO_FRAMES);
                     }
-                    // 跳出循环，下一轮会先检查缓冲区是否已满
-                    break;
+                    freeFramePlanes(videoFrame);
                 }
             }
+            if (mStats) {
+                mStats->recordStage(PipelineStats::Stage::VIDEO_DECODE,
+                                    decodeUs);
+            }
         } catch (const std::exception& e) {
-            mLogger->log(LogLevel::Error, "VideoDecoder",
-                         std::string("解码循环异常: ") + e.what());
-            av_usleep(10000);  // 10毫秒 = 10000微秒
+            YFF_LOG(mLogger, LogLevel::Error, "VideoDecoder",
+                    "解码循环异常: %s", e.what());
+            failed = true;
         }
-    }
 
-    av_frame_free(&avFrame);
-    av_packet_free(&avPacket);
+        if (failed) {
+            co_await stageSleep(10000);  // 10毫秒 = 10000微秒
+        } else {
+            co_await stageYield();
+        }
+    }
 }
 
 }  // namespace yffplayer
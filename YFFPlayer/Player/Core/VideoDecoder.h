@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "BufferQueue.h"
 #include "Decoder.h"
 #include "Logger.h"
@@ -24,7 +26,15 @@ class VideoDecoder : public Decoder {
     void stop() override;
     void close() override;
 
+    // Codec worker threads, applies to the next open(). 0 chooses a count
+    // from the frame size, capped on an executor by the cores its threads
+    // leave idle.
+    void setThreadCount(int threads) { mThreadCount = threads; }
+
    private:
+    // Microbenchmarks call the conversion functions directly
+    friend struct DecoderBenchAccess;
+
     std::shared_ptr<BufferQueue<AVPacket*>> mPacketBuffer;
     std::shared_ptr<BufferQueue<std::shared_ptr<VideoFrame>>> mFrameBuffer;
 
@@ -34,6 +44,15 @@ class VideoDecoder : public Decoder {
     // Decoding context
     void* mCodecContext{nullptr};
 
+    // Codec worker threads started by avcodec_open2, kernel thread ids;
+    // only looked up when stats are set
+    std::vector<int> mCodecThreadIds;
+
+    std::atomic<int> mThreadCount{0};
+
+    // Thread count for a frame of width x height when mThreadCount is 0
+    int chooseThreadCount(int width, int height) const;
+
     // Parameters from last conversion, used to optimize SwsContext creation
     int mLastSrcFormat{-1};
     int mLastDstFormat{-1};
@@ -50,7 +69,11 @@ class VideoDecoder : public Decoder {
     // Convert frame format
     bool convertFrame(AVFrame* srcFrame, std::shared_ptr<VideoFrame> dstFrame);
 
-    void decodeLoop() override;
+    // Receives every decoded frame
+    AVFrame* mFrame{nullptr};
+
+    CoStage decodeLoop() override;
+    void flushCodec() override;
 };
 
 }  // namespace yffplayer
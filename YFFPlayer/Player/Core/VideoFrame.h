@@ -14,6 +14,7 @@ struct VideoFrame {
     int64_t pts;         // Timestamp
     int64_t duration;    // Duration
     PixelFormat format;  // Pixel format
+    uint32_t generation;  // Seek generation, see SeekGeneration.h
 };
 
 }  // namespace yffplayer
@@ -0,0 +1,125 @@
+#include "NullAudioRenderer.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "ThreadUtil.h"
+
+namespace yffplayer {
+
+NullAudioRenderer::NullAudioRenderer(bool realtime) : mRealtime(realtime) {}
+
+NullAudioRenderer::~NullAudioRenderer() { release(); }
+
+bool NullAudioRenderer::init(int sampleRate, int channels, int bitsPerSample,
+                             std::shared_ptr<RendererCallback> callback) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCallback = callback;
+    mPlaying = true;
+    // 重复初始化时沿用已有的渲染线程
+    if (!mRunning) {
+        mRunning = true;
+        mRenderThread = std::thread(&NullAudioRenderer::renderLoop, this);
+    }
+    return true;
+}
+
+bool NullAudioRenderer::play(const AudioFrame& frame) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mRunning) {
+            return false;
+        }
+        // 只保留时间信息，采样数据由调用方持有
+        AudioFrame timing = frame;
+        timing.data = nullptr;
+        mFrames.push_back(timing);
+        mPlaying = true;
+    }
+    mFrameCond.notify_one();
+    return true;
+}
+
+void NullAudioRenderer::pause() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPlaying = false;
+}
+
+void NullAudioRenderer::resume() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPlaying = true;
+    }
+    mFrameCond.notify_one();
+}
+
+void NullAudioRenderer::stop() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPlaying = false;
+    mFrames.clear();
+}
+
+void NullAudioRenderer::setVolume(float volume) {
+    mVolume = std::clamp(volume, 0.0f, 1.0f);
+}
+
+float NullAudioRenderer::getVolume() const { return mVolume; }
+
+void NullAudioRenderer::setMute(bool mute) { mMuted = mute; }
+
+bool NullAudioRenderer::isMuted() const { return mMuted; }
+
+void NullAudioRenderer::release() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning = false;
+        mFrames.clear();
+    }
+    mFrameCond.notify_all();
+    if (mRenderThread.joinable()) {
+        mRenderThread.join();
+    }
+}
+
+void NullAudioRenderer::setRealtime(bool realtime) { mRealtime = realtime; }
+
+int64_t NullAudioRenderer::getFramesRendered() const {
+    return mFramesRendered;
+}
+
+void NullAudioRenderer::renderLoop() {
+    setCurrentThreadName("yff-null-audio");
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point deadline = Clock::now();
+
+    while (true) {
+        AudioFrame frame;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mFrameCond.wait(lock, [this] {
+                return !mRunning || (mPlaying && !mFrames.empty());
+            });
+            if (!mRunning) {
+                break;
+            }
+            frame = mFrames.front();
+            mFrames.pop_front();
+        }
+
+        // 实时模式模拟声卡按帧时长消耗数据，落后时不追赶
+        if (mRealtime) {
+            deadline = std::max(deadline, Clock::now()) +
+                       std::chrono::microseconds(frame.duration);
+            std::this_thread::sleep_until(deadline);
+        }
+
+        mFramesRendered++;
+        // 回调会同步送入下一帧，不能持有锁
+        auto callback = mCallback.lock();
+        if (callback) {
+            callback->onAudioFrameRendered(frame);
+        }
+    }
+}
+
+}  // namespace yffplayer
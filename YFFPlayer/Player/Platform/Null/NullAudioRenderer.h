@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "AudioFrame.h"
+#include "AudioRenderer.h"
+
+namespace yffplayer {
+
+// Audio renderer without an output device. Frames are consumed on a
+// worker thread, at their duration when realtime, otherwise immediately.
+class NullAudioRenderer : public AudioRenderer {
+   public:
+    explicit NullAudioRenderer(bool realtime = true);
+    ~NullAudioRenderer() override;
+
+    bool init(int sampleRate, int channels, int bitsPerSample,
+              std::shared_ptr<RendererCallback> callback) override;
+    bool play(const AudioFrame& frame) override;
+    void pause() override;
+    void resume() override;
+    void stop() override;
+    void setVolume(float volume) override;
+    float getVolume() const override;
+    void setMute(bool mute) override;
+    bool isMuted() const override;
+    void release() override;
+
+    // Pace frames by their duration or consume them immediately
+    void setRealtime(bool realtime);
+
+    int64_t getFramesRendered() const;
+
+   private:
+    void renderLoop();
+
+    std::weak_ptr<RendererCallback> mCallback;
+    std::atomic<bool> mRealtime;
+    std::atomic<float> mVolume{1.0f};
+    std::atomic<bool> mMuted{false};
+    std::atomic<int64_t> mFramesRendered{0};
+
+    std::mutex mMutex;
+    std::condition_variable mFrameCond;
+    // Frames without sample data, only timing is needed
+    std::deque<AudioFrame> mFrames;
+    bool mPlaying{false};
+    bool mRunning{false};
+    std::thread mRenderThread;
+};
+
+}  // namespace yffplayer
@@ -0,0 +1,26 @@
+#include "NullVideoRenderer.h"
+
+namespace yffplayer {
+
+bool NullVideoRenderer::init(int width, int height, PixelFormat format,
+                             std::shared_ptr<RendererCallback> callback) {
+    mCallback = callback;
+    return true;
+}
+
+bool NullVideoRenderer::render(const VideoFrame& frame) {
+    mFramesRendered++;
+    auto callback = mCallback.lock();
+    if (callback) {
+        callback->onVideoFrameRendered(frame);
+    }
+    return true;
+}
+
+void NullVideoRenderer::release() { mCallback.reset(); }
+
+int64_t NullVideoRenderer::getFramesRendered() const {
+    return mFramesRendered;
+}
+
+}  // namespace yffplayer
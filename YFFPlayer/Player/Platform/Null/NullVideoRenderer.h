@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "VideoFrame.h"
+#include "VideoRenderer.h"
+
+namespace yffplayer {
+
+// Video renderer without a display, counts frames and reports them as
+// presented
+class NullVideoRenderer : public VideoRenderer {
+   public:
+    NullVideoRenderer() = default;
+    ~NullVideoRenderer() override = default;
+
+    bool init(int width, int height, PixelFormat format,
+              std::shared_ptr<RendererCallback> callback) override;
+    bool render(const VideoFrame& frame) override;
+    void release() override;
+
+    int64_t getFramesRendered() const;
+
+   private:
+    std::weak_ptr<RendererCallback> mCallback;
+    std::atomic<int64_t> mFramesRendered{0};
+};
+
+}  // namespace yffplayer
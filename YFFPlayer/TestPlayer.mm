@@ -42,6 +42,10 @@ public:
     // 音频帧回调
     void onAudioFrame(AudioFrame& frame) override {
     }
+
+    // 首帧渲染回调
+    void onFirstFrameRendered(int64_t timeToFirstFrameUs) override {
+    }
 private:
     __weak TestPlayer *player;
 };
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace yffplayer {
+
+// HTTP/1.1 server on a loopback port, one thread per connection. It
+// serves one resource with Range, HEAD, ETag and Last-Modified, optionally
+// throttled, or an endless live body from a generator made for each
+// connection. Every response closes its connection.
+class LoopbackServer {
+   public:
+    // Appends the next piece of a live body, false ends it
+    using LiveGenerator = std::function<bool(std::string& chunk)>;
+    // Makes the generator of one live connection
+    using LiveSource = std::function<LiveGenerator()>;
+
+    ~LoopbackServer() { stop(); }
+
+    bool start() {
+        mListenFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (mListenFd < 0) {
+            return false;
+        }
+        int reuse = 1;
+        setsockopt(mListenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        socklen_t length = sizeof(address);
+        if (bind(mListenFd, (sockaddr*)&address, sizeof(address)) != 0 ||
+            listen(mListenFd, 16) != 0 ||
+            getsockname(mListenFd, (sockaddr*)&address, &length) != 0) {
+            return false;
+        }
+        mPort = ntohs(address.sin_port);
+        mRunning = true;
+        mAcceptThread = std::thread(&LoopbackServer::acceptLoop, this);
+        return true;
+    }
+
+    void stop() {
+        if (!mRunning.exchange(false)) {
+            return;
+        }
+        shutdown(mListenFd, SHUT_RDWR);
+        ::close(mListenFd);
+        mAcceptThread.join();
+        std::vector<std::thread> connections;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            connections.swap(mConnections);
+        }
+        for (std::thread& connection : connections) {
+            connection.join();
+        }
+    }
+
+    std::string url(const std::string& path) const {
+        return "http://127.0.0.1:" + std::to_string(mPort) + path;
+    }
+
+    void setResource(const std::string& body, const std::string& etag) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBody = body;
+        mEtag = etag;
+    }
+
+    // Body bytes per second, 0 sends as fast as the client reads
+    void setRate(int64_t bytesPerSecond) { mRate = bytesPerSecond; }
+
+    void setLiveSource(LiveSource source) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mLive = std::move(source);
+    }
+
+    // Body bytes written to sockets, the bytes on the wire
+    int64_t bodyBytesSent() const { return mBodyBytes; }
+    int64_t requests() const { return mRequests; }
+
+   private:
+    void acceptLoop() {
+        while (mRunning) {
+            int fd = accept(mListenFd, nullptr, nullptr);
+            if (fd < 0) {
+                continue;
+            }
+            // A small send buffer keeps the bytes a client never reads
+            // out of the count
+            int sendBuffer = 16 * 1024;
+            setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer,
+                       sizeof(sendBuffer));
+            std::lock_guard<std::mutex> lock(mMutex);
+            mConnections.emplace_back(&LoopbackServer::serve, this, fd);
+        }
+    }
+
+    bool sendAll(int fd, const char* data, size_t size, bool body) {
+        while (size > 0 && mRunning) {
+            ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+            if (sent <= 0) {
+                return false;
+            }
+            if (body) {
+                mBodyBytes += sent;
+            }
+            data += sent;
+            size -= sent;
+        }
+        return size == 0;
+    }
+
+    void serve(int fd) {
+        std::string request;
+        char buffer[4096];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                ::close(fd);
+                return;
+            }
+            request.append(buffer, received);
+        }
+        mRequests++;
+        bool head = request.compare(0, 5, "HEAD ") == 0;
+
+        std::string body;
+        std::string etag;
+        LiveSource liveSource;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            body = mBody;
+            etag = mEtag;
+            liveSource = mLive;
+        }
+
+        if (liveSource) {
+            LiveGenerator live = liveSource();
+            std::string header =
+                "HTTP/1.1 200 OK\r\nContent-Type: video/mp2t\r\n"
+                "Connection: close\r\n\r\n";
+            if (sendAll(fd, header.data(), header.size(), false) && !head) {
+                std::string chunk;
+                while (mRunning && live(chunk)) {
+                    if (!sendAll(fd, chunk.data(), chunk.size(), true)) {
+                        break;
+                    }
+                    chunk.clear();
+                }
+            }
+            ::close(fd);
+            return;
+        }
+
+        int64_t start = 0;
+        int64_t end = static_cast<int64_t>(body.size()) - 1;
+        bool partial = false;
+        size_t range = request.find("Range: bytes=");
+        if (range != std::string::npos) {
+            long long first = 0;
+            long long last = -1;
+            if (sscanf(request.c_str() + range, "Range: bytes=%lld-%lld",
+                       &first, &last) >= 1) {
+                start = first;
+                if (last >= first && last < end) {
+                    end = last;
+                }
+                partial = true;
+            }
+        }
+        if (start > end) {
+            std::string header =
+                "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes "
+                "*/" +
+                std::to_string(body.size()) +
+                "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            sendAll(fd, header.data(), header.size(), false);
+            ::close(fd);
+            return;
+        }
+
+        std::string header =
+            std::string(partial ? "HTTP/1.1 206 Partial Content\r\n"
+                                : "HTTP/1.1 200 OK\r\n") +
+            "Content-Type: application/octet-stream\r\n"
+            "Accept-Ranges: bytes\r\n"
+            "ETag: " + etag + "\r\n"
+            "Last-Modified: Sat, 17 Oct 2026 00:00:00 GMT\r\n"
+            "Content-Length: " + std::to_string(end - start + 1) + "\r\n";
+        if (partial) {
+            header += "Content-Range: bytes " + std::to_string(start) + "-" +
+                      std::to_string(end) + "/" +
+                      std::to_string(body.size()) + "\r\n";
+        }
+        header += "Connection: close\r\n\r\n";
+        if (!sendAll(fd, header.data(), header.size(), false) || head) {
+            ::close(fd);
+            return;
+        }
+
+        // Throttled bodies go out in 10 ms slices
+        auto begin = std::chrono::steady_clock::now();
+        int64_t position = start;
+        int64_t sent = 0;
+        while (position <= end && mRunning) {
+            int64_t slice = mRate > 0 ? std::max<int64_t>(mRate / 100, 1)
+                                      : 64 * 1024;
+            slice = std::min(slice, end - position + 1);
+            if (!sendAll(fd, body.data() + position, slice, true)) {
+                break;
+            }
+            position += slice;
+            sent += slice;
+            if (mRate > 0) {
+                std::this_thread::sleep_until(
+                    begin + std::chrono::microseconds(sent * 1000000 / mRate));
+            }
+        }
+        ::close(fd);
+    }
+
+    int mListenFd{-1};
+    int mPort{0};
+    std::atomic<bool> mRunning{false};
+    std::thread mAcceptThread;
+    std::atomic<int64_t> mRate{0};
+    std::atomic<int64_t> mBodyBytes{0};
+    std::atomic<int64_t> mRequests{0};
+
+    std::mutex mMutex;
+    std::vector<std::thread> mConnections;
+    std::string mBody;
+    std::string mEtag;
+    LiveSource mLive;
+};
+
+}  // namespace yffplayer
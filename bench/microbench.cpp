@@ -0,0 +1,398 @@
+// Microbenchmarks for the hot paths of the pipeline: BufferQueue under
+// contention, VideoDecoder::convertFrame, AudioDecoder::convertAudioFrame,
+// the PipelineStats counters, logging and the task executor.
+// Frames are generated in-process, no media files are needed.
+//
+//   yffmicrobench --benchmark_format=json --benchmark_out=result.json
+//
+// The JSON output of two commits can be compared with Google Benchmark's
+// tools/compare.py.
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+#include "AsyncLogger.h"
+#include "AudioDecoder.h"
+#include "BufferQueue.h"
+#include "Executor.h"
+#include "PipelineStats.h"
+#include "VideoDecoder.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/samplefmt.h>
+}
+
+namespace yffplayer {
+
+// Calls the private conversion functions of the decoders
+struct DecoderBenchAccess {
+    static bool convertFrame(VideoDecoder& decoder, AVFrame* frame,
+                             std::shared_ptr<VideoFrame> dstFrame) {
+        return decoder.convertFrame(frame, dstFrame);
+    }
+
+    static std::shared_ptr<AudioFrame> convertAudioFrame(AudioDecoder& decoder,
+                                                         AVFrame* frame) {
+        return decoder.convertAudioFrame(frame);
+    }
+
+    // PCM decoders only produce packed formats, planar input is simulated
+    static void setSampleFormat(AudioDecoder& decoder, AVSampleFormat format) {
+        decoder.mCodecContext->sample_fmt = format;
+    }
+};
+
+}  // namespace yffplayer
+
+using namespace yffplayer;
+
+namespace {
+
+using PacketQueue = BufferQueue<AVPacket*>;
+using VideoFrameQueue = BufferQueue<std::shared_ptr<VideoFrame>>;
+using AudioFrameQueue = BufferQueue<std::shared_ptr<AudioFrame>>;
+
+class NullLogger : public Logger {
+   public:
+    void log(LogLevel level, const std::string& tag,
+             const std::string& message) override {}
+};
+
+// Resolutions covered by the conversion benchmarks
+constexpr int kResolutions[][2] = {
+    {854, 480}, {1280, 720}, {1920, 1080}, {3840, 2160}};
+
+// Fixed non-zero pattern so conversions touch real data
+void fillFrame(AVFrame* frame) {
+    for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; i++) {
+        memset(frame->buf[i]->data, 0x40 + i * 0x20, frame->buf[i]->size);
+    }
+}
+
+AVFrame* makeVideoFrame(AVPixelFormat format, int width, int height) {
+    AVFrame* frame = av_frame_alloc();
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    av_frame_get_buffer(frame, 0);
+    fillFrame(frame);
+    return frame;
+}
+
+AVFrame* makeAudioFrame(AVSampleFormat format, int channels, int sampleRate,
+                        int samples) {
+    AVFrame* frame = av_frame_alloc();
+    frame->format = format;
+    frame->sample_rate = sampleRate;
+    frame->nb_samples = samples;
+    av_channel_layout_default(&frame->ch_layout, channels);
+    av_frame_get_buffer(frame, 0);
+    fillFrame(frame);
+    return frame;
+}
+
+void freeVideoFrame(VideoFrame& frame) {
+    for (int i = 0; i < 3; i++) {
+        av_freep(&frame.data[i]);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// BufferQueue
+
+void BM_BufferQueue_PushPop(benchmark::State& state) {
+    PacketQueue queue(100);
+    for (auto _ : state) {
+        queue.push(nullptr);
+        benchmark::DoNotOptimize(queue.pop());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BufferQueue_PushPop);
+
+void BM_BufferQueue_TryPushTryPop(benchmark::State& state) {
+    PacketQueue queue(100);
+    AVPacket* item = nullptr;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(queue.tryPush(nullptr));
+        benchmark::DoNotOptimize(queue.tryPop(item));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BufferQueue_TryPushTryPop);
+
+PacketQueue* gSharedQueue = nullptr;
+
+// Even threads produce and odd threads consume with blocking push/pop,
+// like the demuxer feeding a decoder
+void BM_BufferQueue_ProducerConsumer(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        gSharedQueue = new PacketQueue(state.range(0));
+    }
+    bool producer = state.thread_index() % 2 == 0;
+    for (auto _ : state) {
+        if (producer) {
+            gSharedQueue->push(nullptr);
+        } else {
+            benchmark::DoNotOptimize(gSharedQueue->pop());
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        delete gSharedQueue;
+        gSharedQueue = nullptr;
+    }
+}
+BENCHMARK(BM_BufferQueue_ProducerConsumer)
+    ->Arg(8)
+    ->Arg(100)
+    ->ThreadRange(2, 8)
+    ->UseRealTime();
+
+// Every thread alternates tryPush and tryPop on one queue; failures caused
+// by lock contention are reported as a rate
+void BM_BufferQueue_TryContended(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        gSharedQueue = new PacketQueue(100);
+    }
+    AVPacket* item = nullptr;
+    int64_t failures = 0;
+    for (auto _ : state) {
+        failures += !gSharedQueue->tryPush(nullptr);
+        failures += !gSharedQueue->tryPop(item);
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    state.counters["failures"] =
+        benchmark::Counter(failures, benchmark::Counter::kIsRate);
+    if (state.thread_index() == 0) {
+        delete gSharedQueue;
+        gSharedQueue = nullptr;
+    }
+}
+BENCHMARK(BM_BufferQueue_TryContended)->ThreadRange(1, 8)->UseRealTime();
+
+// ---------------------------------------------------------------------------
+// VideoDecoder::convertFrame
+
+// Args: source pixel format, resolution index
+void BM_ConvertFrame(benchmark::State& state) {
+    AVPixelFormat format = static_cast<AVPixelFormat>(state.range(0));
+    int width = kResolutions[state.range(1)][0];
+    int height = kResolutions[state.range(1)][1];
+
+    auto logger = std::make_shared<NullLogger>();
+    VideoDecoder decoder(std::make_shared<PacketQueue>(),
+                         std::make_shared<VideoFrameQueue>(), logger);
+    AVFrame* frame = makeVideoFrame(format, width, height);
+
+    for (auto _ : state) {
+        auto dstFrame = std::make_shared<VideoFrame>();
+        if (!DecoderBenchAccess::convertFrame(decoder, frame, dstFrame)) {
+            state.SkipWithError("convertFrame failed");
+            break;
+        }
+        freeVideoFrame(*dstFrame);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() *
+                            av_image_get_buffer_size(format, width, height, 1));
+    state.SetLabel(std::string(av_get_pix_fmt_name(format)) + " " +
+                   std::to_string(width) + "x" + std::to_string(height));
+    av_frame_free(&frame);
+}
+
+void convertFrameArgs(benchmark::internal::Benchmark* benchmark) {
+    // Copy paths (yuv420p, nv12) and swscale paths (10-bit, 4:2:2, bgra)
+    for (AVPixelFormat format :
+         {AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P10LE,
+          AV_PIX_FMT_YUV422P, AV_PIX_FMT_BGRA}) {
+        for (int resolution = 0; resolution < 4; resolution++) {
+            benchmark->Args({format, resolution});
+        }
+    }
+}
+BENCHMARK(BM_ConvertFrame)->Apply(convertFrameArgs);
+
+// ---------------------------------------------------------------------------
+// AudioDecoder::convertAudioFrame
+
+// Args: channels, sample rate, planar float (1) or packed s16 (0)
+void BM_ConvertAudioFrame(benchmark::State& state) {
+    int channels = static_cast<int>(state.range(0));
+    int sampleRate = static_cast<int>(state.range(1));
+    bool planar = state.range(2) != 0;
+    constexpr int kSamples = 1024;
+
+    // PCM decoder only provides an opened codec context for the conversion
+    AVCodecParameters* params = avcodec_parameters_alloc();
+    params->codec_type = AVMEDIA_TYPE_AUDIO;
+    params->codec_id = planar ? AV_CODEC_ID_PCM_F32LE : AV_CODEC_ID_PCM_S16LE;
+    params->sample_rate = sampleRate;
+    av_channel_layout_default(&params->ch_layout, channels);
+
+    auto logger = std::make_shared<NullLogger>();
+    AudioDecoder decoder(std::make_shared<PacketQueue>(),
+                         std::make_shared<AudioFrameQueue>(), logger);
+    if (!decoder.open(params)) {
+        state.SkipWithError("AudioDecoder::open failed");
+        avcodec_parameters_free(&params);
+        return;
+    }
+    AVSampleFormat format = planar ? AV_SAMPLE_FMT_FLTP : AV_SAMPLE_FMT_S16;
+    DecoderBenchAccess::setSampleFormat(decoder, format);
+    AVFrame* frame = makeAudioFrame(format, channels, sampleRate, kSamples);
+
+    for (auto _ : state) {
+        auto audioFrame = DecoderBenchAccess::convertAudioFrame(decoder, frame);
+        if (!audioFrame) {
+            state.SkipWithError("convertAudioFrame failed");
+            break;
+        }
+        av_free(audioFrame->data);
+    }
+    state.SetItemsProcessed(state.iterations() * kSamples);
+    state.SetLabel(std::to_string(channels) + "ch " +
+                   std::to_string(sampleRate) + "Hz " +
+                   av_get_sample_fmt_name(format));
+    av_frame_free(&frame);
+    avcodec_parameters_free(&params);
+}
+
+void convertAudioFrameArgs(benchmark::internal::Benchmark* benchmark) {
+    // Mono, stereo, 5.1 and 7.1 at the common input rates
+    for (int channels : {1, 2, 6, 8}) {
+        for (int sampleRate : {44100, 48000, 96000}) {
+            for (int planar : {0, 1}) {
+                benchmark->Args({channels, sampleRate, planar});
+            }
+        }
+    }
+}
+BENCHMARK(BM_ConvertAudioFrame)->Apply(convertAudioFrameArgs);
+
+// ---------------------------------------------------------------------------
+// PipelineStats
+
+PipelineStats* gSharedStats = nullptr;
+
+// Stage timing from every pipeline thread at once
+void BM_PipelineStats_RecordStage(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        gSharedStats = new PipelineStats();
+    }
+    auto stage = static_cast<PipelineStats::Stage>(
+        state.thread_index() % static_cast<int>(PipelineStats::Stage::COUNT));
+    int64_t timeUs = 1;
+    for (auto _ : state) {
+        gSharedStats->recordStage(stage, timeUs);
+        timeUs = (timeUs * 3) & 0xffff;
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        delete gSharedStats;
+        gSharedStats = nullptr;
+    }
+}
+BENCHMARK(BM_PipelineStats_RecordStage)->ThreadRange(1, 8)->UseRealTime();
+
+// Cost of one dashboard poll, without the queue sizes
+void BM_PipelineStats_Snapshot(benchmark::State& state) {
+    PipelineStats stats;
+    for (int i = 0; i < 10000; i++) {
+        stats.recordStage(PipelineStats::Stage::VIDEO_DECODE, i);
+    }
+    for (auto _ : state) {
+        PlayerStats snapshot;
+        stats.snapshot(snapshot);
+        benchmark::DoNotOptimize(snapshot);
+    }
+}
+BENCHMARK(BM_PipelineStats_Snapshot);
+
+// ---------------------------------------------------------------------------
+// Logging
+
+// Call site cost of a message below the enabled level
+void BM_Log_Disabled(benchmark::State& state) {
+    auto logger = std::make_shared<NullLogger>();
+    logger->setMinLevel(LogLevel::Info);
+    int64_t pts = 0;
+    for (auto _ : state) {
+        YFF_LOG(logger, LogLevel::Verbose, "Player", "frame %lld dropped",
+                static_cast<long long>(pts++));
+    }
+}
+BENCHMARK(BM_Log_Disabled);
+
+// Concatenation at the call site, as before YFF_LOG
+void BM_Log_StringConcat(benchmark::State& state) {
+    auto logger = std::make_shared<NullLogger>();
+    int64_t pts = 0;
+    for (auto _ : state) {
+        logger->log(LogLevel::Verbose, "Player",
+                    "播放器状态变更: " + std::to_string(pts) + " -> " +
+                        std::to_string(pts + 1));
+        pts++;
+    }
+}
+BENCHMARK(BM_Log_StringConcat);
+
+// Format into the thread-local buffer and queue without allocating;
+// messages the writer cannot keep up with are dropped, not waited for
+void BM_Log_Async(benchmark::State& state) {
+    static std::shared_ptr<AsyncLogger> logger;
+    if (state.thread_index() == 0) {
+        logger = std::make_shared<AsyncLogger>(
+            std::make_shared<NullLogger>(), 1024);
+    }
+    int64_t pts = 0;
+    for (auto _ : state) {
+        YFF_LOG(logger, LogLevel::Verbose, "Player",
+                "播放器状态变更: %lld -> %d", static_cast<long long>(pts++),
+                state.thread_index());
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        state.counters["dropped"] = static_cast<double>(
+            logger->getDroppedCount());
+        logger.reset();
+    }
+}
+BENCHMARK(BM_Log_Async)->ThreadRange(1, 8)->UseRealTime();
+
+// ---------------------------------------------------------------------------
+// Executor
+
+// Wake a parked task and spin until it ran: the hand-off a queue listener
+// adds between two stages on the executor. Arg: worker threads.
+void BM_Executor_WakeRoundTrip(benchmark::State& state) {
+    auto executor = std::make_shared<Executor>(state.range(0));
+    TaskGroup group(executor, TaskPriority::FOREGROUND);
+    std::atomic<int64_t> runs{0};
+    std::shared_ptr<Task> task = group.spawn([&runs]() {
+        runs.fetch_add(1, std::memory_order_release);
+        return TaskStep::idle();
+    });
+    while (runs.load(std::memory_order_acquire) == 0) {
+    }
+    for (auto _ : state) {
+        int64_t expected = runs.load(std::memory_order_acquire) + 1;
+        task->wake();
+        while (runs.load(std::memory_order_acquire) < expected) {
+        }
+    }
+    task->cancel();
+}
+BENCHMARK(BM_Executor_WakeRoundTrip)->Arg(1)->Arg(4)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
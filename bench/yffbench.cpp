@@ -0,0 +1,1032 @@
+// Headless playback benchmark: plays a file through the full pipeline with
+// null renderers and reports throughput, CPU per thread, peak RSS and the
+// time stop() and close() take.
+//
+//   yffbench [options] <url>
+//     --realtime               Pace playback by timestamps (default free-run)
+//     --profile <name>         fast | default | thorough
+//     --backend <name>         default | read-ahead | mmap | disk-cache
+//     --cache-dir <dir>        Directory for --backend disk-cache
+//     --duration <seconds>     Stop after this much wall time
+//     --players <n>            Play n copies at once (default 1)
+//     --executor [threads]     Run the players on one shared executor
+//                              instead of per-component threads
+//     --decoder-threads <n>    Video codec threads (default chosen from
+//                              the frame size and idle cores)
+//     --seek-rate <per second> Seek every player to pseudo-random
+//                              positions at this rate while playing
+//     --scrub-rate <per second>
+//                              Drag the seek bar: pause, preview keyframes
+//                              sweeping back and forth over the input at
+//                              this rate, release at the end (default
+//                              duration 5 s)
+//     --thumbnails <n>         Instead of playing, extract n evenly spaced
+//                              frames with FrameExtractor and report
+//                              thumbnails per second
+//     --thumb-size <WxH>       Bounds of the extracted frames, 0 leaves a
+//                              side unconstrained (default 320x0)
+//     --extract-workers <n>    Decoding pipelines (default one per core)
+//     --reopen <n>             Instead of playing, open and close the
+//                              input n more times after a first open and
+//                              report cold (probe cache miss) against
+//                              warm (probe cache hit) open times
+//     --demux                  Instead of playing, read the input through
+//                              the demuxer alone, dropping the packets,
+//                              and report input bytes per second and CPU
+//                              per GB, e.g. to compare --backend mmap
+//                              against default
+//     --throttle <bytes/s>     Serve a local file to the demuxer through
+//                              a loopback HTTP server at this rate, a
+//                              stand-in for slow network storage
+//     --json                   Print the report as JSON
+//     --trace <file>           Write a Chrome trace of the pipeline
+//     --verbose                Print player logs
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BufferQueue.h"
+#include "Demuxer.h"
+#include "FrameExtractor.h"
+#include "LoopbackServer.h"
+#include "MediaInfo.h"
+#include "NullAudioRenderer.h"
+#include "NullVideoRenderer.h"
+#include "PipelineStats.h"
+#include "Player.h"
+#include "Tracer.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+using namespace yffplayer;
+
+namespace {
+
+class StderrLogger : public Logger {
+   public:
+    explicit StderrLogger(LogLevel minLevel) : mMinLevel(minLevel) {}
+
+    void log(LogLevel level, const std::string& tag,
+             const std::string& message) override {
+        if (level < mMinLevel) {
+            return;
+        }
+        fprintf(stderr, "[%s] %s\n", tag.c_str(), message.c_str());
+    }
+
+   private:
+    LogLevel mMinLevel;
+};
+
+class BenchCallback : public PlayerCallback {
+   public:
+    void onPlayerStateChanged(PlayerState state) override {}
+    void onPlaybackProgress(double position, double duration) override {}
+    void onError(const Error& error) override {
+        fprintf(stderr, "error %d: %s\n", static_cast<int>(error.code),
+                error.message.c_str());
+    }
+    void onMediaInfo(const MediaInfo& info) override {}
+    void onVideoFrame(VideoFrame& frame) override {}
+    void onAudioFrame(AudioFrame& frame) override {}
+    void onFirstFrameRendered(int64_t timeToFirstFrameUs) override {}
+};
+
+// Records the end of a demux-only run
+class DemuxDoneCallback : public DemuxerCallback {
+   public:
+    void onDemuxerStateChanged(DemuxerState state) override {}
+    void onDemuxerError(const Error& error) override {
+        fprintf(stderr, "error %d: %s\n", static_cast<int>(error.code),
+                error.message.c_str());
+        mDone = true;
+    }
+    void onEndOfFile() override { mDone = true; }
+    void onMediaInfoReady(const MediaInfo& info) override {}
+    void onSeekCompleted(int64_t position) override {}
+
+    bool isDone() const { return mDone; }
+
+   private:
+    std::atomic<bool> mDone{false};
+};
+
+struct Options {
+    std::string url;
+    ClockMode clockMode{ClockMode::FREE_RUN};
+    OpenProfile profile{OpenProfile::DEFAULT};
+    InputConfig input;
+    double durationSec{0};
+    int players{1};
+    int executorThreads{-1};  // -1: dedicated threads, 0: one per core
+    int decoderThreads{0};    // 0: chosen by the decoder
+    double seekRate{0};
+    double scrubRate{0};
+    int thumbnails{0};
+    int reopen{0};
+    bool demux{false};
+    int64_t throttle{0};  // Bytes per second, 0 reads the input directly
+    ExtractConfig extract;
+    std::string tracePath;
+    bool json{false};
+    bool verbose{false};
+};
+
+// Stages reported from PlayerStats, in pipeline order
+std::vector<std::pair<const char*, StageStats>> stageList(
+    const PlayerStats& stats) {
+    return {{"demux", stats.demux},
+            {"audio_decode", stats.audioDecode},
+            {"video_decode", stats.videoDecode},
+            {"audio_convert", stats.audioConvert},
+            {"video_convert", stats.videoConvert},
+            {"video_present", stats.videoPresent}};
+}
+
+// Counters of all players summed, histograms merged
+void mergeStage(StageStats& into, const StageStats& from) {
+    into.items += from.items;
+    into.cpuUs += from.cpuUs;
+    mergeHistogram(into.timeUs, from.timeUs);
+}
+
+PlayerStats mergeStats(const std::vector<PlayerStats>& all) {
+    PlayerStats total;
+    for (const PlayerStats& stats : all) {
+        mergeStage(total.demux, stats.demux);
+        mergeStage(total.audioDecode, stats.audioDecode);
+        mergeStage(total.videoDecode, stats.videoDecode);
+        mergeStage(total.audioConvert, stats.audioConvert);
+        mergeStage(total.videoConvert, stats.videoConvert);
+        mergeStage(total.videoPresent, stats.videoPresent);
+        mergeHistogram(total.presentLateUs, stats.presentLateUs);
+        total.audioFramesRendered += stats.audioFramesRendered;
+        total.audioUnderruns += stats.audioUnderruns;
+        total.videoFramesDropped += stats.videoFramesDropped;
+        total.videoFramesLate += stats.videoFramesLate;
+        total.cpuUs += stats.cpuUs;
+        total.audioPackets.stale += stats.audioPackets.stale;
+        total.videoPackets.stale += stats.videoPackets.stale;
+        total.audioFrames.stale += stats.audioFrames.stale;
+        total.videoFrames.stale += stats.videoFrames.stale;
+        total.seeks += stats.seeks;
+        total.seeksCoalesced += stats.seeksCoalesced;
+        total.staleFramesShown += stats.staleFramesShown;
+        mergeHistogram(total.seekLatencyUs, stats.seekLatencyUs);
+        total.scrubRequests += stats.scrubRequests;
+        total.scrubFrames += stats.scrubFrames;
+        total.scrubCacheHits += stats.scrubCacheHits;
+        mergeHistogram(total.scrubLatencyUs, stats.scrubLatencyUs);
+    }
+    return total;
+}
+
+int countThreads() {
+    int count = 0;
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) {
+        return 0;
+    }
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+// CPU seconds of every live thread, summed by thread name
+std::map<std::string, double> sampleThreadCpu() {
+    std::map<std::string, double> cpu;
+    long ticksPerSecond = sysconf(_SC_CLK_TCK);
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) {
+        return cpu;
+    }
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        std::string base = std::string("/proc/self/task/") + entry->d_name;
+        std::ifstream statFile(base + "/stat");
+        std::string stat((std::istreambuf_iterator<char>(statFile)),
+                         std::istreambuf_iterator<char>());
+        size_t nameEnd = stat.rfind(')');
+        size_t nameStart = stat.find('(');
+        if (nameEnd == std::string::npos || nameStart == std::string::npos) {
+            continue;
+        }
+        std::string name = stat.substr(nameStart + 1, nameEnd - nameStart - 1);
+
+        // Fields after the name start at field 3 (state); utime and stime
+        // are fields 14 and 15
+        unsigned long utime = 0;
+        unsigned long stime = 0;
+        if (sscanf(stat.c_str() + nameEnd + 2,
+                   "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                   &utime, &stime) == 2) {
+            cpu[name] += static_cast<double>(utime + stime) / ticksPerSecond;
+        }
+    }
+    closedir(dir);
+    return cpu;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--realtime") {
+            options.clockMode = ClockMode::REALTIME;
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else if (arg == "--demux") {
+            options.demux = true;
+        } else if (arg == "--profile" && hasValue) {
+            std::string value = argv[++i];
+            if (value == "fast") {
+                options.profile = OpenProfile::FAST_START;
+            } else if (value == "thorough") {
+                options.profile = OpenProfile::THOROUGH;
+            } else if (value != "default") {
+                return false;
+            }
+        } else if (arg == "--backend" && hasValue) {
+            std::string value = argv[++i];
+            if (value == "read-ahead") {
+                options.input.backend = InputBackend::READ_AHEAD;
+            } else if (value == "mmap") {
+                options.input.backend = InputBackend::MMAP;
+            } else if (value == "disk-cache") {
+                options.input.backend = InputBackend::DISK_CACHE;
+            } else if (value != "default") {
+                return false;
+            }
+        } else if (arg == "--cache-dir" && hasValue) {
+            options.input.cacheDirectory = argv[++i];
+        } else if (arg == "--trace" && hasValue) {
+            options.tracePath = argv[++i];
+        } else if (arg == "--duration" && hasValue) {
+            options.durationSec = atof(argv[++i]);
+        } else if (arg == "--players" && hasValue) {
+            options.players = atoi(argv[++i]);
+            if (options.players < 1) {
+                return false;
+            }
+        } else if (arg == "--seek-rate" && hasValue) {
+            options.seekRate = atof(argv[++i]);
+            if (options.seekRate <= 0) {
+                return false;
+            }
+        } else if (arg == "--scrub-rate" && hasValue) {
+            options.scrubRate = atof(argv[++i]);
+            if (options.scrubRate <= 0) {
+                return false;
+            }
+        } else if (arg == "--thumbnails" && hasValue) {
+            options.thumbnails = atoi(argv[++i]);
+            if (options.thumbnails < 1) {
+                return false;
+            }
+        } else if (arg == "--reopen" && hasValue) {
+            options.reopen = atoi(argv[++i]);
+            if (options.reopen < 1) {
+                return false;
+            }
+        } else if (arg == "--throttle" && hasValue) {
+            options.throttle = atoll(argv[++i]);
+            if (options.throttle < 1) {
+                return false;
+            }
+        } else if (arg == "--thumb-size" && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &options.extract.maxWidth,
+                       &options.extract.maxHeight) != 2) {
+                return false;
+            }
+        } else if (arg == "--extract-workers" && hasValue) {
+            options.extract.workers = atoi(argv[++i]);
+            if (options.extract.workers < 1) {
+                return false;
+            }
+        } else if (arg == "--executor") {
+            // The thread count is optional
+            options.executorThreads = 0;
+            if (hasValue &&
+                isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                options.executorThreads = atoi(argv[++i]);
+            }
+        } else if (arg == "--decoder-threads" && hasValue) {
+            options.decoderThreads = atoi(argv[++i]);
+            if (options.decoderThreads < 1) {
+                return false;
+            }
+        } else if (!arg.empty() && arg[0] != '-' && options.url.empty()) {
+            options.url = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.url.empty();
+}
+
+// Extract evenly spaced frames of the input and report thumbnails per
+// second
+int runThumbnails(const Options& options, std::shared_ptr<Logger> logger,
+                  std::shared_ptr<Executor> executor) {
+    // The duration from a demuxer of its own, the extractor only sees
+    // timestamps
+    auto packets = std::make_shared<BufferQueue<AVPacket*>>(1);
+    Demuxer probe(packets, packets, logger);
+    if (!probe.open(options.url)) {
+        fprintf(stderr, "failed to open %s\n", options.url.c_str());
+        return 1;
+    }
+    int64_t durationUs = probe.getMediaInfo().durationMs * 1000;
+    if (durationUs <= 0) {
+        fprintf(stderr, "%s has no duration\n", options.url.c_str());
+        return 1;
+    }
+
+    // The middle of n equal slots, like a thumbnail strip
+    std::vector<int64_t> timestampsUs;
+    for (int i = 0; i < options.thumbnails; i++) {
+        timestampsUs.push_back(durationUs * (2 * i + 1) /
+                               (2 * options.thumbnails));
+    }
+
+    FrameExtractor extractor(logger);
+    extractor.setExecutor(executor);
+    rusage startUsage;
+    getrusage(RUSAGE_SELF, &startUsage);
+    std::vector<std::shared_ptr<VideoFrame>> frames =
+        extractor.extract(options.url, timestampsUs, options.extract);
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    ExtractStats stats = extractor.getLastStats();
+
+    int width = 0;
+    int height = 0;
+    for (const std::shared_ptr<VideoFrame>& frame : frames) {
+        if (frame) {
+            width = frame->width;
+            height = frame->height;
+            break;
+        }
+    }
+    double wallSec = stats.elapsedUs / 1e6;
+    double thumbnailsPerSec = wallSec > 0 ? stats.extracted / wallSec : 0;
+    double decodedPerThumbnail =
+        stats.extracted > 0 ? stats.framesDecoded / (double)stats.extracted
+                            : 0;
+    double userSec = (usage.ru_utime.tv_sec - startUsage.ru_utime.tv_sec) +
+                     (usage.ru_utime.tv_usec - startUsage.ru_utime.tv_usec) /
+                         1e6;
+    double systemSec =
+        (usage.ru_stime.tv_sec - startUsage.ru_stime.tv_sec) +
+        (usage.ru_stime.tv_usec - startUsage.ru_stime.tv_usec) / 1e6;
+    int executorThreads = executor ? executor->getThreadCount()
+                                   : Executor::shared()->getThreadCount();
+
+    if (options.json) {
+        printf("{\n");
+        printf("  \"url\": \"%s\",\n", options.url.c_str());
+        printf("  \"thumbnails\": %lld,\n", (long long)stats.requested);
+        printf("  \"extracted\": %lld,\n", (long long)stats.extracted);
+        printf("  \"width\": %d,\n", width);
+        printf("  \"height\": %d,\n", height);
+        printf("  \"workers\": %d,\n", stats.workers);
+        printf("  \"executor_threads\": %d,\n", executorThreads);
+        printf("  \"segments\": %lld,\n", (long long)stats.segments);
+        printf("  \"frames_decoded\": %lld,\n",
+               (long long)stats.framesDecoded);
+        printf("  \"decoded_per_thumbnail\": %.2f,\n", decodedPerThumbnail);
+        printf("  \"wall_s\": %.3f,\n", wallSec);
+        printf("  \"thumbnails_per_s\": %.1f,\n", thumbnailsPerSec);
+        printf("  \"cpu_user_s\": %.3f,\n", userSec);
+        printf("  \"cpu_system_s\": %.3f,\n", systemSec);
+        printf("  \"peak_rss_kb\": %ld\n", usage.ru_maxrss);
+        printf("}\n");
+    } else {
+        printf("url            %s\n", options.url.c_str());
+        printf("thumbnails     %lld of %lld at %dx%d\n",
+               (long long)stats.extracted, (long long)stats.requested, width,
+               height);
+        printf("workers        %d on %d executor threads\n", stats.workers,
+               executorThreads);
+        printf("segments       %lld, %lld frames decoded (%.2f per "
+               "thumbnail)\n",
+               (long long)stats.segments, (long long)stats.framesDecoded,
+               decodedPerThumbnail);
+        printf("wall time      %.3f s\n", wallSec);
+        printf("throughput     %.1f thumbnails/s\n", thumbnailsPerSec);
+        printf("cpu            %.3f s user, %.3f s system\n", userSec,
+               systemSec);
+        printf("peak rss       %.1f MB\n", usage.ru_maxrss / 1024.0);
+    }
+    return stats.extracted == stats.requested ? 0 : 1;
+}
+
+int runReopen(const Options& options, std::shared_ptr<Logger> logger,
+              std::shared_ptr<Executor> executor) {
+    // One player keeps its probe cache across close(), so only the first
+    // open probes the input
+    auto player = std::make_shared<Player>(
+        std::make_shared<BenchCallback>(),
+        std::make_shared<NullAudioRenderer>(false),
+        std::make_shared<NullVideoRenderer>(), logger);
+    player->setLogLevel(options.verbose ? LogLevel::Verbose
+                                        : LogLevel::Warning);
+    player->setOpenProfile(options.profile);
+    player->setInputConfig(options.input);
+    player->setExecutor(executor);
+    player->setVideoDecoderThreads(options.decoderThreads);
+
+    std::vector<StartupMetrics> opens;
+    for (int i = 0; i <= options.reopen; i++) {
+        if (!player->open(options.url)) {
+            fprintf(stderr, "failed to open %s\n", options.url.c_str());
+            return 1;
+        }
+        opens.push_back(player->getStartupMetrics());
+        player->close();
+    }
+
+    const StartupMetrics& cold = opens[0];
+    int warmHits = 0;
+    int64_t warmTotalUs = 0;
+    int64_t warmMinUs = INT64_MAX;
+    int64_t warmMaxUs = 0;
+    for (size_t i = 1; i < opens.size(); i++) {
+        warmHits += opens[i].probeCacheHit ? 1 : 0;
+        warmTotalUs += opens[i].openUs;
+        warmMinUs = std::min(warmMinUs, opens[i].openUs);
+        warmMaxUs = std::max(warmMaxUs, opens[i].openUs);
+    }
+    double warmMeanMs = warmTotalUs / 1000.0 / options.reopen;
+
+    if (options.json) {
+        printf("{\n");
+        printf("  \"url\": \"%s\",\n", options.url.c_str());
+        printf("  \"reopens\": %d,\n", options.reopen);
+        printf("  \"cold_open_us\": %lld,\n", (long long)cold.openUs);
+        printf("  \"cold_probe_cache_hit\": %s,\n",
+               cold.probeCacheHit ? "true" : "false");
+        printf("  \"warm_probe_cache_hits\": %d,\n", warmHits);
+        printf("  \"warm_open_mean_us\": %.0f,\n", warmMeanMs * 1000);
+        printf("  \"warm_open_min_us\": %lld,\n", (long long)warmMinUs);
+        printf("  \"warm_open_max_us\": %lld\n", (long long)warmMaxUs);
+        printf("}\n");
+    } else {
+        printf("url            %s\n", options.url.c_str());
+        printf("cold open      %.1f ms (probe cache %s)\n",
+               cold.openUs / 1000.0, cold.probeCacheHit ? "hit" : "miss");
+        printf("warm open      %.1f ms mean, %.1f-%.1f ms over %d opens\n",
+               warmMeanMs, warmMinUs / 1000.0, warmMaxUs / 1000.0,
+               options.reopen);
+        printf("probe cache    %d of %d warm opens hit\n", warmHits,
+               options.reopen);
+    }
+    return 0;
+}
+
+// Serve the local file at options.url through server at the throttle
+// rate, the player then reads it like a network input. Returns the URL to
+// play, empty on failure.
+std::string startThrottledInput(const Options& options,
+                                LoopbackServer& server) {
+    std::ifstream file(options.url, std::ios::binary);
+    std::string body((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+    if (body.empty() || !server.start()) {
+        return "";
+    }
+    server.setResource(body, "\"yffbench\"");
+    server.setRate(options.throttle);
+    // Keep the extension for format probing
+    size_t slash = options.url.rfind('/');
+    size_t dot = options.url.rfind('.');
+    std::string extension =
+        dot != std::string::npos && (slash == std::string::npos || dot > slash)
+            ? options.url.substr(dot)
+            : "";
+    return server.url("/input" + extension);
+}
+
+// Read the input through the demuxer alone and report input throughput;
+// the packets are freed as soon as they are queued, so the time is spent
+// in I/O and parsing
+int runDemux(const Options& options, const std::string& url,
+             std::shared_ptr<Logger> logger) {
+    auto audioPackets = std::make_shared<BufferQueue<AVPacket*>>();
+    auto videoPackets = std::make_shared<BufferQueue<AVPacket*>>();
+    auto callback = std::make_shared<DemuxDoneCallback>();
+    Demuxer demuxer(audioPackets, videoPackets, logger, callback);
+    demuxer.setOpenProfile(options.profile);
+    demuxer.setInputConfig(options.input);
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point openBegin = Clock::now();
+    if (!demuxer.open(url)) {
+        fprintf(stderr, "failed to open %s\n", url.c_str());
+        return 1;
+    }
+    Clock::time_point begin = Clock::now();
+    double openSec = std::chrono::duration<double>(begin - openBegin).count();
+    demuxer.start();
+
+    int64_t packets = 0;
+    auto drain = [&]() {
+        bool drained = false;
+        AVPacket* packet = nullptr;
+        while (audioPackets->tryPop(packet) || videoPackets->tryPop(packet)) {
+            av_packet_free(&packet);
+            packets++;
+            drained = true;
+        }
+        return drained;
+    };
+    std::map<std::string, double> threadCpu;
+    while (true) {
+        if (drain()) {
+            continue;
+        }
+        double elapsed =
+            std::chrono::duration<double>(Clock::now() - begin).count();
+        if (callback->isDone() ||
+            (options.durationSec > 0 && elapsed >= options.durationSec)) {
+            // Sample before stop() joins the reading threads
+            threadCpu = sampleThreadCpu();
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double wallSec =
+        std::chrono::duration<double>(Clock::now() - begin).count();
+    InputStats input = demuxer.getInputStats();
+    demuxer.stop();
+    drain();
+
+    // Only the player's own threads, not this loop or the throttling
+    // server
+    double cpuSec = 0;
+    for (const auto& entry : threadCpu) {
+        if (entry.first.compare(0, 4, "yff-") == 0) {
+            cpuSec += entry.second;
+        }
+    }
+    double bytesPerSec = wallSec > 0 ? input.bytesRead / wallSec : 0;
+    double cpuPerGb = input.bytesRead > 0 ? cpuSec * 1e9 / input.bytesRead : 0;
+
+    if (options.json) {
+        printf("{\n");
+        printf("  \"url\": \"%s\",\n", options.url.c_str());
+        printf("  \"throttle_bytes_per_s\": %lld,\n",
+               (long long)options.throttle);
+        printf("  \"open_s\": %.3f,\n", openSec);
+        printf("  \"wall_s\": %.3f,\n", wallSec);
+        printf("  \"packets\": %lld,\n", (long long)packets);
+        printf("  \"bytes_demuxed\": %lld,\n", (long long)input.bytesRead);
+        printf("  \"bytes_per_s\": %.0f,\n", bytesPerSec);
+        printf("  \"media_s\": %.3f,\n", input.mediaTimeUs / 1e6);
+        printf("  \"read_s\": %.3f,\n", input.readTimeUs / 1e6);
+        printf("  \"cpu_s\": %.3f,\n", cpuSec);
+        printf("  \"cpu_s_per_gb\": %.3f\n", cpuPerGb);
+        printf("}\n");
+    } else {
+        printf("url            %s\n", options.url.c_str());
+        if (options.throttle > 0) {
+            printf("throttle       %.2f MB/s\n", options.throttle / 1e6);
+        }
+        printf("open           %.1f ms\n", openSec * 1000);
+        printf("wall time      %.3f s\n", wallSec);
+        printf("demuxed        %lld packets, %.2f MB, %.3f s of media\n",
+               (long long)packets, input.bytesRead / 1e6,
+               input.mediaTimeUs / 1e6);
+        printf("throughput     %.2f MB/s\n", bytesPerSec / 1e6);
+        printf("read time      %.3f s inside reads\n",
+               input.readTimeUs / 1e6);
+        printf("cpu            %.3f s on player threads, %.3f s per GB\n",
+               cpuSec, cpuPerGb);
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr,
+                "usage: %s [--realtime] [--profile fast|default|thorough]\n"
+                "       [--backend default|read-ahead|mmap|disk-cache]\n"
+                "       [--cache-dir DIR] [--duration SEC] [--trace FILE]\n"
+                "       [--players N] [--executor [THREADS]]\n"
+                "       [--decoder-threads N] [--reopen N] [--demux]\n"
+                "       [--throttle BYTES_PER_SEC]\n"
+                "       [--seek-rate PER_SEC] [--scrub-rate PER_SEC]\n"
+                "       [--thumbnails N [--thumb-size WxH]\n"
+                "        [--extract-workers N]]\n"
+                "       [--json] [--verbose] <url>\n",
+                argv[0]);
+        return 2;
+    }
+
+    bool freeRun = options.clockMode == ClockMode::FREE_RUN;
+    if (options.scrubRate > 0 && options.durationSec <= 0) {
+        // A scrubbing player stays paused and never completes
+        options.durationSec = 5;
+    }
+    auto logger = std::make_shared<StderrLogger>(
+        options.verbose ? LogLevel::Verbose : LogLevel::Warning);
+    std::shared_ptr<Executor> executor;
+    if (options.executorThreads >= 0) {
+        executor = std::make_shared<Executor>(options.executorThreads);
+    }
+    LoopbackServer server;
+    std::string url = options.url;
+    if (options.throttle > 0) {
+        url = startThrottledInput(options, server);
+        if (url.empty()) {
+            fprintf(stderr, "cannot serve %s\n", options.url.c_str());
+            return 1;
+        }
+    }
+    if (options.demux) {
+        return runDemux(options, url, logger);
+    }
+    if (options.thumbnails > 0) {
+        return runThumbnails(options, logger, executor);
+    }
+    if (options.reopen > 0) {
+        return runReopen(options, logger, executor);
+    }
+
+    struct Instance {
+        std::shared_ptr<NullAudioRenderer> audioRenderer;
+        std::shared_ptr<NullVideoRenderer> videoRenderer;
+        std::shared_ptr<Player> player;
+        bool scrubbing{false};
+    };
+    std::vector<Instance> instances;
+    for (int i = 0; i < options.players; i++) {
+        Instance instance;
+        instance.audioRenderer = std::make_shared<NullAudioRenderer>(!freeRun);
+        instance.videoRenderer = std::make_shared<NullVideoRenderer>();
+        instance.player = std::make_shared<Player>(
+            std::make_shared<BenchCallback>(), instance.audioRenderer,
+            instance.videoRenderer, logger);
+        instance.player->setLogLevel(options.verbose ? LogLevel::Verbose
+                                                     : LogLevel::Warning);
+        instance.player->setClockMode(options.clockMode);
+        instance.player->setOpenProfile(options.profile);
+        instance.player->setInputConfig(options.input);
+        instance.player->setExecutor(executor);
+        instance.player->setVideoDecoderThreads(options.decoderThreads);
+        instances.push_back(instance);
+    }
+    if (!options.tracePath.empty()) {
+        if (!kTracingCompiled) {
+            fprintf(stderr, "tracing is not compiled in (YFF_TRACING)\n");
+        }
+        Tracer::instance().setEnabled(true);
+    }
+
+    rusage startUsage;
+    getrusage(RUSAGE_SELF, &startUsage);
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point begin = Clock::now();
+    for (const Instance& instance : instances) {
+        if (!instance.player->open(url) ||
+            !instance.player->start()) {
+            fprintf(stderr, "failed to play %s\n", options.url.c_str());
+            return 1;
+        }
+    }
+
+    // Wait for the end of the input on every player or the wall-time limit
+    std::map<std::string, double> threadCpu;
+    int threadCount = 0;
+    int64_t seeksIssued = 0;
+    uint64_t seekSeed = 1;  // Same positions on every run
+    int64_t scrubsIssued = 0;
+    double scrubPosition = 0;  // Fraction of the duration
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (options.seekRate > 0) {
+            // Catch up in bursts when the rate exceeds the poll interval,
+            // which is what coalescing has to absorb
+            double elapsed =
+                std::chrono::duration<double>(Clock::now() - begin).count();
+            auto seeksDue = static_cast<int64_t>(elapsed * options.seekRate);
+            while (seeksIssued < seeksDue) {
+                seekSeed = seekSeed * 6364136223846793005ULL +
+                           1442695040888963407ULL;
+                for (const Instance& instance : instances) {
+                    int64_t durationUs = instance.player->getDuration();
+                    if (durationUs > 0 && instance.player->getState() ==
+                                              PlayerState::STARTED) {
+                        instance.player->seek((seekSeed >> 11) % durationUs);
+                    }
+                }
+                seeksIssued++;
+            }
+        }
+        if (options.scrubRate > 0) {
+            // Scrubbing begins once a player renders; the sweep crosses
+            // the input in kScrubSweepSec each way, so keyframes are
+            // revisited and the cache gets hits
+            constexpr double kScrubSweepSec = 2.0;
+            for (Instance& instance : instances) {
+                if (!instance.scrubbing) {
+                    instance.scrubbing = instance.player->beginScrub();
+                }
+            }
+            double elapsed =
+                std::chrono::duration<double>(Clock::now() - begin).count();
+            auto scrubsDue = static_cast<int64_t>(elapsed * options.scrubRate);
+            while (scrubsIssued < scrubsDue) {
+                double phase = std::fmod(
+                    scrubsIssued / (options.scrubRate * kScrubSweepSec), 2.0);
+                scrubPosition = phase < 1.0 ? phase : 2.0 - phase;
+                for (const Instance& instance : instances) {
+                    if (instance.scrubbing) {
+                        instance.player->scrub(static_cast<int64_t>(
+                            scrubPosition * instance.player->getDuration()));
+                    }
+                }
+                scrubsIssued++;
+            }
+        }
+        bool finished = true;
+        for (const Instance& instance : instances) {
+            PlayerState state = instance.player->getState();
+            if (state != PlayerState::COMPLETED &&
+                state != PlayerState::ERROR) {
+                finished = false;
+            }
+        }
+        double elapsed =
+            std::chrono::duration<double>(Clock::now() - begin).count();
+        bool timeUp = options.durationSec > 0 && elapsed >= options.durationSec;
+        if (finished || timeUp) {
+            // Release at the last preview position
+            for (const Instance& instance : instances) {
+                if (instance.scrubbing) {
+                    instance.player->endScrub(static_cast<int64_t>(
+                        scrubPosition * instance.player->getDuration()));
+                }
+            }
+            // Sample before stop() joins the pipeline threads
+            threadCpu = sampleThreadCpu();
+            threadCount = countThreads();
+            break;
+        }
+    }
+    double wallSec =
+        std::chrono::duration<double>(Clock::now() - begin).count();
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    int64_t mediaUs = 0;
+    int64_t videoFrames = 0;
+    int64_t audioFrames = 0;
+    std::vector<PlayerStats> allStats;
+    StartupMetrics startup = instances[0].player->getStartupMetrics();
+    // Slowest stop() and close() over the players
+    TeardownMetrics teardown;
+    for (const Instance& instance : instances) {
+        mediaUs += instance.player->getCurrentPosition();
+        instance.player->stop();
+        // After stop() the pipeline threads have added their last CPU
+        // samples
+        allStats.push_back(instance.player->getStats());
+        instance.player->close();
+        TeardownMetrics metrics = instance.player->getTeardownMetrics();
+        teardown.stopUs = std::max(teardown.stopUs, metrics.stopUs);
+        teardown.closeUs = std::max(teardown.closeUs, metrics.closeUs);
+        videoFrames += instance.videoRenderer->getFramesRendered();
+        audioFrames += instance.audioRenderer->getFramesRendered();
+    }
+    PlayerStats stats = mergeStats(allStats);
+    ExecutorStats executorStats;
+    if (executor) {
+        executorStats = executor->getStats();
+    }
+
+    if (!options.tracePath.empty()) {
+        Tracer::instance().setEnabled(false);
+        if (!Tracer::instance().writeChromeTrace(options.tracePath)) {
+            fprintf(stderr, "failed to write %s\n", options.tracePath.c_str());
+        }
+    }
+
+    double userSec = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+    double systemSec = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    long peakRssKb = usage.ru_maxrss;
+    // Voluntary switches are mostly sleeps and waits, involuntary ones
+    // preemption by other runnable threads
+    long voluntarySwitches = usage.ru_nvcsw - startUsage.ru_nvcsw;
+    long involuntarySwitches = usage.ru_nivcsw - startUsage.ru_nivcsw;
+    double switchesPerSec =
+        wallSec > 0 ? (voluntarySwitches + involuntarySwitches) / wallSec : 0;
+
+    double videoFps = wallSec > 0 ? videoFrames / wallSec : 0;
+    double speed = wallSec > 0 ? mediaUs / 1e6 / wallSec : 0;
+    // Realtime streams one core could sustain, from the pipeline CPU time
+    double streamsPerCore = stats.cpuUs > 0 ? mediaUs / (double)stats.cpuUs : 0;
+    const HistogramStats& late = stats.presentLateUs;
+    const HistogramStats& seekLatency = stats.seekLatencyUs;
+    const HistogramStats& scrubLatency = stats.scrubLatencyUs;
+    int64_t stalePackets = stats.audioPackets.stale + stats.videoPackets.stale;
+    int64_t staleFrames = stats.audioFrames.stale + stats.videoFrames.stale;
+    double staleShownPerSeek =
+        stats.seeks > 0 ? stats.staleFramesShown / (double)stats.seeks : 0;
+
+    if (options.json) {
+        printf("{\n");
+        printf("  \"url\": \"%s\",\n", options.url.c_str());
+        printf("  \"clock\": \"%s\",\n", freeRun ? "free-run" : "realtime");
+        printf("  \"players\": %d,\n", options.players);
+        printf("  \"executor_threads\": %d,\n",
+               executor ? executor->getThreadCount() : 0);
+        printf("  \"open_us\": %lld,\n", (long long)startup.openUs);
+        printf("  \"first_frame_us\": %lld,\n",
+               (long long)startup.firstFrameUs);
+        printf("  \"stop_us\": %lld,\n", (long long)teardown.stopUs);
+        printf("  \"close_us\": %lld,\n", (long long)teardown.closeUs);
+        printf("  \"wall_s\": %.3f,\n", wallSec);
+        printf("  \"media_s\": %.3f,\n", mediaUs / 1e6);
+        printf("  \"speed\": %.2f,\n", speed);
+        printf("  \"video_frames\": %lld,\n", (long long)videoFrames);
+        printf("  \"audio_frames\": %lld,\n", (long long)audioFrames);
+        printf("  \"video_fps\": %.1f,\n", videoFps);
+        printf("  \"cpu_user_s\": %.3f,\n", userSec);
+        printf("  \"cpu_system_s\": %.3f,\n", systemSec);
+        printf("  \"peak_rss_kb\": %ld,\n", peakRssKb);
+        printf("  \"threads\": %d,\n", threadCount);
+        printf("  \"voluntary_switches\": %ld,\n", voluntarySwitches);
+        printf("  \"involuntary_switches\": %ld,\n", involuntarySwitches);
+        printf("  \"switches_per_s\": %.1f,\n", switchesPerSec);
+        printf("  \"video_dropped\": %lld,\n",
+               (long long)stats.videoFramesDropped);
+        printf("  \"video_late\": %lld,\n", (long long)stats.videoFramesLate);
+        printf("  \"audio_underruns\": %lld,\n",
+               (long long)stats.audioUnderruns);
+        printf("  \"present_late_us\": {\"p50\": %lld, \"p99\": %lld, "
+               "\"max\": %lld},\n",
+               (long long)late.p50Us, (long long)late.p99Us,
+               (long long)late.maxUs);
+        printf("  \"seeks\": %lld,\n", (long long)stats.seeks);
+        printf("  \"seeks_coalesced\": %lld,\n",
+               (long long)stats.seeksCoalesced);
+        printf("  \"seek_latency_us\": {\"p50\": %lld, \"p99\": %lld, "
+               "\"max\": %lld},\n",
+               (long long)seekLatency.p50Us, (long long)seekLatency.p99Us,
+               (long long)seekLatency.maxUs);
+        printf("  \"stale_packets\": %lld,\n", (long long)stalePackets);
+        printf("  \"stale_frames\": %lld,\n", (long long)staleFrames);
+        printf("  \"stale_frames_shown\": %lld,\n",
+               (long long)stats.staleFramesShown);
+        printf("  \"stale_shown_per_seek\": %.3f,\n", staleShownPerSeek);
+        printf("  \"scrub_requests\": %lld,\n",
+               (long long)stats.scrubRequests);
+        printf("  \"scrub_frames\": %lld,\n", (long long)stats.scrubFrames);
+        printf("  \"scrub_cache_hits\": %lld,\n",
+               (long long)stats.scrubCacheHits);
+        printf("  \"scrub_latency_us\": {\"p50\": %lld, \"p99\": %lld, "
+               "\"max\": %lld},\n",
+               (long long)scrubLatency.p50Us, (long long)scrubLatency.p99Us,
+               (long long)scrubLatency.maxUs);
+        printf("  \"pipeline_cpu_s\": %.3f,\n", stats.cpuUs / 1e6);
+        printf("  \"streams_per_core\": %.2f,\n", streamsPerCore);
+        if (executor) {
+            printf("  \"executor\": {\"runs\": %lld, \"steps\": %lld, "
+                   "\"steals\": %lld, \"wakes\": %lld, \"timeouts\": %lld, "
+                   "\"sleeps\": %lld},\n",
+                   (long long)executorStats.runs,
+                   (long long)executorStats.steps,
+                   (long long)executorStats.steals,
+                   (long long)executorStats.wakes,
+                   (long long)executorStats.timeouts,
+                   (long long)executorStats.sleeps);
+        }
+        printf("  \"stages\": {");
+        const char* stageSeparator = "";
+        for (const auto& stage : stageList(stats)) {
+            const HistogramStats& time = stage.second.timeUs;
+            printf("%s\n    \"%s\": {\"items\": %lld, \"p50_us\": %lld, "
+                   "\"p99_us\": %lld, \"max_us\": %lld, \"cpu_s\": %.3f}",
+                   stageSeparator, stage.first, (long long)stage.second.items,
+                   (long long)time.p50Us, (long long)time.p99Us,
+                   (long long)time.maxUs, stage.second.cpuUs / 1e6);
+            stageSeparator = ",";
+        }
+        printf("\n  },\n");
+        printf("  \"thread_cpu_s\": {");
+        const char* separator = "";
+        for (const auto& entry : threadCpu) {
+            printf("%s\n    \"%s\": %.3f", separator, entry.first.c_str(),
+                   entry.second);
+            separator = ",";
+        }
+        printf("\n  }\n}\n");
+        return 0;
+    }
+
+    printf("url            %s\n", options.url.c_str());
+    printf("clock          %s\n", freeRun ? "free-run" : "realtime");
+    if (executor) {
+        printf("players        %d on %d executor threads\n", options.players,
+               executor->getThreadCount());
+    } else {
+        printf("players        %d on dedicated threads\n", options.players);
+    }
+    printf("open           %.1f ms\n", startup.openUs / 1000.0);
+    printf("first frame    %.1f ms\n", startup.firstFrameUs / 1000.0);
+    printf("stop / close   %.1f ms / %.1f ms\n", teardown.stopUs / 1000.0,
+           teardown.closeUs / 1000.0);
+    printf("wall time      %.3f s\n", wallSec);
+    printf("media time     %.3f s (%.2fx)\n", mediaUs / 1e6, speed);
+    printf("video frames   %lld (%.1f fps)\n", (long long)videoFrames,
+           videoFps);
+    printf("audio frames   %lld\n", (long long)audioFrames);
+    printf("cpu            %.3f s user, %.3f s system\n", userSec, systemSec);
+    printf("peak rss       %.1f MB\n", peakRssKb / 1024.0);
+    printf("threads        %d\n", threadCount);
+    printf("ctx switches   %ld voluntary, %ld involuntary (%.0f/s)\n",
+           voluntarySwitches, involuntarySwitches, switchesPerSec);
+    printf("dropped/late   %lld / %lld video frames, %lld audio underruns\n",
+           (long long)stats.videoFramesDropped,
+           (long long)stats.videoFramesLate, (long long)stats.audioUnderruns);
+    printf("present late   p50 %lld us, p99 %lld us, max %lld us\n",
+           (long long)late.p50Us, (long long)late.p99Us,
+           (long long)late.maxUs);
+    if (stats.seeks > 0) {
+        printf("seeks          %lld (%lld coalesced), latency p50 %lld us, "
+               "p99 %lld us, max %lld us\n",
+               (long long)stats.seeks, (long long)stats.seeksCoalesced,
+               (long long)seekLatency.p50Us, (long long)seekLatency.p99Us,
+               (long long)seekLatency.maxUs);
+        printf("stale          %lld packets, %lld frames discarded, "
+               "%lld shown (%.3f per seek)\n",
+               (long long)stalePackets, (long long)staleFrames,
+               (long long)stats.staleFramesShown, staleShownPerSeek);
+    }
+    if (stats.scrubRequests > 0) {
+        printf("scrub          %lld requests, %lld frames (%lld cached), "
+               "latency p50 %lld us, p99 %lld us, max %lld us\n",
+               (long long)stats.scrubRequests, (long long)stats.scrubFrames,
+               (long long)stats.scrubCacheHits,
+               (long long)scrubLatency.p50Us, (long long)scrubLatency.p99Us,
+               (long long)scrubLatency.maxUs);
+    }
+    printf("pipeline cpu   %.3f s (%.2f streams per core)\n",
+           stats.cpuUs / 1e6, streamsPerCore);
+    if (executor) {
+        printf("executor       %lld runs, %lld steps, %lld steals, "
+               "%lld wakes, %lld timeouts, %lld sleeps\n",
+               (long long)executorStats.runs, (long long)executorStats.steps,
+               (long long)executorStats.steals,
+               (long long)executorStats.wakes,
+               (long long)executorStats.timeouts,
+               (long long)executorStats.sleeps);
+    }
+    printf("stage            items      p50      p99      max (us)"
+           "   cpu (s)\n");
+    for (const auto& stage : stageList(stats)) {
+        const HistogramStats& time = stage.second.timeUs;
+        printf("  %-14s %7lld %8lld %8lld %8lld %9.3f\n", stage.first,
+               (long long)stage.second.items, (long long)time.p50Us,
+               (long long)time.p99Us, (long long)time.maxUs,
+               stage.second.cpuUs / 1e6);
+    }
+    printf("thread cpu\n");
+    for (const auto& entry : threadCpu) {
+        printf("  %-16s %.3f s\n", entry.first.c_str(), entry.second);
+    }
+    return 0;
+}
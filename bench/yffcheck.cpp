@@ -0,0 +1,1261 @@
+// Headless checks of the player core against local stand-ins for network
+// inputs, run by CTest. Each check is one test case:
+//
+//   yffcheck <check>
+//     disk-cache      A second CachedIO read of a loopback HTTP resource
+//                     is served from disk, and so are seeks back into a
+//                     partial entry; concurrent instances and a changed
+//                     ETag do not reuse a cache entry they must not use
+//     mmap-truncate   MmapIO keeps reading, without SIGBUS, a file that
+//                     is truncated while it is mapped
+//     throttled-http  Playback of a clip served faster than realtime
+//                     never stalls; served slower than realtime it
+//                     stalls, but rarely
+//     live-catchup    A low-latency player behind a live stream plays
+//                     faster than realtime to close the gap
+//     live-jump       Above the jump threshold it skips to the newest
+//                     keyframe and keeps playing
+//     timeshift       The timeshift window of a live stream stays within
+//                     its limit, and seeks inside it rewind and return
+//                     to live
+//     tracks          The demuxer discards unselected audio tracks, and
+//                     switching the audio track keeps playing
+//     seek-storm      A burst of seeks coalesces to the last target, and
+//                     no frame of an earlier target is shown
+//     scrub           Scrubbing back over keyframes already shown is
+//                     served from KeyframeCache, which evicts the least
+//                     recently used frames by size
+//     frame-at        FrameExtractor returns the frames a precise seek
+//                     shows, with one seek per group of times in a GOP
+//
+// A check prints what it measured and exits non-zero on failure.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CachedIO.h"
+#include "FrameExtractor.h"
+#include "FrameScaler.h"
+#include "KeyframeCache.h"
+#include "Logger.h"
+#include "LoopbackServer.h"
+#include "MmapIO.h"
+#include "NullAudioRenderer.h"
+#include "NullVideoRenderer.h"
+#include "Player.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/error.h>
+}
+
+using namespace yffplayer;
+
+namespace {
+
+#define CHECK(condition, ...)                                        \
+    do {                                                             \
+        if (!(condition)) {                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n  ", __FILE__, \
+                    __LINE__, #condition);                           \
+            fprintf(stderr, __VA_ARGS__);                            \
+            fprintf(stderr, "\n");                                   \
+            return false;                                            \
+        }                                                            \
+    } while (0)
+
+class StderrLogger : public Logger {
+   public:
+    void log(LogLevel level, const std::string& tag,
+             const std::string& message) override {
+        if (getenv("YFFCHECK_VERBOSE")) {
+            fprintf(stderr, "[%s] %s\n", tag.c_str(), message.c_str());
+        }
+    }
+};
+
+std::string makeTempDir() {
+    char path[] = "/tmp/yffcheck-XXXXXX";
+    return mkdtemp(path) ? path : "";
+}
+
+std::string pseudoRandomBytes(size_t size, uint32_t seed) {
+    std::string bytes(size, '\0');
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1664525 + 1013904223;
+        bytes[i] = static_cast<char>(seed >> 24);
+    }
+    return bytes;
+}
+
+// Encodes a moving test pattern and a tone into MPEG-TS in memory, with
+// MPEG-2 video and MP2 audio whose encoders every FFmpeg build has. Gives
+// the checks clips of known bitrate and endless live streams without
+// shipping media.
+class SyntheticStream {
+   public:
+    static constexpr int kWidth = 320;
+    static constexpr int kHeight = 240;
+    static constexpr int kFps = 25;
+    static constexpr int kSampleRate = 48000;
+
+    ~SyntheticStream() { close(); }
+
+    // A keyframe every gopFrames video frames. More than one audio track
+    // muxes the same tone into each, tagged with the languages of
+    // kLanguages in order.
+    bool open(int gopFrames, int audioTracks = 1) {
+        mAudioTracks = audioTracks;
+        if (avformat_alloc_output_context2(&mFormat, nullptr, "mpegts",
+                                           nullptr) < 0) {
+            return false;
+        }
+        const AVCodec* videoCodec =
+            avcodec_find_encoder(AV_CODEC_ID_MPEG2VIDEO);
+        const AVCodec* audioCodec = avcodec_find_encoder(AV_CODEC_ID_MP2);
+        if (!videoCodec || !audioCodec) {
+            return false;
+        }
+
+        mVideo = avcodec_alloc_context3(videoCodec);
+        mVideo->width = kWidth;
+        mVideo->height = kHeight;
+        mVideo->pix_fmt = AV_PIX_FMT_YUV420P;
+        mVideo->time_base = {1, kFps};
+        mVideo->framerate = {kFps, 1};
+        mVideo->gop_size = gopFrames;
+        mVideo->max_b_frames = 0;
+        mVideo->bit_rate = 300000;
+
+        mAudio = avcodec_alloc_context3(audioCodec);
+        mAudio->sample_fmt = AV_SAMPLE_FMT_S16;
+        mAudio->sample_rate = kSampleRate;
+        av_channel_layout_default(&mAudio->ch_layout, 2);
+        mAudio->time_base = {1, kSampleRate};
+        mAudio->bit_rate = 128000;
+
+        if (avcodec_open2(mVideo, videoCodec, nullptr) < 0 ||
+            avcodec_open2(mAudio, audioCodec, nullptr) < 0) {
+            return false;
+        }
+        for (int i = 0; i <= audioTracks; i++) {
+            AVCodecContext* codec = i == 0 ? mVideo : mAudio;
+            AVStream* stream = avformat_new_stream(mFormat, nullptr);
+            if (!stream ||
+                avcodec_parameters_from_context(stream->codecpar, codec) < 0) {
+                return false;
+            }
+            stream->time_base = codec->time_base;
+            if (i > 0 && audioTracks > 1) {
+                av_dict_set(&stream->metadata, "language",
+                            kLanguages[(i - 1) % std::size(kLanguages)], 0);
+            }
+        }
+        mPackets.assign(audioTracks + 1, 0);
+
+        mFrame = av_frame_alloc();
+        mPacket = av_packet_alloc();
+        return mFrame && mPacket && avio_open_dyn_buf(&mFormat->pb) >= 0 &&
+               avformat_write_header(mFormat, nullptr) >= 0;
+    }
+
+    // Encode media up to untilUs and append the muxed bytes to out
+    bool encodeUntil(int64_t untilUs, std::string& out) {
+        while (true) {
+            int64_t videoUs = mVideoFrames * 1000000 / kFps;
+            int64_t audioUs = mAudioSamples * 1000000 / kSampleRate;
+            if (std::min(videoUs, audioUs) >= untilUs) {
+                break;
+            }
+            bool encoded =
+                videoUs <= audioUs ? encodeVideoFrame() : encodeAudioFrame();
+            if (!encoded) {
+                return false;
+            }
+        }
+        return takeOutput(out, true);
+    }
+
+    // Flush the encoders and end the stream
+    bool finish(std::string& out) {
+        return encode(mVideo, 0, nullptr) && encode(mAudio, 1, nullptr) &&
+               av_write_trailer(mFormat) >= 0 && takeOutput(out, false);
+    }
+
+    // Media time encoded so far
+    int64_t positionUs() const { return mVideoFrames * 1000000 / kFps; }
+
+    // Packets muxed so far into the stream, 0 is video
+    int64_t packetsMuxed(int streamIndex) const {
+        return mPackets[streamIndex];
+    }
+
+    static constexpr const char* kLanguages[] = {"eng", "fra", "deu"};
+
+   private:
+    bool encodeVideoFrame() {
+        av_frame_unref(mFrame);
+        mFrame->format = AV_PIX_FMT_YUV420P;
+        mFrame->width = kWidth;
+        mFrame->height = kHeight;
+        if (av_frame_get_buffer(mFrame, 0) < 0) {
+            return false;
+        }
+        // Diagonal bands moving by 3 pixels per frame
+        for (int y = 0; y < kHeight; y++) {
+            uint8_t* row = mFrame->data[0] + y * mFrame->linesize[0];
+            for (int x = 0; x < kWidth; x++) {
+                row[x] = static_cast<uint8_t>(x + y + mVideoFrames * 3);
+            }
+        }
+        for (int plane = 1; plane < 3; plane++) {
+            for (int y = 0; y < kHeight / 2; y++) {
+                memset(mFrame->data[plane] + y * mFrame->linesize[plane],
+                       plane == 1 ? 96 : 160, kWidth / 2);
+            }
+        }
+        mFrame->pts = mVideoFrames++;
+        return encode(mVideo, 0, mFrame);
+    }
+
+    bool encodeAudioFrame() {
+        av_frame_unref(mFrame);
+        mFrame->format = AV_SAMPLE_FMT_S16;
+        mFrame->sample_rate = kSampleRate;
+        mFrame->nb_samples = mAudio->frame_size;
+        if (av_channel_layout_copy(&mFrame->ch_layout, &mAudio->ch_layout) <
+                0 ||
+            av_frame_get_buffer(mFrame, 0) < 0) {
+            return false;
+        }
+        // 440 Hz in both channels
+        auto* samples = reinterpret_cast<int16_t*>(mFrame->data[0]);
+        for (int i = 0; i < mFrame->nb_samples; i++) {
+            double t = static_cast<double>(mAudioSamples + i) / kSampleRate;
+            auto value = static_cast<int16_t>(8000 * sin(2 * M_PI * 440 * t));
+            samples[2 * i] = value;
+            samples[2 * i + 1] = value;
+        }
+        mFrame->pts = mAudioSamples;
+        mAudioSamples += mFrame->nb_samples;
+        return encode(mAudio, 1, mFrame);
+    }
+
+    // Send a frame, nullptr to flush, and mux the packets that come out
+    // into the stream, or into every audio track for audio
+    bool encode(AVCodecContext* codec, int streamIndex, AVFrame* frame) {
+        if (avcodec_send_frame(codec, frame) < 0) {
+            return false;
+        }
+        while (true) {
+            int ret = avcodec_receive_packet(codec, mPacket);
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                return true;
+            }
+            if (ret < 0) {
+                return false;
+            }
+            int lastIndex = codec == mAudio ? mAudioTracks : streamIndex;
+            av_packet_rescale_ts(mPacket, codec->time_base,
+                                 mFormat->streams[streamIndex]->time_base);
+            for (int i = streamIndex; i <= lastIndex; i++) {
+                AVPacket* packet =
+                    i < lastIndex ? av_packet_clone(mPacket) : mPacket;
+                if (!packet) {
+                    return false;
+                }
+                packet->stream_index = i;
+                int ret = av_interleaved_write_frame(mFormat, packet);
+                if (packet != mPacket) {
+                    av_packet_free(&packet);
+                }
+                if (ret < 0) {
+                    return false;
+                }
+                mPackets[i]++;
+            }
+        }
+    }
+
+    // Move the muxed bytes to out, with a fresh buffer when reopen is set
+    bool takeOutput(std::string& out, bool reopen) {
+        uint8_t* data = nullptr;
+        int size = avio_close_dyn_buf(mFormat->pb, &data);
+        mFormat->pb = nullptr;
+        out.append(reinterpret_cast<const char*>(data), size);
+        av_free(data);
+        return !reopen || avio_open_dyn_buf(&mFormat->pb) >= 0;
+    }
+
+    void close() {
+        if (mFormat) {
+            std::string discarded;
+            if (mFormat->pb) {
+                takeOutput(discarded, false);
+            }
+            avformat_free_context(mFormat);
+            mFormat = nullptr;
+        }
+        avcodec_free_context(&mVideo);
+        avcodec_free_context(&mAudio);
+        av_frame_free(&mFrame);
+        av_packet_free(&mPacket);
+    }
+
+    AVFormatContext* mFormat{nullptr};
+    AVCodecContext* mVideo{nullptr};
+    AVCodecContext* mAudio{nullptr};
+    AVFrame* mFrame{nullptr};
+    AVPacket* mPacket{nullptr};
+    int64_t mVideoFrames{0};
+    int64_t mAudioSamples{0};
+    int mAudioTracks{1};
+    std::vector<int64_t> mPackets;
+};
+
+// A finished synthetic clip of durationUs
+bool makeClip(int64_t durationUs, int gopFrames, std::string& out) {
+    SyntheticStream stream;
+    return stream.open(gopFrames) && stream.encodeUntil(durationUs, out) &&
+           stream.finish(out);
+}
+
+// Every video frame of path in display order as its timestamp in
+// microseconds and its luma plane, decoded from the start without seeking
+bool decodeVideo(const std::string& path,
+                 std::vector<std::pair<int64_t, std::string>>& frames) {
+    AVFormatContext* format = nullptr;
+    if (avformat_open_input(&format, path.c_str(), nullptr, nullptr) < 0) {
+        return false;
+    }
+    AVCodecContext* codec = nullptr;
+    AVPacket* packet = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+    int streamIndex = -1;
+    bool ok = packet && frame &&
+              avformat_find_stream_info(format, nullptr) >= 0;
+    if (ok) {
+        streamIndex = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1,
+                                          nullptr, 0);
+        ok = streamIndex >= 0;
+    }
+    if (ok) {
+        AVCodecParameters* params = format->streams[streamIndex]->codecpar;
+        const AVCodec* decoder = avcodec_find_decoder(params->codec_id);
+        codec = decoder ? avcodec_alloc_context3(decoder) : nullptr;
+        ok = codec && avcodec_parameters_to_context(codec, params) >= 0 &&
+             avcodec_open2(codec, decoder, nullptr) >= 0;
+    }
+    while (ok) {
+        // The end of the input flushes the decoder with a null packet
+        bool draining = av_read_frame(format, packet) < 0;
+        if (!draining && packet->stream_index != streamIndex) {
+            av_packet_unref(packet);
+            continue;
+        }
+        // Errors on the packets before the first keyframe are expected
+        avcodec_send_packet(codec, draining ? nullptr : packet);
+        av_packet_unref(packet);
+        while (avcodec_receive_frame(codec, frame) >= 0) {
+            std::string luma;
+            for (int y = 0; y < frame->height; y++) {
+                luma.append(reinterpret_cast<const char*>(frame->data[0]) +
+                                y * frame->linesize[0],
+                            frame->width);
+            }
+            frames.emplace_back(
+                av_rescale_q(frame->best_effort_timestamp,
+                             format->streams[streamIndex]->time_base,
+                             AV_TIME_BASE_Q),
+                std::move(luma));
+        }
+        if (draining) {
+            break;
+        }
+    }
+    avcodec_free_context(&codec);
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    avformat_close_input(&format);
+    return ok && !frames.empty();
+}
+
+class CheckCallback : public PlayerCallback {
+   public:
+    void onPlayerStateChanged(PlayerState state) override {}
+    void onPlaybackProgress(double position, double duration) override {}
+    void onError(const Error& error) override {
+        fprintf(stderr, "player error %d: %s\n",
+                static_cast<int>(error.code), error.message.c_str());
+    }
+    void onMediaInfo(const MediaInfo& info) override {}
+    void onVideoFrame(VideoFrame& frame) override {}
+    void onAudioFrame(AudioFrame& frame) override {}
+    void onFirstFrameRendered(int64_t timeToFirstFrameUs) override {}
+};
+
+// A realtime player on null renderers
+std::shared_ptr<Player> makePlayer(const std::shared_ptr<Logger>& logger) {
+    auto player = std::make_shared<Player>(
+        std::make_shared<CheckCallback>(),
+        std::make_shared<NullAudioRenderer>(true),
+        std::make_shared<NullVideoRenderer>(), logger);
+    player->setLogLevel(getenv("YFFCHECK_VERBOSE") ? LogLevel::Verbose
+                                                   : LogLevel::Warning);
+    player->setClockMode(ClockMode::REALTIME);
+    return player;
+}
+
+void sleepMs(int64_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// Live MPEG-TS paced by the wall clock. Each connection starts backlogUs
+// behind the live edge and gets that backlog at once, like a server that
+// starts clients at an older segment.
+LoopbackServer::LiveSource makeLiveSource(int64_t backlogUs, int gopFrames) {
+    return [backlogUs, gopFrames]() -> LoopbackServer::LiveGenerator {
+        auto stream = std::make_shared<SyntheticStream>();
+        bool opened = stream->open(gopFrames);
+        auto begin = std::chrono::steady_clock::now();
+        return [stream, opened, begin, backlogUs](std::string& chunk) {
+            if (!opened) {
+                return false;
+            }
+            int64_t edgeUs =
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - begin)
+                    .count() +
+                backlogUs;
+            if (stream->positionUs() >= edgeUs) {
+                sleepMs(10);
+                return true;
+            }
+            return stream->encodeUntil(edgeUs, chunk);
+        };
+    };
+}
+
+// Plays url on a low-latency live player and samples getLiveStats()
+// every 100 ms for playUs
+struct LiveRun {
+    int64_t samples{0};
+    float maxSpeed{1.0f};
+    int64_t maxLatencyUs{-1};
+    int64_t firstJumpPositionUs{-1};
+    LiveStats last;
+    int64_t positionUs{0};
+    PlayerState state{PlayerState::IDLE};
+};
+
+bool playLive(const std::string& url, const LiveConfig& config,
+              int64_t playUs, const std::shared_ptr<Logger>& logger,
+              LiveRun& run) {
+    std::shared_ptr<Player> player = makePlayer(logger);
+    player->setLiveConfig(config);
+    if (!player->open(url) || !player->start()) {
+        return false;
+    }
+    for (int64_t elapsed = 0; elapsed < playUs; elapsed += 100000) {
+        sleepMs(100);
+        LiveStats stats = player->getLiveStats();
+        if (stats.latencyUs >= 0) {
+            run.samples++;
+            run.maxSpeed = std::max(run.maxSpeed, stats.playbackSpeed);
+            run.maxLatencyUs = std::max(run.maxLatencyUs, stats.latencyUs);
+        }
+        if (stats.jumpCount > 0 && run.firstJumpPositionUs < 0) {
+            run.firstJumpPositionUs = player->getCurrentPosition();
+        }
+        run.last = stats;
+    }
+    run.positionUs = player->getCurrentPosition();
+    run.state = player->getState();
+    player->stop();
+    player->close();
+    return true;
+}
+
+// Read a CachedIO from the start to the end of its input
+bool readAll(CachedIO& io, std::string& out) {
+    out.clear();
+    std::vector<uint8_t> buffer(64 * 1024);
+    while (true) {
+        int ret = io.read(buffer.data(), static_cast<int>(buffer.size()));
+        if (ret == AVERROR_EOF || ret == 0) {
+            return true;
+        }
+        if (ret < 0) {
+            return false;
+        }
+        out.append(reinterpret_cast<const char*>(buffer.data()), ret);
+    }
+}
+
+bool checkDiskCache() {
+    constexpr size_t kSize = 4 * 1024 * 1024;
+    std::string body = pseudoRandomBytes(kSize, 1);
+    LoopbackServer server;
+    CHECK(server.start(), "cannot listen on a loopback port");
+    server.setResource(body, "\"v1\"");
+    std::string url = server.url("/clip.bin");
+    std::string directory = makeTempDir();
+    CHECK(!directory.empty(), "cannot create a cache directory");
+    auto logger = std::make_shared<StderrLogger>();
+    AVIOInterruptCB interrupt{nullptr, nullptr};
+    std::string data;
+
+    // Cold: everything comes from the network and lands in the cache
+    {
+        CachedIO io(directory, 0, logger);
+        CHECK(io.open(url, interrupt), "cold open failed");
+        CHECK(readAll(io, data) && data == body, "cold read mismatch");
+        CHECK(io.getNetworkBytes() == (int64_t)kSize,
+              "cold read fetched %lld bytes",
+              (long long)io.getNetworkBytes());
+    }
+
+    // Warm: served from disk, only the opening request touches the wire
+    int64_t wireBefore = server.bodyBytesSent();
+    {
+        CachedIO io(directory, 0, logger);
+        CHECK(io.open(url, interrupt), "warm open failed");
+        CHECK(readAll(io, data) && data == body, "warm read mismatch");
+        CHECK(io.getNetworkBytes() == 0, "warm read fetched %lld bytes",
+              (long long)io.getNetworkBytes());
+        CHECK(io.getCachedBytes() == (int64_t)kSize,
+              "warm read served %lld cached bytes",
+              (long long)io.getCachedBytes());
+    }
+    int64_t warmWire = server.bodyBytesSent() - wireBefore;
+    printf("disk-cache     warm read %lld of %zu bytes on the wire\n",
+           (long long)warmWire, kSize);
+    CHECK(warmWire < (int64_t)kSize / 8, "warm read sent %lld bytes",
+          (long long)warmWire);
+
+    // Seek back: after reading ahead, rereading inside the cached ranges
+    // of a partial entry sends nothing more over the network. The wire
+    // count settles first, since the open connection keeps sending until
+    // the socket buffers fill.
+    {
+        std::string seekUrl = server.url("/seek.bin");
+        CachedIO io(directory, 0, logger);
+        CHECK(io.open(seekUrl, interrupt), "seek-back open failed");
+        std::vector<uint8_t> buffer(kSize / 2);
+        int filled = 0;
+        while (filled < (int)buffer.size()) {
+            int ret = io.read(buffer.data() + filled,
+                              (int)buffer.size() - filled);
+            CHECK(ret > 0, "read ahead stopped at %d bytes", filled);
+            filled += ret;
+        }
+        sleepMs(200);
+        int64_t networkBefore = io.getNetworkBytes();
+        int64_t wireBefore = server.bodyBytesSent();
+        constexpr int kChunk = kSize / 8;
+        for (int64_t offset : {int64_t{kChunk}, int64_t{0},
+                               int64_t{2 * kChunk}}) {
+            CHECK(io.seek(offset, SEEK_SET) == offset, "seek to %lld failed",
+                  (long long)offset);
+            filled = 0;
+            while (filled < kChunk) {
+                int ret = io.read(buffer.data() + filled, kChunk - filled);
+                CHECK(ret > 0, "reread at %lld stopped at %d bytes",
+                      (long long)offset, filled);
+                filled += ret;
+            }
+            CHECK(memcmp(buffer.data(), body.data() + offset, filled) == 0,
+                  "reread at %lld mismatch", (long long)offset);
+        }
+        int64_t seekWire = server.bodyBytesSent() - wireBefore;
+        printf("disk-cache     seek back %lld bytes on the wire\n",
+               (long long)seekWire);
+        CHECK(io.getNetworkBytes() == networkBefore,
+              "seeking back fetched %lld bytes",
+              (long long)(io.getNetworkBytes() - networkBefore));
+        CHECK(seekWire == 0, "seeking back sent %lld bytes",
+              (long long)seekWire);
+    }
+
+    // Concurrent: the second instance reads through without the entry
+    {
+        CachedIO first(directory, 0, logger);
+        CachedIO second(directory, 0, logger);
+        CHECK(first.open(url, interrupt) && second.open(url, interrupt),
+              "concurrent open failed");
+        std::string other;
+        CHECK(readAll(second, other) && other == body,
+              "concurrent uncached read mismatch");
+        CHECK(second.getNetworkBytes() == (int64_t)kSize,
+              "uncached instance fetched %lld bytes",
+              (long long)second.getNetworkBytes());
+        CHECK(readAll(first, data) && data == body,
+              "concurrent cached read mismatch");
+        CHECK(first.getNetworkBytes() == 0,
+              "owning instance fetched %lld bytes",
+              (long long)first.getNetworkBytes());
+    }
+
+    // Changed resource of the same length: the entry is invalidated
+    std::string changed = pseudoRandomBytes(kSize, 2);
+    server.setResource(changed, "\"v2\"");
+    {
+        CachedIO io(directory, 0, logger);
+        CHECK(io.open(url, interrupt), "reopen after change failed");
+        CHECK(readAll(io, data) && data == changed,
+              "stale cache served after the ETag changed");
+        CHECK(io.getNetworkBytes() == (int64_t)kSize,
+              "changed resource fetched %lld bytes",
+              (long long)io.getNetworkBytes());
+    }
+
+    server.stop();
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    return true;
+}
+
+bool checkMmapTruncate() {
+    constexpr size_t kSize = 1024 * 1024;
+    std::string directory = makeTempDir();
+    CHECK(!directory.empty(), "cannot create a temporary directory");
+    std::string path = directory + "/clip.bin";
+    std::string body = pseudoRandomBytes(kSize, 3);
+    FILE* file = fopen(path.c_str(), "wb");
+    CHECK(file && fwrite(body.data(), 1, kSize, file) == kSize,
+          "cannot write %s", path.c_str());
+    fclose(file);
+
+    auto logger = std::make_shared<StderrLogger>();
+    AVIOInterruptCB interrupt{nullptr, nullptr};
+    MmapIO io(logger);
+    CHECK(io.open(path, interrupt), "cannot map %s", path.c_str());
+    std::vector<uint8_t> buffer(kSize / 4);
+    CHECK(io.read(buffer.data(), (int)buffer.size()) == (int)buffer.size(),
+          "first read came up short");
+
+    // Cut the file inside the range not read yet; touching the dropped
+    // pages through the mapping would kill the process
+    CHECK(truncate(path.c_str(), kSize / 2) == 0, "cannot truncate %s",
+          path.c_str());
+    int64_t total = buffer.size();
+    while (true) {
+        int ret = io.read(buffer.data(), (int)buffer.size());
+        if (ret <= 0) {
+            CHECK(ret == AVERROR_EOF, "read after truncation failed: %d",
+                  ret);
+            break;
+        }
+        CHECK(memcmp(buffer.data(), body.data() + total, ret) == 0,
+              "data at %lld changed", (long long)total);
+        total += ret;
+    }
+    printf("mmap-truncate  read %lld of %zu bytes after truncating to %zu\n",
+           (long long)total, kSize, kSize / 2);
+    CHECK(total == (int64_t)kSize / 2, "read %lld bytes", (long long)total);
+
+    io.close();
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    return true;
+}
+
+bool checkThrottledHttp() {
+    constexpr int64_t kClipUs = 30000000;
+    std::string clip;
+    CHECK(makeClip(kClipUs, SyntheticStream::kFps, clip),
+          "cannot encode the synthetic clip");
+    int64_t clipRate = static_cast<int64_t>(clip.size()) * 1000000 / kClipUs;
+    LoopbackServer server;
+    CHECK(server.start(), "cannot listen on a loopback port");
+    server.setResource(clip, "\"clip\"");
+    std::string url = server.url("/clip.ts");
+    auto logger = std::make_shared<StderrLogger>();
+
+    // Plays for playUs with the input served at rateNum / rateDen of the
+    // clip's bitrate
+    auto play = [&](int64_t rateNum, int64_t rateDen, int64_t playUs,
+                    RebufferStats& stats, int64_t& positionUs) {
+        server.setRate(clipRate * rateNum / rateDen);
+        std::shared_ptr<Player> player = makePlayer(logger);
+        if (!player->open(url) || !player->start()) {
+            return false;
+        }
+        sleepMs(playUs / 1000);
+        stats = player->getRebufferStats();
+        positionUs = player->getCurrentPosition();
+        player->stop();
+        player->close();
+        return true;
+    };
+    RebufferStats stats;
+    int64_t positionUs = 0;
+
+    // Faster than realtime: playback begins after the preroll, far below
+    // the low watermark, and must not stall right away
+    CHECK(play(3, 2, 6000000, stats, positionUs), "cannot play %s",
+          url.c_str());
+    printf("throttled-http 1.5x: %d stalls, position %.1f s\n",
+           stats.rebufferCount, positionUs / 1e6);
+    CHECK(stats.rebufferCount == 0, "%d stalls at 1.5x realtime",
+          stats.rebufferCount);
+    CHECK(positionUs >= 4000000, "played %lld us in 6 s",
+          (long long)positionUs);
+
+    // Slower than realtime: the buffer runs dry once, then the adapted
+    // watermarks hold enough to play through the rest of the run
+    CHECK(play(4, 5, 8000000, stats, positionUs), "cannot play %s",
+          url.c_str());
+    printf("throttled-http 0.8x: %d stalls, position %.1f s, "
+           "watermarks %.1f-%.1f s\n",
+           stats.rebufferCount, positionUs / 1e6, stats.lowWatermarkUs / 1e6,
+           stats.highWatermarkUs / 1e6);
+    CHECK(stats.rebufferCount >= 1 && stats.rebufferCount <= 2,
+          "%d stalls at 0.8x realtime", stats.rebufferCount);
+    CHECK(positionUs >= 2000000, "played %lld us in 8 s",
+          (long long)positionUs);
+
+    server.stop();
+    return true;
+}
+
+bool checkLiveCatchup() {
+    LoopbackServer server;
+    CHECK(server.start(), "cannot listen on a loopback port");
+    server.setLiveSource(makeLiveSource(3000000, SyntheticStream::kFps));
+    std::string url = server.url("/live.ts");
+    auto logger = std::make_shared<StderrLogger>();
+
+    // The live queues hold well under a second, so a target below that
+    // keeps the player behind it for the whole run
+    LiveConfig config;
+    config.lowLatency = true;
+    config.targetLatencyUs = 200000;
+    config.jumpThresholdUs = 0;
+    LiveRun run;
+    CHECK(playLive(url, config, 6000000, logger, run), "cannot play %s",
+          url.c_str());
+    server.stop();
+    printf("live-catchup   %lld samples, latency up to %.2f s, speed up to "
+           "%.3f, position %.1f s\n",
+           (long long)run.samples, run.maxLatencyUs / 1e6, run.maxSpeed,
+           run.positionUs / 1e6);
+    CHECK(run.last.active, "low-latency mode inactive on a live input");
+    CHECK(run.samples > 0, "latency never measured");
+    CHECK(run.maxLatencyUs > config.targetLatencyUs,
+          "latency %lld us never above the target",
+          (long long)run.maxLatencyUs);
+    CHECK(run.maxSpeed > 1.0f, "no catch-up above realtime speed");
+    CHECK(run.last.jumpCount == 0, "%lld jumps with jumping disabled",
+          (long long)run.last.jumpCount);
+    CHECK(run.state == PlayerState::STARTED, "player stalled in state %d",
+          static_cast<int>(run.state));
+    return true;
+}
+
+bool checkLiveJump() {
+    LoopbackServer server;
+    CHECK(server.start(), "cannot listen on a loopback port");
+    server.setLiveSource(makeLiveSource(3000000, SyntheticStream::kFps / 2));
+    std::string url = server.url("/live.ts");
+    auto logger = std::make_shared<StderrLogger>();
+
+    // A threshold below the queued latency: the player skips to the
+    // newest keyframe and must keep playing after it
+    LiveConfig config;
+    config.lowLatency = true;
+    config.targetLatencyUs = 100000;
+    config.jumpThresholdUs = 400000;
+    LiveRun run;
+    CHECK(playLive(url, config, 6000000, logger, run), "cannot play %s",
+          url.c_str());
+    server.stop();
+    printf("live-jump      %lld jumps, latency up to %.2f s, position "
+           "%.1f s (%.1f s at the first jump)\n",
+           (long long)run.last.jumpCount, run.maxLatencyUs / 1e6,
+           run.positionUs / 1e6, run.firstJumpPositionUs / 1e6);
+    CHECK(run.last.active, "low-latency mode inactive on a live input");
+    CHECK(run.last.jumpCount >= 1, "no jump with latency up to %lld us",
+          (long long)run.maxLatencyUs);
+    CHECK(run.positionUs > run.firstJumpPositionUs + 1000000,
+          "playback did not continue after the jump: %lld -> %lld us",
+          (long long)run.firstJumpPositionUs, (long long)run.positionUs);
+    return true;
+}
+
+bool checkTimeshift() {
+    LoopbackServer server;
+    CHECK(server.start(), "cannot listen on a loopback port");
+    server.setLiveSource(makeLiveSource(0, SyntheticStream::kFps / 2));
+    std::string url = server.url("/live.ts");
+    auto logger = std::make_shared<StderrLogger>();
+
+    constexpr int64_t kWindowUs = 6000000;
+    std::shared_ptr<Player> player = makePlayer(logger);
+    TimeshiftConfig config;
+    config.enabled = true;
+    config.maxDurationUs = kWindowUs;
+    player->setTimeshiftConfig(config);
+    CHECK(player->open(url) && player->start(), "cannot play %s",
+          url.c_str());
+
+    // The window fills with the stream and then slides with it
+    sleepMs(8000);
+    int64_t startUs = 0;
+    int64_t endUs = 0;
+    CHECK(player->getTimeshiftRange(startUs, endUs),
+          "no timeshift window on a live input");
+    printf("timeshift      window %.2f s after 8 s\n",
+           (endUs - startUs) / 1e6);
+    CHECK(endUs - startUs >= kWindowUs / 2 && endUs - startUs <= kWindowUs,
+          "window of %lld us, limit %lld us", (long long)(endUs - startUs),
+          (long long)kWindowUs);
+
+    CHECK(!player->seekTimeshift(startUs - 1000000),
+          "seek before the window accepted");
+
+    // Rewind near the start of the window; playback then stays that far
+    // behind the edge
+    int64_t targetUs = startUs + 1000000;
+    CHECK(player->seekTimeshift(targetUs), "seek to %lld us rejected",
+          (long long)targetUs);
+    sleepMs(1500);
+    int64_t positionUs = player->getCurrentPosition();
+    CHECK(player->getTimeshiftRange(startUs, endUs), "window lost");
+    int64_t rewoundLagUs = endUs - positionUs;
+    printf("timeshift      %.2f s behind the edge after rewinding\n",
+           rewoundLagUs / 1e6);
+    CHECK(positionUs >= targetUs - 1000000 && positionUs <= targetUs + 2500000,
+          "position %lld us after seeking to %lld us",
+          (long long)positionUs, (long long)targetUs);
+
+    // Back to live; the player buffers up to the high watermark at the
+    // edge, so it ends up that far behind rather than at it
+    CHECK(player->seekToLive(), "seek to live rejected");
+    sleepMs(3000);
+    positionUs = player->getCurrentPosition();
+    CHECK(player->getTimeshiftRange(startUs, endUs), "window lost");
+    int64_t liveLagUs = endUs - positionUs;
+    printf("timeshift      %.2f s behind the edge after seekToLive()\n",
+           liveLagUs / 1e6);
+    CHECK(liveLagUs < rewoundLagUs - 1500000,
+          "%lld us behind the edge after seekToLive(), %lld us rewound",
+          (long long)liveLagUs, (long long)rewoundLagUs);
+
+    player->stop();
+    player->close();
+    server.stop();
+    return true;
+}
+
+bool checkTracks() {
+    constexpr int64_t kClipUs = 4000000;
+    constexpr int kAudioTracks = 3;
+    SyntheticStream stream;
+    std::string clip;
+    CHECK(stream.open(SyntheticStream::kFps, kAudioTracks) &&
+              stream.encodeUntil(kClipUs, clip) && stream.finish(clip),
+          "cannot encode the synthetic clip");
+    int64_t videoPackets = stream.packetsMuxed(0);
+    int64_t audioPackets = stream.packetsMuxed(1);
+    LoopbackServer server;
+    CHECK(server.start(), "cannot listen on a loopback port");
+    server.setResource(clip, "\"tracks\"");
+    std::string url = server.url("/tracks.ts");
+    auto logger = std::make_shared<StderrLogger>();
+
+    // The selected audio track; streamIndex -1 unless exactly one is
+    auto selectedAudio = [](const std::shared_ptr<Player>& player,
+                            int& audioTracks) {
+        TrackInfo selected;
+        int selectedCount = 0;
+        audioTracks = 0;
+        for (const TrackInfo& track : player->getTracks()) {
+            if (track.type == MediaType::AUDIO) {
+                audioTracks++;
+                if (track.selected) {
+                    selected = track;
+                    selectedCount++;
+                }
+            }
+        }
+        return selectedCount == 1 ? selected : TrackInfo();
+    };
+    auto waitForState = [](const std::shared_ptr<Player>& player,
+                           PlayerState state, int64_t timeoutUs) {
+        for (int64_t elapsed = 0;
+             player->getState() != state && elapsed < timeoutUs;
+             elapsed += 50000) {
+            sleepMs(50);
+        }
+        return player->getState() == state;
+    };
+
+    // The language preference picks the second track. The demuxer
+    // discards the other two, so a full playback reads fewer packets than
+    // the clip minus one audio track. FAST_START keeps the packets read
+    // while probing, before the discard applies, out of the count.
+    TrackPreferences preferences;
+    preferences.audioLanguage = SyntheticStream::kLanguages[1];
+    std::shared_ptr<Player> player = makePlayer(logger);
+    player->setTrackPreferences(preferences);
+    player->setOpenProfile(OpenProfile::FAST_START);
+    CHECK(player->open(url), "cannot open %s", url.c_str());
+    int audioTracks = 0;
+    TrackInfo audio = selectedAudio(player, audioTracks);
+    CHECK(audioTracks == kAudioTracks, "%d audio tracks, muxed %d",
+          audioTracks, kAudioTracks);
+    CHECK(audio.language == preferences.audioLanguage,
+          "selected audio track %d in \"%s\", preferred \"%s\"",
+          audio.streamIndex, audio.language.c_str(),
+          preferences.audioLanguage.c_str());
+    CHECK(player->start(), "cannot play %s", url.c_str());
+    CHECK(waitForState(player, PlayerState::COMPLETED, 3 * kClipUs),
+          "playback not completed, state %d",
+          static_cast<int>(player->getState()));
+    PlayerStats stats = player->getStats();
+    player->stop();
+    player->close();
+    printf("tracks         demuxed %lld of %lld packets with %d audio "
+           "tracks\n",
+           (long long)stats.demux.items,
+           (long long)(videoPackets + kAudioTracks * audioPackets),
+           kAudioTracks);
+    CHECK(stats.demux.items < videoPackets + 2 * audioPackets,
+          "demuxed %lld packets, %lld video and %lld per audio track",
+          (long long)stats.demux.items, (long long)videoPackets,
+          (long long)audioPackets);
+
+    // Switching the audio track mid-play keeps playing from about the
+    // same position, and the new track is the only one selected
+    player = makePlayer(logger);
+    CHECK(player->open(url) && player->start(), "cannot play %s",
+          url.c_str());
+    sleepMs(1000);
+    audio = selectedAudio(player, audioTracks);
+    int target = audio.streamIndex % kAudioTracks + 1;
+    int64_t switchUs = player->getCurrentPosition();
+    int64_t renderedBefore = player->getStats().audioFramesRendered;
+    CHECK(player->selectTrack(target), "cannot switch to audio track %d",
+          target);
+    audio = selectedAudio(player, audioTracks);
+    CHECK(audio.streamIndex == target, "selected audio track %d after "
+          "switching to %d", audio.streamIndex, target);
+    sleepMs(1000);
+    int64_t positionUs = player->getCurrentPosition();
+    stats = player->getStats();
+    PlayerState state = player->getState();
+    player->stop();
+    player->close();
+    server.stop();
+    printf("tracks         switched to track %d at %.2f s, position %.2f s "
+           "after 1 s\n",
+           target, switchUs / 1e6, positionUs / 1e6);
+    CHECK(state == PlayerState::STARTED, "state %d after the switch",
+          static_cast<int>(state));
+    CHECK(positionUs >= switchUs + 500000,
+          "position %lld us a second after switching at %lld us",
+          (long long)positionUs, (long long)switchUs);
+    CHECK(stats.audioFramesRendered > renderedBefore,
+          "no audio rendered after the switch");
+    return true;
+}
+
+bool checkSeekStorm() {
+    constexpr int64_t kClipUs = 10000000;
+    std::string clip;
+    CHECK(makeClip(kClipUs, SyntheticStream::kFps, clip),
+          "cannot encode the synthetic clip");
+    LoopbackServer server;
+    CHECK(server.start(), "cannot listen on a loopback port");
+    server.setResource(clip, "\"seek\"");
+    std::string url = server.url("/seek.ts");
+    auto logger = std::make_shared<StderrLogger>();
+
+    std::shared_ptr<Player> player = makePlayer(logger);
+    CHECK(player->open(url) && player->start(), "cannot play %s",
+          url.c_str());
+    sleepMs(500);
+
+    // A burst of seeks back and forth over the clip, faster than the
+    // demuxer can act on them: all but the last are replaced, playback
+    // continues from the last target, and no frame decoded for an
+    // earlier position reaches the renderers
+    constexpr int kSeeks = 30;
+    constexpr int64_t kTargetUs = 6000000;
+    for (int i = 0; i < kSeeks - 1; i++) {
+        CHECK(player->seek((i * 7 % 10) * 1000000), "seek %d rejected", i);
+    }
+    CHECK(player->seek(kTargetUs), "last seek rejected");
+    sleepMs(1000);
+    int64_t positionUs = player->getCurrentPosition();
+    PlayerStats stats = player->getStats();
+    PlayerState state = player->getState();
+    player->stop();
+    player->close();
+    server.stop();
+    printf("seek-storm     %lld seeks, %lld coalesced, %lld stale frames "
+           "shown, position %.2f s after seeking to %.2f s\n",
+           (long long)stats.seeks, (long long)stats.seeksCoalesced,
+           (long long)stats.staleFramesShown, positionUs / 1e6,
+           kTargetUs / 1e6);
+    CHECK(stats.seeks == kSeeks, "%lld seeks counted",
+          (long long)stats.seeks);
+    CHECK(stats.seeksCoalesced > 0, "no seek of the burst coalesced");
+    CHECK(stats.staleFramesShown == 0, "%lld stale frames shown",
+          (long long)stats.staleFramesShown);
+    CHECK(state == PlayerState::STARTED, "state %d after the seeks",
+          static_cast<int>(state));
+    CHECK(positionUs >= kTargetUs - 1000000 &&
+              positionUs <= kTargetUs + 2000000,
+          "position %lld us a second after seeking to %lld us",
+          (long long)positionUs, (long long)kTargetUs);
+    return true;
+}
+
+bool checkScrub() {
+    // The cache is bounded by bytes and evicts the least recently used
+    // frames first, as many as a larger frame needs
+    auto makeFrame = [](int width) {
+        return FrameScaler::allocFrame(width, 64, PixelFormat::YUV420P);
+    };
+    int64_t frameBytes = KeyframeCache::frameBytes(*makeFrame(64));
+    KeyframeCache cache(3 * frameBytes);
+    for (int64_t key = 0; key < 3; key++) {
+        cache.insert(key, makeFrame(64));
+    }
+    CHECK(cache.find(0), "frame 0 missing below the limit");
+    cache.insert(3, makeFrame(64));
+    CHECK(cache.getCount() == 3 && cache.getSize() == 3 * frameBytes,
+          "%zu frames of %lld bytes cached, limit %lld", cache.getCount(),
+          (long long)cache.getSize(), (long long)(3 * frameBytes));
+    CHECK(!cache.find(1), "least recently used frame 1 kept");
+    CHECK(cache.find(0) && cache.find(2) && cache.find(3),
+          "recently used frames evicted");
+    cache.insert(4, makeFrame(128));
+    CHECK(!cache.find(0) && !cache.find(2) && cache.find(3) &&
+              cache.find(4),
+          "a double-size frame kept %zu frames of %lld bytes",
+          cache.getCount(), (long long)cache.getSize());
+
+    constexpr int64_t kClipUs = 10000000;
+    std::string clip;
+    CHECK(makeClip(kClipUs, SyntheticStream::kFps, clip),
+          "cannot encode the synthetic clip");
+    LoopbackServer server;
+    CHECK(server.start(), "cannot listen on a loopback port");
+    server.setResource(clip, "\"scrub\"");
+    std::string url = server.url("/scrub.ts");
+    auto logger = std::make_shared<StderrLogger>();
+
+    std::shared_ptr<Player> player = makePlayer(logger);
+    CHECK(player->open(url) && player->start(), "cannot play %s",
+          url.c_str());
+    sleepMs(300);
+    CHECK(player->beginScrub(), "beginScrub() rejected");
+
+    // Waits for the preview of each position, one keyframe apart, so
+    // none of them coalesce
+    const std::vector<int64_t> positionsUs = {1500000, 3500000, 5500000,
+                                              7500000};
+    auto sweep = [&](bool reverse) {
+        for (size_t i = 0; i < positionsUs.size(); i++) {
+            int64_t positionUs =
+                positionsUs[reverse ? positionsUs.size() - 1 - i : i];
+            int64_t frames = player->getStats().scrubFrames;
+            if (!player->scrub(positionUs)) {
+                return false;
+            }
+            for (int waitedMs = 0;
+                 player->getStats().scrubFrames == frames; waitedMs += 10) {
+                if (waitedMs >= 3000) {
+                    return false;
+                }
+                sleepMs(10);
+            }
+        }
+        return true;
+    };
+    CHECK(sweep(false), "no preview frame within 3 s");
+    PlayerStats first = player->getStats();
+    CHECK(sweep(true), "no preview frame within 3 s on the way back");
+    PlayerStats second = player->getStats();
+    CHECK(player->endScrub(4000000), "endScrub() rejected");
+    sleepMs(500);
+    PlayerState state = player->getState();
+    player->stop();
+    player->close();
+    server.stop();
+
+    // The way back shows the keyframes decoded on the way out
+    int64_t hits = second.scrubCacheHits - first.scrubCacheHits;
+    printf("scrub          %lld frames, %lld of %zu repeated ones from the "
+           "cache, latency p50 %lld us\n",
+           (long long)second.scrubFrames, (long long)hits,
+           positionsUs.size(), (long long)second.scrubLatencyUs.p50Us);
+    CHECK(first.scrubCacheHits == 0, "%lld cache hits on the first sweep",
+          (long long)first.scrubCacheHits);
+    CHECK(hits == (int64_t)positionsUs.size(),
+          "%lld of %zu repeated keyframes served from the cache",
+          (long long)hits, positionsUs.size());
+    CHECK(state == PlayerState::STARTED, "state %d after endScrub()",
+          static_cast<int>(state));
+    return true;
+}
+
+bool checkFrameAt() {
+    constexpr int64_t kClipUs = 10000000;
+    std::string clip;
+    CHECK(makeClip(kClipUs, SyntheticStream::kFps, clip),
+          "cannot encode the synthetic clip");
+    std::string directory = makeTempDir();
+    CHECK(!directory.empty(), "cannot create a temporary directory");
+    std::string path = directory + "/clip.ts";
+    FILE* file = fopen(path.c_str(), "wb");
+    CHECK(file && fwrite(clip.data(), 1, clip.size(), file) == clip.size(),
+          "cannot write %s", path.c_str());
+    fclose(file);
+
+    // The reference: the last frame starting at or before each time in a
+    // decode from the start, which a precise seek must reproduce
+    std::vector<std::pair<int64_t, std::string>> frames;
+    CHECK(decodeVideo(path, frames), "cannot decode %s", path.c_str());
+    std::sort(frames.begin(), frames.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    // Three groups of times one keyframe interval or more apart, inside a
+    // GOP each and off frame boundaries, requested in reverse order
+    const std::vector<std::vector<int64_t>> groupsMs = {
+        {210, 510, 930}, {4210, 4630}, {8310, 8850}};
+    std::vector<int64_t> timestampsUs;
+    int64_t decodeBound = 0;
+    for (const std::vector<int64_t>& group : groupsMs) {
+        for (int64_t ms : group) {
+            timestampsUs.push_back(frames.front().first + ms * 1000);
+        }
+        // Frames from the first time of the group through one past the
+        // last
+        decodeBound += (group.back() - group.front()) *
+                           SyntheticStream::kFps / 1000 + 2;
+    }
+    std::reverse(timestampsUs.begin(), timestampsUs.end());
+
+    ExtractConfig config;
+    config.maxWidth = SyntheticStream::kWidth;
+    config.format = PixelFormat::YUV420P;
+    config.workers = 2;
+    auto logger = std::make_shared<StderrLogger>();
+    FrameExtractor extractor(logger);
+    std::vector<std::shared_ptr<VideoFrame>> extracted =
+        extractor.extract(path, timestampsUs, config);
+    ExtractStats stats = extractor.getLastStats();
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+
+    printf("frame-at       %lld of %lld frames in %lld segments, %lld "
+           "decoded\n",
+           (long long)stats.extracted, (long long)stats.requested,
+           (long long)stats.segments, (long long)stats.framesDecoded);
+    CHECK(extracted.size() == timestampsUs.size(), "%zu results for %zu "
+          "times", extracted.size(), timestampsUs.size());
+    for (size_t i = 0; i < timestampsUs.size(); i++) {
+        int64_t timestampUs = timestampsUs[i];
+        auto expected = std::upper_bound(
+            frames.begin(), frames.end(), timestampUs,
+            [](int64_t t, const auto& frame) { return t < frame.first; });
+        CHECK(expected != frames.begin(), "no reference frame at %lld us",
+              (long long)timestampUs);
+        --expected;
+        const std::shared_ptr<VideoFrame>& frame = extracted[i];
+        CHECK(frame, "no frame extracted at %lld us", (long long)timestampUs);
+        CHECK(frame->pts == expected->first,
+              "frame at %lld us has pts %lld, precise seek shows %lld",
+              (long long)timestampUs, (long long)frame->pts,
+              (long long)expected->first);
+        CHECK(frame->width == SyntheticStream::kWidth &&
+                  frame->height == SyntheticStream::kHeight,
+              "frame at %lld us is %dx%d", (long long)timestampUs,
+              frame->width, frame->height);
+        int64_t difference = 0;
+        for (int y = 0; y < frame->height; y++) {
+            const uint8_t* row = frame->data[0] + y * frame->linesize[0];
+            for (int x = 0; x < frame->width; x++) {
+                difference += std::abs(
+                    row[x] - static_cast<uint8_t>(
+                                 expected->second[y * frame->width + x]));
+            }
+        }
+        double meanDifference =
+            static_cast<double>(difference) / (frame->width * frame->height);
+        CHECK(meanDifference < 1.0,
+              "frame at %lld us differs from the reference by %.2f per "
+              "pixel",
+              (long long)timestampUs, meanDifference);
+    }
+    CHECK(stats.segments == (int64_t)groupsMs.size(),
+          "%lld seeks for %zu groups", (long long)stats.segments,
+          groupsMs.size());
+    CHECK(stats.framesDecoded <= decodeBound,
+          "%lld frames decoded, the groups span %lld",
+          (long long)stats.framesDecoded, (long long)decodeBound);
+    return true;
+}
+
+struct Check {
+    const char* name;
+    bool (*run)();
+};
+
+const Check kChecks[] = {
+    {"disk-cache", checkDiskCache},
+    {"mmap-truncate", checkMmapTruncate},
+    {"throttled-http", checkThrottledHttp},
+    {"live-catchup", checkLiveCatchup},
+    {"live-jump", checkLiveJump},
+    {"timeshift", checkTimeshift},
+    {"tracks", checkTracks},
+    {"seek-storm", checkSeekStorm},
+    {"scrub", checkScrub},
+    {"frame-at", checkFrameAt},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    avformat_network_init();
+    if (argc != 2) {
+        fprintf(stderr, "usage: yffcheck <check>\n");
+        for (const Check& check : kChecks) {
+            fprintf(stderr, "  %s\n", check.name);
+        }
+        return 2;
+    }
+    for (const Check& check : kChecks) {
+        if (strcmp(argv[1], check.name) == 0) {
+            bool passed = check.run();
+            printf("%-14s %s\n", check.name, passed ? "passed" : "FAILED");
+            return passed ? 0 : 1;
+        }
+    }
+    fprintf(stderr, "unknown check: %s\n", argv[1]);
+    return 2;
+}